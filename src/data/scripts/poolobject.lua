@@ -16,6 +16,15 @@ setmetatable(PoolObject, {
 -- go = GameObjectManager:createGameObject("enemy" .. self.uniqueIdentifier)
 -- go.render = go:createRenderComponent()
 -- self.go = go
+--
+-- Pools of game objects that only differ in their state are better off in a GameObjectPool,
+-- which can also grow during runtime:
+-- enemies = GameObjectManager:createGameObjectPool("enemy", 20, function(go)
+--     go.render = go:createRenderComponent()
+--     go.render:setPath("data/models/enemy.thModel")
+-- end)
+-- go = enemies:acquire()
+-- enemies:release(go)
 function PoolObject:create()
     logMessage("CREATED".. self.uniqueIdentifier)
 end
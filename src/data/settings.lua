@@ -33,6 +33,19 @@ Settings:load{
 		-- Note: The path needs to end with a slash/
 		-- Default: "data/scripts/"
 		userScriptsRoot = "data/scripts/",
+
+		-- Time the Lua garbage collector may spend per frame, in milliseconds.
+		-- Default: 1.0
+		garbageCollectionBudgetMs = 1.0,
+
+		-- When the scripts produce garbage faster than it is collected,
+		-- the budget grows up to this many milliseconds per frame.
+		-- Default: 4.0
+		maxGarbageCollectionBudgetMs = 4.0,
+
+		-- Use the generational garbage collector of Lua instead of the incremental one.
+		-- Default: false
+		generationalGarbageCollection = false,
 	},
 
 	-- Settings about video and the renderer
@@ -65,6 +78,55 @@ Settings:load{
 		clearColor = Color(0.9, 0.9, 0.9, 1.0),
 	},
 
+	-- Settings about the task queue which runs work in parallel.
+	taskQueue = {
+		-- Number of worker threads, including the game thread.
+		-- Default: 0 -> one worker per hardware thread
+		numWorkers = 0,
+
+		-- Restricts each worker thread to its own core.
+		-- Default: false
+		pinWorkersToCores = false,
+	},
+
+	-- Settings about loading resources.
+	resources = {
+		-- Number of threads which load resources in the background.
+		-- Use 1 if a resource loader is not thread safe.
+		-- Default: 2
+		numLoaderThreads = 2,
+
+		-- Time the renderer may spend per frame finalizing (uploading) loaded resources, in milliseconds.
+		-- Resources loaded with critical priority ignore the budget. 0 means unlimited.
+		-- Default: 2.0
+		finalizeBudgetMs = 2.0,
+
+		-- Number of bytes which may be finalized per frame. 0 means unlimited.
+		-- Default: 16 MB
+		finalizeBudgetBytes = 16 * 1024 * 1024,
+
+		-- Files with the same content are loaded only once, all loads share the resource.
+		-- Default: true
+		shareIdenticalResources = true,
+
+		-- Directory where converted resources (e.g. compiled shaders) are cached, so the next start
+		-- does not have to convert them again. Relative to the working directory, "" disables the cache.
+		-- Default: "cache"
+		cacheDirectory = "cache",
+	},
+
+	-- Settings about the log system.
+	logging = {
+		-- Logging a message only copies its arguments, the log thread formats them.
+		-- Default: false
+		deferredFormatting = false,
+
+		-- With deferred formatting, the messages are also written unformatted into this binary file.
+		-- Use the logdecoder to turn it into text. "" disables the binary log file.
+		-- Default: "logfile.bin"
+		binaryLogFile = "logfile.bin",
+	},
+
 	-- Settings about the behavior of the scripting system.
 	lua = {
 		maxStackDumpLevel = 2,
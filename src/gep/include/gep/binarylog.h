@@ -0,0 +1,77 @@
+#pragma once
+
+#include "gep/interfaces/logging.h"
+#include "gep/container/DynamicArray.h"
+#include <fstream>
+#include <stdarg.h>
+
+namespace gep
+{
+    /// \brief returned by encodeLogArguments when the arguments can not be encoded
+    const size_t INVALID_LOG_ARGUMENTS_SIZE = ~(size_t)0;
+
+    /// \brief copies the raw arguments of a printf style format string into a compact buffer, without formatting them
+    ///
+    /// Integers, characters and pointers are stored as 64 bit values, floating point values as doubles
+    /// and strings as 16 bit length followed by the characters, so the encoded arguments can be formatted
+    /// on another thread, after the strings were freed, or offline by a program compiled for another platform.
+    /// Returns the number of bytes written to the buffer or INVALID_LOG_ARGUMENTS_SIZE
+    /// if they do not fit or the format string uses %n or wide characters.
+    GEP_API size_t encodeLogArguments(GEP_PRINTF_FORMAT_STRING const char* fmt, va_list argptr, ArrayPtr<uint8> buffer);
+
+    /// \brief formats arguments encoded by encodeLogArguments with the same format string, replaces the content of outMessage
+    ///
+    /// Gives the same result as vsnprintf for everything except %p, which is printed as pointerSize * 2 hex digits.
+    /// \param pointerSize the pointer size of the program that encoded the arguments
+    /// \return false if there are fewer arguments than the format string expects, they are printed as "<missing>"
+    GEP_API bool formatLogArguments(std::string& outMessage, const char* fmt, ArrayPtr<const uint8> arguments, uint32 pointerSize = sizeof(void*));
+
+    /// \brief layout of the files written by BinaryFileLogSink
+    ///
+    /// The file starts with MAGIC, VERSION and the pointer size of the program as uint32, followed by entries.
+    /// Every entry starts with its EntryType as uint8, all values are little endian.
+    ///   formatString:    uint32 id, uint32 length, characters
+    ///   deferredMessage: uint8 channel, uint32 format id, uint16 arguments size, arguments
+    ///   message:         uint8 channel, uint32 length, characters
+    /// A format string is written once, before the first message that uses it.
+    namespace BinaryLogFile
+    {
+        const char MAGIC[8] = "GEPBLOG";
+        const uint32 VERSION = 1;
+
+        enum class EntryType : uint8
+        {
+            formatString = 1,
+            deferredMessage = 2,
+            message = 3
+        };
+    }
+
+    /// \brief reads the messages of a log written by a BinaryFileLogSink and formats them
+    class GEP_API BinaryLogReader
+    {
+        std::ifstream m_file;
+        uint32 m_pointerSize;
+        bool m_isValid;
+        // indexed by format id
+        DynamicArray<std::string> m_formatStrings;
+        DynamicArray<uint8> m_arguments;
+
+        GEP_DISALLOW_COPY_AND_ASSIGNMENT(BinaryLogReader);
+
+        bool read(void* pDestination, size_t size);
+
+    public:
+        BinaryLogReader(const char* filename);
+
+        /// \brief false if the file could not be opened or is not a binary log
+        inline bool isValid() const { return m_isValid; }
+
+        /// \brief pointer size of the program that wrote the log
+        inline uint32 getPointerSize() const { return m_pointerSize; }
+
+        /// \brief reads and formats the next message
+        /// \return false at the end of the file, or if the rest of the file is corrupted
+        bool readMessage(LogChannel& outChannel, std::string& outMessage);
+    };
+}
@@ -14,38 +14,87 @@ namespace gep
         {
             read,
             write,
-            modify
+            modify,
+            /// reads from the file mapped into memory, readArrayView returns data without copying it
+            mappedRead
         };
 
     private:
         Operation m_operation;
         ArrayPtr<uint8> m_oldData;
-        uint8* m_readLocation;
+        // what modify and mappedRead read from
+        ArrayPtr<const uint8> m_readData;
+        const uint8* m_readLocation;
         RawFile m_file;
+        MappedFile m_mappedFile;
         std::string m_filename;
         uint32 m_version;
+        bool m_writeIndex;
 
         static const uint32 MAX_CHUNK_NAME_LENGTH = 27;
+        // marks a file which ends with a chunk index, followed by the offset of the index chunk
+        static const uint32 INDEX_MAGIC = 0x58444E49; // "INDX"
+        static const size_t INDEX_FOOTER_SIZE = 2 * sizeof(uint32);
+        static const uint32 NO_INDEX_ENTRY = 0xFFFFFFFF;
 
         struct ChunkReadInfo
         {
             char name[MAX_CHUNK_NAME_LENGTH];
             uint8 nameLength;
             uint32 bytesLeft;
+            uint32 indexEntry;
 
-            ChunkReadInfo() : nameLength(0), bytesLeft(0) {}
+            ChunkReadInfo() : nameLength(0), bytesLeft(0), indexEntry(NO_INDEX_ENTRY) {}
         };
 
         struct ChunkWriteInfo
         {
             size_t lengthPosition;
             size_t length;
+            uint32 indexEntry;
 
-            ChunkWriteInfo() : lengthPosition(0), length(0) {}
+            ChunkWriteInfo() : lengthPosition(0), length(0), indexEntry(NO_INDEX_ENTRY) {}
+        };
+
+        // a chunk of the file, the entries are in the order the chunks start in the file.
+        // The index stores them as they are, so it can be used straight from a mapped file.
+        struct IndexEntry
+        {
+            uint8 nameLength;
+            char name[MAX_CHUNK_NAME_LENGTH];
+            // the chunk this one is in, NO_INDEX_ENTRY for the file chunk
+            uint32 parent;
+            // position of the chunk header in the file
+            uint32 offset;
+            // the length of the chunk data, without the header
+            uint32 length;
+            // ResourceCache::hashContent of the chunk data, it is the same on every platform
+            uint64 hash;
+
+            IndexEntry() : nameLength(0), parent(NO_INDEX_ENTRY), offset(0), length(0), hash(0) {}
         };
 
         DynamicArray<ChunkReadInfo> m_readInfo;
         DynamicArray<ChunkWriteInfo> m_writeInfo;
+        // the entries of a mapped index point into the file, otherwise into m_indexEntries
+        ArrayPtr<const IndexEntry> m_index;
+        DynamicArray<IndexEntry> m_indexEntries;
+
+        inline bool hasReadData(size_t bytes) const
+        {
+            return bytes <= size_t((m_readData.getPtr() + m_readData.length()) - m_readLocation);
+        }
+
+        size_t getReadPosition();
+        void setReadPosition(size_t position);
+        // finds the chunk index at the end of the file, if there is one
+        void readIndex(size_t fileSize);
+        // appends the index of the chunks written so far to the file
+        void writeIndex();
+        // the offset of the chunk index if the footer marks one, 0 otherwise
+        static size_t findIndexOffset(const uint32 footer[2], size_t fileSize);
+        // the index entry of the chunk whose header is at the given position, NO_INDEX_ENTRY if there is none
+        uint32 findIndexEntry(size_t offset, const ChunkReadInfo& info) const;
 
     public:
         /// \brief creates or opens a chunkfile
@@ -59,6 +108,11 @@ namespace gep
 
         void skipRead(size_t bytes);
 
+        inline bool isOpen() const
+        {
+            return m_file.isOpen() || m_readData.getPtr() != nullptr;
+        }
+
         template <typename T>
         size_t read(T& val)
         {
@@ -72,8 +126,10 @@ namespace gep
             }
             else
             {
-                GEP_ASSERT(m_readLocation + sizeof(T) <= m_oldData.getPtr() + m_oldData.length(), "out of bounds");
-                val = *(T*)(m_readLocation);
+                // like fread nothing is read at the end of the data
+                if(!hasReadData(sizeof(T)))
+                    return 0;
+                memcpy(&val, m_readLocation, sizeof(T));
                 size = sizeof(T);
                 m_readLocation += sizeof(T);
             }
@@ -95,13 +151,10 @@ namespace gep
             }
             else
             {
-                if(m_readLocation + sizeof(T) * val.length() <= m_oldData.getPtr() + m_oldData.length())
-                {
-                    GEP_ASSERT(false, "out of bounds");
-                    return 0;
-                }
-                val.copyFrom(ArrayPtr<T>((T*)m_readLocation, val.length()));
                 size = sizeof(T) * val.length();
+                if(!hasReadData(size))
+                    return 0;
+                memcpy(val.getPtr(), m_readLocation, size);
                 m_readLocation += size;
             }
             if(m_readInfo.length() > 0)
@@ -109,6 +162,26 @@ namespace gep
             return size;
         }
 
+        /// \brief returns the next count values of the file without copying them, only in mappedRead operation
+        ///
+        /// The view points into the mapped file and is valid until the chunkfile is destroyed.
+        /// The values are only aligned if the file was written that way.
+        /// \return an empty array if there is not enough data left
+        template <typename T>
+        ArrayPtr<const T> readArrayView(size_t count)
+        {
+            GEP_ASSERT(m_operation == Operation::mappedRead, "views are only possible in mapped read operation");
+            const size_t size = sizeof(T) * count;
+            GEP_ASSERT(m_readInfo.length() == 0 || m_readInfo.lastElement().bytesLeft >= size, "reading over chunk boundary");
+            if(!hasReadData(size))
+                return ArrayPtr<const T>();
+            ArrayPtr<const T> view(reinterpret_cast<const T*>(m_readLocation), count);
+            m_readLocation += size;
+            if(m_readInfo.length() > 0)
+                m_readInfo.lastElement().bytesLeft -= (uint32)size;
+            return view;
+        }
+
         /// \brief Allocates and reads a array of a given type from the chunk file
         /// \param pAllocator
         ///   the allocator to use
@@ -165,6 +238,23 @@ namespace gep
         void discardChanges();
         Result startReadChunk();
 
+        /// \brief starts reading the next chunk with the given name within the current chunk, the chunks before it are skipped
+        ///
+        /// If the file has a chunk index the chunk is found without reading anything before it,
+        /// otherwise the headers of the chunks before it are read.
+        /// \return FAILURE if the current chunk has no such chunk left, without an index the rest of the current chunk was skipped then
+        Result startReadChunk(const char* name);
+
+        /// \brief if the file ends with a chunk index written by endWriting
+        inline bool hasIndex() const
+        {
+            return m_index.length() > 0;
+        }
+
+        /// \brief gets the hash of the data of the current chunk from the chunk index, see ResourceCache::hashContent
+        /// \return FAILURE if the chunk is not in the index
+        Result getCurrentChunkHash(uint64& hash) const;
+
         inline bool currentChunkHasMoreData() const
         {
             GEP_ASSERT(m_readInfo.length() > 0, "no chunk is open");
@@ -198,7 +288,10 @@ namespace gep
         */
         void skipCurrentChunk();
 
-        void startWriting(const char* filetype, uint32 ver);
+        /// \param writeIndex
+        ///   if endWriting should append an index of all chunks (name, offset, length and hash), only in write operation.
+        ///   Readers which do not know the index ignore it.
+        void startWriting(const char* filetype, uint32 ver, bool writeIndex = false);
 
         void endWriting();
 
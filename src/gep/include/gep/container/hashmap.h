@@ -5,8 +5,74 @@
 
 namespace gep
 {
+    /// \brief fast non-cryptographic hash function for arbitrary data
     GEP_API unsigned int hashOf( const void* buf, size_t len, unsigned int seed = 0 );
 
+    namespace detail
+    {
+        // FNV-1a over the first I characters of a string literal, fully unrolled so the optimizer can fold it
+        template <size_t N, size_t I>
+        struct LiteralHash
+        {
+            __forceinline static uint32 hash(const char (&str)[N])
+            {
+                return (LiteralHash<N, I - 1>::hash(str) ^ (uint8)str[I - 1]) * 16777619u;
+            }
+        };
+
+        template <size_t N>
+        struct LiteralHash<N, 0>
+        {
+            __forceinline static uint32 hash(const char (&str)[N])
+            {
+                return 2166136261u;
+            }
+        };
+    }
+
+    /// \brief precomputed hash of a string
+    ///
+    /// Constructing it from a string literal hashes the literal at compile time,
+    /// fromString hashes other strings at runtime with the same function.
+    /// Only a pointer to the string is kept, so the string has to outlive the StringHash.
+    class StringHash
+    {
+        uint32 m_hash;
+        const char* m_str;
+
+        StringHash(uint32 hash, const char* str) : m_hash(hash), m_str(str) {}
+
+      public:
+        template <size_t N>
+        __forceinline StringHash(const char (&str)[N]) :
+            m_hash(detail::LiteralHash<N, N - 1>::hash(str)),
+            m_str(str)
+        {
+            GEP_ASSERT(strlen(str) == N - 1, "StringHash can only be constructed from string literals, use fromString instead", str);
+        }
+
+        /// \brief hashes a zero terminated string at runtime
+        static StringHash fromString(const char* str)
+        {
+            uint32 hash = 2166136261u;
+            for(const char* c = str; *c != '\0'; c++)
+                hash = (hash ^ (uint8)*c) * 16777619u;
+            return StringHash(hash, str);
+        }
+
+        inline uint32 getHash() const { return m_hash; }
+        inline const char* c_str() const { return m_str; }
+
+        inline bool operator == (const StringHash& rh) const
+        {
+            return m_hash == rh.m_hash && (m_str == rh.m_str || strcmp(m_str, rh.m_str) == 0);
+        }
+        inline bool operator != (const StringHash& rh) const
+        {
+            return !operator == (rh);
+        }
+    };
+
     struct StdHashPolicy
     {
         template <class T>
@@ -43,6 +109,16 @@ namespace gep
         {
             return lhs == rhs;
         }
+
+        static unsigned int hash(const StringHash& str)
+        {
+            return str.getHash();
+        }
+
+        static bool equals(const StringHash& lhs, const StringHash& rhs)
+        {
+            return lhs == rhs;
+        }
     };
 
     struct HashMethodPolicy
@@ -109,6 +185,13 @@ namespace gep
         }
     };
 
+    /// \brief open addressing hash map with robin hood probing
+    ///
+    /// The capacity is always a power of two. The hash of every entry is stored next to it,
+    /// so probing only compares keys with an equal hash and growing does not rehash the keys.
+    /// Entries which are further away from their home slot take the place of entries which are closer,
+    /// this keeps the probe sequences short and lets lookups of missing keys stop early.
+    /// Removing shifts the following entries back, so there are no tombstones.
     template <class K, class V, class HashPolicy>
     class HashmapImpl
     {
@@ -119,82 +202,141 @@ namespace gep
             Pair(const K& key, const V& value) :
                 key(key), value(value) {}
             Pair(K&& key, V&& value) :
-                key(key), value(value) {}
+                key(std::move(key)), value(std::move(value)) {}
+            Pair(const Pair& other) :
+                key(other.key), value(other.value) {}
+            Pair(Pair&& other) :
+                key(std::move(other.key)), value(std::move(other.value)) {}
+            Pair& operator = (const Pair& other)
+            {
+                key = other.key;
+                value = other.value;
+                return *this;
+            }
+            Pair& operator = (Pair&& other)
+            {
+                key = std::move(other.key);
+                value = std::move(other.value);
+                return *this;
+            }
         };
 
       private:
-        enum class State : char {
-          Free, // 0
-          Deleted, // 1
-          Data // 2
-        };
-
-        static_assert(sizeof(State) == 1, "Invalid size of State enum");
+        // stored hash of free slots, real hashes of 0 are stored as 1
+        static const uint32 FREE_HASH = 0;
 
         Pair* m_data;
-        State* m_states;
+        uint32* m_hashes;
         size_t m_reserved;
+        size_t m_mask;
+        // 32 - log2(m_reserved), the home slot are the upper bits of the mixed hash
+        uint32 m_shift;
         size_t m_fullCount;
-        size_t m_numDeletedEntries;
         IAllocator* m_allocator;
 
         static const int INITIAL_SIZE = 4;
 
-        size_t insertEntry(const K& key, const V& value)
+        static inline uint32 hashKey(const K& key)
         {
-            size_t index = getFreeIndex(key);
-            new (m_data+index) Pair(key, value);
-            if (m_states[index] == State::Deleted)
-            {
-                m_numDeletedEntries--;
-            }
-            m_states[index] = State::Data;
-            return index;
+            uint32 hash = (uint32)HashPolicy::hash(key);
+            return (hash == FREE_HASH) ? 1 : hash;
+        }
+
+        inline size_t homeIndex(uint32 hash) const
+        {
+            // fibonacci hashing, spreads hash functions with weak low bits (like DontHashPolicy) over the table
+            return (size_t)((hash * 2654435769u) >> m_shift);
         }
 
-        size_t moveEntry(K& key, V& value)
+        inline size_t probeDistance(uint32 hash, size_t index) const
         {
-            size_t index = getFreeIndex(key);
-            new (m_data+index) Pair(std::move(key), std::move(value));
-            m_states[index] = State::Data;
-            return index;
+            return (index - homeIndex(hash)) & m_mask;
         }
 
-        void moveEntry(const Pair& data)
+        void allocate(size_t numSlots)
         {
-            new (m_data + getFreeIndex(data.key)) Pair(std::move(data));
+            GEP_ASSERT(numSlots >= 2 && (numSlots & (numSlots - 1)) == 0, "capacity has to be a power of two", numSlots);
+            m_data = (Pair*)m_allocator->allocateMemory(sizeof(Pair) * numSlots);
+            m_hashes = (uint32*)m_allocator->allocateMemory(sizeof(uint32) * numSlots);
+            memset(m_hashes, FREE_HASH, sizeof(uint32) * numSlots);
+            m_reserved = numSlots;
+            m_mask = numSlots - 1;
+            m_shift = 32;
+            for(size_t i = numSlots; i > 1; i >>= 1)
+                m_shift--;
         }
 
-        size_t getFreeIndex(const K& key) const
+        // inserts a key which is not in the map yet, returns the index it ended up at
+        size_t insertEntry(uint32 hash, Pair&& entry)
         {
-            size_t index = HashPolicy::hash(key) % m_reserved;
-            while(m_states[index] == State::Data)
+            size_t index = homeIndex(hash);
+            size_t distance = 0;
+            size_t result = std::numeric_limits<size_t>::max();
+            Pair carried(std::move(entry));
+            while(true)
             {
-                index++;
-                if(index == m_reserved)
+                uint32 storedHash = m_hashes[index];
+                if(storedHash == FREE_HASH)
                 {
-                    index = 0;
+                    new (m_data + index) Pair(std::move(carried));
+                    m_hashes[index] = hash;
+                    return (result == std::numeric_limits<size_t>::max()) ? index : result;
                 }
+                // take the slot from entries that are closer to their home, then keep inserting the displaced entry
+                size_t storedDistance = probeDistance(storedHash, index);
+                if(storedDistance < distance)
+                {
+                    std::swap(hash, m_hashes[index]);
+                    std::swap(carried, m_data[index]);
+                    if(result == std::numeric_limits<size_t>::max())
+                        result = index;
+                    distance = storedDistance;
+                }
+                index = (index + 1) & m_mask;
+                distance++;
+            }
+        }
+
+        void grow()
+        {
+            Pair* oldData = m_data;
+            uint32* oldHashes = m_hashes;
+            size_t oldLength = m_reserved;
+            allocate((oldLength == 0) ? INITIAL_SIZE : oldLength * 2);
+
+            //move all entries over, the stored hashes are reused
+            for(size_t i=0; i < oldLength; i++)
+            {
+                if(oldHashes[i] != FREE_HASH)
+                {
+                    insertEntry(oldHashes[i], std::move(oldData[i]));
+                    oldData[i].~Pair();
+                }
+            }
+            if(oldData != nullptr)
+            {
+                m_allocator->freeMemory(oldData);
+                m_allocator->freeMemory(oldHashes);
             }
-            return index;
         }
 
         size_t getIndex(const K& key) const
         {
-            if(m_reserved > 0)
+            if(m_fullCount > 0)
             {
-                size_t index = HashPolicy::hash(key) % m_reserved;
-                size_t searched = 0;
-                while(m_states[index] != State::Free && searched < m_reserved)
+                const uint32 hash = hashKey(key);
+                size_t index = homeIndex(hash);
+                size_t distance = 0;
+                while(true)
                 {
-                    if(m_states[index] == State::Data && HashPolicy::equals(m_data[index].key, key))
+                    uint32 storedHash = m_hashes[index];
+                    // the key would have taken the place of any entry which is closer to its home
+                    if(storedHash == FREE_HASH || probeDistance(storedHash, index) < distance)
+                        break;
+                    if(storedHash == hash && HashPolicy::equals(m_data[index].key, key))
                         return index;
-                    index++;
-                    if(index == m_reserved)
-                    {
-                        index = 0;
-                    }
-                    searched++;
+                    index = (index + 1) & m_mask;
+                    distance++;
                 }
             }
             return std::numeric_limits<size_t>::max();
@@ -202,35 +344,40 @@ namespace gep
 
         void doRemove(size_t index)
         {
-            size_t nextIndex = (index + 1) % m_reserved;
-            if(m_states[nextIndex] != State::Free)
-            {
-                m_states[index] = State::Deleted;
-                m_numDeletedEntries++;
-            }
-            else
+            m_data[index].~Pair();
+            // shift the following entries one slot back, until one is at its home or a slot is free
+            size_t nextIndex = (index + 1) & m_mask;
+            while(m_hashes[nextIndex] != FREE_HASH && probeDistance(m_hashes[nextIndex], nextIndex) > 0)
             {
-                m_states[index] = State::Free;
+                new (m_data + index) Pair(std::move(m_data[nextIndex]));
+                m_data[nextIndex].~Pair();
+                m_hashes[index] = m_hashes[nextIndex];
+                index = nextIndex;
+                nextIndex = (nextIndex + 1) & m_mask;
             }
-
-            m_data[index].~Pair();
+            m_hashes[index] = FREE_HASH;
             m_fullCount--;
         }
 
         void copy(const HashmapImpl<K, V, HashPolicy>& other)
         {
             m_allocator = other.m_allocator;
-            m_data = (Pair*)m_allocator->allocateMemory(sizeof(Pair) * other.m_reserved);
-            m_states = (State*)m_allocator->allocateMemory(other.m_reserved);
-            m_reserved = other.m_reserved;
+            m_data = nullptr;
+            m_hashes = nullptr;
+            m_reserved = 0;
+            m_mask = 0;
+            m_shift = 32;
             m_fullCount = other.m_fullCount;
-            m_numDeletedEntries = other.m_numDeletedEntries;
-            memcpy(m_states, other.m_states, other.m_reserved);
-            for(size_t i=0; i<m_reserved; i++)
+            if(other.m_reserved > 0)
             {
-                if(m_states[i] == State::Data)
+                allocate(other.m_reserved);
+                memcpy(m_hashes, other.m_hashes, sizeof(uint32) * m_reserved);
+                for(size_t i=0; i<m_reserved; i++)
                 {
-                    new (m_data + i) Pair (other.m_data[i]);
+                    if(m_hashes[i] != FREE_HASH)
+                    {
+                        new (m_data + i) Pair (other.m_data[i]);
+                    }
                 }
             }
         }
@@ -240,14 +387,16 @@ namespace gep
             m_allocator = other.m_allocator;
             m_data = other.m_data;
             other.m_data = nullptr;
-            m_states = other.m_states;
-            other.m_states = nullptr;
+            m_hashes = other.m_hashes;
+            other.m_hashes = nullptr;
             m_fullCount = other.m_fullCount;
             other.m_fullCount = 0;
-            m_numDeletedEntries = other.m_numDeletedEntries;
-            other.m_numDeletedEntries = 0;
             m_reserved = other.m_reserved;
             other.m_reserved = 0;
+            m_mask = other.m_mask;
+            other.m_mask = 0;
+            m_shift = other.m_shift;
+            other.m_shift = 32;
         }
 
         void destroy()
@@ -256,12 +405,12 @@ namespace gep
             {
                 for(size_t i=0; i<m_reserved; i++)
                 {
-                    if(m_states[i] == State::Data)
+                    if(m_hashes[i] != FREE_HASH)
                     {
                         m_data[i].~Pair();
                     }
                 }
-                m_allocator->freeMemory(m_states);
+                m_allocator->freeMemory(m_hashes);
                 m_allocator->freeMemory(m_data);
             }
         }
@@ -292,13 +441,13 @@ namespace gep
                 do
                 {
                     index++;
-                    if(index > m_pBackptr->m_reserved)
+                    if(index >= m_pBackptr->m_reserved)
                     {
                         index = m_pBackptr->m_reserved;
                         break;
                     }
                 }
-                while(m_pBackptr->m_states[index] != State::Data);
+                while(m_pBackptr->m_hashes[index] == FREE_HASH);
                 return *this;
             }
             Pair* operator->() const
@@ -401,12 +550,8 @@ namespace gep
         HashmapImpl(IAllocator* allocator)
         {
             m_allocator = allocator;
-            m_data = (Pair*)allocator->allocateMemory(sizeof(Pair) * INITIAL_SIZE);
-            m_states = (State*)allocator->allocateMemory(INITIAL_SIZE);
-            m_reserved = INITIAL_SIZE;
             m_fullCount = 0;
-            m_numDeletedEntries = 0;
-            memset(m_states, 0, m_reserved);
+            allocate(INITIAL_SIZE);
         }
 
         /// \brief copy constructor
@@ -449,38 +594,16 @@ namespace gep
         /// \brief [] operator
         V& operator[](const K& key)
         {
-          size_t index = getIndex(key);
-          if(index == std::numeric_limits<size_t>::max()) //not in the HashmapImpl yet
-          {
-            m_fullCount++;
-            auto pseudoFullCount = m_fullCount + m_numDeletedEntries;
-            if(pseudoFullCount > ((m_reserved * 3) / 4) || pseudoFullCount >= m_reserved)
-            {
-              Pair* oldData = m_data;
-              State* oldStates = m_states;
-              size_t oldLength = m_reserved;
-              m_reserved = (oldLength == 0) ? 4 : oldLength * 2;
-              m_data = (Pair*)m_allocator->allocateMemory(m_reserved * sizeof(Pair));
-              m_states = (State*)m_allocator->allocateMemory(m_reserved);
-              memset(m_states, (int)State::Free, m_reserved);
-
-              //rehash all values
-              for(size_t i=0; i < oldLength; i++)
-              {
-                  if(oldStates[i] == State::Data)
-                  {
-                      //move from the old to the new array
-                      moveEntry(oldData[i].key, oldData[i].value);
-                      //destroy the element in the old array
-                      oldData[i].~Pair();
-                  }
-              }
-              m_allocator->freeMemory(oldData);
-              m_allocator->freeMemory(oldStates);
-            }
-            index = insertEntry(key, V());
-          }
-          return m_data[index].value;
+            size_t index = getIndex(key);
+            if(index == std::numeric_limits<size_t>::max()) //not in the HashmapImpl yet
+            {
+                // keep the load factor at 3/4 at most, so probe sequences stay short
+                if((m_fullCount + 1) * 4 > m_reserved * 3)
+                    grow();
+                index = insertEntry(hashKey(key), Pair(key, V()));
+                m_fullCount++;
+            }
+            return m_data[index].value;
         }
 
         /// \brief const version of operator []
@@ -530,10 +653,10 @@ namespace gep
         {
             for(size_t i=0; i < m_reserved; i++)
             {
-                if(m_states[i] == State::Data)
+                if(m_hashes[i] != FREE_HASH)
                 {
                     m_data[i].~Pair();
-                    m_states[i] = State::Free;
+                    m_hashes[i] = FREE_HASH;
                 }
             }
             m_fullCount = 0;
@@ -571,16 +694,29 @@ namespace gep
 
         inline size_t removeWhere(std::function<bool(K&, V&)> condition)
         {
+            if(m_fullCount == 0)
+                return 0;
+
+            // Start behind a free slot: removing shifts entries back, but never across a free slot,
+            // so entries which were already visited are not moved again.
+            size_t start = 0;
+            while(m_hashes[start] != FREE_HASH)
+                start++;
+
             size_t removed = 0;
-            for (size_t index = 0; index < m_reserved; ++index)
+            size_t index = (start + 1) & m_mask;
+            while(index != start)
             {
-                State state = m_states[index];
-                Pair& entry = m_data[index];
-                if (m_states[index] == State::Data && condition(entry.key, entry.value))
+                if (m_hashes[index] != FREE_HASH && condition(m_data[index].key, m_data[index].value))
                 {
+                    // the next entry might have been shifted into this slot
                     doRemove(index);
                     ++removed;
                 }
+                else
+                {
+                    index = (index + 1) & m_mask;
+                }
             }
             return removed;
         }
@@ -599,7 +735,7 @@ namespace gep
         {
             for(size_t i = 0; i < m_reserved; ++i)
             {
-                if (m_states[i] == State::Free)
+                if (m_hashes[i] == FREE_HASH)
                 {
                     return false;
                 }
@@ -607,6 +743,12 @@ namespace gep
             return true;
 
         }
+
+        /// \brief returns the number of slots, for testing
+        inline size_t reserved() const
+        {
+            return m_reserved;
+        }
     };
 
     /// \brief Hashmap indirection to deal with allocator policies and avoid code bloat
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "gep/gepmodule.h"
+#include "gep/ArrayPtr.h"
 #include <stdio.h>
 
 namespace gep
@@ -186,6 +187,34 @@ namespace gep
         }
     };
 
+    /// \brief a file mapped into memory for reading
+    ///
+    /// The whole file is visible as one array, the operating system loads the pages when they are first read.
+    class GEP_API MappedFile
+    {
+        void* m_fileHandle;
+        void* m_mappingHandle;
+        ArrayPtr<const uint8> m_data;
+
+        GEP_DISALLOW_COPY_AND_ASSIGNMENT(MappedFile);
+
+    public:
+        MappedFile();
+        ~MappedFile();
+
+        /// \brief maps the given file, closes the previously mapped one
+        /// \return false if the file could not be opened or is empty
+        bool open(const char* pFilename);
+
+        /// \brief unmaps the file, all views into it become invalid
+        void close();
+
+        inline bool isOpen() const { return m_data.getPtr() != nullptr; }
+
+        /// \brief the content of the file, valid until the file is closed
+        inline ArrayPtr<const uint8> getData() const { return m_data; }
+    };
+
     /// \brief checks if the given file exists
     GEP_API bool fileExists(const char* pathToFile);
 }
@@ -38,6 +38,7 @@ namespace gep
         ILogging* m_pLogging;
         ILogSink* m_ConsoleLogSink;
         ILogSink* m_FileLogSink;
+        ILogSink* m_BinaryFileLogSink;
         IMemoryManager* m_pMemoryManager;
         IResourceManager* m_pResourceManager;
         Timer* m_pTimer;
@@ -98,6 +98,7 @@ namespace gep
                 m_triggerLevel);
 
             if(m_onDestroy) { m_onDestroy(*this); }
+            lua::utils::invalidateProxy(this);
 
             m_onDestroy = nullptr;
             stopUpdating();
@@ -18,8 +18,18 @@ namespace gep
     public:
         virtual ~ILogSink() {}
         virtual void take(LogChannel channel, const char* msg) = 0;
+        /// \brief makes sure all messages taken so far are stored, called after every batch of messages
+        virtual void flush() {}
+
+        /// \brief return true to get messages whose formatting was deferred through takeDeferred instead of take
+        virtual bool takesDeferredMessages() const { return false; }
+        /// \brief takes a message that has not been formatted yet
+        /// \param fmt the format string passed to the logging, it is a literal and stays valid
+        /// \param arguments the arguments encoded by encodeLogArguments (see gep/binaryLog.h)
+        virtual void takeDeferred(LogChannel channel, const char* fmt, ArrayPtr<const uint8> arguments) {}
     };
 
+    /// \brief the format strings have to be string literals, a logging might keep them to format the message later
     class ILogging
     {
     public:
@@ -31,6 +41,9 @@ namespace gep
         virtual void registerSink(ILogSink* pSink) = 0;
         virtual void deregisterSink(ILogSink* pSink) = 0;
 
+        /// \brief blocks until all messages logged so far have been written to the sinks
+        virtual void flush() = 0;
+
         LUA_BIND_REFERENCE_TYPE_BEGIN
             LUA_BIND_FUNCTION_NAMED(logMessagePreFormatted, "logMessage")
             LUA_BIND_FUNCTION_NAMED(logWarningPreFormatted, "logWarning")
@@ -38,8 +51,8 @@ namespace gep
         LUA_BIND_REFERENCE_TYPE_END
 
     private:
-        inline void logMessagePreFormatted(const char* message) { logMessage(message); }
-        inline void logWarningPreFormatted(const char* message) { logWarning(message); }
-        inline void logErrorPreFormatted(const char* message) { logError(message); }
+        inline void logMessagePreFormatted(const char* message) { logMessage("%s", message); }
+        inline void logWarningPreFormatted(const char* message) { logWarning("%s", message); }
+        inline void logErrorPreFormatted(const char* message) { logError("%s", message); }
     };
 }
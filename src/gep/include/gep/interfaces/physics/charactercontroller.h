@@ -94,6 +94,8 @@ namespace gep
             characterGravity(0.0f)
         {
         }
+        // the input lives on the stack of the character update, scripts which keep it see a null object
+        ~CharacterInput() { lua::utils::invalidateProxy(this); }
 
         // Functions needed for scripting
         //////////////////////////////////////////////////////////////////////////
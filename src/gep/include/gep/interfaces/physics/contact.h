@@ -35,7 +35,7 @@ namespace gep
         {
         }
 
-        virtual ~CollisionArgs() {}
+        virtual ~CollisionArgs() { lua::utils::invalidateProxy(this); }
 
         CallbackSource::Enum getSource() const { return m_source; }
 
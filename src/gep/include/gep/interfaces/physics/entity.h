@@ -61,6 +61,7 @@ namespace gep
         };
 
     public:
+        virtual ~ITriggerEventArgs() { lua::utils::invalidateProxy(this); }
 
         virtual IRigidBody* getRigidBody() = 0;
         virtual Type::Enum getEventType() = 0;
@@ -8,6 +8,7 @@ namespace gep
     //forward reference
     class IResource;
     class IResourceLoader;
+    class ResourceCache;
     template <class T>
     struct ResourcePtr;
 
@@ -28,6 +29,66 @@ namespace gep
         Yes
     };
 
+    /// \brief how urgently an asynchronously loaded resource is needed
+    ///
+    /// The loader threads always take the most urgent request first,
+    /// and finished resources are finalized in the same order.
+    enum class LoadPriority
+    {
+        /// needed right now, finalized even if the finalize budget of the frame is used up
+        Critical,
+        /// needed for something that is visible
+        Visible,
+        /// might be needed soon
+        Prefetch
+    };
+    const size_t NUM_LOAD_PRIORITIES = 3;
+
+    /// \brief counters of the asynchronous resource loading
+    struct ResourceLoadingStatistics
+    {
+        /// \brief number of requests waiting for a loader thread, per LoadPriority
+        size_t queueDepth[NUM_LOAD_PRIORITIES];
+        /// \brief number of resources the loader threads are loading right now
+        size_t numLoading;
+        /// \brief number of loaded resources waiting to be finalized
+        size_t numWaitingForFinalize;
+        /// \brief number of resources loaded asynchronously so far
+        uint64 numLoaded;
+        /// \brief number of asynchronous loads which failed so far
+        uint64 numFailed;
+        /// \brief number of requests canceled so far
+        uint64 numCanceled;
+        // The latencies are the time between requesting a resource and replacing its dummy,
+        // in milliseconds, over the most recent loads.
+        /// \brief median load latency
+        float latencyMedianMs;
+        /// \brief 90th percentile of the load latency
+        float latency90Ms;
+        /// \brief 99th percentile of the load latency
+        float latency99Ms;
+        /// \brief maximum load latency
+        float latencyMaxMs;
+        /// \brief time the last call to finalizeResourcesWithFlags spent finalizing, in milliseconds
+        float lastFinalizeTimeMs;
+        /// \brief number of bytes the last call to finalizeResourcesWithFlags finalized
+        size_t lastFinalizeBytes;
+        // Loads whose source has the same content as an already loaded resource share it,
+        // synchronous ones included.
+        /// \brief number of loads which shared an already loaded resource
+        uint64 numShared;
+        /// \brief number of bytes the shared resources did not load again, see IResource::getFinalizeSize
+        uint64 sharedBytes;
+        /// \brief time the shared resources took to load the first time, summed up over all loads which shared them, in milliseconds
+        float sharedLoadTimeMs;
+        /// \brief number of converted resources found in the resource cache
+        uint64 numCacheHits;
+        /// \brief number of converted resources which were not in the resource cache and had to be converted
+        uint64 numCacheMisses;
+        /// \brief time the conversions skipped because of the resource cache would have taken, in milliseconds
+        float cacheSavedTimeMs;
+    };
+
     class IResource
         : public WeakReferenced<IResource, WeakReferencedExport>
     {
@@ -53,6 +114,8 @@ namespace gep
         virtual void finalize() = 0;
         /// \brief returns the finalize options \see ResourceFinalize
         virtual uint32 getFinalizeOptions() = 0;
+        /// \brief returns roughly how many bytes finalize uploads, counts against the finalize budget
+        virtual size_t getFinalizeSize() { return 0; }
         /// \brief checks if this resource is loaded or not
         virtual bool isLoaded() = 0;
         /// \brief returns the resource this subresource is part of
@@ -113,6 +176,16 @@ namespace gep
             m_ptr.invalidateAndReplace(ptr);
         }
 
+        void setAlias(T* ptr)
+        {
+            m_ptr.setAlias(ptr);
+        }
+
+        void invalidate()
+        {
+            m_ptr.invalidate();
+        }
+
     public:
         ResourcePtr() {}
 
@@ -184,13 +257,18 @@ namespace gep
         virtual void release() = 0;
         /// \brief gets called after each load operation
         virtual void postLoad(ResourcePtr<IResource> pResource) = 0;
+        /// \brief hashes the source the resource would be loaded from, see ResourceCache::hashContent
+        ///
+        /// Resources of the same type with the same hash are only loaded once, the later loads share the first resource.
+        /// \return false if the loader can not tell, then the resource is never shared
+        virtual bool getContentHash(uint64& hash) { return false; }
     };
 
     /// \brief interface for the resource manager
     class IResourceManager : public ISubsystem
     {
     protected:
-        virtual ResourcePtr<IResource> doLoadResource(IResourceLoader& loader, LoadAsync loadAsync) = 0;
+        virtual ResourcePtr<IResource> doLoadResource(IResourceLoader& loader, LoadAsync loadAsync, LoadPriority priority) = 0;
 
         inline static IResource** begin() { return IResource::begin(); }
         inline static IResource** end() { return IResource::end(); }
@@ -198,6 +276,14 @@ namespace gep
         {
             ptr.invalidateAndReplace(replaceWith);
         }
+        inline static void setAlias(ResourcePtr<IResource>& ptr, IResource* pResource)
+        {
+            ptr.setAlias(pResource);
+        }
+        inline static void invalidate(ResourcePtr<IResource>& ptr)
+        {
+            ptr.invalidate();
+        }
 
         inline static ResourcePtr<IResource> makeResourcePtr(IResource* pResource, bool isDummy)
         {
@@ -214,12 +300,31 @@ namespace gep
         virtual void reloadResource(ResourcePtr<IResource> pResource) = 0;
 
         /// \brief loads a resource
+        /// \param priority
+        ///   how urgently an asynchronously loaded resource is needed.
+        ///   Requesting a resource which is still waiting for a loader thread again raises its priority.
         template <class T>
-        inline ResourcePtr<T> loadResource(IResourceLoader& loader, LoadAsync loadAsync = LoadAsync::Yes)
+        inline ResourcePtr<T> loadResource(IResourceLoader& loader, LoadAsync loadAsync = LoadAsync::Yes, LoadPriority priority = LoadPriority::Visible)
         {
-            return doLoadResource(loader, loadAsync).castTo<T>();
+            return doLoadResource(loader, loadAsync, priority).castTo<T>();
         }
 
+        /// \brief cancels the asynchronous load of a resource which is still a dummy
+        ///
+        /// The resource pointer keeps pointing to the dummy, loading the resource again starts a new request.
+        /// \return true if a pending load was canceled
+        virtual bool cancelLoading(ResourcePtr<IResource> pResource) = 0;
+
+        /// \brief cancels all asynchronous loads with the given priority which did not replace their dummy yet
+        /// \return the number of canceled loads
+        virtual size_t cancelLoading(LoadPriority priority) = 0;
+
+        /// \brief returns the counters of the asynchronous resource loading
+        virtual ResourceLoadingStatistics getLoadingStatistics() = 0;
+
+        /// \brief returns the cache for converted resources, null if it is disabled
+        virtual ResourceCache* getResourceCache() = 0;
+
         /// \brief deletes a resource
         virtual void deleteResource(IResource* pResource) = 0;
 
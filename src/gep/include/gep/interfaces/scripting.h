@@ -15,6 +15,33 @@ namespace gep
     typedef lua::FunctionWrapper ScriptFunctionWrapper;
     typedef lua::TableWrapper ScriptTableWrapper;
 
+    /// \brief what the Lua garbage collector did in the last frame
+    struct ScriptGarbageCollectionStatistics
+    {
+        /// \brief time spent collecting, in milliseconds
+        float timeMs;
+        /// \brief time the collector was allowed to spend, in milliseconds
+        float budgetMs;
+        /// \brief number of collection steps
+        uint32 numSteps;
+        /// \brief bytes freed by the collection steps
+        size_t bytesFreed;
+        /// \brief bytes used by Lua after the collection steps
+        size_t bytesUsed;
+        /// \brief number of collection cycles finished since the Lua state was created
+        uint32 numCycles;
+
+        ScriptGarbageCollectionStatistics() :
+            timeMs(0.0f),
+            budgetMs(0.0f),
+            numSteps(0),
+            bytesFreed(0),
+            bytesUsed(0),
+            numCycles(0)
+        {
+        }
+    };
+
     class GEP_API IScriptingManager : public ISubsystem
     {
     public:
@@ -56,7 +83,9 @@ namespace gep
 
         // in KB
         virtual int32 memoryUsed() const = 0;
+        /// \brief runs a full collection cycle, the per frame collection runs in update
         virtual void collectGarbage() = 0;
+        virtual const ScriptGarbageCollectionStatistics& getGarbageCollectionStatistics() const = 0;
 
         virtual lua_State* getState() = 0;
 
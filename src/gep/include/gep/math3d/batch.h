@@ -0,0 +1,31 @@
+#pragma once
+#include "gep/math3d/mat4.h"
+#include "gep/math3d/quaternion.h"
+#include "gep/ArrayPtr.h"
+
+// Operations on whole arrays of math3d types. Every element gets exactly the same result as the
+// corresponding single operation, the arrays are just processed without the per call overhead.
+// result may be the same array as the input unless stated otherwise.
+
+namespace gep
+{
+    /// \brief result[i] = matrix.transformPosition(positions[i])
+    GEP_API void transformPositions(const mat4& matrix, ArrayPtr<const vec3> positions, ArrayPtr<vec3> result);
+
+    /// \brief result[i] = matrix.transformDirection(directions[i])
+    GEP_API void transformDirections(const mat4& matrix, ArrayPtr<const vec3> directions, ArrayPtr<vec3> result);
+
+    /// \brief result[i] = matrix * vectors[i]
+    GEP_API void transformVectors(const mat4& matrix, ArrayPtr<const vec4> vectors, ArrayPtr<vec4> result);
+
+    /// \brief result[i] = lh * rh[i], e.g. the view projection matrix times many world matrices
+    GEP_API void multiplyMatrices(const mat4& lh, ArrayPtr<const mat4> rh, ArrayPtr<mat4> result);
+
+    /// \brief result[i] = lh[i] * rh[i]
+    GEP_API void multiplyMatrices(ArrayPtr<const mat4> lh, ArrayPtr<const mat4> rh, ArrayPtr<mat4> result);
+
+    /// \brief result[i] = rotations[i].toMat4()
+    ///
+    /// Converts four rotations at once. Unlike toMat4 the rotations are not checked for validity.
+    GEP_API void toRotationMatrices(ArrayPtr<const Quaternion> rotations, ArrayPtr<mat4> result);
+}
@@ -4,6 +4,7 @@
 #include "gep/math3d/vec3.h"
 #include "gep/math3d/vec4.h"
 #include "gep/math3d/mat3.h"
+#include "gep/math3d/simd.h"
 
 namespace gep
 {
@@ -547,4 +548,40 @@ namespace gep
     };
 
     typedef mat4_t<float> mat4;
+
+#ifdef GEP_MATH3D_SSE
+    // SSE versions for float, see simd.h
+
+    template <>
+    inline const mat4_t<float> mat4_t<float>::operator * (const mat4_t<float>& m) const
+    {
+        mat4_t<float> result(DO_NOT_INITIALIZE);
+        simd::Columns(data).multiply(m.data, result.data);
+        return result;
+    }
+
+    template <>
+    inline const vec4_t<float> mat4_t<float>::operator * (const vec4_t<float>& v) const
+    {
+        vec4_t<float> temp(DO_NOT_INITIALIZE);
+        _mm_storeu_ps(temp.data, simd::Columns(data).combine(_mm_set1_ps(v.x), _mm_set1_ps(v.y), _mm_set1_ps(v.z), _mm_set1_ps(v.w)));
+        return temp;
+    }
+
+    template <>
+    inline const vec3_t<float> mat4_t<float>::transformDirection(const vec3_t<float>& v) const
+    {
+        vec3_t<float> temp(DO_NOT_INITIALIZE);
+        simd::storeVec3(temp.data, simd::Columns(data).combine(_mm_set1_ps(v.x), _mm_set1_ps(v.y), _mm_set1_ps(v.z)));
+        return temp;
+    }
+
+    template <>
+    inline const vec3_t<float> mat4_t<float>::transformPosition(const vec3_t<float>& v) const
+    {
+        vec3_t<float> temp(DO_NOT_INITIALIZE);
+        simd::storeVec3(temp.data, simd::Columns(data).combinePosition(_mm_set1_ps(v.x), _mm_set1_ps(v.y), _mm_set1_ps(v.z)));
+        return temp;
+    }
+#endif
 };
@@ -354,4 +354,29 @@ namespace gep
     };
 
     typedef Quaternion_t<float> Quaternion;
+
+#ifdef GEP_MATH3D_SSE
+    // SSE version for float, see simd.h
+
+    template <>
+    inline const Quaternion_t<float> Quaternion_t<float>::operator * (const Quaternion_t<float>& rh) const
+    {
+        // lane i computes component i, the terms the fourth component subtracts are negated
+        const __m128 lh = _mm_loadu_ps(data);
+        const __m128 r = _mm_loadu_ps(rh.data);
+        const __m128 negateW = _mm_castsi128_ps(_mm_set_epi32(0x80000000, 0, 0, 0));
+        // angle * rh.x,    angle * rh.y,    angle * rh.z,     angle * rh.angle
+        const __m128 term1 = _mm_mul_ps(_mm_shuffle_ps(lh, lh, _MM_SHUFFLE(3, 3, 3, 3)), r);
+        // x * rh.angle,    y * rh.angle,    z * rh.angle,    -x * rh.x
+        const __m128 term2 = _mm_xor_ps(_mm_mul_ps(_mm_shuffle_ps(lh, lh, _MM_SHUFFLE(0, 2, 1, 0)), _mm_shuffle_ps(r, r, _MM_SHUFFLE(0, 3, 3, 3))), negateW);
+        // y * rh.z,        z * rh.x,        x * rh.y,        -y * rh.y
+        const __m128 term3 = _mm_xor_ps(_mm_mul_ps(_mm_shuffle_ps(lh, lh, _MM_SHUFFLE(1, 0, 2, 1)), _mm_shuffle_ps(r, r, _MM_SHUFFLE(1, 1, 0, 2))), negateW);
+        // z * rh.y,        x * rh.z,        y * rh.x,         z * rh.z
+        const __m128 term4 = _mm_mul_ps(_mm_shuffle_ps(lh, lh, _MM_SHUFFLE(2, 1, 0, 2)), _mm_shuffle_ps(r, r, _MM_SHUFFLE(2, 0, 2, 1)));
+
+        Quaternion_t<float> res(DO_NOT_INITIALIZE);
+        _mm_storeu_ps(res.data, _mm_sub_ps(_mm_add_ps(_mm_add_ps(term1, term2), term3), term4));
+        return res;
+    }
+#endif
 };
@@ -0,0 +1,81 @@
+#pragma once
+
+// SSE versions of the hot math3d operations for float.
+// They compute exactly what the scalar code computes: the same operations in the same order,
+// just four at a time, so switching between them never changes a result.
+// Define GEP_MATH3D_NO_SSE to use the scalar code only.
+#if !defined(GEP_MATH3D_NO_SSE) && (defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__))
+    #define GEP_MATH3D_SSE
+    #include <emmintrin.h>
+#endif
+
+#ifdef GEP_MATH3D_SSE
+namespace gep
+{
+    namespace simd
+    {
+        /// \brief loads x, y and z, the fourth component is 0
+        inline __m128 loadVec3(const float* v)
+        {
+            // 8 + 4 bytes, never reads past the vector
+            const __m128 xy = _mm_castpd_ps(_mm_load_sd(reinterpret_cast<const double*>(v)));
+            return _mm_movelh_ps(xy, _mm_load_ss(v + 2));
+        }
+
+        /// \brief stores x, y and z, never writes past the vector
+        inline void storeVec3(float* v, __m128 value)
+        {
+            // the compiler turns this into register moves, which is faster than two partial stores
+            float lanes[4];
+            _mm_storeu_ps(lanes, value);
+            v[0] = lanes[0];
+            v[1] = lanes[1];
+            v[2] = lanes[2];
+        }
+
+        /// \brief the columns of a column major 4x4 matrix
+        // The vectors are passed by reference, 32 bit builds can not pass more than three of them by value.
+        struct Columns
+        {
+            __m128 column[4];
+
+            explicit Columns(const float* data)
+            {
+                column[0] = _mm_loadu_ps(data);
+                column[1] = _mm_loadu_ps(data + 4);
+                column[2] = _mm_loadu_ps(data + 8);
+                column[3] = _mm_loadu_ps(data + 12);
+            }
+
+            /// \brief returns column[0] * x + column[1] * y + column[2] * z + column[3], summed up from left to right
+            inline __m128 combinePosition(const __m128& x, const __m128& y, const __m128& z) const
+            {
+                return _mm_add_ps(combine(x, y, z), column[3]);
+            }
+
+            /// \brief returns column[0] * x + column[1] * y + column[2] * z + column[3] * w, summed up from left to right
+            inline __m128 combine(const __m128& x, const __m128& y, const __m128& z, const __m128& w) const
+            {
+                return _mm_add_ps(combine(x, y, z), _mm_mul_ps(column[3], w));
+            }
+
+            /// \brief returns column[0] * x + column[1] * y + column[2] * z, summed up from left to right
+            inline __m128 combine(const __m128& x, const __m128& y, const __m128& z) const
+            {
+                return _mm_add_ps(_mm_add_ps(_mm_mul_ps(column[0], x), _mm_mul_ps(column[1], y)), _mm_mul_ps(column[2], z));
+            }
+
+            /// \brief returns the matrix times the given column major matrix, one column at a time
+            inline void multiply(const float* rh, float* result) const
+            {
+                for(size_t i=0; i < 4; i++)
+                {
+                    const float* rhColumn = rh + i * 4;
+                    _mm_storeu_ps(result + i * 4, combine(_mm_set1_ps(rhColumn[0]), _mm_set1_ps(rhColumn[1]),
+                                                          _mm_set1_ps(rhColumn[2]), _mm_set1_ps(rhColumn[3])));
+                }
+            }
+        };
+    }
+}
+#endif
@@ -4,10 +4,18 @@
 
 namespace gep
 {
+    /// \brief returns a new transform change stamp, it is bigger than every stamp returned before
+    ///
+    /// Transforms take a new stamp whenever they change, see ITransform::getWorldChangeStamp.
+    GEP_API uint64 nextTransformChangeStamp();
+
+    /// \brief returns the most recent transform change stamp without taking a new one
+    GEP_API uint64 getLastTransformChangeStamp();
+
     class GEP_API ITransform
     {
     public:
-        virtual ~ITransform() {}
+        virtual ~ITransform();
 
         virtual void setPosition(const vec3& pos) = 0;
         virtual void setRotation(const Quaternion& rot) = 0;
@@ -30,6 +38,13 @@ namespace gep
         virtual ITransform* getParent() = 0;
         virtual const ITransform* getParent() const = 0;
 
+        /// \brief returns the stamp of the most recent change to this transform or to one of its parents
+        ///
+        /// Transforms which cache their world transformation compute it again once this stamp changes.
+        /// The default returns a new stamp on every call, so children of transforms which do not track
+        /// their changes never use their cache.
+        virtual uint64 getWorldChangeStamp() const { return nextTransformChangeStamp(); }
+
         LUA_BIND_REFERENCE_TYPE_BEGIN
             LUA_BIND_FUNCTION(setPosition)
             LUA_BIND_FUNCTION(setRotation)
@@ -51,6 +66,15 @@ namespace gep
 
     GEP_API ITransform* getIdentityTransform();
 
+    /// \brief transform with a position and rotation relative to a parent transform
+    ///
+    /// The local and the world transformation are cached. Changing a transform takes a new change stamp,
+    /// the world transformation is computed again when the world change stamp of the transform differs
+    /// from the one it was cached with. As long as nothing changed anywhere since a transform was last
+    /// validated, its world transformation is returned without walking the parents at all.
+    /// Parents are validated before their children, so every world transformation is computed once per change,
+    /// no matter if the hierarchy is deep or wide.
+    /// Reading the same transform from several threads is safe, changing it while it is read is not.
     class GEP_API Transform : public ITransform
     {
     public:
@@ -58,32 +82,39 @@ namespace gep
             m_position(),
             m_rotation(),
             m_baseOrientation(),
-            m_pParent(getIdentityTransform())
+            m_pParent(getIdentityTransform()),
+            m_changeStamp(0),
+            m_cachedWorldStamp(INVALID_STAMP),
+            m_validatedAt(INVALID_STAMP),
+            m_cacheLock(0)
         {
         }
         virtual ~Transform() { m_pParent = nullptr; }
 
-        virtual void setPosition(const vec3& pos) override { m_position = pos; }
-        virtual void setRotation(const Quaternion& rot) override { m_rotation = rot; }
-        virtual void setBaseOrientation(const Quaternion& orientation) override { m_baseOrientation = orientation; }
-        virtual void setBaseViewDirection(const vec3& direction) override { m_baseOrientation = Quaternion(direction, vec3(0, 1, 0)); }
+        virtual void setPosition(const vec3& pos) override { m_position = pos; markChanged(); }
+        virtual void setRotation(const Quaternion& rot) override { m_rotation = rot; markChanged(); }
+        virtual void setBaseOrientation(const Quaternion& orientation) override { m_baseOrientation = orientation; markChanged(); }
+        virtual void setBaseViewDirection(const vec3& direction) override { m_baseOrientation = Quaternion(direction, vec3(0, 1, 0)); markChanged(); }
 
         virtual vec3 getWorldPosition() const override
         {
-            return getWorldTransformationMatrix().translationPart();
+            validateWorldCache();
+            return m_worldMatrix.translationPart();
         }
         virtual Quaternion getWorldRotation() const override
         {
-            return m_pParent->getWorldRotation() * m_rotation;
+            validateWorldCache();
+            return m_worldRotation;
         }
 
         virtual mat4 getWorldTransformationMatrix() const override
         {
-            return m_pParent->getWorldTransformationMatrix() * getTransformationMatrix();
+            validateWorldCache();
+            return m_worldMatrix;
         }
-        virtual vec3 getViewDirection() const override { return (getWorldRotation() * m_baseOrientation).toMat3() * vec3(0, 1, 0); }
-        virtual vec3 getUpDirection() const override { return  (getWorldRotation()  * m_baseOrientation).toMat3() * vec3(0, 0, 1); }
-        virtual vec3 getRightDirection() const override { return (getWorldRotation() * m_baseOrientation).toMat3() * vec3(1, 0, 0); }
+        virtual vec3 getViewDirection() const override { validateWorldCache(); return m_worldOrientation * vec3(0, 1, 0); }
+        virtual vec3 getUpDirection() const override { validateWorldCache(); return m_worldOrientation * vec3(0, 0, 1); }
+        virtual vec3 getRightDirection() const override { validateWorldCache(); return m_worldOrientation * vec3(1, 0, 0); }
 
         virtual void setParent(ITransform* parent) override
         {
@@ -92,6 +123,7 @@ namespace gep
                        "set the parent to an identity transform "
                        "(e.g. gep::getIdentityTransform() in C++ or IdentityTransform in Lua).");
             m_pParent = parent;
+            markChanged();
         }
 
         virtual ITransform* getParent() override
@@ -106,7 +138,8 @@ namespace gep
 
         virtual mat4 getTransformationMatrix() const override
         {
-            return mat4::translationMatrix(m_position) * m_rotation.toMat4();
+            validateWorldCache();
+            return m_localMatrix;
         }
 
         virtual vec3 getPosition() const override
@@ -119,11 +152,36 @@ namespace gep
             return m_rotation;
         }
 
+        virtual uint64 getWorldChangeStamp() const override;
+
     protected:
         vec3 m_position;
         Quaternion m_rotation;
         Quaternion m_baseOrientation;
         ITransform* m_pParent;
+        /// stamp of the last change to this transform itself, not to its parents
+        uint64 m_changeStamp;
+
+        /// \brief has to be called by subclasses which change the members directly or whose transformation changes otherwise
+        inline void markChanged()
+        {
+            m_changeStamp = nextTransformChangeStamp();
+        }
 
+    private:
+        static const uint64 INVALID_STAMP = ~0ull;
+
+        // local and world transformation, valid for the world change stamp m_cachedWorldStamp
+        mutable mat4 m_localMatrix;
+        mutable mat4 m_worldMatrix;
+        mutable Quaternion m_worldRotation;
+        /// world rotation combined with the base orientation, its columns are the directions
+        mutable mat3 m_worldOrientation;
+        mutable uint64 m_cachedWorldStamp;
+        /// last change stamp of all transforms when the cache was last found to be valid
+        mutable volatile uint64 m_validatedAt;
+        mutable volatile LONG m_cacheLock;
+
+        void validateWorldCache() const;
     };
 }
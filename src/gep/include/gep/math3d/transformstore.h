@@ -0,0 +1,154 @@
+#pragma once
+#include "gep/math3d/transform.h"
+#include "gep/container/dynamicarray.h"
+
+namespace gep
+{
+    class StoredTransform;
+
+    /// \brief stores many transforms in one place and computes all their world transformations in one pass
+    ///
+    /// Positions, rotations and parents are kept in separate arrays, one per component (structure of arrays),
+    /// sorted so that every parent comes before its children. update() walks the hierarchy level by level and
+    /// computes the world transformations of four transforms at once with SSE. Transforms whose world change stamp
+    /// did not change since the last pass are skipped, four at a time.
+    /// The transforms are used through StoredTransform handles, which implement ITransform. Reading a handle between
+    /// two passes computes its world transformation on demand, exactly like the pass would, so the cached values
+    /// are never stale.
+    /// Creating, destroying, changing and reparenting transforms as well as update() have to happen on one thread.
+    /// Reading the world transformation from several threads is safe as long as nothing changes meanwhile.
+    class GEP_API TransformStore
+    {
+        friend class StoredTransform;
+    public:
+        TransformStore();
+
+        /// \brief computes the world transformation of every transform which changed since the last call
+        /// \return the number of world transformations that were computed
+        size_t update();
+
+        /// \brief returns the number of transforms in the store
+        inline size_t getNumTransforms() const { return m_handles.length() - m_freeIndices.length(); }
+
+    private:
+        static const uint32 NO_PARENT = 0xFFFFFFFF;
+        static const uint64 INVALID_STAMP = ~0ull;
+
+        // the local transformation, one array per component so four transforms are loaded with one instruction
+        DynamicArray<float> m_positionX;
+        DynamicArray<float> m_positionY;
+        DynamicArray<float> m_positionZ;
+        DynamicArray<float> m_rotationX;
+        DynamicArray<float> m_rotationY;
+        DynamicArray<float> m_rotationZ;
+        DynamicArray<float> m_rotationW;
+        DynamicArray<Quaternion> m_baseOrientations;
+        /// index of the parent in this store, NO_PARENT if the parent is not stored here
+        DynamicArray<uint32> m_parentIndices;
+        /// parent which is not stored here, null if there is no parent besides the identity transform
+        DynamicArray<ITransform*> m_externalParents;
+        /// number of children in this store
+        DynamicArray<uint32> m_numChildren;
+        /// stamp of the last change to the transform itself, not to its parents
+        DynamicArray<uint64> m_changeStamps;
+        /// the handle of each transform, null for free entries
+        DynamicArray<StoredTransform*> m_handles;
+
+        // the world transformation, valid for the world change stamps in m_cachedWorldStamps
+        mutable DynamicArray<mat4> m_worldMatrices;
+        mutable DynamicArray<float> m_worldRotationX;
+        mutable DynamicArray<float> m_worldRotationY;
+        mutable DynamicArray<float> m_worldRotationZ;
+        mutable DynamicArray<float> m_worldRotationW;
+        mutable DynamicArray<uint64> m_cachedWorldStamps;
+        /// last change stamp of all transforms when the cache was last found to be valid
+        mutable DynamicArray<uint64> m_validatedAt;
+        mutable DynamicArray<LONG> m_cacheLocks;
+
+        /// entries of destroyed transforms, reused or removed when the store is sorted again
+        DynamicArray<uint32> m_freeIndices;
+        /// end of each level of the hierarchy, level 0 are the transforms without a parent in this store
+        DynamicArray<uint32> m_levelEnds;
+        bool m_isSorted;
+
+        uint32 create(StoredTransform* pHandle);
+        void destroy(uint32 index);
+        void setParent(uint32 index, ITransform* pParent);
+        void setParentOfChildren(uint32 index, ITransform* pParent);
+        ITransform* getParent(uint32 index) const;
+        void markChanged(uint32 index);
+
+        Quaternion getRotation(uint32 index) const;
+        mat4 getLocalMatrix(uint32 index) const;
+        const mat4& getWorldMatrix(uint32 index) const;
+        Quaternion getWorldRotation(uint32 index) const;
+        mat3 getWorldOrientation(uint32 index) const;
+        uint64 getWorldChangeStamp(uint32 index) const;
+
+        void validateWorldCache(uint32 index) const;
+        void computeWorld(uint32 index, const mat4& parentWorld, const Quaternion& parentRotation) const;
+        void sortByDepth();
+        size_t updateGroup(uint32 begin, uint32 count, uint64 lastChange);
+
+        template <class Operation>
+        void forEachArray(Operation& operation);
+
+        GEP_DISALLOW_COPY_AND_ASSIGNMENT(TransformStore);
+    };
+
+    /// \brief handle to a transform in a TransformStore
+    ///
+    /// Behaves like a Transform, but the data lives in the store. The transform is removed from the store
+    /// when the handle is destroyed.
+    class GEP_API StoredTransform : public ITransform
+    {
+        friend class TransformStore;
+    public:
+        explicit StoredTransform(TransformStore& store);
+        virtual ~StoredTransform();
+
+        virtual void setPosition(const vec3& pos) override;
+        virtual void setRotation(const Quaternion& rot) override;
+        virtual void setBaseOrientation(const Quaternion& orientation) override;
+        virtual void setBaseViewDirection(const vec3& direction) override;
+
+        virtual mat4 getWorldTransformationMatrix() const override;
+        virtual vec3 getWorldPosition() const override;
+        virtual Quaternion getWorldRotation() const override;
+
+        virtual mat4 getTransformationMatrix() const override;
+        virtual vec3 getPosition() const override;
+        virtual Quaternion getRotation() const override;
+
+        virtual vec3 getViewDirection() const override;
+        virtual vec3 getUpDirection() const override;
+        virtual vec3 getRightDirection() const override;
+
+        /// \brief sets the parent, parents in the same store are part of the batched update
+        virtual void setParent(ITransform* parent) override;
+        virtual ITransform* getParent() override;
+        virtual const ITransform* getParent() const override;
+
+        virtual uint64 getWorldChangeStamp() const override;
+
+        /// \brief gives all children of this transform in the store the given parent
+        void setParentOfChildren(ITransform* parent);
+
+        /// \brief removes the transform from the store before the handle is destroyed
+        ///
+        /// Its children fall back to the identity transform. Only the destructor may be called afterwards.
+        void removeFromStore();
+
+        /// \brief returns if the transform was not removed from the store yet
+        inline bool isInStore() const { return m_pStore != nullptr; }
+
+        inline TransformStore& getStore() const { return *m_pStore; }
+
+    private:
+        TransformStore* m_pStore;
+        /// index in the store, changes when the store is sorted
+        uint32 m_index;
+
+        GEP_DISALLOW_COPY_AND_ASSIGNMENT(StoredTransform);
+    };
+}
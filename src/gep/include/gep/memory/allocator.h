@@ -38,7 +38,106 @@ namespace gep
         virtual IAllocator* getParentAllocator() const = 0;
     };
 
+    /// \brief size class based allocator with a cache per thread
+    ///
+    /// Small allocations are served from thread local free lists without taking any lock.
+    /// The free lists exchange blocks with a shared pool per size class in batches.
+    /// Allocations bigger than MAX_SMALL_SIZE are passed through to malloc.
+    /// Statistics are counted per thread and only summed up when they are queried.
+    class GEP_API ThreadCachingAllocator : public IAllocatorStatistics
+    {
+    public:
+        static const size_t NUM_SIZE_CLASSES = 16;
+        static const size_t MAX_SMALL_SIZE = 2048;
+
+    private:
+        struct FreeBlock
+        {
+            FreeBlock* pNext;
+        };
+
+        // stored in front of every allocation, keeps the malloc alignment
+        struct BlockHeader
+        {
+            size_t size;
+            size_t sizeClass;
+        };
+
+        struct ChunkHeader
+        {
+            ChunkHeader* pNext;
+            size_t size;
+        };
+
+        struct CentralFreeList
+        {
+            Mutex mutex;
+            FreeBlock* pFirst;
+            size_t count;
+            ChunkHeader* pChunks;
+        };
+
+        struct ThreadCache
+        {
+            ThreadCachingAllocator* pOwner;
+            ThreadCache* pPrev;
+            ThreadCache* pNext;
+            FreeBlock* freeLists[NUM_SIZE_CLASSES];
+            size_t freeCounts[NUM_SIZE_CLASSES];
+            // only written by the owning thread
+            volatile size_t numAllocations;
+            volatile size_t numFrees;
+            volatile ptrdiff_t bytesUsed;
+        };
+
+        static const size_t LARGE_SIZE_CLASS = NUM_SIZE_CLASSES;
+        static const size_t MIN_CHUNK_SIZE = 64 * 1024;
+
+        uint32 m_cacheIndex;
+        uint8 m_sizeClassLookup[MAX_SMALL_SIZE / 16 + 1];
+        CentralFreeList m_central[NUM_SIZE_CLASSES];
+
+        mutable Mutex m_cacheListMutex;
+        ThreadCache* m_pCaches;
+        size_t m_retiredNumAllocations;
+        size_t m_retiredNumFrees;
+        ptrdiff_t m_retiredBytesUsed;
+
+        volatile int64 m_chunkBytesReserved;
+        volatile int64 m_largeBytesReserved;
+
+        GEP_DISALLOW_COPY_AND_ASSIGNMENT(ThreadCachingAllocator);
+
+        ThreadCache* getThreadCache();
+        ThreadCache* createThreadCache();
+        void retireThreadCache(ThreadCache* pCache);
+        Result fetchFromCentral(ThreadCache* pCache, size_t sizeClass);
+        void releaseToCentral(ThreadCache* pCache, size_t sizeClass, size_t numBlocks);
+        Result allocateChunk(size_t sizeClass);
+
+        static void __stdcall threadCacheDestructor(void* pCache);
+
+    public:
+        ThreadCachingAllocator();
+        ~ThreadCachingAllocator();
+
+        // IAllocator interface
+        virtual void* allocateMemory(size_t size) override;
+        virtual void freeMemory(void* mem) override;
+
+        // IAllocatorStatistics Interface
+        virtual size_t getNumAllocations() const override;
+        virtual size_t getNumFrees() const override;
+        virtual size_t getNumBytesReserved() const override;
+        virtual size_t getNumBytesUsed() const override;
+        virtual IAllocator* getParentAllocator() const override;
+
+        /// \brief returns the usable size of the given size class
+        static size_t getSizeClassSize(size_t sizeClass);
+    };
+
     /// \brief standard allocator
+    /// forwards to a ThreadCachingAllocator, so allocations from different threads do not serialize
     class GEP_API StdAllocator : public IAllocatorStatistics
     {
     private:
@@ -50,12 +149,7 @@ namespace gep
 
         static Mutex s_creationMutex;
 
-        size_t m_numAllocations;
-        size_t m_numFrees;
-        size_t m_bytesAllocated;
-        size_t m_peakBytesAllocated;
-
-        Mutex m_allocationLock;
+        ThreadCachingAllocator m_allocator;
 
         StdAllocator(){}
         ~StdAllocator(){}
@@ -199,6 +199,98 @@ namespace gep
         // returns the memory reserved by the internally used dynamic arrays of both stack allocators
         size_t getDynamicArraysSize() const;
     };
+
+    /// \brief single threaded allocator for many small objects whose size is known when they are freed
+    ///
+    /// Sizes up to MAX_SMALL_SIZE are rounded up to one of NUM_SIZE_CLASSES size classes.
+    /// Every size class cuts its blocks from pages of PAGE_SIZE bytes and keeps freed blocks in a free list,
+    /// there is no header in front of the blocks. Pages are only given back to the parent allocator on destruction.
+    /// Resizing a block within its size class does not move it, and neither does shrinking it into a smaller one.
+    /// Bigger allocations are passed through to the parent allocator.
+    /// This is the interface of Lua's lua_Alloc, which always passes the size of the block.
+    class GEP_API SmallObjectAllocator : public IAllocatorStatistics
+    {
+    public:
+        static const size_t NUM_SIZE_CLASSES = 16;
+        static const size_t MAX_SMALL_SIZE = 512;
+        static const size_t PAGE_SIZE = 16 * 1024;
+
+    private:
+        struct FreeBlock
+        {
+            FreeBlock* pNext;
+        };
+
+        struct Page
+        {
+            Page* pNext;
+            // keeps the blocks 16 byte aligned
+            size_t padding[(16 - sizeof(Page*)) / sizeof(size_t)];
+        };
+
+        struct SizeClass
+        {
+            FreeBlock* pFreeList;
+            // the part of the newest page that has not been handed out yet
+            char* pUnused;
+            char* pUnusedEnd;
+        };
+
+        static const size_t SIZE_CLASS_GRANULARITY = 16;
+        static const size_t LARGE_SIZE_CLASS = NUM_SIZE_CLASSES;
+
+        IAllocator* m_pParentAllocator;
+        SizeClass m_sizeClasses[NUM_SIZE_CLASSES];
+        uint8 m_sizeClassLookup[MAX_SMALL_SIZE / SIZE_CLASS_GRANULARITY + 1];
+        Page* m_pPages;
+
+        size_t m_numAllocations;
+        size_t m_numFrees;
+        size_t m_numBytesUsed;
+        size_t m_numBytesReserved;
+
+        GEP_DISALLOW_COPY_AND_ASSIGNMENT(SmallObjectAllocator);
+
+        inline size_t getSizeClass(size_t size) const
+        {
+            return (size <= MAX_SMALL_SIZE) ? m_sizeClassLookup[(size + SIZE_CLASS_GRANULARITY - 1) / SIZE_CLASS_GRANULARITY] : LARGE_SIZE_CLASS;
+        }
+
+        void* allocateFromNewPage(size_t sizeClass);
+
+    public:
+        SmallObjectAllocator(IAllocator* pParentAllocator);
+        ~SmallObjectAllocator();
+
+        /// \brief allocates at least size bytes
+        void* allocate(size_t size);
+
+        /// \brief frees a block, size has to be the size it was allocated or last reallocated with
+        void deallocate(void* mem, size_t size);
+
+        /// \brief resizes a block, allocates a new one if mem is null and frees it if newSize is 0
+        ///
+        /// The block only moves if it grows into another size class or shrinks from a large block into a size class.
+        /// Shrinking never fails.
+        void* reallocate(void* mem, size_t originalSize, size_t newSize);
+
+        // IAllocator interface
+        // Without the size the block can not be found in the size classes,
+        // so these are passed through to the parent allocator and do not count as bytes used.
+        virtual void* allocateMemory(size_t size) override;
+        virtual void freeMemory(void* mem) override;
+
+        // IAllocatorStatistics Interface
+        virtual size_t getNumAllocations() const override;
+        virtual size_t getNumFrees() const override;
+        virtual size_t getNumBytesReserved() const override;
+        /// \brief the sum of the sizes that were requested for the alive blocks
+        virtual size_t getNumBytesUsed() const override;
+        virtual IAllocator* getParentAllocator() const override;
+
+        /// \brief returns the usable size of the given size class
+        static size_t getSizeClassSize(size_t sizeClass);
+    };
 }
 
 #define ALIGNMENT AlignmentHelper::__ALIGNMENT
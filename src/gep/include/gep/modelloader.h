@@ -8,11 +8,15 @@
 #include "gep/math3d/aabb.h"
 #include "gep/memory/allocators.h"
 #include "gep/container/hashmap.h"
+#include "gep/chunkfile.h"
 
 struct ID3D11Device;
 
 namespace gep
 {
+    // forward declarations
+    class TaskQueue;
+
     /// \brief supported texture types
     enum class TextureType : gep::uint8
     {
@@ -56,7 +60,7 @@ namespace gep
         };
     };
 
-    class ModelLoader
+    class GEP_API ModelLoader
     {
     public:
         struct Load
@@ -254,7 +258,13 @@ namespace gep
         ///   the filename to load the model from
         /// \param loadWhat
         ///   which data should be loaded. Combination of Load::Enum values
-        void loadFile(const char* pFilename, uint32 loadWhat);
+        /// \param readOperation
+        ///   Chunkfile::Operation::mappedRead or Chunkfile::Operation::read, the mapped file avoids a read call per value
+        /// \param pTaskQueue
+        ///   if not null the vertex data and faces of the meshes are decoded in parallel on this task queue,
+        ///   after the file has been parsed on the calling thread
+        void loadFile(const char* pFilename, uint32 loadWhat, Chunkfile::Operation readOperation = Chunkfile::Operation::mappedRead,
+                      TaskQueue* pTaskQueue = nullptr);
         void loadFromData(SmartPtr<ReferenceCounted> pDataHolder, ArrayPtr<vec4> vertices, ArrayPtr<uint32> indices);
     };
 }
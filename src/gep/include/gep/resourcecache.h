@@ -0,0 +1,67 @@
+#pragma once
+
+#include "gep/gepmodule.h"
+#include "gep/ArrayPtr.h"
+#include "gep/container/DynamicArray.h"
+#include "gep/threading/mutex.h"
+
+namespace gep
+{
+    /// \brief on disk cache for converted resource data, keyed by the hash of the source data
+    ///
+    /// A loader which converts its source (e.g. compiles a shader) stores the result under the hash of the
+    /// source file, the next start finds it there and skips the conversion.
+    /// Every entry also stores a version which the loader increments whenever its output format changes.
+    /// Damaged or outdated entries are treated as misses and overwritten by the next store.
+    /// All methods are thread safe.
+    class GEP_API ResourceCache
+    {
+    public:
+        struct Statistics
+        {
+            /// \brief number of entries found in the cache
+            uint64 numHits;
+            /// \brief number of entries which were missing, outdated or damaged
+            uint64 numMisses;
+            /// \brief number of entries written to the cache
+            uint64 numStores;
+            /// \brief sum of the conversion times the hits skipped, in milliseconds
+            float savedTimeMs;
+        };
+
+    private:
+        std::string m_directory;
+        Mutex m_mutex;
+        Statistics m_statistics;
+
+        GEP_DISALLOW_COPY_AND_ASSIGNMENT(ResourceCache);
+
+        std::string getFilename(const char* resourceType, uint64 contentHash);
+
+    public:
+        /// \brief hashes the given data, the hash is the same on every platform and build and may be stored
+        ///
+        /// The hash is not cryptographic, it is only meant to tell apart data which was not crafted to collide.
+        static uint64 hashContent(ArrayPtr<const uint8> data, uint64 seed = 0);
+
+        /// \brief hashes the content of the given file with hashContent
+        static Result hashFile(const char* filename, uint64& hash);
+
+        /// \brief uses the given directory, it is created if it does not exist
+        ResourceCache(const char* directory);
+
+        inline const char* getDirectory() const { return m_directory.c_str(); }
+
+        /// \brief loads the converted data of a resource
+        /// \return FAILURE if there is no entry for the hash and version
+        Result load(const char* resourceType, uint64 contentHash, uint32 version, DynamicArray<uint8>& payload);
+
+        /// \brief stores the converted data of a resource, replacing an existing entry
+        /// \param conversionTimeMs
+        ///   the time the conversion took, the loads which hit the entry count it as saved
+        Result store(const char* resourceType, uint64 contentHash, uint32 version, ArrayPtr<const uint8> payload, float conversionTimeMs);
+
+        /// \brief returns the hits, misses and stores so far
+        Statistics getStatistics();
+    };
+}
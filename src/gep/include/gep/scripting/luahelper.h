@@ -86,20 +86,13 @@ namespace lua
             {
                 typedef __RM_P(T_Ptr) T;
 
-                lua_newtable(L);
-                auto tableIndex = lua_gettop(L);
-                pushTableEntry<const char*, void*>(L, "__ptr", pObject);
-
-                lua_pushcfunction(L, lua::utils::ptrCompare);
-                lua_setfield(L, tableIndex, "equals");
-
-                lua_pushcfunction(L, lua::utils::nullCheck);
-                lua_setfield(L, tableIndex, "isNull");
-
                 auto& scriptTypeInfo = gep::getScriptTypeInfo<T>();
 
-                luaL_setmetatable(L, scriptTypeInfo.getMetaTableName());
-                IncreaseReferenceCount<std::is_convertible<T_Ptr, gep::ReferenceCounted*>::value>::addRef(pObject);
+                // every proxy holds one reference, the cached ones already have it
+                if(!lua::utils::pushProxy(L, pObject, scriptTypeInfo.getMetaTableName()))
+                {
+                    IncreaseReferenceCount<std::is_convertible<T_Ptr, gep::ReferenceCounted*>::value>::addRef(pObject);
+                }
                 return 1;
             }
         };
@@ -30,7 +30,8 @@
 
 #define LUA_BIND_REFERENCE_TYPE_BEGIN public:          \
     typedef lua::structs::ReferenceTypeMarker LuaType; \
-    _LUA_BIND_TYPE_BEGIN
+    _LUA_BIND_TYPE_BEGIN                               \
+        lua::utils::addProxyFunctions(L, metaTableIndex);
 
 #define LUA_BIND_REFERENCE_TYPE_END \
         lua_pop(L, 1);              \
@@ -35,6 +35,31 @@ namespace lua
 
         GEP_API int nullCheck(lua_State* L);
 
+        /// \brief adds equals and isNull to the metatable at the given index, shared by all proxies of that type
+        GEP_API void addProxyFunctions(lua_State* L, int metaTableIndex);
+
+        /// \brief pushes the proxy table of the given object
+        ///
+        /// Proxies are cached in a registry table with weak values, keyed by the object pointer,
+        /// so pushing the same object again returns the same table without allocating.
+        /// \return true if the cached proxy was pushed, false if a new one was created
+        GEP_API bool pushProxy(lua_State* L, void* pObject, const char* metaTableName);
+
+        /// \brief call this when an object that may have been pushed to Lua is destroyed
+        ///
+        /// Scripts still holding its proxy see a null object, and a new object at the same address gets a new proxy.
+        /// Not needed for reference counted objects, their proxies keep them alive.
+        GEP_API void invalidateProxy(lua_State* L, void* pObject);
+
+        /// \brief invalidates the proxy of the object in the state of the scripting manager, see setProxyState
+        ///
+        /// Bound reference types which are no game objects call this in their destructors.
+        /// Does nothing while there is no such state, e.g. for objects destroyed after the scripting manager.
+        GEP_API void invalidateProxy(void* pObject);
+
+        /// \brief sets the state invalidateProxy(void*) works on, nullptr when the state is closed
+        GEP_API void setProxyState(lua_State* L);
+
         /// \brief Checks the type of the item on the stack with the given \a expectedLuaType
         /// \remark may raise a lua error
         inline void typeCheck(lua_State* L, int expectedLuaType, int index, const char* expectedName = nullptr)
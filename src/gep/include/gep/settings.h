@@ -25,12 +25,21 @@ namespace gep
             std::string setupScript;
             std::string importantScriptsRoot;
             std::string userScriptsRoot;
+            /// \brief time the Lua garbage collector may spend per frame, in milliseconds
+            float garbageCollectionBudgetMs;
+            /// \brief when the collector falls behind its budget grows up to this, in milliseconds
+            float maxGarbageCollectionBudgetMs;
+            /// \brief use the generational collector of Lua instead of the incremental one
+            bool generationalGarbageCollection;
 
             Scripts()
                 : mainScript("data/scripts/main.lua")
                 , setupScript("data/scripts/setup.lua")
                 , importantScriptsRoot("data/base/")
                 , userScriptsRoot("data/scripts/")
+                , garbageCollectionBudgetMs(1.0f)
+                , maxGarbageCollectionBudgetMs(4.0f)
+                , generationalGarbageCollection(false)
             {
             }
 
@@ -58,6 +67,57 @@ namespace gep
             }
         };
         
+        struct TaskQueue
+        {
+            /// \brief number of workers including the game thread, 0 uses one worker per hardware thread
+            size_t numWorkers;
+            /// \brief if each worker thread should only run on its own core
+            bool pinWorkersToCores;
+
+            TaskQueue() :
+                numWorkers(0),
+                pinWorkersToCores(false)
+            {
+            }
+        };
+
+        struct Resources
+        {
+            /// \brief number of threads which load resources asynchronously
+            size_t numLoaderThreads;
+            /// \brief time the resources may spend finalizing per frame, in milliseconds, 0 is unlimited
+            float finalizeBudgetMs;
+            /// \brief number of bytes which may be finalized per frame, 0 is unlimited
+            size_t finalizeBudgetBytes;
+            /// \brief loads of sources with the same content share one resource
+            bool shareIdenticalResources;
+            /// \brief directory of the cache for converted resources, empty disables the cache
+            std::string cacheDirectory;
+
+            Resources() :
+                numLoaderThreads(2),
+                finalizeBudgetMs(2.0f),
+                finalizeBudgetBytes(16 * 1024 * 1024),
+                shareIdenticalResources(true),
+                cacheDirectory("cache")
+            {
+            }
+        };
+
+        struct Logging
+        {
+            /// \brief logging a message only copies its arguments, the writer thread formats them
+            bool deferredFormatting;
+            /// \brief file of the binary log sink which stores the deferred messages unformatted, empty disables it
+            std::string binaryLogFile;
+
+            Logging() :
+                deferredFormatting(false),
+                binaryLogFile("logfile.bin")
+            {
+            }
+        };
+
         struct Lua
         {
             size_t maxStackDumpLevel;
@@ -98,6 +158,18 @@ namespace gep
         virtual       settings::Scripts& getScriptsSettings() = 0;
         virtual const settings::Scripts& getScriptsSettings() const = 0;
 
+        virtual void setTaskQueueSettings(const settings::TaskQueue& settings) = 0;
+        virtual       settings::TaskQueue& getTaskQueueSettings() = 0;
+        virtual const settings::TaskQueue& getTaskQueueSettings() const = 0;
+
+        virtual void setResourcesSettings(const settings::Resources& settings) = 0;
+        virtual       settings::Resources& getResourcesSettings() = 0;
+        virtual const settings::Resources& getResourcesSettings() const = 0;
+
+        virtual void setLoggingSettings(const settings::Logging& settings) = 0;
+        virtual       settings::Logging& getLoggingSettings() = 0;
+        virtual const settings::Logging& getLoggingSettings() const = 0;
+
         virtual void setLuaSettings(const settings::Lua& settings) = 0;
         virtual       settings::Lua& getLuaSettings() = 0;
         virtual const settings::Lua& getLuaSettings() const = 0;
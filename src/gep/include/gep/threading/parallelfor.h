@@ -0,0 +1,101 @@
+#pragma once
+
+#include "gep/threading/taskQueue.h"
+#include "gep/container/DynamicArray.h"
+
+namespace gep
+{
+    namespace detail
+    {
+        template <class F>
+        struct ParallelForRangeContext
+        {
+            static void call(void* pContext, size_t chunkIndex, size_t begin, size_t end)
+            {
+                (*static_cast<const F*>(pContext))(begin, end);
+            }
+        };
+
+        template <class F>
+        struct ParallelForContext
+        {
+            const F* pFunction;
+
+            static void call(void* pContext, size_t chunkIndex, size_t begin, size_t end)
+            {
+                const F& function = *static_cast<ParallelForContext<F>*>(pContext)->pFunction;
+                for(size_t i = begin; i < end; i++)
+                    function(i);
+            }
+        };
+
+        template <class T, class Map, class Combine>
+        struct ParallelReduceContext
+        {
+            const T* pIdentity;
+            const Map* pMap;
+            const Combine* pCombine;
+            T* pPartialResults;
+
+            static void call(void* pContext, size_t chunkIndex, size_t begin, size_t end)
+            {
+                auto& context = *static_cast<ParallelReduceContext<T, Map, Combine>*>(pContext);
+                T result = *context.pIdentity;
+                for(size_t i = begin; i < end; i++)
+                    result = (*context.pCombine)(result, (*context.pMap)(i));
+                context.pPartialResults[chunkIndex] = result;
+            }
+        };
+    }
+
+    /// \brief calls function(begin, end) for consecutive sub ranges of [begin, end) in parallel
+    ///
+    /// Each sub range has at least grainSize elements (except for the last one).
+    /// Returns when all sub ranges are processed, the calling thread helps processing them.
+    template <class F>
+    void parallelForRange(TaskQueue& taskQueue, size_t begin, size_t end, size_t grainSize, const F& function)
+    {
+        if(end <= begin)
+            return;
+        const size_t chunkSize = taskQueue.calculateChunkSize(end - begin, grainSize);
+        taskQueue.runParallelFor(begin, end, chunkSize, &detail::ParallelForRangeContext<F>::call, const_cast<F*>(&function));
+    }
+
+    /// \brief calls function(i) for every i in [begin, end) in parallel
+    ///
+    /// The elements are processed in chunks of at least grainSize elements.
+    /// Returns when all elements are processed, the calling thread helps processing them.
+    template <class F>
+    void parallelFor(TaskQueue& taskQueue, size_t begin, size_t end, size_t grainSize, const F& function)
+    {
+        if(end <= begin)
+            return;
+        detail::ParallelForContext<F> context = { &function };
+        const size_t chunkSize = taskQueue.calculateChunkSize(end - begin, grainSize);
+        taskQueue.runParallelFor(begin, end, chunkSize, &detail::ParallelForContext<F>::call, &context);
+    }
+
+    /// \brief computes combine(...combine(combine(identity, map(begin)), map(begin + 1))..., map(end - 1)) in parallel
+    ///
+    /// combine has to be associative, identity has to be its neutral element.
+    /// The partial results are combined in the order of the elements, so combine does not need to be commutative
+    /// and the result is the same on every run for a given number of workers.
+    template <class T, class Map, class Combine>
+    T parallelReduce(TaskQueue& taskQueue, size_t begin, size_t end, size_t grainSize, const T& identity, const Map& map, const Combine& combine)
+    {
+        if(end <= begin)
+            return identity;
+        const size_t chunkSize = taskQueue.calculateChunkSize(end - begin, grainSize);
+        const size_t numChunks = (end - begin + chunkSize - 1) / chunkSize;
+
+        DynamicArray<T> partialResults;
+        partialResults.resize(numChunks);
+        detail::ParallelReduceContext<T, Map, Combine> context = { &identity, &map, &combine, partialResults.toArray().getPtr() };
+        taskQueue.runParallelFor(begin, end, chunkSize, &detail::ParallelReduceContext<T, Map, Combine>::call, &context);
+
+        T result = identity;
+        for(auto& partialResult : partialResults)
+            result = combine(result, partialResult);
+        return result;
+    }
+}
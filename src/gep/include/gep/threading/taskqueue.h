@@ -4,9 +4,11 @@
 #include "gep/gepmodule.h"
 #include "gep/threading/thread.h"
 #include "gep/threading/semaphore.h"
+#include "gep/threading/workStealingDeque.h"
 #include "gep/container/DynamicArray.h"
 #include "gep/container/Queue.h"
 #include "gep/types.h"
+#include "gep/timer.h"
 #include <functional>
 
 namespace gep
@@ -36,27 +38,56 @@ namespace gep
         virtual void execute() override { if(m_executable) m_executable(); }
     };
 
+    class TaskGroup;
+
+    /// \brief a task of a group which has been scheduled for execution
+    struct ScheduledTask
+    {
+        ITask* pTask;
+        TaskGroup* pGroup;
+    };
+
     /// \brief Groups together tasks which can be executed in parallel
+    ///
+    /// Groups can depend on other groups, a scheduled group only starts executing
+    /// once all of its dependencies finished. Groups without dependencies between them
+    /// are executed at the same time. All dependencies of a scheduled group have to be
+    /// scheduled as well and a group may only be scheduled again once its dependents finished.
+    /// A single task with dependencies is a group with one task.
     class GEP_API TaskGroup
     {
         friend class TaskQueue;
         friend class TaskWorker;
     private:
-        bool m_isExecuting;
+        volatile bool m_isExecuting;
         TaskQueue* m_pTaskQueue;
         std::function<void(ArrayPtr<ITask*>)> m_finishedCallback;
         volatile uint32 m_numRemainingTasks;
+        // number of tasks handed out to workers so far
+        volatile LONG m_numTasksClaimed;
+        // number of dependencies which did not finish yet, +1 until the group is scheduled
+        volatile LONG m_numPendingDependencies;
         DynamicArray<ITask*> m_tasks;
+        DynamicArray<ScheduledTask> m_scheduledTasks;
+        DynamicArray<TaskGroup*> m_dependencies;
+        DynamicArray<TaskGroup*> m_dependents;
 
         TaskGroup(TaskQueue* pTaskQueue);
 
         void reset();
         void taskFinished();
+        void dependencyFinished();
 
     public:
         /// \brief adds a task to the task group
         void addTask(ITask* pTask);
 
+        /// \brief the group will only start executing after the given group finished
+        void addDependency(TaskGroup* pDependency);
+
+        /// \brief removes a dependency previously added with addDependency
+        void removeDependency(TaskGroup* pDependency);
+
         /// \brief sets a function which should be called when the task group finished
         inline void setOnFinished(std::function<void(ArrayPtr<ITask*>)> onFinished)
         {
@@ -64,34 +95,87 @@ namespace gep
             m_finishedCallback = onFinished;
         }
 
+        /// \brief returns if the group is scheduled or executing
+        inline bool isExecuting() const { return m_isExecuting; }
+    };
+
+    /// \brief counters of a single task worker, for tuning the task queue
+    struct TaskWorkerStatistics
+    {
+        /// \brief number of tasks the worker executed, including stolen ones
+        uint64 numTasksExecuted;
+        /// \brief number of tasks the worker stole from other workers
+        uint64 numTasksStolen;
+        /// \brief number of times the worker found no work to steal
+        uint64 numFailedSteals;
+        /// \brief number of times the worker went to sleep
+        uint64 numParks;
+        /// \brief seconds spent executing tasks
+        float busyTime;
+        /// \brief seconds spent looking for work without sleeping
+        float spinTime;
+        /// \brief seconds spent sleeping
+        float idleTime;
     };
 
     /// \brief worker which executes a single task at a time
-    /// each worker has its own task queue
-    /// if the task queue is empty it tries to steal tasks from other workers
+    /// each worker has its own lock-free task deque which it works on in LIFO order
+    /// if the deque is empty it takes a share of one of the ready groups or steals tasks from random other workers
     class GEP_API TaskWorker
         : public Thread
     {
         friend class TaskQueue;
     private:
+        // number of failed steal attempts which spin before yielding the time slice
+        static const uint32 NUM_SPINNING_STEALS = 6;
+        // bounds of the number of failed steal attempts after which the worker goes to sleep,
+        // the limit adapts to how long the worker usually has to wait for new work
+        static const uint32 MIN_FAILED_STEALS = 8;
+        static const uint32 MAX_FAILED_STEALS = 256;
+
         TaskQueue* m_pTaskQueue;
-        TaskGroup* m_pActiveGroup;
         Semaphore m_hasWorkSemaphore;
-        DynamicArray<ITask*> m_tasks;
-        Mutex m_tasksMutex;
+        // 1 while the worker sleeps (or is about to) on m_hasWorkSemaphore
+        volatile LONG m_isParked;
+        WorkStealingDeque<ScheduledTask*> m_tasks;
+        uint32 m_randomState;
+        uint32 m_maxFailedSteals;
+        size_t m_coreIndex;
 
-        inline void setActiveGroup(TaskGroup* pGroup) { m_pActiveGroup = pGroup; }
-        void addTasks(ArrayPtr<ITask*> tasks);
+        // only written by the thread running the worker
+        volatile uint64 m_numTasksExecuted;
+        volatile uint64 m_numTasksStolen;
+        volatile uint64 m_numFailedSteals;
+        volatile uint64 m_numParks;
+        volatile uint64 m_busyTicks;
+        volatile uint64 m_spinTicks;
+        volatile uint64 m_idleTicks;
 
+        // moves a share of the not yet claimed tasks of a ready group into our deque
+        Result claimTasks();
+        Result claimTasks(TaskGroup* pGroup);
+        // executes a task and notifies its group
+        void executeTask(ScheduledTask* pTask);
         // runs a single task
         Result runSingleTask();
-        // tries to steal tasks from other task workers
-        Result stealTasks();
+        // tries to steal a task from a random other worker and runs it
+        Result stealTask();
+        Result stealTask(TaskWorker* pVictim);
         // runs tasks until there is no more work
         void runTasks();
+        // sleeps until new work is available
+        void park();
+        // returns if other workers could steal tasks from this worker
+        inline bool hasTasks() const { return !m_tasks.isEmpty(); }
+        // wakes the worker up if it is sleeping, returns SUCCESS if it was
+        Result wakeUp();
 
     public:
-        TaskWorker(TaskQueue* pTaskQueue);
+        /// \brief coreIndex is the core the worker thread is pinned to, -1 for no pinning
+        TaskWorker(TaskQueue* pTaskQueue, size_t coreIndex = (size_t)-1);
+
+        /// \brief returns the counters of this worker, they are updated while the worker is running
+        TaskWorkerStatistics getStatistics() const;
 
         virtual void run() override;
     };
@@ -101,20 +185,67 @@ namespace gep
     {
         friend class TaskWorker;
         friend class TaskGroup;
+    public:
+        /// \brief function which processes the elements [begin, end) of a parallel loop
+        typedef void (*ParallelForFunction)(void* pContext, size_t chunkIndex, size_t begin, size_t end);
+
     private:
+        class ParallelForNode;
+
+        // number of groups the workers can take tasks from at the same time
+        static const size_t MAX_READY_GROUPS = 64;
+        // upper limit for the number of chunks a parallel loop is split into, per worker
+        static const size_t MAX_CHUNKS_PER_WORKER = 32;
+        // number of threads which are no worker but call into the queue at the same time, besides the one using the local worker
+        static const size_t MAX_OUTSIDE_WORKERS = 16;
+
         bool m_isRunning;
-        TaskGroup* m_currentTaskGroup;
         Mutex m_schedulingMutex;
-        Queue<TaskGroup*> m_remainingTaskGroups;
+        // groups whose dependencies are finished, read by the workers without locking
+        TaskGroup* volatile m_readyGroups[MAX_READY_GROUPS];
+        // ready groups which did not fit into m_readyGroups
+        Queue<TaskGroup*> m_waitingGroups;
         DynamicArray<TaskGroup*> m_unusedTaskGroups;
         DynamicArray<TaskWorker*> m_worker;
+        // worker of the thread which called attachLocalWorker, usually the game thread
         TaskWorker m_localWorker;
+        volatile LONG m_isLocalWorkerUsed;
+        // workers of the other threads which are no worker (e.g. the resource loaders),
+        // each thread needs its own because only the owner of a deque may push and pop.
+        // The workers of exited threads are reused, they stay in the array so their remaining tasks can be stolen.
+        TaskWorker* volatile m_outsideWorkers[MAX_OUTSIDE_WORKERS];
+        volatile LONG m_numOutsideWorkers;
+        // outside workers whose thread exited, protected by m_schedulingMutex
+        DynamicArray<TaskWorker*> m_freeOutsideWorkers;
+        Timer m_timer;
+        // FLS slot with the worker run by the current thread, the destructor gives back outside workers of exited threads
+        uint32 m_currentWorkerFlsIndex;
 
-        void scheduleNextGroup();
+        void groupReady(TaskGroup* pGroup);
+        void groupFinished(TaskGroup* pGroup);
+        // returns the worker of the calling thread, threads which are no worker get one on their first call
+        TaskWorker* getCurrentWorker();
+        // reuses or creates the worker for a thread which is no worker
+        TaskWorker* addOutsideWorker();
+        // called when a thread which has a worker of this queue exits
+        static void __stdcall currentWorkerDestructor(void* pWorker);
+        // adds a task to the group while it is executing, the current worker executes it or it gets stolen
+        void spawnTask(ScheduledTask* pTask);
+        bool hasStealableTasks() const;
+        void wakeUpWorker();
     public:
-        TaskQueue();
+        /// \brief creates a task queue with numWorkers workers, including the local worker (see attachLocalWorker)
+        /// \param numWorkers the number of workers, 0 uses one worker per hardware thread
+        /// \param pinWorkersToCores if each worker thread should only run on its own core
+        explicit TaskQueue(size_t numWorkers = 0, bool pinWorkersToCores = false);
         ~TaskQueue();
 
+        /// \brief lets the calling thread use the local worker, whose statistics are at index 0
+        ///
+        /// The game thread calls this before it uses the queue. Other threads which are no worker get a worker of their own,
+        /// it is given back when the thread exits. Only one thread at a time can use the local worker.
+        void attachLocalWorker();
+
         /// \brief creates a new task group
         TaskGroup* createGroup();
 
@@ -122,8 +253,24 @@ namespace gep
         void deleteGroup(TaskGroup*);
 
         /// \brief schedules a task group for execution, it should at least contain 1 task
+        /// the group starts executing as soon as all of its dependencies finished
         void scheduleForExecution(TaskGroup* group);
 
+        /// \brief runs tasks until the given group finished executing
+        /// can be called from within a task, the worker running the task helps out then.
+        /// Any thread may call this, threads which are no worker get their own task deque on their first call.
+        void waitForGroup(TaskGroup* group);
+
+        /// \brief returns the chunk size runParallelFor should use for the given number of elements,
+        /// at least grainSize elements per chunk
+        size_t calculateChunkSize(size_t numElements, size_t grainSize) const;
+
+        /// \brief calls pFunction for the chunks of [begin, end) in parallel and waits until all of them are done
+        ///
+        /// The range is split recursively, so idle workers steal the biggest remaining parts.
+        /// The calling thread helps executing. Use gep::parallelFor and gep::parallelReduce instead of calling this directly.
+        void runParallelFor(size_t begin, size_t end, size_t chunkSize, ParallelForFunction pFunction, void* pContext);
+
         /// \brief tries to run a single task from the queue
         /// \return SUCCESS if successfull, FAILURE otherwise
         Result runSingleTask();
@@ -133,5 +280,11 @@ namespace gep
 
         /// \brief stops execution of tasks, blocks until all tasks are stopped
         void stop();
+
+        /// \brief returns the number of workers, including the local worker
+        inline size_t getNumWorkers() const { return m_worker.length(); }
+
+        /// \brief returns the counters of a worker, index 0 is the local worker, see attachLocalWorker
+        TaskWorkerStatistics getWorkerStatistics(size_t workerIndex) const;
     };
 }
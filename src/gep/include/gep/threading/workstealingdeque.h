@@ -0,0 +1,160 @@
+#pragma once
+
+#include "gep/gepmodule.h"
+#include "gep/common.h"
+#include "gep/memory/allocator.h"
+#include <Windows.h>
+#include <type_traits>
+
+namespace gep
+{
+    /// \brief lock-free work stealing deque (Chase-Lev)
+    ///
+    /// Only the owning thread may call push and pop, which work on the bottom end (LIFO).
+    /// Any other thread may call steal, which takes from the top end (FIFO).
+    /// T has to be a pointer type, nullptr is returned if no element could be taken.
+    ///
+    /// The indices are 32 bit counters that are allowed to wrap around,
+    /// so they are only ever compared through their difference.
+    template <class T>
+    class WorkStealingDeque
+    {
+        static_assert(std::is_pointer<T>::value, "WorkStealingDeque only supports pointer types");
+    private:
+        struct Buffer
+        {
+            LONG mask;
+            Buffer* pPrevious;
+            T* elements;
+
+            inline T get(LONG index) const { return elements[index & mask]; }
+            inline void put(LONG index, T value) { elements[index & mask] = value; }
+        };
+
+        volatile LONG m_top;
+        volatile LONG m_bottom;
+        Buffer* volatile m_pBuffer;
+        IAllocator* m_pAllocator;
+
+        GEP_DISALLOW_COPY_AND_ASSIGNMENT(WorkStealingDeque);
+
+        static inline LONG distance(LONG from, LONG to)
+        {
+            return (LONG)((ULONG)to - (ULONG)from);
+        }
+
+        Buffer* allocateBuffer(LONG capacity, Buffer* pPrevious)
+        {
+            auto pBuffer = static_cast<Buffer*>(m_pAllocator->allocateMemory(sizeof(Buffer) + sizeof(T) * capacity));
+            pBuffer->mask = capacity - 1;
+            pBuffer->pPrevious = pPrevious;
+            pBuffer->elements = reinterpret_cast<T*>(pBuffer + 1);
+            return pBuffer;
+        }
+
+        Buffer* grow(Buffer* pOld, LONG top, LONG bottom)
+        {
+            // thieves might still read from the old buffer, so it is only freed in the destructor
+            Buffer* pNew = allocateBuffer((pOld->mask + 1) * 2, pOld);
+            for(LONG i = top; i != bottom; i++)
+                pNew->put(i, pOld->get(i));
+            MemoryBarrier();
+            m_pBuffer = pNew;
+            return pNew;
+        }
+
+    public:
+        WorkStealingDeque(IAllocator* pAllocator = nullptr, LONG initialCapacity = 64) :
+            m_top(0),
+            m_bottom(0),
+            m_pAllocator(pAllocator)
+        {
+            GEP_ASSERT(initialCapacity > 0 && (initialCapacity & (initialCapacity - 1)) == 0, "capacity has to be a power of two", initialCapacity);
+            if(m_pAllocator == nullptr)
+                m_pAllocator = &g_stdAllocator;
+            m_pBuffer = allocateBuffer(initialCapacity, nullptr);
+        }
+
+        ~WorkStealingDeque()
+        {
+            Buffer* pBuffer = m_pBuffer;
+            while(pBuffer != nullptr)
+            {
+                Buffer* pPrevious = pBuffer->pPrevious;
+                m_pAllocator->freeMemory(pBuffer);
+                pBuffer = pPrevious;
+            }
+        }
+
+        /// \brief adds an element at the bottom, owner only
+        void push(T value)
+        {
+            LONG bottom = m_bottom;
+            LONG top = m_top;
+            Buffer* pBuffer = m_pBuffer;
+            if(distance(top, bottom) > pBuffer->mask)
+                pBuffer = grow(pBuffer, top, bottom);
+            pBuffer->put(bottom, value);
+            // the element has to be visible before the new bottom
+            _ReadWriteBarrier();
+            m_bottom = bottom + 1;
+        }
+
+        /// \brief takes the most recently pushed element, owner only
+        T pop()
+        {
+            LONG bottom = m_bottom - 1;
+            Buffer* pBuffer = m_pBuffer;
+            // the store to bottom has to be visible to thieves before top is read
+            InterlockedExchange(&m_bottom, bottom);
+            LONG top = m_top;
+
+            LONG size = distance(top, bottom);
+            if(size < 0)
+            {
+                // deque was empty
+                m_bottom = bottom + 1;
+                return nullptr;
+            }
+
+            T result = pBuffer->get(bottom);
+            if(size == 0)
+            {
+                // last element, race against thieves for it
+                if(InterlockedCompareExchange(&m_top, top + 1, top) != top)
+                    result = nullptr;
+                m_bottom = bottom + 1;
+            }
+            return result;
+        }
+
+        /// \brief takes the oldest element, can be called from any thread
+        T steal()
+        {
+            LONG top = m_top;
+            MemoryBarrier();
+            LONG bottom = m_bottom;
+            if(distance(top, bottom) <= 0)
+                return nullptr;
+
+            Buffer* pBuffer = m_pBuffer;
+            T result = pBuffer->get(top);
+            if(InterlockedCompareExchange(&m_top, top + 1, top) != top)
+                return nullptr; // lost the race against another thief or the owner
+            return result;
+        }
+
+        /// \brief returns the approximate number of elements
+        inline size_t count() const
+        {
+            LONG size = distance(m_top, m_bottom);
+            return size > 0 ? (size_t)size : 0;
+        }
+
+        /// \brief returns if the deque is (approximately) empty
+        inline bool isEmpty() const
+        {
+            return distance(m_top, m_bottom) <= 0;
+        }
+    };
+}
@@ -284,6 +284,37 @@ namespace gep
             #endif
         }
 
+        /// \brief makes a weak reference which was previously created with setWithNewIndex point to another object
+        ///
+        /// Unlike invalidateAndReplace the object keeps its own index, so several references can share it.
+        /// The reference has to be invalidated before the object is destroyed.
+        void setAlias(T* ptr)
+        {
+            ScopedLock<Mutex> lock(WeakReferenced<typename T::WeakReferencedBaseType, ExportType>::s_mutex);
+            GEP_ASSERT(ptr != nullptr);
+            GEP_ASSERT(get() != nullptr, "reference is already invalid");
+            WeakReferenced<typename T::WeakReferencedBaseType, ExportType>::s_weakTable[m_weakRefIndex.index] = ptr;
+            #ifdef _DEBUG
+            m_pLastLookupResult = ptr;
+            #endif
+        }
+
+        /// \brief invalidates a weak reference which was previously created with setWithNewIndex,
+        ///   all copies of it become invalid too
+        void invalidate()
+        {
+            ScopedLock<Mutex> lock(WeakReferenced<typename T::WeakReferencedBaseType, ExportType>::s_mutex);
+            if(get() != nullptr)
+            {
+                WeakReferenced<typename T::WeakReferencedBaseType, ExportType>::s_weakTable[m_weakRefIndex.index] = nullptr;
+                WeakReferenced<typename T::WeakReferencedBaseType, ExportType>::s_weakTableNumEntries--;
+            }
+            m_weakRefIndex = WeakRefIndex::invalidValue();
+            #ifdef _DEBUG
+            m_pLastLookupResult = nullptr;
+            #endif
+        }
+
         /// \brief gets the weak ref index for debugging purposes
         uint32 getWeakRefIndex()
         {
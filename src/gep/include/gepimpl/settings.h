@@ -11,6 +11,9 @@ namespace gep
         settings::Video m_video;
 
         settings::Scripts m_scripts;
+        settings::TaskQueue m_taskQueue;
+        settings::Resources m_resources;
+        settings::Logging m_logging;
         settings::Lua m_lua;
     public:
 
@@ -26,6 +29,18 @@ namespace gep
         virtual       settings::Scripts& getScriptsSettings()       override { return m_scripts; }
         virtual const settings::Scripts& getScriptsSettings() const override { return m_scripts; }
 
+        virtual void setTaskQueueSettings(const settings::TaskQueue& settings) override { m_taskQueue = settings; }
+        virtual       settings::TaskQueue& getTaskQueueSettings()       override { return m_taskQueue; }
+        virtual const settings::TaskQueue& getTaskQueueSettings() const override { return m_taskQueue; }
+
+        virtual void setResourcesSettings(const settings::Resources& settings) override { m_resources = settings; }
+        virtual       settings::Resources& getResourcesSettings()       override { return m_resources; }
+        virtual const settings::Resources& getResourcesSettings() const override { return m_resources; }
+
+        virtual void setLoggingSettings(const settings::Logging& settings) override { m_logging = settings; }
+        virtual       settings::Logging& getLoggingSettings()       override { return m_logging; }
+        virtual const settings::Logging& getLoggingSettings() const override { return m_logging; }
+
         virtual void setLuaSettings(const settings::Lua& settings) override { m_lua = settings; }
         virtual       settings::Lua& getLuaSettings() override { return m_lua; }
         virtual const settings::Lua& getLuaSettings() const override { return m_lua; }
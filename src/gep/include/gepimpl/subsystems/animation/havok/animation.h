@@ -166,6 +166,8 @@ namespace gep
 
         virtual void release();
 
+        virtual bool getContentHash(uint64& hash);
+
     };
 
 }
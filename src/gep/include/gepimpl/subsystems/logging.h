@@ -3,18 +3,136 @@
 #include "gep/interfaces/logging.h"
 #include "gep/container/DynamicArray.h"
 #include "gep/threading/mutex.h"
+#include "gep/threading/semaphore.h"
+#include "gep/threading/thread.h"
+#include "gep/timer.h"
+#include "gep/container/hashmap.h"
 
 namespace gep
 {
-    class Logging
+    /// \brief what happens to a log message when the log buffer is full
+    enum class LogOverflowPolicy
+    {
+        /// the message is dropped and counted in LogChannelStatistics::numDropped
+        dropMessage,
+        /// the calling thread waits until there is space, and writes messages itself if the writer thread does not keep up
+        waitForSpace
+    };
+
+    /// \brief counters of a single log channel
+    struct LogChannelStatistics
+    {
+        /// \brief number of messages written to the sinks
+        uint64 numWritten;
+        /// \brief number of messages dropped because the buffer was full
+        uint64 numDropped;
+        /// \brief average time between logging a message and writing it to the sinks, in milliseconds
+        float averageLatencyMs;
+        /// \brief maximum time between logging a message and writing it to the sinks, in milliseconds
+        float maxLatencyMs;
+    };
+
+    /// \brief logging which formats messages on the calling thread and writes them on a background thread
+    ///
+    /// Formatted messages are put into a lock-free bounded ring buffer (multiple producers, single consumer).
+    /// A writer thread takes them out in batches and passes them to the sinks, so logging never waits for I/O.
+    /// Only the thread holding m_sinkMutex consumes messages, that is usually the writer thread,
+    /// but flush, deregisterSink and producers waiting for space drain the buffer themselves.
+    /// On an unhandled exception the buffer is written and the sinks are flushed before the process dies.
+    /// With deferred formatting only the format string and the raw arguments are put into the buffer,
+    /// the writer thread formats them for the sinks that want text.
+    class GEP_API Logging
         : public ILogging
     {
+    public:
+        /// \brief number of messages the buffer can hold, has to be a power of two
+        static const uint32 DEFAULT_CAPACITY = 4096;
+        /// \brief messages up to this length (including the terminating zero) are stored in the buffer without allocation
+        static const size_t INLINE_MESSAGE_SIZE = 232;
+
     private:
+        static const size_t NUM_CHANNELS = 3;
+        // maximum number of messages the writer passes to the sinks before flushing them
+        static const size_t MAX_BATCH_SIZE = 256;
+        // the writer thread checks for new messages at least this often
+        static const uint32 WRITER_SLEEP_MS = 10;
+
+        struct Record
+        {
+            // == position: free for the producer that claimed position
+            // == position + 1: holds a message for the consumer
+            volatile LONG sequence;
+            LogChannel channel;
+            uint64 logTime;
+            // messages which did not fit into message
+            std::string* pLongMessage;
+            // not null if message holds the arguments encoded by encodeLogArguments instead of the text
+            const char* format;
+            size_t argumentsSize;
+            char message[INLINE_MESSAGE_SIZE];
+        };
+
+        class WriterThread : public Thread
+        {
+            Logging& m_logging;
+            GEP_DISALLOW_COPY_AND_ASSIGNMENT(WriterThread);
+        public:
+            WriterThread(Logging& logging) : m_logging(logging) {}
+            virtual void run() override;
+        };
+
+        Record* m_records;
+        uint32 m_mask;
+        volatile LONG m_enqueuePosition;
+        // only used by the consumer
+        LONG m_dequeuePosition;
+
         DynamicArray<ILogSink*> m_sinks;
         Mutex m_sinkMutex;
+        // id of the thread that currently writes to the sinks, it must not wait for space
+        volatile DWORD m_consumerThreadId;
+
+        WriterThread m_writerThread;
+        Semaphore m_wakeUpWriter;
+        volatile LONG m_writerIsSleeping;
+        volatile bool m_stopWriter;
+        volatile bool m_deferFormatting;
+
+        Timer m_timer;
+        LogOverflowPolicy m_overflowPolicies[NUM_CHANNELS];
+        volatile LONG m_numDropped[NUM_CHANNELS];
+        // the consumer adds to these after every batch, so reading them does not wait for the sinks
+        Mutex m_statisticsMutex;
+        uint64 m_numWritten[NUM_CHANNELS];
+        uint64 m_totalLatency[NUM_CHANNELS];
+        uint64 m_maxLatency[NUM_CHANNELS];
+
+        // deferred messages are formatted into this for the sinks that want text, only used by the consumer
+        std::string m_formattedMessage;
+
+        LPTOP_LEVEL_EXCEPTION_FILTER m_previousExceptionFilter;
+        // the logging whose messages are written when the process crashes
+        static Logging* volatile s_pCrashLogging;
+
+        GEP_DISALLOW_COPY_AND_ASSIGNMENT(Logging);
+
+        void log(LogChannel channel, const char* fmt, va_list argptr);
+        // claims a record for writing, nullptr if the message was dropped
+        Record* beginRecord(LogChannel channel);
+        void endRecord(Record* pRecord);
+        // passes up to maxRecords messages to the sinks and flushes them, requires m_sinkMutex
+        // returns the number of messages written
+        size_t writeRecords(size_t maxRecords);
+        // writes all messages that are ready, requires m_sinkMutex
+        void writeAllRecords();
+        bool hasReadyRecord() const;
+        void runWriter();
+
+        static LONG WINAPI unhandledExceptionFilter(EXCEPTION_POINTERS* pExceptionInfo);
 
     public:
-        Logging();
+        /// \param capacity the number of messages the buffer can hold, has to be a power of two
+        explicit Logging(uint32 capacity = DEFAULT_CAPACITY);
         ~Logging();
 
         virtual void logMessage(const char* fmt, ...) override;
@@ -22,8 +140,24 @@ namespace gep
         virtual void logError(const char* fmt, ...) override;
 
         virtual void registerSink(ILogSink* pSink) override;
+        /// \brief all messages logged before are written to the sink before it is removed
         virtual void deregisterSink(ILogSink* pSink) override;
 
+        /// \brief writes all messages logged so far to the sinks and flushes them
+        virtual void flush() override;
+
+        /// \brief sets what happens to messages of the given channel when the buffer is full
+        /// by default messages and warnings are dropped and errors wait for space
+        void setOverflowPolicy(LogChannel channel, LogOverflowPolicy policy);
+
+        /// \brief returns the counters of the given channel
+        LogChannelStatistics getStatistics(LogChannel channel);
+
+        /// \brief when enabled, logging a message only copies its arguments, formatting happens on the writer thread
+        ///
+        /// Sinks that take deferred messages never get them formatted.
+        /// Messages whose arguments do not fit into the buffer or can not be encoded are still formatted immediately.
+        void setDeferredFormatting(bool deferFormatting);
     };
 
     class ConsoleLogSink
@@ -41,8 +175,32 @@ namespace gep
         bool m_autoFlush;
 
     public:
-        FileLogSink(const char* filename, bool autoFlush = true);
+        /// \param autoFlush flush after every message instead of after every batch of messages
+        FileLogSink(const char* filename, bool autoFlush = false);
         virtual ~FileLogSink();
         virtual void take(LogChannel channel, const char* msg) override;
+        virtual void flush() override;
+    };
+
+    /// \brief writes the messages into a compact binary file, use the logdecoder to turn it into text
+    ///
+    /// Deferred messages are stored as format string id and encoded arguments, see BinaryLogFile for the layout.
+    class BinaryFileLogSink
+         : public ILogSink
+    {
+    private:
+        std::ofstream m_LogFile;
+        // ids of the format strings written so far, they are literals so their address identifies them
+        Hashmap<const char*, uint32> m_formatIds;
+
+        void writeFormatString(const char* fmt, uint32 id);
+
+    public:
+        BinaryFileLogSink(const char* filename);
+        virtual ~BinaryFileLogSink();
+        virtual void take(LogChannel channel, const char* msg) override;
+        virtual bool takesDeferredMessages() const override { return true; }
+        virtual void takeDeferred(LogChannel channel, const char* fmt, ArrayPtr<const uint8> arguments) override;
+        virtual void flush() override;
     };
 }
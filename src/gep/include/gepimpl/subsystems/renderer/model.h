@@ -52,6 +52,7 @@ namespace gep
         virtual void postLoad(ResourcePtr<IResource> pResource) override;
         virtual ModelFileLoader* moveToHeap() override;
         virtual const char* getResourceId() override;
+        virtual bool getContentHash(uint64& hash) override;
     };
 
     /// \brief loads a Model from given data
@@ -218,7 +219,7 @@ namespace gep
         /// \brief draws the model
         void draw(const mat4& modelMatrix, ArrayPtr<mat4> bones, mat4& viewMatrix, mat4& projectionMatrix, ID3D11DeviceContext* pContext);
 
-        /// \brief loads the model from a file
+        /// \brief loads the model from a file, the mesh data is decoded in parallel on the global task queue
         void loadFile(const char* filename);
         void loadFromData(SmartPtr<ReferenceCounted> pDataHolder, ArrayPtr<vec4> vertices, ArrayPtr<uint32> indices);
         /**
@@ -298,6 +299,7 @@ namespace gep
         virtual void unload() override;
         virtual void finalize() override;
         virtual uint32 getFinalizeOptions() override;
+        virtual size_t getFinalizeSize() override;
 
         //IModel interface
         virtual void extract(IRendererExtractor& extractor, mat4 modelMatrix) override;
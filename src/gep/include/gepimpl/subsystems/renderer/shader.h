@@ -39,6 +39,8 @@ namespace gep
     };
 
     /// \brief loads a shader from a fx file
+    ///
+    /// The compiled byte code is kept in the resource cache, so unchanged files are only compiled once.
     class ShaderFileLoader : public IShaderLoader
     {
     private:
@@ -47,12 +49,16 @@ namespace gep
         bool m_isRegistered;
 
     public:
+        /// \brief increment when the compiler flags change, so the cached byte code is compiled again
+        static const uint32 CACHE_VERSION = 1;
+
         ShaderFileLoader(const char* filename);
         ~ShaderFileLoader();
         virtual Shader* loadResource(Shader* pInPlace) override;
         virtual void postLoad(ResourcePtr<IResource> pResource) override;
         virtual ShaderFileLoader* moveToHeap() override;
         virtual const char* getResourceId() override;
+        virtual bool getContentHash(uint64& hash) override;
     };
 
     /// \brief shader constant base class
@@ -188,6 +194,10 @@ namespace gep
         }
 
         void loadFromFX(const char* filename);
+        /// \brief loads the shader from byte code previously compiled by loadFromFX
+        void loadFromByteCode(ArrayPtr<const uint8> byteCode);
+        /// \brief the compiled byte code, only available until the shader is finalized
+        ArrayPtr<const uint8> getByteCode();
         void use(ID3D11DeviceContext* pContext, Vertexbuffer* pVertexbuffer);
 
         //IResource interface
@@ -198,6 +208,7 @@ namespace gep
         virtual void unload() override;
         virtual void finalize() override;
         virtual uint32 getFinalizeOptions() override;
+        virtual size_t getFinalizeSize() override;
         virtual bool isLoaded() override;
     };
 }
@@ -36,6 +36,7 @@ namespace gep
         virtual void postLoad(ResourcePtr<IResource> pResource) override;
         virtual Texture2DFileLoader* moveToHeap() override;
         virtual const char* getResourceId() override;
+        virtual bool getContentHash(uint64& hash) override;
     };
 
     class DummyTexture2DLoader : public ITexture2DLoader
@@ -99,5 +100,6 @@ namespace gep
         virtual void unload() override;
         virtual void finalize() override;
         virtual uint32 getFinalizeOptions() override;
+        virtual size_t getFinalizeSize() override;
     };
 }
@@ -0,0 +1,109 @@
+#pragma once
+
+#include "gep/interfaces/resourceManager.h"
+#include "gep/container/DynamicArray.h"
+#include "gep/threading/mutex.h"
+#include "gep/threading/semaphore.h"
+
+namespace gep
+{
+    /// \brief the asynchronous resource load requests, shared by all loader threads
+    ///
+    /// Every priority has its own queue, a loader thread always takes the oldest request of the most urgent one.
+    /// Requests which are waiting can be canceled or moved to a more urgent priority,
+    /// requests which are loading can only be marked as canceled, the loader thread then throws away the result.
+    /// Also keeps the counters and the most recent latencies for the ResourceLoadingStatistics.
+    class GEP_API ResourceLoadQueue
+    {
+    public:
+        struct Request
+        {
+            ResourcePtr<IResource> ptr;
+            IResourceLoader* pLoader;
+            std::string resourceId;
+            LoadPriority priority;
+            /// \brief time of the request in seconds, see Timer::getTimeAsDouble
+            double requestTime;
+            /// \brief set by the queue, identifies the request while it is loading
+            uint32 sequence;
+        };
+
+        /// \brief number of latencies the percentiles are computed from
+        static const size_t NUM_LATENCY_SAMPLES = 256;
+
+    private:
+        struct LoadingInfo
+        {
+            uint32 sequence;
+            std::string resourceId;
+            LoadPriority priority;
+            bool isCanceled;
+        };
+
+        DynamicArray<Request> m_requests[NUM_LOAD_PRIORITIES];
+        // index of the oldest request in m_requests, the ones before it were taken already
+        size_t m_firstRequest[NUM_LOAD_PRIORITIES];
+        DynamicArray<LoadingInfo> m_loading;
+        Mutex m_mutex;
+        // only wakes the loader threads up, they check the queue before waiting on it
+        Semaphore m_wakeUp;
+        uint32 m_nextSequence;
+
+        uint64 m_numLoaded;
+        uint64 m_numFailed;
+        uint64 m_numCanceled;
+        float m_latencies[NUM_LATENCY_SAMPLES];
+        size_t m_numLatencies;
+
+        GEP_DISALLOW_COPY_AND_ASSIGNMENT(ResourceLoadQueue);
+
+        // removes the taken requests from the front of the queue of the given priority, requires m_mutex
+        void compact(size_t priority);
+        // finds a waiting request, requires m_mutex
+        bool find(const std::string& resourceId, size_t& priority, size_t& index);
+
+    public:
+        ResourceLoadQueue();
+
+        /// \brief adds a request, there must not be another one for the same resource waiting, see raisePriority
+        void push(const Request& request);
+
+        /// \brief moves the request for the given resource to a more urgent priority, if it is still waiting
+        /// \return true if a waiting request was found
+        bool raisePriority(const std::string& resourceId, LoadPriority priority);
+
+        /// \brief takes the most urgent request and marks it as loading
+        ///
+        /// Waits up to millisecondsToWait for a request if there is none.
+        /// Every successful call has to be followed by a call to finishLoading.
+        Result take(Request& request, uint32 millisecondsToWait);
+
+        /// \brief removes the request from the loading ones
+        /// \return false if the request was canceled while it was loading, then the result has to be thrown away
+        bool finishLoading(const Request& request, bool succeeded);
+
+        /// \brief cancels the requests for the given resource
+        ///
+        /// Waiting requests are removed and appended to canceled, the caller has to release their loaders.
+        /// \return true if a waiting or loading request was canceled
+        bool cancel(const std::string& resourceId, DynamicArray<Request>& canceled);
+
+        /// \brief cancels all waiting and loading requests with the given priority
+        ///
+        /// Waiting requests are appended to canceled, the ids of the loading ones to canceledLoading.
+        /// \return the number of canceled requests
+        size_t cancel(LoadPriority priority, DynamicArray<Request>& canceled, DynamicArray<std::string>& canceledLoading);
+
+        /// \brief wakes up a thread waiting in take
+        void wakeUp();
+
+        /// \brief remembers the latency of a finished load for the percentiles
+        void addLatency(float latencyMs);
+
+        /// \brief counts a request which was canceled after it finished loading
+        void addCanceled();
+
+        /// \brief fills in the queue depths, the number of loading resources, the counters and the latencies
+        void getStatistics(ResourceLoadingStatistics& statistics);
+    };
+}
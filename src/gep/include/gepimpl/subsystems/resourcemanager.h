@@ -1,18 +1,27 @@
 #pragma once
 
 #include "gep/interfaces/resourceManager.h"
+#include "gepimpl/subsystems/resourceLoadQueue.h"
+#include "gep/resourceCache.h"
 #include "gep/container/hashmap.h"
 #include "gep/container/DynamicArray.h"
 #include "gep/directory.h"
 #include "gep/threading/thread.h"
-#include "gep/container/queue.h"
-#include "gep/threading/semaphore.h"
+#include "gep/settings.h"
+#include "gep/timer.h"
 
 namespace gep
 {
     // forward declarations
     class ResourceLoaderThread;
 
+    /// \brief loads resources synchronously or on a pool of loader threads
+    ///
+    /// Asynchronous loads go through a ResourceLoadQueue ordered by LoadPriority.
+    /// Loaded resources are finalized most urgent first, finalizeResourcesWithFlags stops when the
+    /// time or byte budget of the frame is used up, only critical resources are finalized regardless.
+    /// Loads of sources with the same content as an already loaded resource share it instead of loading it again,
+    /// see IResourceLoader::getContentHash. Deleting or reloading a shared resource affects all loads sharing it.
     class ResourceManager
         : public IResourceManager
     {
@@ -30,6 +39,24 @@ namespace gep
             IResource* pResource;
             IResourceLoader* pLoader;
             bool isFinalized;
+            LoadPriority priority;
+            /// \brief time of the request in seconds, see Timer::getTimeAsDouble
+            double requestTime;
+            /// \brief the source has the same content as an already loaded resource, pResource is null
+            bool isShared;
+            bool hasContentHash;
+            uint64 contentHash;
+            size_t contentSize;
+            float loadTimeMs;
+        };
+
+        struct SharedContent
+        {
+            IResource* pResource;
+            std::string resourceType;
+            /// \brief see IResource::getFinalizeSize, taken before the resource was finalized
+            size_t size;
+            float loadTimeMs;
         };
 
         Hashmap<std::string, IResource*, StringHashPolicy> m_resourceDummies;
@@ -41,21 +68,47 @@ namespace gep
         Mutex m_newResourceMutex;
         DynamicArray<PatchInfo> m_resourcesToPatch;
         Mutex m_patchResourceMutex;
-        ResourceLoaderThread* m_pResourceLoader;
+        ResourceLoadQueue m_loadQueue;
+        DynamicArray<ResourceLoaderThread*> m_loaderThreads;
         Mutex m_loadingResourceMutex;
+        settings::Resources m_settings;
+        Timer m_timer;
+        float m_lastFinalizeTimeMs;
+        size_t m_lastFinalizeBytes;
+        // loaded resources by the hash of their source
+        Hashmap<uint64, SharedContent> m_sharedContent;
+        // dummies of asynchronous loads which point to a shared resource
+        DynamicArray<ResourcePtr<IResource>> m_aliases;
+        Mutex m_sharedContentMutex;
+        uint64 m_numShared;
+        uint64 m_sharedBytes;
+        float m_sharedLoadTimeMs;
+        ResourceCache* m_pResourceCache;
         DirectoryWatcher m_dataDirWatcher;
         float m_timeSinceLastCheck;
         uint32 m_updateNum;
 
         void removeFromNewList(IResource* pResource);
+        // releases the loaders of canceled requests and removes the requests from m_loadedResources, requires m_loadingResourceMutex
+        void releaseCanceledRequests(DynamicArray<ResourceLoadQueue::Request>& canceled);
+        // deletes the loaded resource of a patch entry which did not replace its dummy yet
+        void deleteUnpatchedResource(PatchInfo& info);
+        // remembers the content of a loaded resource so later loads can share it
+        void registerContent(IResource* pResource, uint64 contentHash, size_t size, float loadTimeMs);
+        // returns the shared resource with the given content and counts the load sharing it, null if there is none
+        IResource* shareContent(const char* resourceType, uint64 contentHash);
+        // forgets the content of a resource which is deleted or was reloaded with other content
+        void forgetContent(IResource* pResource);
+        // makes the aliases of pOldResource point to pNewResource, invalidates them if pNewResource is null
+        void replaceAliases(IResource* pOldResource, IResource* pNewResource);
 
         hkLoader* m_pHkResourceLoader;
 
     protected:
-        virtual ResourcePtr<IResource> doLoadResource(IResourceLoader& loader, LoadAsync loadAsync) override;
+        virtual ResourcePtr<IResource> doLoadResource(IResourceLoader& loader, LoadAsync loadAsync, LoadPriority priority) override;
 
     public:
-        ResourceManager();
+        ResourceManager(const settings::Resources& settings);
 
         // ISubsystem interface
         virtual void initialize() override;
@@ -72,8 +125,22 @@ namespace gep
         virtual void registerLoaderForReload(const std::string& filename, IResourceLoader* pLoader, ResourcePtr<IResource> pResource) override;
         virtual void deregisterLoaderForReload(const std::string& filename, IResourceLoader* pLoader) override;
         virtual void reloadResource(ResourcePtr<IResource> pResource);
+        virtual bool cancelLoading(ResourcePtr<IResource> pResource) override;
+        virtual size_t cancelLoading(LoadPriority priority) override;
+        virtual ResourceLoadingStatistics getLoadingStatistics() override;
+        virtual ResourceCache* getResourceCache() override;
+
+        void resourceFinishedLoading(ResourcePtr<IResource> ptr, IResource* pResource, IResourceLoader* pLoader,
+                                     LoadPriority priority = LoadPriority::Critical);
+        /// \brief called by the loader threads
+        void resourceFinishedLoading(const ResourceLoadQueue::Request& request, IResource* pResource,
+                                     bool hasContentHash, uint64 contentHash, float loadTimeMs);
+        /// \brief called by the loader threads when the source has the same content as an already loaded resource
+        void resourceShared(const ResourceLoadQueue::Request& request, uint64 contentHash);
 
-        void resourceFinishedLoading(ResourcePtr<IResource> ptr, IResource* pResource, IResourceLoader* pLoader);
+        /// \brief hashes the source of the loader if the loader supports it and sharing is enabled
+        /// \return true if there is a loaded resource with the same content, it can be shared by the load
+        bool findSharedContent(IResourceLoader* pLoader, bool& hasContentHash, uint64& contentHash);
 
 
         hkLoader* getHavokResourceLoader() const { return m_pHkResourceLoader; }
@@ -81,28 +148,22 @@ namespace gep
 
 #define g_resourceManager (*static_cast<ResourceManager*>(g_globalManager.getResourceManager()))
 
+    /// \brief one of the threads which take requests from the load queue of the resource manager
     class ResourceLoaderThread : public Thread
     {
     private:
-        struct ToLoadInfo
-        {
-            ResourcePtr<IResource> ptr;
-            IResourceLoader* pLoader;
-        };
-        Queue<ToLoadInfo, MutexLockPolicy> m_resourcesToLoad;
-        Semaphore m_toLoadCounter;
         ResourceManager* m_pResourceManager;
-        bool m_isRunning;
+        ResourceLoadQueue* m_pLoadQueue;
+        volatile bool m_isRunning;
+        Timer m_timer;
 
     public:
 
-        ResourceLoaderThread(ResourceManager* pResourceManager);
+        ResourceLoaderThread(ResourceManager* pResourceManager, ResourceLoadQueue* pLoadQueue);
         ~ResourceLoaderThread();
 
-        void loadResource(ResourcePtr<IResource> ptr, IResourceLoader* pLoader);
-
         virtual void run() override;
 
-        void stop(); // stops the resource loader thread
+        void stop(); // stops the resource loader thread, it finishes the resource it is loading
     };
 }
@@ -0,0 +1,55 @@
+#pragma once
+
+#include "gep/settings.h"
+#include "gep/interfaces/scripting.h"
+
+namespace gep
+{
+    class Timer;
+
+    /// \brief runs the garbage collector of a Lua state in bounded steps, once per frame
+    ///
+    /// The budget grows with the memory allocated since the last cycle, so the collector keeps up,
+    /// and is halved when the last frame took longer than the recent ones.
+    /// Lua's own collector only starts when the steps fall far behind.
+    class GEP_API ScriptGarbageCollector
+    {
+    public:
+        /// \brief Lua collects automatically when the memory grew to this many percent of what was used after the last cycle
+        static const int AUTOMATIC_COLLECTION_PAUSE = 400;
+        /// \brief amount of work of one incremental step, the budget is checked between steps
+        static const int COLLECTION_STEP_SIZE_KB = 8;
+
+    private:
+        lua_State* m_L;
+        const settings::Scripts* m_pScriptSettings;
+        ScriptGarbageCollectionStatistics m_statistics;
+        size_t m_bytesUsedAfterLastCycle;
+        bool m_isGenerational;
+
+        void setGenerational(bool generational);
+
+    public:
+        ScriptGarbageCollector(const settings::Scripts* pScriptSettings);
+
+        /// \brief takes over the collector of a newly created Lua state
+        void initialize(lua_State* L);
+
+        /// \brief runs collection steps until the budget of this frame is used up or a cycle finished
+        ///
+        /// In generational mode every step is a whole minor collection, so only one runs per frame.
+        /// \param elapsedTime duration of the last frame in seconds
+        /// \param averageElapsedTime average duration of the recent frames in seconds
+        void update(Timer& timer, float elapsedTime, float averageElapsedTime);
+
+        /// \brief runs a whole collection cycle right now
+        void collectFully();
+
+        /// \brief time the collector may spend in this frame, in milliseconds
+        float calculateBudget(float elapsedTime, float averageElapsedTime) const;
+
+        size_t getBytesUsed() const;
+        bool isGenerational() const { return m_isGenerational; }
+        const ScriptGarbageCollectionStatistics& getStatistics() const { return m_statistics; }
+    };
+}
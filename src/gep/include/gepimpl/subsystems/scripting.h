@@ -2,41 +2,21 @@
 
 #include "gep/settings.h"
 #include "gep/interfaces/scripting.h"
+#include "gepimpl/subsystems/scriptGarbageCollector.h"
 #include "gep/container/DynamicArray.h"
 #include "gep/container/hashmap.h"
+#include "gep/memory/allocators.h"
 
 namespace gep
 {
-    class IAllocatorStatistics;
-
-    class ScriptingAllocator : public IAllocatorStatistics
-    {
-    public:
-        ScriptingAllocator(IAllocatorStatistics* pParentAllocator);
-        ~ScriptingAllocator();
-
-        virtual size_t getNumAllocations() const override;
-        virtual size_t getNumFrees() const override;
-        virtual size_t getNumBytesReserved() const override;
-        virtual size_t getNumBytesUsed() const override;
-
-        virtual IAllocator* getParentAllocator() const override;
-
-        virtual void* allocateMemory(size_t size) override;
-        virtual void freeMemory(void* mem) override;
-
-        inline void setLuaState(lua_State* L) { m_L = L; }
-        inline lua_State* getLuaState() { return m_L; }
-
-    private:
-        lua_State* m_L;
-        IAllocatorStatistics* m_pParentAllocator;
-        size_t m_numAllocations;
-        size_t m_numFrees;
-    };
-
+    /// \brief runs the Lua scripts
+    ///
+    /// The garbage collector runs in bounded steps at the end of every game frame, see update.
     class ScriptingManager : public IScriptingManager
     {
+        // number of frames whose average time is compared with the last frame
+        static const size_t NUM_AVERAGED_FRAMES = 30;
+
     public:
 
         ScriptingManager(settings::Scripts* pScriptSettings);
@@ -44,6 +24,7 @@ namespace gep
 
         /// \brief IScriptingManager interface
         virtual void initialize();
+        /// \brief runs garbage collection steps in the time budget of this frame, see ScriptGarbageCollector
         virtual void update(float elapsedTime);
         virtual void destroy();
 
@@ -64,13 +45,15 @@ namespace gep
 
         virtual int32 memoryUsed() const override;
         virtual void collectGarbage() override;
+        virtual const ScriptGarbageCollectionStatistics& getGarbageCollectionStatistics() const override { return m_garbageCollector.getStatistics(); }
 
         virtual void debugBreak(const char* message) const override;
 
         void makeBasicBindings();
 
     private:
-        ScriptingAllocator m_allocator;
+        // Lua creates lots of small tables, strings and closures and always passes their size
+        SmallObjectAllocator m_allocator;
 
         lua_State* m_L;
         State m_state;
@@ -78,6 +61,8 @@ namespace gep
         settings::Scripts* m_pScriptSettings;
         gep::DynamicArray<std::string> m_loadedScripts;
 
+        ScriptGarbageCollector m_garbageCollector;
+
         bool isLoaded(const std::string& fileName);
 
         std::string constructFileName(const std::string& filename, LoadOptions::Enum loadOptions = LoadOptions::Default);
@@ -88,11 +88,82 @@ namespace gep
         {
             g_globalManager.getLogging()->logWarning("Ignoring attempt to set the parent of an identity transform.");
         }
+
+        virtual uint64 getWorldChangeStamp() const override
+        {
+            // never changes
+            return 0;
+        }
     };
 }
 
+namespace
+{
+    // stamp of the most recent change to any transform
+    volatile LONGLONG g_lastTransformChangeStamp = 0;
+}
+
+gep::ITransform::~ITransform()
+{
+    // scripts which still hold the transform see a null object
+    lua::utils::invalidateProxy(this);
+}
+
 gep::ITransform* gep::getIdentityTransform()
 {
     static DefaultIdentityTransform instance;
     return &instance;
 }
+
+gep::uint64 gep::nextTransformChangeStamp()
+{
+    return (uint64)InterlockedIncrement64(&g_lastTransformChangeStamp);
+}
+
+gep::uint64 gep::getLastTransformChangeStamp()
+{
+#ifdef _WIN64
+    // aligned 64 bit reads are atomic on x64
+    return (uint64)g_lastTransformChangeStamp;
+#else
+    return (uint64)InterlockedCompareExchange64(&g_lastTransformChangeStamp, 0, 0);
+#endif
+}
+
+gep::uint64 gep::Transform::getWorldChangeStamp() const
+{
+    if(m_validatedAt == getLastTransformChangeStamp())
+        return m_cachedWorldStamp;
+    const uint64 parentStamp = m_pParent->getWorldChangeStamp();
+    return GEP_MAX(m_changeStamp, parentStamp);
+}
+
+void gep::Transform::validateWorldCache() const
+{
+    // nothing changed anywhere since the last time
+    const uint64 lastChange = getLastTransformChangeStamp();
+    if(m_validatedAt == lastChange)
+        return;
+
+    // The parents are validated while the lock is held. They are always locked after their children,
+    // so this can not dead lock.
+    while(InterlockedCompareExchange(&m_cacheLock, 1, 0) != 0)
+        YieldProcessor();
+
+    const uint64 parentStamp = m_pParent->getWorldChangeStamp();
+    const uint64 worldStamp = GEP_MAX(m_changeStamp, parentStamp);
+    if(worldStamp != m_cachedWorldStamp)
+    {
+        m_localMatrix = mat4::translationMatrix(m_position) * m_rotation.toMat4();
+        m_worldMatrix = m_pParent->getWorldTransformationMatrix() * m_localMatrix;
+        m_worldRotation = m_pParent->getWorldRotation() * m_rotation;
+        m_worldOrientation = (m_worldRotation * m_baseOrientation).toMat3();
+        m_cachedWorldStamp = worldStamp;
+    }
+    // A parent which does not track its changes took a new stamp above,
+    // then the cache can not be trusted without asking the parents again.
+    if(worldStamp <= lastChange)
+        m_validatedAt = lastChange;
+
+    InterlockedExchange(&m_cacheLock, 0);
+}
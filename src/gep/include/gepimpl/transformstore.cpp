@@ -0,0 +1,696 @@
+#include "stdafx.h"
+#include "gep/math3d/transformStore.h"
+
+#include <emmintrin.h>
+
+namespace
+{
+    const gep::mat4 g_identityMatrix = gep::mat4::identity();
+
+    struct AppendEntry
+    {
+        template <class T>
+        void operator()(gep::DynamicArray<T>& values) const
+        {
+            values.resize(values.length() + 1);
+        }
+    };
+
+    // moves every entry to its new index, entries whose new index is ~0 are removed
+    struct PermuteEntries
+    {
+        const gep::DynamicArray<gep::uint32>& newIndices;
+        size_t newLength;
+
+        template <class T>
+        void operator()(gep::DynamicArray<T>& values) const
+        {
+            gep::DynamicArray<T> permuted;
+            permuted.resize(newLength);
+            for(size_t i=0; i < values.length(); i++)
+            {
+                if(newIndices[i] != ~0u)
+                    permuted[newIndices[i]] = values[i];
+            }
+            values = std::move(permuted);
+        }
+    };
+}
+
+template <class Operation>
+void gep::TransformStore::forEachArray(Operation& operation)
+{
+    operation(m_positionX);
+    operation(m_positionY);
+    operation(m_positionZ);
+    operation(m_rotationX);
+    operation(m_rotationY);
+    operation(m_rotationZ);
+    operation(m_rotationW);
+    operation(m_baseOrientations);
+    operation(m_parentIndices);
+    operation(m_externalParents);
+    operation(m_numChildren);
+    operation(m_changeStamps);
+    operation(m_handles);
+    operation(m_worldMatrices);
+    operation(m_worldRotationX);
+    operation(m_worldRotationY);
+    operation(m_worldRotationZ);
+    operation(m_worldRotationW);
+    operation(m_cachedWorldStamps);
+    operation(m_validatedAt);
+    operation(m_cacheLocks);
+}
+
+gep::TransformStore::TransformStore() :
+    m_isSorted(true)
+{
+}
+
+gep::uint32 gep::TransformStore::create(StoredTransform* pHandle)
+{
+    uint32 index;
+    if(m_freeIndices.length() > 0)
+    {
+        index = m_freeIndices.lastElement();
+        m_freeIndices.removeLastElement();
+    }
+    else
+    {
+        GEP_ASSERT(m_handles.length() < NO_PARENT, "too many transforms");
+        index = (uint32)m_handles.length();
+        AppendEntry append;
+        forEachArray(append);
+    }
+
+    m_positionX[index] = 0;
+    m_positionY[index] = 0;
+    m_positionZ[index] = 0;
+    m_rotationX[index] = 0;
+    m_rotationY[index] = 0;
+    m_rotationZ[index] = 0;
+    m_rotationW[index] = 1;
+    m_baseOrientations[index] = Quaternion();
+    m_parentIndices[index] = NO_PARENT;
+    m_externalParents[index] = nullptr;
+    m_numChildren[index] = 0;
+    m_changeStamps[index] = 0;
+    m_handles[index] = pHandle;
+    m_cachedWorldStamps[index] = INVALID_STAMP;
+    m_validatedAt[index] = INVALID_STAMP;
+    m_cacheLocks[index] = 0;
+
+    m_isSorted = false;
+    return index;
+}
+
+void gep::TransformStore::destroy(uint32 index)
+{
+    GEP_ASSERT(m_handles[index] != nullptr, "transform was already destroyed", index);
+
+    // children which are still alive fall back to the identity transform
+    if(m_numChildren[index] > 0)
+    {
+        for(size_t i=0; i < m_parentIndices.length(); i++)
+        {
+            if(m_parentIndices[i] == index)
+            {
+                m_parentIndices[i] = NO_PARENT;
+                markChanged((uint32)i);
+            }
+        }
+    }
+    const uint32 parentIndex = m_parentIndices[index];
+    if(parentIndex != NO_PARENT)
+        m_numChildren[parentIndex]--;
+
+    // the entry stays a valid root until the next sort removes it
+    m_rotationX[index] = 0;
+    m_rotationY[index] = 0;
+    m_rotationZ[index] = 0;
+    m_rotationW[index] = 1;
+    m_parentIndices[index] = NO_PARENT;
+    m_externalParents[index] = nullptr;
+    m_numChildren[index] = 0;
+    m_handles[index] = nullptr;
+    m_freeIndices.append(index);
+    m_isSorted = false;
+}
+
+void gep::TransformStore::setParent(uint32 index, ITransform* pParent)
+{
+    GEP_ASSERT(pParent, "The parent of a transform needs to be valid! "
+               "If you want to detach this instance, "
+               "set the parent to an identity transform "
+               "(e.g. gep::getIdentityTransform() in C++ or IdentityTransform in Lua).");
+
+    const uint32 oldParentIndex = m_parentIndices[index];
+    if(oldParentIndex != NO_PARENT)
+        m_numChildren[oldParentIndex]--;
+    m_parentIndices[index] = NO_PARENT;
+    m_externalParents[index] = nullptr;
+
+    auto pStored = dynamic_cast<StoredTransform*>(pParent);
+    if(pStored != nullptr && pStored->m_pStore == this)
+    {
+        #ifdef _DEBUG
+        for(uint32 ancestor = pStored->m_index; ancestor != NO_PARENT; ancestor = m_parentIndices[ancestor])
+        {
+            GEP_ASSERT(ancestor != index, "a transform can not be its own parent");
+        }
+        #endif
+        m_parentIndices[index] = pStored->m_index;
+        m_numChildren[pStored->m_index]++;
+        m_isSorted = false;
+    }
+    else if(pParent != getIdentityTransform())
+    {
+        m_externalParents[index] = pParent;
+    }
+    markChanged(index);
+}
+
+void gep::TransformStore::setParentOfChildren(uint32 index, ITransform* pParent)
+{
+    for(size_t i=0; i < m_parentIndices.length() && m_numChildren[index] > 0; i++)
+    {
+        if(m_parentIndices[i] == index)
+            setParent((uint32)i, pParent);
+    }
+}
+
+gep::ITransform* gep::TransformStore::getParent(uint32 index) const
+{
+    const uint32 parentIndex = m_parentIndices[index];
+    if(parentIndex != NO_PARENT)
+        return m_handles[parentIndex];
+    if(m_externalParents[index] != nullptr)
+        return m_externalParents[index];
+    return getIdentityTransform();
+}
+
+void gep::TransformStore::markChanged(uint32 index)
+{
+    m_changeStamps[index] = nextTransformChangeStamp();
+}
+
+gep::Quaternion gep::TransformStore::getRotation(uint32 index) const
+{
+    Quaternion rotation(DO_NOT_INITIALIZE);
+    rotation.x = m_rotationX[index];
+    rotation.y = m_rotationY[index];
+    rotation.z = m_rotationZ[index];
+    rotation.angle = m_rotationW[index];
+    return rotation;
+}
+
+gep::mat4 gep::TransformStore::getLocalMatrix(uint32 index) const
+{
+    // the same operations in the same order as updateGroup, so both give exactly the same result
+    const float x = m_rotationX[index];
+    const float y = m_rotationY[index];
+    const float z = m_rotationZ[index];
+    const float w = m_rotationW[index];
+    const float length = sqrtf(x * x + y * y + z * z + w * w);
+    const float nx = x / length;
+    const float ny = y / length;
+    const float nz = z / length;
+    const float nw = w / length;
+    const float xx = nx * nx;
+    const float xy = nx * ny;
+    const float xz = nx * nz;
+    const float xw = nx * nw;
+    const float yy = ny * ny;
+    const float yz = ny * nz;
+    const float yw = ny * nw;
+    const float zz = nz * nz;
+    const float zw = nz * nw;
+
+    mat4 local(DO_NOT_INITIALIZE);
+    local.data[ 0] = 1.0f - 2.0f * (yy + zz);
+    local.data[ 1] =        2.0f * (xy + zw);
+    local.data[ 2] =        2.0f * (xz - yw);
+    local.data[ 3] = 0.0f;
+    local.data[ 4] =        2.0f * (xy - zw);
+    local.data[ 5] = 1.0f - 2.0f * (xx + zz);
+    local.data[ 6] =        2.0f * (yz + xw);
+    local.data[ 7] = 0.0f;
+    local.data[ 8] =        2.0f * (xz + yw);
+    local.data[ 9] =        2.0f * (yz - xw);
+    local.data[10] = 1.0f - 2.0f * (xx + yy);
+    local.data[11] = 0.0f;
+    local.data[12] = m_positionX[index];
+    local.data[13] = m_positionY[index];
+    local.data[14] = m_positionZ[index];
+    local.data[15] = 1.0f;
+    return local;
+}
+
+const gep::mat4& gep::TransformStore::getWorldMatrix(uint32 index) const
+{
+    validateWorldCache(index);
+    return m_worldMatrices[index];
+}
+
+gep::Quaternion gep::TransformStore::getWorldRotation(uint32 index) const
+{
+    validateWorldCache(index);
+    Quaternion rotation(DO_NOT_INITIALIZE);
+    rotation.x = m_worldRotationX[index];
+    rotation.y = m_worldRotationY[index];
+    rotation.z = m_worldRotationZ[index];
+    rotation.angle = m_worldRotationW[index];
+    return rotation;
+}
+
+gep::mat3 gep::TransformStore::getWorldOrientation(uint32 index) const
+{
+    return (getWorldRotation(index) * m_baseOrientations[index]).toMat3();
+}
+
+gep::uint64 gep::TransformStore::getWorldChangeStamp(uint32 index) const
+{
+    if(m_validatedAt[index] == getLastTransformChangeStamp())
+        return m_cachedWorldStamps[index];
+    uint64 parentStamp = 0;
+    const uint32 parentIndex = m_parentIndices[index];
+    if(parentIndex != NO_PARENT)
+        parentStamp = getWorldChangeStamp(parentIndex);
+    else if(m_externalParents[index] != nullptr)
+        parentStamp = m_externalParents[index]->getWorldChangeStamp();
+    return GEP_MAX(m_changeStamps[index], parentStamp);
+}
+
+void gep::TransformStore::validateWorldCache(uint32 index) const
+{
+    // nothing changed anywhere since the last time
+    const uint64 lastChange = getLastTransformChangeStamp();
+    if(m_validatedAt[index] == lastChange)
+        return;
+
+    // Works like Transform::validateWorldCache, the parents are always locked after their children.
+    while(InterlockedCompareExchange(&m_cacheLocks[index], 1, 0) != 0)
+        YieldProcessor();
+
+    const uint32 parentIndex = m_parentIndices[index];
+    ITransform* pExternalParent = m_externalParents[index];
+    uint64 parentStamp = 0;
+    if(parentIndex != NO_PARENT)
+        parentStamp = getWorldChangeStamp(parentIndex);
+    else if(pExternalParent != nullptr)
+        parentStamp = pExternalParent->getWorldChangeStamp();
+    const uint64 worldStamp = GEP_MAX(m_changeStamps[index], parentStamp);
+    if(worldStamp != m_cachedWorldStamps[index])
+    {
+        if(parentIndex != NO_PARENT)
+            computeWorld(index, getWorldMatrix(parentIndex), getWorldRotation(parentIndex));
+        else if(pExternalParent != nullptr)
+            computeWorld(index, pExternalParent->getWorldTransformationMatrix(), pExternalParent->getWorldRotation());
+        else
+            computeWorld(index, g_identityMatrix, Quaternion());
+        m_cachedWorldStamps[index] = worldStamp;
+    }
+    if(worldStamp <= lastChange)
+        m_validatedAt[index] = lastChange;
+
+    InterlockedExchange(&m_cacheLocks[index], 0);
+}
+
+void gep::TransformStore::computeWorld(uint32 index, const mat4& parentWorld, const Quaternion& parentRotation) const
+{
+    m_worldMatrices[index] = parentWorld * getLocalMatrix(index);
+    const Quaternion worldRotation = parentRotation * getRotation(index);
+    m_worldRotationX[index] = worldRotation.x;
+    m_worldRotationY[index] = worldRotation.y;
+    m_worldRotationZ[index] = worldRotation.z;
+    m_worldRotationW[index] = worldRotation.angle;
+}
+
+void gep::TransformStore::sortByDepth()
+{
+    const size_t numEntries = m_handles.length();
+
+    // depth of every entry, destroyed entries are removed
+    const uint32 UNKNOWN = ~0u;
+    DynamicArray<uint32> depths;
+    depths.resize(numEntries);
+    for(size_t i=0; i < numEntries; i++)
+        depths[i] = UNKNOWN;
+    DynamicArray<uint32> path;
+    uint32 maxDepth = 0;
+    for(size_t i=0; i < numEntries; i++)
+    {
+        if(m_handles[i] == nullptr || depths[i] != UNKNOWN)
+            continue;
+        // walk up until the depth is known, then go back down
+        uint32 current = (uint32)i;
+        while(current != NO_PARENT && depths[current] == UNKNOWN)
+        {
+            path.append(current);
+            current = m_parentIndices[current];
+        }
+        uint32 depth = (current == NO_PARENT) ? 0 : depths[current] + 1;
+        while(path.length() > 0)
+        {
+            depths[path.lastElement()] = depth++;
+            path.removeLastElement();
+        }
+        maxDepth = GEP_MAX(maxDepth, depth - 1);
+    }
+
+    // counting sort by depth, the order within a level stays the same
+    const size_t numLevels = (numEntries > m_freeIndices.length()) ? maxDepth + 1 : 0;
+    m_levelEnds.resize(numLevels);
+    for(size_t level=0; level < numLevels; level++)
+        m_levelEnds[level] = 0;
+    for(size_t i=0; i < numEntries; i++)
+    {
+        if(depths[i] != UNKNOWN)
+            m_levelEnds[depths[i]]++;
+    }
+    DynamicArray<uint32> nextIndex;
+    nextIndex.resize(numLevels);
+    uint32 levelBegin = 0;
+    for(size_t level=0; level < numLevels; level++)
+    {
+        nextIndex[level] = levelBegin;
+        levelBegin += m_levelEnds[level];
+        m_levelEnds[level] = levelBegin;
+    }
+    DynamicArray<uint32> newIndices;
+    newIndices.resize(numEntries);
+    for(size_t i=0; i < numEntries; i++)
+        newIndices[i] = (depths[i] != UNKNOWN) ? nextIndex[depths[i]]++ : ~0u;
+
+    for(size_t i=0; i < numEntries; i++)
+    {
+        if(m_parentIndices[i] != NO_PARENT)
+            m_parentIndices[i] = newIndices[m_parentIndices[i]];
+    }
+    PermuteEntries permute = { newIndices, levelBegin };
+    forEachArray(permute);
+    for(uint32 i=0; i < levelBegin; i++)
+        m_handles[i]->m_index = i;
+
+    m_freeIndices.clear();
+    m_isSorted = true;
+}
+
+size_t gep::TransformStore::update()
+{
+    if(!m_isSorted)
+        sortByDepth();
+
+    const uint64 lastChange = getLastTransformChangeStamp();
+    size_t numComputed = 0;
+    uint32 levelBegin = 0;
+    for(size_t level=0; level < m_levelEnds.length(); level++)
+    {
+        // the parents are all in the previous levels
+        const uint32 levelEnd = m_levelEnds[level];
+        for(uint32 begin = levelBegin; begin < levelEnd; begin += 4)
+        {
+            const uint32 count = GEP_MIN(levelEnd - begin, 4u);
+            numComputed += updateGroup(begin, count, lastChange);
+        }
+        levelBegin = levelEnd;
+    }
+    return numComputed;
+}
+
+size_t gep::TransformStore::updateGroup(uint32 begin, uint32 count, uint64 lastChange)
+{
+    // nothing to do if none of the four world change stamps changed
+    uint64 worldStamps[4];
+    bool anyChanged = false;
+    for(uint32 lane=0; lane < count; lane++)
+    {
+        const uint32 index = begin + lane;
+        const uint32 parentIndex = m_parentIndices[index];
+        uint64 parentStamp = 0;
+        if(parentIndex != NO_PARENT)
+            parentStamp = m_cachedWorldStamps[parentIndex];
+        else if(m_externalParents[index] != nullptr)
+            parentStamp = m_externalParents[index]->getWorldChangeStamp();
+        worldStamps[lane] = GEP_MAX(m_changeStamps[index], parentStamp);
+        anyChanged |= (worldStamps[lane] != m_cachedWorldStamps[index]);
+    }
+
+    if(anyChanged)
+    {
+        // one lane per transform, the lanes of an incomplete group are padded with the identity
+        auto load = [begin, count](const DynamicArray<float>& values, float padding) -> __m128
+        {
+            if(count == 4)
+                return _mm_loadu_ps(&values[begin]);
+            float lanes[4] = { padding, padding, padding, padding };
+            for(uint32 lane=0; lane < count; lane++)
+                lanes[lane] = values[begin + lane];
+            return _mm_loadu_ps(lanes);
+        };
+        const __m128 positionX = load(m_positionX, 0.0f);
+        const __m128 positionY = load(m_positionY, 0.0f);
+        const __m128 positionZ = load(m_positionZ, 0.0f);
+        const __m128 rotationX = load(m_rotationX, 0.0f);
+        const __m128 rotationY = load(m_rotationY, 0.0f);
+        const __m128 rotationZ = load(m_rotationZ, 0.0f);
+        const __m128 rotationW = load(m_rotationW, 1.0f);
+
+        // local matrices, the same operations in the same order as getLocalMatrix
+        const __m128 lengthSquared = _mm_add_ps(_mm_add_ps(_mm_add_ps(
+            _mm_mul_ps(rotationX, rotationX), _mm_mul_ps(rotationY, rotationY)),
+            _mm_mul_ps(rotationZ, rotationZ)), _mm_mul_ps(rotationW, rotationW));
+        const __m128 length = _mm_sqrt_ps(lengthSquared);
+        const __m128 nx = _mm_div_ps(rotationX, length);
+        const __m128 ny = _mm_div_ps(rotationY, length);
+        const __m128 nz = _mm_div_ps(rotationZ, length);
+        const __m128 nw = _mm_div_ps(rotationW, length);
+        const __m128 xx = _mm_mul_ps(nx, nx);
+        const __m128 xy = _mm_mul_ps(nx, ny);
+        const __m128 xz = _mm_mul_ps(nx, nz);
+        const __m128 xw = _mm_mul_ps(nx, nw);
+        const __m128 yy = _mm_mul_ps(ny, ny);
+        const __m128 yz = _mm_mul_ps(ny, nz);
+        const __m128 yw = _mm_mul_ps(ny, nw);
+        const __m128 zz = _mm_mul_ps(nz, nz);
+        const __m128 zw = _mm_mul_ps(nz, nw);
+        const __m128 one = _mm_set1_ps(1.0f);
+        const __m128 two = _mm_set1_ps(2.0f);
+        const __m128 zero = _mm_setzero_ps();
+
+        __m128 local[16];
+        local[ 0] = _mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(yy, zz)));
+        local[ 1] =                 _mm_mul_ps(two, _mm_add_ps(xy, zw));
+        local[ 2] =                 _mm_mul_ps(two, _mm_sub_ps(xz, yw));
+        local[ 3] = zero;
+        local[ 4] =                 _mm_mul_ps(two, _mm_sub_ps(xy, zw));
+        local[ 5] = _mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, zz)));
+        local[ 6] =                 _mm_mul_ps(two, _mm_add_ps(yz, xw));
+        local[ 7] = zero;
+        local[ 8] =                 _mm_mul_ps(two, _mm_add_ps(xz, yw));
+        local[ 9] =                 _mm_mul_ps(two, _mm_sub_ps(yz, xw));
+        local[10] = _mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, yy)));
+        local[11] = zero;
+        local[12] = positionX;
+        local[13] = positionY;
+        local[14] = positionZ;
+        local[15] = one;
+        float localLanes[16][4];
+        for(size_t element=0; element < 16; element++)
+            _mm_storeu_ps(localLanes[element], local[element]);
+
+        // the parent world transformations
+        float parentRotations[4][4] = { { 0, 0, 0, 0 }, { 0, 0, 0, 0 }, { 0, 0, 0, 0 }, { 1, 1, 1, 1 } };
+        for(uint32 lane=0; lane < count; lane++)
+        {
+            const uint32 index = begin + lane;
+            const uint32 parentIndex = m_parentIndices[index];
+            ITransform* pExternalParent = m_externalParents[index];
+            mat4 externalWorld(DO_NOT_INITIALIZE);
+            const mat4* pParentWorld = &g_identityMatrix;
+            if(parentIndex != NO_PARENT)
+            {
+                pParentWorld = &m_worldMatrices[parentIndex];
+                parentRotations[0][lane] = m_worldRotationX[parentIndex];
+                parentRotations[1][lane] = m_worldRotationY[parentIndex];
+                parentRotations[2][lane] = m_worldRotationZ[parentIndex];
+                parentRotations[3][lane] = m_worldRotationW[parentIndex];
+            }
+            else if(pExternalParent != nullptr)
+            {
+                externalWorld = pExternalParent->getWorldTransformationMatrix();
+                pParentWorld = &externalWorld;
+                const Quaternion parentRotation = pExternalParent->getWorldRotation();
+                parentRotations[0][lane] = parentRotation.x;
+                parentRotations[1][lane] = parentRotation.y;
+                parentRotations[2][lane] = parentRotation.z;
+                parentRotations[3][lane] = parentRotation.angle;
+            }
+
+            // world = parent * local, one column at a time, summed up in the same order as mat4::operator *
+            const __m128 parentColumn0 = _mm_loadu_ps(pParentWorld->data);
+            const __m128 parentColumn1 = _mm_loadu_ps(pParentWorld->data + 4);
+            const __m128 parentColumn2 = _mm_loadu_ps(pParentWorld->data + 8);
+            const __m128 parentColumn3 = _mm_loadu_ps(pParentWorld->data + 12);
+            float* world = m_worldMatrices[index].data;
+            for(size_t column=0; column < 4; column++)
+            {
+                const __m128 result = _mm_add_ps(_mm_add_ps(_mm_add_ps(
+                    _mm_mul_ps(parentColumn0, _mm_set1_ps(localLanes[column * 4 + 0][lane])),
+                    _mm_mul_ps(parentColumn1, _mm_set1_ps(localLanes[column * 4 + 1][lane]))),
+                    _mm_mul_ps(parentColumn2, _mm_set1_ps(localLanes[column * 4 + 2][lane]))),
+                    _mm_mul_ps(parentColumn3, _mm_set1_ps(localLanes[column * 4 + 3][lane])));
+                _mm_storeu_ps(world + column * 4, result);
+            }
+        }
+
+        // world rotation = parent rotation * rotation, in the same order as Quaternion::operator *
+        const __m128 parentX = _mm_loadu_ps(parentRotations[0]);
+        const __m128 parentY = _mm_loadu_ps(parentRotations[1]);
+        const __m128 parentZ = _mm_loadu_ps(parentRotations[2]);
+        const __m128 parentW = _mm_loadu_ps(parentRotations[3]);
+        float worldRotations[4][4];
+        _mm_storeu_ps(worldRotations[0], _mm_sub_ps(_mm_add_ps(_mm_add_ps(
+            _mm_mul_ps(parentW, rotationX), _mm_mul_ps(parentX, rotationW)), _mm_mul_ps(parentY, rotationZ)), _mm_mul_ps(parentZ, rotationY)));
+        _mm_storeu_ps(worldRotations[1], _mm_sub_ps(_mm_add_ps(_mm_add_ps(
+            _mm_mul_ps(parentW, rotationY), _mm_mul_ps(parentY, rotationW)), _mm_mul_ps(parentZ, rotationX)), _mm_mul_ps(parentX, rotationZ)));
+        _mm_storeu_ps(worldRotations[2], _mm_sub_ps(_mm_add_ps(_mm_add_ps(
+            _mm_mul_ps(parentW, rotationZ), _mm_mul_ps(parentZ, rotationW)), _mm_mul_ps(parentX, rotationY)), _mm_mul_ps(parentY, rotationX)));
+        _mm_storeu_ps(worldRotations[3], _mm_sub_ps(_mm_sub_ps(_mm_sub_ps(
+            _mm_mul_ps(parentW, rotationW), _mm_mul_ps(parentX, rotationX)), _mm_mul_ps(parentY, rotationY)), _mm_mul_ps(parentZ, rotationZ)));
+        for(uint32 lane=0; lane < count; lane++)
+        {
+            m_worldRotationX[begin + lane] = worldRotations[0][lane];
+            m_worldRotationY[begin + lane] = worldRotations[1][lane];
+            m_worldRotationZ[begin + lane] = worldRotations[2][lane];
+            m_worldRotationW[begin + lane] = worldRotations[3][lane];
+        }
+    }
+
+    for(uint32 lane=0; lane < count; lane++)
+    {
+        const uint32 index = begin + lane;
+        m_cachedWorldStamps[index] = worldStamps[lane];
+        if(worldStamps[lane] <= lastChange)
+            m_validatedAt[index] = lastChange;
+    }
+    return anyChanged ? count : 0;
+}
+
+gep::StoredTransform::StoredTransform(TransformStore& store) :
+    m_pStore(&store),
+    m_index(store.create(this))
+{
+}
+
+gep::StoredTransform::~StoredTransform()
+{
+    if(m_pStore != nullptr)
+        m_pStore->destroy(m_index);
+}
+
+void gep::StoredTransform::removeFromStore()
+{
+    GEP_ASSERT(m_pStore != nullptr, "the transform was already removed from its store");
+    m_pStore->destroy(m_index);
+    m_pStore = nullptr;
+}
+
+void gep::StoredTransform::setParentOfChildren(ITransform* parent)
+{
+    m_pStore->setParentOfChildren(m_index, parent);
+}
+
+void gep::StoredTransform::setPosition(const vec3& pos)
+{
+    m_pStore->m_positionX[m_index] = pos.x;
+    m_pStore->m_positionY[m_index] = pos.y;
+    m_pStore->m_positionZ[m_index] = pos.z;
+    m_pStore->markChanged(m_index);
+}
+
+void gep::StoredTransform::setRotation(const Quaternion& rot)
+{
+    m_pStore->m_rotationX[m_index] = rot.x;
+    m_pStore->m_rotationY[m_index] = rot.y;
+    m_pStore->m_rotationZ[m_index] = rot.z;
+    m_pStore->m_rotationW[m_index] = rot.angle;
+    m_pStore->markChanged(m_index);
+}
+
+void gep::StoredTransform::setBaseOrientation(const Quaternion& orientation)
+{
+    m_pStore->m_baseOrientations[m_index] = orientation;
+    m_pStore->markChanged(m_index);
+}
+
+void gep::StoredTransform::setBaseViewDirection(const vec3& direction)
+{
+    setBaseOrientation(Quaternion(direction, vec3(0, 1, 0)));
+}
+
+gep::mat4 gep::StoredTransform::getWorldTransformationMatrix() const
+{
+    return m_pStore->getWorldMatrix(m_index);
+}
+
+gep::vec3 gep::StoredTransform::getWorldPosition() const
+{
+    return m_pStore->getWorldMatrix(m_index).translationPart();
+}
+
+gep::Quaternion gep::StoredTransform::getWorldRotation() const
+{
+    return m_pStore->getWorldRotation(m_index);
+}
+
+gep::mat4 gep::StoredTransform::getTransformationMatrix() const
+{
+    return m_pStore->getLocalMatrix(m_index);
+}
+
+gep::vec3 gep::StoredTransform::getPosition() const
+{
+    return vec3(m_pStore->m_positionX[m_index], m_pStore->m_positionY[m_index], m_pStore->m_positionZ[m_index]);
+}
+
+gep::Quaternion gep::StoredTransform::getRotation() const
+{
+    return m_pStore->getRotation(m_index);
+}
+
+gep::vec3 gep::StoredTransform::getViewDirection() const
+{
+    return m_pStore->getWorldOrientation(m_index) * vec3(0, 1, 0);
+}
+
+gep::vec3 gep::StoredTransform::getUpDirection() const
+{
+    return m_pStore->getWorldOrientation(m_index) * vec3(0, 0, 1);
+}
+
+gep::vec3 gep::StoredTransform::getRightDirection() const
+{
+    return m_pStore->getWorldOrientation(m_index) * vec3(1, 0, 0);
+}
+
+void gep::StoredTransform::setParent(ITransform* parent)
+{
+    m_pStore->setParent(m_index, parent);
+}
+
+gep::ITransform* gep::StoredTransform::getParent()
+{
+    return m_pStore->getParent(m_index);
+}
+
+const gep::ITransform* gep::StoredTransform::getParent() const
+{
+    return m_pStore->getParent(m_index);
+}
+
+gep::uint64 gep::StoredTransform::getWorldChangeStamp() const
+{
+    return m_pStore->getWorldChangeStamp(m_index);
+}
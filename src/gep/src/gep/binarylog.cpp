@@ -0,0 +1,611 @@
+#include "stdafx.h"
+#include "gep/binaryLog.h"
+#include "gep/utils.h"
+#include <stdio.h>
+
+#ifndef va_copy
+// va_list is a plain pointer on Windows
+#define va_copy(destination, source) ((destination) = (source))
+#endif
+
+namespace
+{
+    enum class ArgumentType
+    {
+        // %%
+        none,
+        signedInteger,
+        unsignedInteger,
+        character,
+        floatingPoint,
+        string,
+        pointer,
+        // %n, wide characters and invalid conversions
+        unsupported
+    };
+
+    enum class LengthModifier
+    {
+        none,
+        hh,
+        h,
+        l,
+        ll,
+        j,
+        z,
+        t,
+        L,
+        // I on Windows, the size of a pointer
+        I,
+        wide
+    };
+
+    // conversion specifications longer than this are not encoded
+    const size_t MAX_SPEC_LENGTH = 32;
+    const gep::uint16 NULL_STRING_LENGTH = 0xFFFF;
+
+    struct FormatSpec
+    {
+        // the '%'
+        const char* begin;
+        // after the conversion character
+        const char* end;
+        // the length modifier, it is left out when the spec is rebuilt for formatting
+        const char* lengthBegin;
+        const char* lengthEnd;
+        bool starWidth;
+        bool starPrecision;
+        LengthModifier length;
+        ArgumentType type;
+    };
+
+    // finds the next conversion specification in fmt, returns false if there is none
+    bool parseNextSpec(const char* fmt, FormatSpec& spec)
+    {
+        const char* p = strchr(fmt, '%');
+        if(p == nullptr)
+        {
+            return false;
+        }
+        spec.begin = p++;
+        spec.starWidth = false;
+        spec.starPrecision = false;
+        spec.length = LengthModifier::none;
+
+        while(*p == '-' || *p == '+' || *p == ' ' || *p == '#' || *p == '0')
+            p++;
+        if(*p == '*')
+        {
+            spec.starWidth = true;
+            p++;
+        }
+        while(*p >= '0' && *p <= '9')
+            p++;
+        if(*p == '.')
+        {
+            p++;
+            if(*p == '*')
+            {
+                spec.starPrecision = true;
+                p++;
+            }
+            while(*p >= '0' && *p <= '9')
+                p++;
+        }
+
+        spec.lengthBegin = p;
+        switch(*p)
+        {
+        case 'h':
+            p++;
+            spec.length = LengthModifier::h;
+            if(*p == 'h')
+            {
+                p++;
+                spec.length = LengthModifier::hh;
+            }
+            break;
+        case 'l':
+            p++;
+            spec.length = LengthModifier::l;
+            if(*p == 'l')
+            {
+                p++;
+                spec.length = LengthModifier::ll;
+            }
+            break;
+        case 'j': p++; spec.length = LengthModifier::j; break;
+        case 'z': p++; spec.length = LengthModifier::z; break;
+        case 't': p++; spec.length = LengthModifier::t; break;
+        case 'L': p++; spec.length = LengthModifier::L; break;
+        case 'w': p++; spec.length = LengthModifier::wide; break;
+        case 'I':
+            p++;
+            if(p[0] == '6' && p[1] == '4')
+            {
+                p += 2;
+                spec.length = LengthModifier::ll;
+            }
+            else if(p[0] == '3' && p[1] == '2')
+            {
+                p += 2;
+            }
+            else
+            {
+                spec.length = LengthModifier::I;
+            }
+            break;
+        }
+        spec.lengthEnd = p;
+
+        const bool isWide = (spec.length == LengthModifier::l || spec.length == LengthModifier::wide);
+        switch(*p)
+        {
+        case '%':
+            spec.type = ArgumentType::none;
+            break;
+        case 'd': case 'i':
+            spec.type = ArgumentType::signedInteger;
+            break;
+        case 'u': case 'o': case 'x': case 'X':
+            spec.type = ArgumentType::unsignedInteger;
+            break;
+        case 'c':
+            spec.type = isWide ? ArgumentType::unsupported : ArgumentType::character;
+            break;
+        case 's':
+            spec.type = isWide ? ArgumentType::unsupported : ArgumentType::string;
+            break;
+        case 'e': case 'E': case 'f': case 'F': case 'g': case 'G': case 'a': case 'A':
+            spec.type = ArgumentType::floatingPoint;
+            break;
+        case 'p':
+            spec.type = ArgumentType::pointer;
+            break;
+        default:
+            // %n, the wide %C and %S of Windows and everything invalid
+            spec.type = ArgumentType::unsupported;
+            break;
+        }
+        if(*p != '\0')
+        {
+            p++;
+        }
+        spec.end = p;
+        return true;
+    }
+
+    gep::int64 readSignedInteger(LengthModifier length, va_list* pArgptr)
+    {
+        switch(length)
+        {
+        case LengthModifier::hh: return (signed char)va_arg(*pArgptr, int);
+        case LengthModifier::h:  return (short)va_arg(*pArgptr, int);
+        case LengthModifier::l:  return va_arg(*pArgptr, long);
+        case LengthModifier::ll: return va_arg(*pArgptr, long long);
+        case LengthModifier::j:  return va_arg(*pArgptr, intmax_t);
+        case LengthModifier::z:
+        case LengthModifier::t:
+        case LengthModifier::I:  return va_arg(*pArgptr, ptrdiff_t);
+        default:                 return va_arg(*pArgptr, int);
+        }
+    }
+
+    gep::uint64 readUnsignedInteger(LengthModifier length, va_list* pArgptr)
+    {
+        switch(length)
+        {
+        case LengthModifier::hh: return (unsigned char)va_arg(*pArgptr, unsigned int);
+        case LengthModifier::h:  return (unsigned short)va_arg(*pArgptr, unsigned int);
+        case LengthModifier::l:  return va_arg(*pArgptr, unsigned long);
+        case LengthModifier::ll: return va_arg(*pArgptr, unsigned long long);
+        case LengthModifier::j:  return va_arg(*pArgptr, uintmax_t);
+        case LengthModifier::z:
+        case LengthModifier::t:
+        case LengthModifier::I:  return va_arg(*pArgptr, size_t);
+        default:                 return va_arg(*pArgptr, unsigned int);
+        }
+    }
+
+    class ArgumentWriter
+    {
+        gep::uint8* m_pCurrent;
+        gep::uint8* m_pEnd;
+        bool m_hasSpace;
+
+    public:
+        ArgumentWriter(gep::ArrayPtr<gep::uint8> buffer) :
+            m_pCurrent(buffer.getPtr()),
+            m_pEnd(buffer.getPtr() + buffer.length()),
+            m_hasSpace(true)
+        {
+        }
+
+        void write(const void* pData, size_t size)
+        {
+            if((size_t)(m_pEnd - m_pCurrent) < size)
+            {
+                m_hasSpace = false;
+                return;
+            }
+            memcpy(m_pCurrent, pData, size);
+            m_pCurrent += size;
+        }
+
+        template <class T>
+        inline void write(const T& value)
+        {
+            write(&value, sizeof(T));
+        }
+
+        inline bool hasSpace() const { return m_hasSpace; }
+        inline gep::uint8* getCurrent() const { return m_pCurrent; }
+    };
+
+    class ArgumentReader
+    {
+        const gep::uint8* m_pCurrent;
+        const gep::uint8* m_pEnd;
+
+    public:
+        ArgumentReader(gep::ArrayPtr<const gep::uint8> arguments) :
+            m_pCurrent(arguments.getPtr()),
+            m_pEnd(arguments.getPtr() + arguments.length())
+        {
+        }
+
+        bool read(void* pDestination, size_t size)
+        {
+            if((size_t)(m_pEnd - m_pCurrent) < size)
+            {
+                m_pCurrent = m_pEnd;
+                return false;
+            }
+            memcpy(pDestination, m_pCurrent, size);
+            m_pCurrent += size;
+            return true;
+        }
+
+        template <class T>
+        inline bool read(T& outValue)
+        {
+            return read(&outValue, sizeof(T));
+        }
+
+        bool readString(std::string& outString, bool& outIsNull)
+        {
+            gep::uint16 length;
+            if(!read(length))
+            {
+                return false;
+            }
+            outIsNull = (length == NULL_STRING_LENGTH);
+            if(outIsNull)
+            {
+                outString.clear();
+                return true;
+            }
+            if((size_t)(m_pEnd - m_pCurrent) < length)
+            {
+                m_pCurrent = m_pEnd;
+                return false;
+            }
+            outString.assign(reinterpret_cast<const char*>(m_pCurrent), length);
+            m_pCurrent += length;
+            return true;
+        }
+    };
+
+    // formats a single argument and appends it
+    void appendFormatted(std::string& outMessage, const char* spec, ...)
+    {
+        va_list argptr;
+        va_start(argptr, spec);
+        SCOPE_EXIT{ va_end(argptr); });
+
+        char buffer[128];
+        va_list argptrCopy;
+        va_copy(argptrCopy, argptr);
+        const int length = vsnprintf(buffer, GEP_ARRAY_SIZE(buffer), spec, argptrCopy);
+        va_end(argptrCopy);
+        if(length >= 0 && length < (int)GEP_ARRAY_SIZE(buffer))
+        {
+            outMessage.append(buffer, length);
+        }
+        else
+        {
+            outMessage += gep::vformat(spec, argptr);
+        }
+    }
+}
+
+size_t gep::encodeLogArguments(const char* fmt, va_list argptr, ArrayPtr<uint8> buffer)
+{
+    // the arguments are read by helper functions, which needs a va_list that can be passed by pointer
+    va_list arguments;
+    va_copy(arguments, argptr);
+    SCOPE_EXIT{ va_end(arguments); });
+
+    ArgumentWriter writer(buffer);
+    FormatSpec spec;
+    for(const char* p = fmt; parseNextSpec(p, spec); p = spec.end)
+    {
+        if(spec.type == ArgumentType::unsupported || (size_t)(spec.end - spec.begin) > MAX_SPEC_LENGTH)
+        {
+            return INVALID_LOG_ARGUMENTS_SIZE;
+        }
+        if(spec.starWidth)
+        {
+            writer.write((int64)va_arg(arguments, int));
+        }
+        if(spec.starPrecision)
+        {
+            writer.write((int64)va_arg(arguments, int));
+        }
+
+        switch(spec.type)
+        {
+        case ArgumentType::signedInteger:
+            writer.write(readSignedInteger(spec.length, &arguments));
+            break;
+        case ArgumentType::unsignedInteger:
+            writer.write(readUnsignedInteger(spec.length, &arguments));
+            break;
+        case ArgumentType::character:
+            writer.write((int64)va_arg(arguments, int));
+            break;
+        case ArgumentType::floatingPoint:
+            if(spec.length == LengthModifier::L)
+                writer.write((double)va_arg(arguments, long double));
+            else
+                writer.write(va_arg(arguments, double));
+            break;
+        case ArgumentType::pointer:
+            writer.write((uint64)(size_t)va_arg(arguments, void*));
+            break;
+        case ArgumentType::string:
+            {
+                const char* str = va_arg(arguments, const char*);
+                if(str == nullptr)
+                {
+                    writer.write(NULL_STRING_LENGTH);
+                    break;
+                }
+                const size_t length = strlen(str);
+                if(length >= NULL_STRING_LENGTH)
+                {
+                    return INVALID_LOG_ARGUMENTS_SIZE;
+                }
+                writer.write((uint16)length);
+                writer.write(str, length);
+            }
+            break;
+        default:
+            break;
+        }
+
+        if(!writer.hasSpace())
+        {
+            return INVALID_LOG_ARGUMENTS_SIZE;
+        }
+    }
+    return writer.getCurrent() - buffer.getPtr();
+}
+
+bool gep::formatLogArguments(std::string& outMessage, const char* fmt, ArrayPtr<const uint8> arguments, uint32 pointerSize)
+{
+    outMessage.clear();
+    ArgumentReader reader(arguments);
+    bool isComplete = true;
+    std::string str;
+
+    const char* p = fmt;
+    FormatSpec spec;
+    for(; parseNextSpec(p, spec); p = spec.end)
+    {
+        outMessage.append(p, spec.begin);
+        if(spec.type == ArgumentType::none)
+        {
+            outMessage += '%';
+            continue;
+        }
+        if(spec.type == ArgumentType::unsupported || (size_t)(spec.end - spec.begin) > MAX_SPEC_LENGTH)
+        {
+            // encodeLogArguments does not accept these
+            outMessage += "<unsupported>";
+            isComplete = false;
+            continue;
+        }
+
+        // rebuild the spec with the values of * and the length modifier of the encoded argument
+        char specBuffer[MAX_SPEC_LENGTH + 32];
+        char* pSpec = specBuffer;
+        int64 starValue = 0;
+        bool hasArguments = true;
+        for(const char* q = spec.begin; q < spec.lengthBegin; q++)
+        {
+            if(*q == '*')
+            {
+                hasArguments = reader.read(starValue) && hasArguments;
+                pSpec += sprintf(pSpec, "%d", (int)starValue);
+            }
+            else
+            {
+                *pSpec++ = *q;
+            }
+        }
+        const char conversion = *spec.lengthEnd;
+
+        switch(spec.type)
+        {
+        case ArgumentType::signedInteger:
+        case ArgumentType::unsignedInteger:
+            {
+                *pSpec++ = 'l';
+                *pSpec++ = 'l';
+                *pSpec++ = conversion;
+                *pSpec = '\0';
+                int64 value = 0;
+                if(reader.read(value) && hasArguments)
+                    appendFormatted(outMessage, specBuffer, value);
+                else
+                    hasArguments = false;
+            }
+            break;
+        case ArgumentType::character:
+            {
+                *pSpec++ = conversion;
+                *pSpec = '\0';
+                int64 value = 0;
+                if(reader.read(value) && hasArguments)
+                    appendFormatted(outMessage, specBuffer, (int)value);
+                else
+                    hasArguments = false;
+            }
+            break;
+        case ArgumentType::floatingPoint:
+            {
+                *pSpec++ = conversion;
+                *pSpec = '\0';
+                double value = 0.0;
+                if(reader.read(value) && hasArguments)
+                    appendFormatted(outMessage, specBuffer, value);
+                else
+                    hasArguments = false;
+            }
+            break;
+        case ArgumentType::pointer:
+            {
+                // the program that wrote the arguments might have used another pointer size, so %p can not be used
+                uint64 value = 0;
+                if(reader.read(value) && hasArguments)
+                    appendFormatted(outMessage, "%0*llX", (int)pointerSize * 2, value);
+                else
+                    hasArguments = false;
+            }
+            break;
+        case ArgumentType::string:
+            {
+                *pSpec++ = conversion;
+                *pSpec = '\0';
+                bool isNull = false;
+                if(reader.readString(str, isNull) && hasArguments)
+                    appendFormatted(outMessage, specBuffer, isNull ? nullptr : str.c_str());
+                else
+                    hasArguments = false;
+            }
+            break;
+        default:
+            break;
+        }
+
+        if(!hasArguments)
+        {
+            outMessage += "<missing>";
+            isComplete = false;
+        }
+    }
+    outMessage += p;
+    return isComplete;
+}
+
+gep::BinaryLogReader::BinaryLogReader(const char* filename) :
+    m_pointerSize(0),
+    m_isValid(false)
+{
+    m_file.open(filename, std::ios::in | std::ios::binary);
+    if(!m_file.is_open())
+    {
+        return;
+    }
+
+    char magic[GEP_ARRAY_SIZE(BinaryLogFile::MAGIC)];
+    uint32 version = 0;
+    m_isValid = read(magic, sizeof(magic))
+        && memcmp(magic, BinaryLogFile::MAGIC, sizeof(magic)) == 0
+        && read(&version, sizeof(version))
+        && version == BinaryLogFile::VERSION
+        && read(&m_pointerSize, sizeof(m_pointerSize));
+}
+
+bool gep::BinaryLogReader::read(void* pDestination, size_t size)
+{
+    m_file.read(static_cast<char*>(pDestination), size);
+    return (size_t)m_file.gcount() == size;
+}
+
+bool gep::BinaryLogReader::readMessage(LogChannel& outChannel, std::string& outMessage)
+{
+    if(!m_isValid)
+    {
+        return false;
+    }
+
+    for(;;)
+    {
+        uint8 entryType;
+        if(!read(&entryType, sizeof(entryType)))
+        {
+            return false;
+        }
+
+        switch((BinaryLogFile::EntryType)entryType)
+        {
+        case BinaryLogFile::EntryType::formatString:
+            {
+                uint32 id, length;
+                if(!read(&id, sizeof(id)) || !read(&length, sizeof(length)) || id != m_formatStrings.length())
+                {
+                    return false;
+                }
+                std::string formatString(length, '\0');
+                if(length > 0 && !read(&formatString[0], length))
+                {
+                    return false;
+                }
+                m_formatStrings.append(formatString);
+            }
+            break;
+
+        case BinaryLogFile::EntryType::deferredMessage:
+            {
+                uint8 channel;
+                uint32 formatId;
+                uint16 argumentsSize;
+                if(!read(&channel, sizeof(channel)) || !read(&formatId, sizeof(formatId)) || !read(&argumentsSize, sizeof(argumentsSize))
+                   || formatId >= m_formatStrings.length())
+                {
+                    return false;
+                }
+                m_arguments.resize(argumentsSize);
+                if(argumentsSize > 0 && !read(&m_arguments[0], argumentsSize))
+                {
+                    return false;
+                }
+                outChannel = (LogChannel)channel;
+                formatLogArguments(outMessage, m_formatStrings[formatId].c_str(), m_arguments.toArray(), m_pointerSize);
+                return true;
+            }
+
+        case BinaryLogFile::EntryType::message:
+            {
+                uint8 channel;
+                uint32 length;
+                if(!read(&channel, sizeof(channel)) || !read(&length, sizeof(length)))
+                {
+                    return false;
+                }
+                outMessage.resize(length);
+                if(length > 0 && !read(&outMessage[0], length))
+                {
+                    return false;
+                }
+                outChannel = (LogChannel)channel;
+                return true;
+            }
+
+        default:
+            return false;
+        }
+    }
+}
@@ -1,15 +1,19 @@
 #include "stdafx.h"
 #include "gep/chunkfile.h"
+#include "gep/resourceCache.h"
 
 gep::Chunkfile::Chunkfile(const char* filename, Operation operation)
 {
       m_filename = filename;
       m_operation = operation;
       m_readLocation = nullptr;
+      m_writeIndex = false;
       switch(m_operation)
       {
       case Operation::read:
           m_file.open(filename, "rb");
+          if(m_file.isOpen())
+              readIndex(m_file.getSize());
           break;
       case Operation::write:
           m_file.open(filename, "wb");
@@ -17,11 +21,29 @@ gep::Chunkfile::Chunkfile(const char* filename, Operation operation)
       case Operation::modify:
           m_file.open(filename, "rb");
           m_oldData = GEP_NEW_ARRAY(g_stdAllocator, uint8, m_file.getSize());
+          m_readData = m_oldData;
           m_readLocation = m_oldData.getPtr();
           m_file.readArray(m_oldData.getPtr(), m_oldData.length());
           m_file.close();
+          // the chunk index of the old file is dropped, it would not match the modified file
+          if(m_oldData.length() >= INDEX_FOOTER_SIZE)
+          {
+              uint32 footer[2];
+              memcpy(footer, m_oldData.getPtr() + m_oldData.length() - INDEX_FOOTER_SIZE, INDEX_FOOTER_SIZE);
+              const size_t indexOffset = findIndexOffset(footer, m_oldData.length());
+              if(indexOffset > 0)
+                  m_readData = ArrayPtr<const uint8>(m_oldData.getPtr(), indexOffset);
+          }
           m_file.open(filename, "wb");
           break;
+      case Operation::mappedRead:
+          if(m_mappedFile.open(filename))
+          {
+              m_readData = m_mappedFile.getData();
+              m_readLocation = m_readData.getPtr();
+              readIndex(m_readData.length());
+          }
+          break;
       }
 }
 
@@ -51,6 +73,7 @@ gep::Result gep::Chunkfile::startReadChunk()
     });
     GEP_ASSERT(m_operation != Operation::write, "opening a existing chunk is not possible in write mode");
     ChunkReadInfo info;
+    const size_t headerPosition = hasIndex() ? getReadPosition() : 0;
 
     //read the chunk name
     if(read(info.nameLength) != 1 || info.nameLength > MAX_CHUNK_NAME_LENGTH)
@@ -74,12 +97,67 @@ gep::Result gep::Chunkfile::startReadChunk()
         m_readInfo.lastElement().bytesLeft -= info.bytesLeft;
     }
 
+    if(hasIndex())
+        info.indexEntry = findIndexEntry(headerPosition, info);
     m_readInfo.append(info);
 
     result = SUCCESS;
     return SUCCESS;
 }
 
+gep::Result gep::Chunkfile::startReadChunk(const char* name)
+{
+    GEP_ASSERT(m_operation != Operation::write, "opening a existing chunk is not possible in write mode");
+    const size_t nameLength = strlen(name);
+
+    if(m_readInfo.length() > 0 && m_readInfo.lastElement().indexEntry != NO_INDEX_ENTRY)
+    {
+        // the children of a chunk follow it in the index, nothing before the chunk we look for is read
+        const uint32 parent = m_readInfo.lastElement().indexEntry;
+        const size_t position = getReadPosition();
+        const size_t parentEnd = position + m_readInfo.lastElement().bytesLeft;
+        for(size_t i = parent + 1; i < m_index.length() && m_index[i].offset < parentEnd; i++)
+        {
+            const IndexEntry& entry = m_index[i];
+            if(entry.parent == parent && entry.offset >= position &&
+               entry.nameLength == nameLength && memcmp(entry.name, name, nameLength) == 0)
+            {
+                skipRead(entry.offset - position);
+                if(startReadChunk() != SUCCESS)
+                    return FAILURE;
+                if(m_readInfo.lastElement().indexEntry == i)
+                    return SUCCESS;
+                // the index does not match the file
+                skipCurrentChunk();
+                return FAILURE;
+            }
+        }
+        return FAILURE;
+    }
+
+    // without an index the chunks before it have to be walked
+    while(m_readInfo.length() == 0 || currentChunkHasMoreData())
+    {
+        if(startReadChunk() != SUCCESS)
+            return FAILURE;
+        auto& info = m_readInfo.lastElement();
+        if(info.nameLength == nameLength && memcmp(info.name, name, nameLength) == 0)
+            return SUCCESS;
+        skipCurrentChunk();
+    }
+    return FAILURE;
+}
+
+gep::Result gep::Chunkfile::getCurrentChunkHash(uint64& hash) const
+{
+    GEP_ASSERT(m_readInfo.length() > 0, "no chunk is open");
+    const uint32 indexEntry = m_readInfo.lastElement().indexEntry;
+    if(indexEntry == NO_INDEX_ENTRY)
+        return FAILURE;
+    hash = m_index[indexEntry].hash;
+    return SUCCESS;
+}
+
 void gep::Chunkfile::endReadChunk()
 {
     GEP_ASSERT(m_readInfo.length() > 0, "no chunk to end");
@@ -90,8 +168,18 @@ void gep::Chunkfile::endReadChunk()
 void gep::Chunkfile::startWriteChunk(const char* name)
 {
     GEP_ASSERT(strlen(name) <= MAX_CHUNK_NAME_LENGTH, "chunk name is to long");
-    writeArrayWithLength<char, uint8>(ArrayPtr<char>((char*)name, strlen(name)));
     ChunkWriteInfo info;
+    if(m_writeIndex)
+    {
+        IndexEntry entry;
+        entry.nameLength = (uint8)strlen(name);
+        memcpy(entry.name, name, entry.nameLength);
+        entry.parent = (m_writeInfo.length() > 0) ? m_writeInfo.lastElement().indexEntry : NO_INDEX_ENTRY;
+        entry.offset = (uint32)m_file.position();
+        info.indexEntry = (uint32)m_indexEntries.length();
+        m_indexEntries.append(entry);
+    }
+    writeArrayWithLength<char, uint8>(ArrayPtr<char>((char*)name, strlen(name)));
     info.lengthPosition = m_file.position();
     write<uint32>(0);
     m_writeInfo.append(info);
@@ -101,6 +189,8 @@ size_t gep::Chunkfile::endWriteChunk()
 {
     GEP_ASSERT(m_writeInfo.length() > 0, "there is no chunk to end");
     auto length = m_writeInfo.lastElement().length;
+    if(m_writeInfo.lastElement().indexEntry != NO_INDEX_ENTRY)
+        m_indexEntries[m_writeInfo.lastElement().indexEntry].length = static_cast<uint32>(length);
     m_file.seek(m_writeInfo.lastElement().lengthPosition);
     m_file.write<uint32>(static_cast<uint32>(length));
     m_file.seekEnd();
@@ -113,7 +203,7 @@ size_t gep::Chunkfile::endWriteChunk()
 void gep::Chunkfile::keepRestOfCurrentChunk()
 {
     GEP_ASSERT(m_operation == Operation::modify, "can only keep chunks in modifiy operation");
-    ptrdiff_t bytesRemaining = (m_oldData.getPtr() + m_oldData.length()) - m_readLocation;
+    ptrdiff_t bytesRemaining = (m_readData.getPtr() + m_readData.length()) - m_readLocation;
     GEP_ASSERT(bytesRemaining >= 0, "privous read did go out of bounds");
     if(bytesRemaining > 0)
     {
@@ -132,7 +222,7 @@ void gep::Chunkfile::skipRead(size_t bytes)
     }
     else
     {
-        GEP_ASSERT(m_readLocation + bytes <= m_oldData.getPtr() + m_oldData.length(), "out of bounds");
+        GEP_ASSERT(hasReadData(bytes), "out of bounds");
         m_readLocation += bytes;
     }
     if(m_readInfo.length() > 0)
@@ -150,16 +240,20 @@ void gep::Chunkfile::skipCurrentChunk()
     }
     else
     {
+        // jumps straight to the next chunk, nothing of the skipped one is touched
+        GEP_ASSERT(hasReadData(m_readInfo.lastElement().bytesLeft), "out of bounds");
         m_readLocation += m_readInfo.lastElement().bytesLeft;
         m_readInfo.lastElement().bytesLeft = 0;
         endReadChunk();
     }
 }
 
-void gep::Chunkfile::startWriting(const char* filetype, uint32 ver)
+void gep::Chunkfile::startWriting(const char* filetype, uint32 ver, bool writeIndex)
 {
     GEP_ASSERT(m_operation != Operation::read, "can't write in reading operation");
     GEP_ASSERT(ver > 0, "version has to be greater then 0");
+    GEP_ASSERT(!writeIndex || m_operation == Operation::write, "the chunk index can only be written in write operation");
+    m_writeIndex = writeIndex;
     startWriteChunk(filetype);
     write(ver);
     write<uint32>(1); // DebugMode = off
@@ -170,6 +264,8 @@ void gep::Chunkfile::endWriting()
     GEP_ASSERT(m_operation != Operation::read, "can't write in reading operation");
     GEP_ASSERT(m_writeInfo.length() == 1, "there is still more then 1 chunk open");
     endWriteChunk();
+    if(m_writeIndex)
+        writeIndex();
 }
 
 gep::Result gep::Chunkfile::startReading(const char* filetype)
@@ -214,3 +310,134 @@ void gep::Chunkfile::endReading()
 {
     endReadChunk();
 }
+
+size_t gep::Chunkfile::getReadPosition()
+{
+    if(m_operation == Operation::read)
+        return m_file.position();
+    return m_readLocation - m_readData.getPtr();
+}
+
+void gep::Chunkfile::setReadPosition(size_t position)
+{
+    if(m_operation == Operation::read)
+    {
+        m_file.seek(position);
+    }
+    else
+    {
+        GEP_ASSERT(position <= m_readData.length(), "out of bounds");
+        m_readLocation = m_readData.getPtr() + position;
+    }
+}
+
+size_t gep::Chunkfile::findIndexOffset(const uint32 footer[2], size_t fileSize)
+{
+    // the file chunk is at 0, so that is never the position of the index
+    if(footer[1] != INDEX_MAGIC || footer[0] >= fileSize - INDEX_FOOTER_SIZE)
+        return 0;
+    return footer[0];
+}
+
+void gep::Chunkfile::readIndex(size_t fileSize)
+{
+    if(fileSize < INDEX_FOOTER_SIZE)
+        return;
+    const size_t startPosition = getReadPosition();
+    SCOPE_EXIT{ setReadPosition(startPosition); });
+
+    uint32 footer[2] = { 0, 0 };
+    setReadPosition(fileSize - INDEX_FOOTER_SIZE);
+    if(readArray(ArrayPtr<uint32>(footer)) != INDEX_FOOTER_SIZE)
+        return;
+    const size_t indexOffset = findIndexOffset(footer, fileSize);
+    if(indexOffset == 0)
+        return;
+
+    setReadPosition(indexOffset);
+    if(startReadChunk() != SUCCESS)
+        return;
+    SCOPE_EXIT{ m_readInfo.clear(); });
+
+    uint32 numEntries = 0;
+    if(getCurrentChunkName() != "chunkIndex" || read(numEntries) != sizeof(numEntries) ||
+       m_readInfo.lastElement().bytesLeft % sizeof(IndexEntry) != 0 ||
+       m_readInfo.lastElement().bytesLeft / sizeof(IndexEntry) != numEntries)
+    {
+        return;
+    }
+    if(m_operation == Operation::mappedRead)
+    {
+        m_index = readArrayView<IndexEntry>(numEntries);
+    }
+    else
+    {
+        m_indexEntries.resize(numEntries);
+        if(readArray(m_indexEntries.toArray()) == numEntries * sizeof(IndexEntry))
+            m_index = m_indexEntries.toArray();
+    }
+}
+
+gep::uint32 gep::Chunkfile::findIndexEntry(size_t offset, const ChunkReadInfo& info) const
+{
+    size_t first = 0;
+    size_t last = m_index.length();
+    while(first < last)
+    {
+        const size_t middle = first + (last - first) / 2;
+        if(m_index[middle].offset < offset)
+            first = middle + 1;
+        else
+            last = middle;
+    }
+    // an index which does not match the file is ignored
+    if(first == m_index.length() || m_index[first].offset != offset || m_index[first].nameLength != info.nameLength ||
+       memcmp(m_index[first].name, info.name, info.nameLength) != 0)
+    {
+        return NO_INDEX_ENTRY;
+    }
+    return (uint32)first;
+}
+
+void gep::Chunkfile::writeIndex()
+{
+    // the hashes are computed from the finished file
+    m_file.close();
+    {
+        MappedFile writtenFile;
+        if(!writtenFile.open(m_filename.c_str()))
+        {
+            GEP_ASSERT(false, "could not read the written file for the chunk index", m_filename.c_str());
+            return;
+        }
+        auto data = writtenFile.getData();
+        for(auto& entry : m_indexEntries)
+        {
+            const size_t dataOffset = entry.offset + sizeof(uint8) + entry.nameLength + sizeof(uint32);
+            GEP_ASSERT(dataOffset + entry.length <= data.length(), "chunk is outside of the file", entry.offset, entry.length);
+            // hashOf differs between x86 and x64, the index needs a hash which can be stored
+            entry.hash = ResourceCache::hashContent(data(dataOffset, dataOffset + entry.length));
+        }
+    }
+
+    m_file.open(m_filename.c_str(), "r+b");
+    m_file.seekEnd();
+
+    // the entries are aligned, readers can use them straight from a mapped file
+    static_assert(sizeof(IndexEntry) == sizeof(uint8) + MAX_CHUNK_NAME_LENGTH + 3 * sizeof(uint32) + sizeof(uint64), "the index entries are written as they are");
+    const char* indexChunkName = "chunkIndex";
+    const size_t entriesOffset = sizeof(uint8) + strlen(indexChunkName) + sizeof(uint32) + sizeof(uint32);
+    while((m_file.position() + entriesOffset) % sizeof(uint64) != 0)
+        write<uint8>(0);
+    const uint32 indexOffset = (uint32)m_file.position();
+
+    // the index itself is not part of the index
+    m_writeIndex = false;
+    startWriteChunk(indexChunkName);
+    write((uint32)m_indexEntries.length());
+    writeArray(m_indexEntries.toArray());
+    endWriteChunk();
+
+    write(indexOffset);
+    write((uint32)INDEX_MAGIC);
+}
@@ -1,71 +1,234 @@
 #include "stdafx.h"
 #include "gep/container/hashmap.h"
+#include <emmintrin.h>
+#include <intrin.h>
 
 namespace
 {
-    inline unsigned int get16bits( const unsigned char* x )
+    //
+    // The short and medium path is wyhash by Wang Yi (public domain, https://github.com/wangyi-fudan/wyhash),
+    // the long path is an SSE2 accumulator in the style of XXH3 by Yann Collet.
+    // The hash values differ between x86 and x64, they must not be stored.
+    //
+
+    const gep::uint64 PRIME0 = 0xa0761d6478bd642full;
+    const gep::uint64 PRIME1 = 0xe7037ed1a0b428dbull;
+    const gep::uint64 PRIME2 = 0x8ebc6af09c88c6e3ull;
+    const gep::uint64 PRIME3 = 0x589965cc75374cc3ull;
+    // mix(PRIME0, PRIME1), the initial state for seed 0
+    const gep::uint64 ZERO_SEED_STATE = 0x1ff5c2923a788d2cull;
+
+    // inputs longer than this are hashed with the SSE2 accumulator
+    #ifdef _M_X64
+    // 64 bit multiplications are native, the three multiplication chains of the medium path are faster
+    const size_t LONG_INPUT = std::numeric_limits<size_t>::max();
+    #else
+    const size_t LONG_INPUT = 256;
+    #endif
+    const size_t STRIPE_SIZE = 64;
+    const size_t SECRET_SIZE = 192;
+    // every stripe of a block uses the secret shifted by 8 bytes
+    const size_t STRIPES_PER_BLOCK = (SECRET_SIZE - STRIPE_SIZE) / 8;
+    const size_t BLOCK_SIZE = STRIPES_PER_BLOCK * STRIPE_SIZE;
+
+    // random bytes, generated with splitmix64
+    const gep::uint64 s_secret[SECRET_SIZE / 8] = {
+        0xc0e16b163a85a4dcull, 0x890acd8dd443c47cull, 0xb3889d8a6dc47761ull, 0x6a0398e528f0ae6aull,
+        0x048344ece48a855eull, 0xf175cfea21871330ull, 0x391ceef02702c2fdull, 0x4baf8cac4784cb12ull,
+        0x3547744583a3f88eull, 0xd9cf2b15c6b6c90eull, 0x961facc76d5fe21cull, 0x0094ab49d50f11f9ull,
+        0xe3211e37bdbeb6dcull, 0x62fe6c274ff3511aull, 0x5ac30b329fdf0574ull, 0x1450582c6b65b406ull,
+        0x7a30fcc7888eb791ull, 0x5540f5ba6a15576eull, 0x16cef0559096d3e9ull, 0x2cf8f14b06874899ull,
+        0xc9c9263b6e2ce103ull, 0xd6ff920b0a9faa6dull, 0x53192697db998dc1ull, 0x73ea9b9bc7cd18d7ull,
+    };
+
+    // x86 allows unaligned reads
+    inline gep::uint64 read64(const unsigned char* p)
     {
-        return *reinterpret_cast<const unsigned short*>(x);
+        return *reinterpret_cast<const gep::uint64*>(p);
     }
-}
 
-unsigned int gep::hashOf( const void* buf, size_t len, unsigned int seed)
-{
-    //
-    // This is Paul Hsieh's SuperFastHash algorithm, described here:
-    //  http://www.azillionmonkeys.com/qed/hash.html
-    // It is protected by the following open source license:
-    //   http://www.azillionmonkeys.com/qed/weblicense.html
-    //
+    inline gep::uint64 read32(const unsigned char* p)
+    {
+        return *reinterpret_cast<const gep::uint32*>(p);
+    }
 
+    // reads 1 to 3 bytes
+    inline gep::uint64 readSmall(const unsigned char* p, size_t len)
+    {
+        return (((gep::uint64)p[0]) << 16) | (((gep::uint64)p[len >> 1]) << 8) | p[len - 1];
+    }
 
-    // NOTE: SuperFastHash normally starts with a zero hash value.  The seed
-    //       value was incorporated to allow chaining.
-    auto data = reinterpret_cast<const unsigned char*>(buf);
-    auto hash = seed;
-    int  rem;
+    /// \brief computes the 128 bit product of a and b, a receives the low and b the high half
+    inline void multiply128(gep::uint64& a, gep::uint64& b)
+    {
+        #ifdef _M_X64
+        gep::uint64 high;
+        a = _umul128(a, b, &high);
+        b = high;
+        #else
+        const gep::uint64 aHigh = a >> 32, aLow = (gep::uint32)a;
+        const gep::uint64 bHigh = b >> 32, bLow = (gep::uint32)b;
+        const gep::uint64 high = aHigh * bHigh;
+        const gep::uint64 middle0 = aHigh * bLow;
+        const gep::uint64 middle1 = bHigh * aLow;
+        const gep::uint64 low = aLow * bLow;
+        const gep::uint64 t = low + (middle0 << 32);
+        gep::uint64 carry = (t < low) ? 1 : 0;
+        const gep::uint64 result = t + (middle1 << 32);
+        carry += (result < t) ? 1 : 0;
+        a = result;
+        b = high + (middle0 >> 32) + (middle1 >> 32) + carry;
+        #endif
+    }
+
+    inline gep::uint64 mix(gep::uint64 a, gep::uint64 b)
+    {
+        multiply128(a, b);
+        return a ^ b;
+    }
 
-    if( len <= 0 || data == nullptr )
-    return 0;
+    inline gep::uint64 avalanche(gep::uint64 hash)
+    {
+        hash ^= hash >> 37;
+        hash *= 0x165667919e3779f9ull;
+        hash ^= hash >> 32;
+        return hash;
+    }
 
-    rem = len & 3;
-    len >>= 2;
+    inline void accumulateStripe(__m128i* acc, const unsigned char* data, const unsigned char* key)
+    {
+        for(int i = 0; i < 4; i++)
+        {
+            const __m128i dataVec = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data) + i);
+            const __m128i keyVec = _mm_loadu_si128(reinterpret_cast<const __m128i*>(key) + i);
+            const __m128i dataKey = _mm_xor_si128(dataVec, keyVec);
+            // 32x32 -> 64 bit products of the low and high half of every 64 bit lane
+            const __m128i dataKeyHigh = _mm_shuffle_epi32(dataKey, _MM_SHUFFLE(0, 3, 0, 1));
+            const __m128i product = _mm_mul_epu32(dataKey, dataKeyHigh);
+            // also add the unmixed input of the neighbouring lane, so no input bits get lost in the multiplication
+            const __m128i dataSwapped = _mm_shuffle_epi32(dataVec, _MM_SHUFFLE(1, 0, 3, 2));
+            acc[i] = _mm_add_epi64(acc[i], _mm_add_epi64(dataSwapped, product));
+        }
+    }
 
-    for( ; len > 0; len-- )
+    inline void scramble(__m128i* acc, const unsigned char* key)
     {
-    hash += get16bits( data );
-    auto tmp = (get16bits( data + 2 ) << 11) ^ hash;
-    hash  = (hash << 16) ^ tmp;
-    data += 2 * sizeof(unsigned short);
-    hash += hash >> 11;
+        const __m128i prime = _mm_set1_epi32(0x9e3779b1);
+        for(int i = 0; i < 4; i++)
+        {
+            __m128i value = acc[i];
+            value = _mm_xor_si128(value, _mm_srli_epi64(value, 47));
+            value = _mm_xor_si128(value, _mm_loadu_si128(reinterpret_cast<const __m128i*>(key) + i));
+            // 64 bit lanes times a 32 bit prime
+            const __m128i productLow = _mm_mul_epu32(value, prime);
+            const __m128i productHigh = _mm_mul_epu32(_mm_shuffle_epi32(value, _MM_SHUFFLE(0, 3, 0, 1)), prime);
+            acc[i] = _mm_add_epi64(productLow, _mm_slli_epi64(productHigh, 32));
+        }
     }
 
-    switch( rem )
+    gep::uint64 hashLong(const unsigned char* data, size_t len, gep::uint64 seed)
     {
-    case 3: hash += get16bits( data );
-        hash ^= hash << 16;
-        hash ^= data[sizeof(unsigned short)] << 18;
-        hash += hash >> 11;
-        break;
-    case 2: hash += get16bits( data );
-        hash ^= hash << 11;
-        hash += hash >> 17;
-        break;
-    case 1: hash += *data;
-        hash ^= hash << 10;
-        hash += hash >> 1;
-        break;
-    default:
-        break;
+        const unsigned char* secret = reinterpret_cast<const unsigned char*>(s_secret);
+
+        gep::uint64 lanes[8] = {
+            seed ^ PRIME3, PRIME0, seed ^ PRIME1, PRIME2,
+            seed ^ PRIME2, PRIME1, seed ^ PRIME0, PRIME3
+        };
+        __m128i acc[4];
+        for(int i = 0; i < 4; i++)
+            acc[i] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(lanes) + i);
+
+        const size_t numBlocks = (len - 1) / BLOCK_SIZE;
+        for(size_t block = 0; block < numBlocks; block++)
+        {
+            const unsigned char* blockData = data + block * BLOCK_SIZE;
+            for(size_t stripe = 0; stripe < STRIPES_PER_BLOCK; stripe++)
+                accumulateStripe(acc, blockData + stripe * STRIPE_SIZE, secret + stripe * 8);
+            scramble(acc, secret + SECRET_SIZE - STRIPE_SIZE);
+        }
+
+        const unsigned char* lastBlock = data + numBlocks * BLOCK_SIZE;
+        const size_t numStripes = ((len - 1) - numBlocks * BLOCK_SIZE) / STRIPE_SIZE;
+        for(size_t stripe = 0; stripe < numStripes; stripe++)
+            accumulateStripe(acc, lastBlock + stripe * STRIPE_SIZE, secret + stripe * 8);
+        // the last stripe overlaps with the previous one, so there is no partial stripe
+        accumulateStripe(acc, data + len - STRIPE_SIZE, secret + SECRET_SIZE - STRIPE_SIZE - 7);
+
+        for(int i = 0; i < 4; i++)
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(lanes) + i, acc[i]);
+
+        gep::uint64 result = len * PRIME1;
+        for(int i = 0; i < 4; i++)
+            result += mix(lanes[2 * i] ^ read64(secret + 11 + 16 * i), lanes[2 * i + 1] ^ read64(secret + 19 + 16 * i));
+        return avalanche(result);
     }
+}
 
-    // Force "avalanching" of final 127 bits
-    hash ^= hash << 3;
-    hash += hash >> 5;
-    hash ^= hash << 4;
-    hash += hash >> 17;
-    hash ^= hash << 25;
-    hash += hash >> 6;
+unsigned int gep::hashOf( const void* buf, size_t len, unsigned int seed)
+{
+    auto data = reinterpret_cast<const unsigned char*>(buf);
+    if(data == nullptr)
+        return 0;
 
-    return hash;
+    gep::uint64 hash;
+    if(len > LONG_INPUT)
+    {
+        hash = hashLong(data, len, seed);
+    }
+    else
+    {
+        gep::uint64 state = (seed == 0) ? ZERO_SEED_STATE : seed ^ mix(seed ^ PRIME0, PRIME1);
+        gep::uint64 a, b;
+        if(len <= 16)
+        {
+            if(len >= 4)
+            {
+                // two overlapping reads cover 4 to 16 bytes
+                const size_t offset = (len >> 3) << 2;
+                a = (read32(data) << 32) | read32(data + offset);
+                b = (read32(data + len - 4) << 32) | read32(data + len - 4 - offset);
+            }
+            else if(len > 0)
+            {
+                a = readSmall(data, len);
+                b = 0;
+            }
+            else
+            {
+                a = b = 0;
+            }
+        }
+        else
+        {
+            size_t remaining = len;
+            if(remaining > 48)
+            {
+                // three independent multiplication chains
+                gep::uint64 state1 = state, state2 = state;
+                do
+                {
+                    state = mix(read64(data) ^ PRIME1, read64(data + 8) ^ state);
+                    state1 = mix(read64(data + 16) ^ PRIME2, read64(data + 24) ^ state1);
+                    state2 = mix(read64(data + 32) ^ PRIME3, read64(data + 40) ^ state2);
+                    data += 48;
+                    remaining -= 48;
+                }
+                while(remaining > 48);
+                state ^= state1 ^ state2;
+            }
+            while(remaining > 16)
+            {
+                state = mix(read64(data) ^ PRIME1, read64(data + 8) ^ state);
+                data += 16;
+                remaining -= 16;
+            }
+            a = read64(data + remaining - 16);
+            b = read64(data + remaining - 8);
+        }
+        a ^= PRIME1;
+        b ^= state;
+        multiply128(a, b);
+        hash = mix(a ^ PRIME0 ^ len, b ^ PRIME1);
+    }
+    return (unsigned int)(hash ^ (hash >> 32));
 }
@@ -7,3 +7,67 @@ bool gep::fileExists(const char* name)
     return (attributes != 0xFFFFFFFF &&
             !(attributes & FILE_ATTRIBUTE_DIRECTORY));
 }
+
+gep::MappedFile::MappedFile() :
+    m_fileHandle(INVALID_HANDLE_VALUE),
+    m_mappingHandle(nullptr),
+    m_data()
+{
+}
+
+gep::MappedFile::~MappedFile()
+{
+    close();
+}
+
+bool gep::MappedFile::open(const char* pFilename)
+{
+    close();
+
+    m_fileHandle = CreateFileA(pFilename, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if(m_fileHandle == INVALID_HANDLE_VALUE)
+        return false;
+
+    LARGE_INTEGER size;
+    // empty files can not be mapped
+    if(!GetFileSizeEx(m_fileHandle, &size) || size.QuadPart == 0 || (unsigned long long)size.QuadPart > (size_t)-1)
+    {
+        close();
+        return false;
+    }
+
+    m_mappingHandle = CreateFileMappingA(m_fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if(m_mappingHandle == nullptr)
+    {
+        close();
+        return false;
+    }
+
+    auto pView = static_cast<const uint8*>(MapViewOfFile(m_mappingHandle, FILE_MAP_READ, 0, 0, 0));
+    if(pView == nullptr)
+    {
+        close();
+        return false;
+    }
+    m_data = ArrayPtr<const uint8>(pView, (size_t)size.QuadPart);
+    return true;
+}
+
+void gep::MappedFile::close()
+{
+    if(m_data.getPtr() != nullptr)
+    {
+        UnmapViewOfFile(m_data.getPtr());
+        m_data = ArrayPtr<const uint8>();
+    }
+    if(m_mappingHandle != nullptr)
+    {
+        CloseHandle(m_mappingHandle);
+        m_mappingHandle = nullptr;
+    }
+    if(m_fileHandle != INVALID_HANDLE_VALUE)
+    {
+        CloseHandle(m_fileHandle);
+        m_fileHandle = INVALID_HANDLE_VALUE;
+    }
+}
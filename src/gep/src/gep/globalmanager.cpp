@@ -36,6 +36,7 @@ gep::GlobalManager::GlobalManager() :
     m_pLogging(nullptr),
     m_ConsoleLogSink(nullptr),
     m_FileLogSink(nullptr),
+    m_BinaryFileLogSink(nullptr),
     m_pMemoryManager(nullptr),
     m_pResourceManager(nullptr),
     m_pTimer(nullptr)
@@ -95,6 +96,21 @@ void gep::GlobalManager::initialize()
         m_pScriptingManager->setManagerState(IScriptingManager::State::LoadingDisabled);
     }
     m_pLogging->logMessage("settings loaded");
+
+    {
+        auto& loggingSettings = m_pSettings->getLoggingSettings();
+        if (loggingSettings.deferredFormatting)
+        {
+            // the log system was created before the settings were loaded
+            static_cast<Logging*>(m_pLogging)->setDeferredFormatting(true);
+            if (!loggingSettings.binaryLogFile.empty())
+            {
+                m_BinaryFileLogSink = new BinaryFileLogSink(loggingSettings.binaryLogFile.c_str());
+                m_pLogging->registerSink(m_BinaryFileLogSink);
+            }
+            m_pLogging->logMessage("deferred log formatting enabled");
+        }
+    }
     m_pLogging->logMessage("\n==================================================");
 
     m_pLogging->logMessage("\n==================================================");
@@ -119,13 +135,16 @@ void gep::GlobalManager::initialize()
     m_pLogging->logMessage("\n==================================================");
 
     m_pLogging->logMessage("initializing task queue");
-    m_pTaskQueue = new TaskQueue();
+    {
+        auto& taskQueueSettings = m_pSettings->getTaskQueueSettings();
+        m_pTaskQueue = new TaskQueue(taskQueueSettings.numWorkers, taskQueueSettings.pinWorkersToCores);
+    }
     m_pLogging->logMessage("task queue initialized");
 
     m_pLogging->logMessage("\n==================================================");
 
     m_pLogging->logMessage("initializing resource manager");
-    m_pResourceManager = new gep::ResourceManager();
+    m_pResourceManager = new gep::ResourceManager(m_pSettings->getResourcesSettings());
     m_pResourceManager->initialize();
     m_pLogging->logMessage("resource manager initialized");
 
@@ -321,6 +340,12 @@ void gep::GlobalManager::destroy()
     m_pLogging->logMessage("\n==================================================");
 
     m_pLogging->logMessage("destroying log system");
+    if (m_BinaryFileLogSink != nullptr)
+    {
+        m_pLogging->deregisterSink(m_BinaryFileLogSink);
+        DELETE_AND_NULL(m_BinaryFileLogSink);
+    }
+
     m_pLogging->deregisterSink(m_FileLogSink);
     DELETE_AND_NULL(m_FileLogSink);
 #ifdef _DEBUG
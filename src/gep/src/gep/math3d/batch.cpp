@@ -0,0 +1,181 @@
+#include "stdafx.h"
+#include "gep/math3d/batch.h"
+
+#ifdef GEP_MATH3D_SSE
+namespace
+{
+    // converts four rotations, the same operations in the same order as Quaternion::toMat4
+    void toRotationMatrices4(const gep::Quaternion* rotations, gep::mat4* result)
+    {
+        // one lane per rotation
+        __m128 x = _mm_loadu_ps(rotations[0].data);
+        __m128 y = _mm_loadu_ps(rotations[1].data);
+        __m128 z = _mm_loadu_ps(rotations[2].data);
+        __m128 w = _mm_loadu_ps(rotations[3].data);
+        _MM_TRANSPOSE4_PS(x, y, z, w);
+
+        const __m128 length = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_add_ps(
+            _mm_mul_ps(x, x), _mm_mul_ps(y, y)), _mm_mul_ps(z, z)), _mm_mul_ps(w, w)));
+        const __m128 nx = _mm_div_ps(x, length);
+        const __m128 ny = _mm_div_ps(y, length);
+        const __m128 nz = _mm_div_ps(z, length);
+        const __m128 nw = _mm_div_ps(w, length);
+        const __m128 xx = _mm_mul_ps(nx, nx);
+        const __m128 xy = _mm_mul_ps(nx, ny);
+        const __m128 xz = _mm_mul_ps(nx, nz);
+        const __m128 xw = _mm_mul_ps(nx, nw);
+        const __m128 yy = _mm_mul_ps(ny, ny);
+        const __m128 yz = _mm_mul_ps(ny, nz);
+        const __m128 yw = _mm_mul_ps(ny, nw);
+        const __m128 zz = _mm_mul_ps(nz, nz);
+        const __m128 zw = _mm_mul_ps(nz, nw);
+        const __m128 one = _mm_set1_ps(1.0f);
+        const __m128 two = _mm_set1_ps(2.0f);
+        const __m128 zero = _mm_setzero_ps();
+
+        // element i of the four matrices
+        __m128 elements[16];
+        elements[ 0] = _mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(yy, zz)));
+        elements[ 1] =                 _mm_mul_ps(two, _mm_add_ps(xy, zw));
+        elements[ 2] =                 _mm_mul_ps(two, _mm_sub_ps(xz, yw));
+        elements[ 3] = zero;
+        elements[ 4] =                 _mm_mul_ps(two, _mm_sub_ps(xy, zw));
+        elements[ 5] = _mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, zz)));
+        elements[ 6] =                 _mm_mul_ps(two, _mm_add_ps(yz, xw));
+        elements[ 7] = zero;
+        elements[ 8] =                 _mm_mul_ps(two, _mm_add_ps(xz, yw));
+        elements[ 9] =                 _mm_mul_ps(two, _mm_sub_ps(yz, xw));
+        elements[10] = _mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, yy)));
+        elements[11] = zero;
+        elements[12] = zero;
+        elements[13] = zero;
+        elements[14] = zero;
+        elements[15] = one;
+
+        // back to one matrix per rotation, a column at a time
+        for(size_t column=0; column < 4; column++)
+        {
+            __m128 m0 = elements[column * 4 + 0];
+            __m128 m1 = elements[column * 4 + 1];
+            __m128 m2 = elements[column * 4 + 2];
+            __m128 m3 = elements[column * 4 + 3];
+            _MM_TRANSPOSE4_PS(m0, m1, m2, m3);
+            _mm_storeu_ps(result[0].data + column * 4, m0);
+            _mm_storeu_ps(result[1].data + column * 4, m1);
+            _mm_storeu_ps(result[2].data + column * 4, m2);
+            _mm_storeu_ps(result[3].data + column * 4, m3);
+        }
+    }
+}
+#endif
+
+void gep::transformPositions(const mat4& matrix, ArrayPtr<const vec3> positions, ArrayPtr<vec3> result)
+{
+    GEP_ASSERT(result.length() == positions.length(), "result has the wrong length", result.length(), positions.length());
+    const vec3* pPositions = positions.getPtr();
+    vec3* pResult = result.getPtr();
+#ifdef GEP_MATH3D_SSE
+    const simd::Columns columns(matrix.data);
+    for(size_t i=0; i < positions.length(); i++)
+    {
+        const vec3& position = pPositions[i];
+        simd::storeVec3(pResult[i].data, columns.combinePosition(_mm_set1_ps(position.x), _mm_set1_ps(position.y), _mm_set1_ps(position.z)));
+    }
+#else
+    for(size_t i=0; i < positions.length(); i++)
+        pResult[i] = matrix.transformPosition(pPositions[i]);
+#endif
+}
+
+void gep::transformDirections(const mat4& matrix, ArrayPtr<const vec3> directions, ArrayPtr<vec3> result)
+{
+    GEP_ASSERT(result.length() == directions.length(), "result has the wrong length", result.length(), directions.length());
+    const vec3* pDirections = directions.getPtr();
+    vec3* pResult = result.getPtr();
+#ifdef GEP_MATH3D_SSE
+    const simd::Columns columns(matrix.data);
+    for(size_t i=0; i < directions.length(); i++)
+    {
+        const vec3& direction = pDirections[i];
+        simd::storeVec3(pResult[i].data, columns.combine(_mm_set1_ps(direction.x), _mm_set1_ps(direction.y), _mm_set1_ps(direction.z)));
+    }
+#else
+    for(size_t i=0; i < directions.length(); i++)
+        pResult[i] = matrix.transformDirection(pDirections[i]);
+#endif
+}
+
+void gep::transformVectors(const mat4& matrix, ArrayPtr<const vec4> vectors, ArrayPtr<vec4> result)
+{
+    GEP_ASSERT(result.length() == vectors.length(), "result has the wrong length", result.length(), vectors.length());
+    const vec4* pVectors = vectors.getPtr();
+    vec4* pResult = result.getPtr();
+#ifdef GEP_MATH3D_SSE
+    const simd::Columns columns(matrix.data);
+    for(size_t i=0; i < vectors.length(); i++)
+    {
+        const vec4& vector = pVectors[i];
+        _mm_storeu_ps(pResult[i].data, columns.combine(_mm_set1_ps(vector.x), _mm_set1_ps(vector.y), _mm_set1_ps(vector.z), _mm_set1_ps(vector.w)));
+    }
+#else
+    for(size_t i=0; i < vectors.length(); i++)
+        pResult[i] = matrix * pVectors[i];
+#endif
+}
+
+void gep::multiplyMatrices(const mat4& lh, ArrayPtr<const mat4> rh, ArrayPtr<mat4> result)
+{
+    GEP_ASSERT(result.length() == rh.length(), "result has the wrong length", result.length(), rh.length());
+    const mat4* pRh = rh.getPtr();
+    mat4* pResult = result.getPtr();
+#ifdef GEP_MATH3D_SSE
+    const simd::Columns columns(lh.data);
+    for(size_t i=0; i < rh.length(); i++)
+        columns.multiply(pRh[i].data, pResult[i].data);
+#else
+    for(size_t i=0; i < rh.length(); i++)
+        pResult[i] = lh * pRh[i];
+#endif
+}
+
+void gep::multiplyMatrices(ArrayPtr<const mat4> lh, ArrayPtr<const mat4> rh, ArrayPtr<mat4> result)
+{
+    GEP_ASSERT(lh.length() == rh.length(), "the arrays have different lengths", lh.length(), rh.length());
+    GEP_ASSERT(result.length() == rh.length(), "result has the wrong length", result.length(), rh.length());
+    const mat4* pLh = lh.getPtr();
+    const mat4* pRh = rh.getPtr();
+    mat4* pResult = result.getPtr();
+#ifdef GEP_MATH3D_SSE
+    for(size_t i=0; i < rh.length(); i++)
+        simd::Columns(pLh[i].data).multiply(pRh[i].data, pResult[i].data);
+#else
+    for(size_t i=0; i < rh.length(); i++)
+        pResult[i] = pLh[i] * pRh[i];
+#endif
+}
+
+void gep::toRotationMatrices(ArrayPtr<const Quaternion> rotations, ArrayPtr<mat4> result)
+{
+    GEP_ASSERT(result.length() == rotations.length(), "result has the wrong length", result.length(), rotations.length());
+    const Quaternion* pRotations = rotations.getPtr();
+    mat4* pResult = result.getPtr();
+#ifdef GEP_MATH3D_SSE
+    size_t i = 0;
+    for(; i + 4 <= rotations.length(); i += 4)
+        toRotationMatrices4(pRotations + i, pResult + i);
+    if(i < rotations.length())
+    {
+        // the last incomplete group is padded with the identity
+        Quaternion padded[4];
+        mat4 paddedResult[4];
+        for(size_t lane=0; i + lane < rotations.length(); lane++)
+            padded[lane] = pRotations[i + lane];
+        toRotationMatrices4(padded, paddedResult);
+        for(size_t lane=0; i + lane < rotations.length(); lane++)
+            pResult[i + lane] = paddedResult[lane];
+    }
+#else
+    for(size_t i=0; i < rotations.length(); i++)
+        pResult[i] = pRotations[i].toMat4();
+#endif
+}
@@ -15,45 +15,338 @@ volatile gep::StdAllocator* gep::StdAllocator::s_globalInstance = nullptr;
 
 gep::Mutex gep::StdAllocator::s_creationMutex;
 
-void* gep::StdAllocator::allocateMemory(size_t size)
+namespace
 {
-    ScopedLock<Mutex> lock(m_allocationLock);
-    m_bytesAllocated += size;
-    if(m_bytesAllocated > m_peakBytesAllocated)
-        m_peakBytesAllocated = m_bytesAllocated;
-    m_numAllocations++;
-    return malloc(size);
+    const size_t g_sizeClassSizes[gep::ThreadCachingAllocator::NUM_SIZE_CLASSES] = {
+        16, 32, 48, 64, 80, 96, 112, 128,
+        192, 256, 384, 512, 768, 1024, 1536, 2048
+    };
+
+    // number of blocks moved between a thread cache and the shared pool at once
+    inline size_t batchSize(size_t sizeClass)
+    {
+        const size_t result = 8192 / g_sizeClassSizes[sizeClass];
+        return GEP_MAX((size_t)4, GEP_MIN((size_t)64, result));
+    }
 }
 
-void gep::StdAllocator::freeMemory(void* mem)
+gep::ThreadCachingAllocator::ThreadCachingAllocator() :
+    m_pCaches(nullptr),
+    m_retiredNumAllocations(0),
+    m_retiredNumFrees(0),
+    m_retiredBytesUsed(0),
+    m_chunkBytesReserved(0),
+    m_largeBytesReserved(0)
+{
+    static_assert(GEP_ARRAY_SIZE(g_sizeClassSizes) == NUM_SIZE_CLASSES, "size class table does not match NUM_SIZE_CLASSES");
+    static_assert(sizeof(BlockHeader) == 2 * sizeof(void*), "the block header has to keep the malloc alignment");
+
+    size_t sizeClass = 0;
+    for(size_t i=0; i < GEP_ARRAY_SIZE(m_sizeClassLookup); i++)
+    {
+        while(g_sizeClassSizes[sizeClass] < i * 16)
+            sizeClass++;
+        m_sizeClassLookup[i] = (uint8)sizeClass;
+    }
+
+    for(auto& central : m_central)
+    {
+        central.pFirst = nullptr;
+        central.count = 0;
+        central.pChunks = nullptr;
+    }
+
+    m_cacheIndex = FlsAlloc(&threadCacheDestructor);
+    GEP_ASSERT(m_cacheIndex != FLS_OUT_OF_INDEXES, "out of fiber local storage indices");
+}
+
+gep::ThreadCachingAllocator::~ThreadCachingAllocator()
+{
+    // calls threadCacheDestructor for every thread that still has a cache
+    FlsFree(m_cacheIndex);
+    while(m_pCaches != nullptr)
+        retireThreadCache(m_pCaches);
+
+    // memory which is still alive might be freed after we are gone (e.g. by other static destructors),
+    // so the chunks are only given back if nothing references them anymore
+    if(m_retiredNumAllocations != m_retiredNumFrees)
+        return;
+    for(auto& central : m_central)
+    {
+        while(central.pChunks != nullptr)
+        {
+            auto pChunk = central.pChunks;
+            central.pChunks = pChunk->pNext;
+            free(pChunk);
+        }
+        central.pFirst = nullptr;
+        central.count = 0;
+    }
+}
+
+void __stdcall gep::ThreadCachingAllocator::threadCacheDestructor(void* pCache)
+{
+    if(pCache != nullptr)
+    {
+        auto pThreadCache = static_cast<ThreadCache*>(pCache);
+        pThreadCache->pOwner->retireThreadCache(pThreadCache);
+    }
+}
+
+inline gep::ThreadCachingAllocator::ThreadCache* gep::ThreadCachingAllocator::getThreadCache()
+{
+    auto pCache = static_cast<ThreadCache*>(FlsGetValue(m_cacheIndex));
+    if(pCache == nullptr)
+        pCache = createThreadCache();
+    return pCache;
+}
+
+gep::ThreadCachingAllocator::ThreadCache* gep::ThreadCachingAllocator::createThreadCache()
+{
+    // the cache itself can not come from this allocator
+    auto pCache = static_cast<ThreadCache*>(malloc(sizeof(ThreadCache)));
+    GEP_ASSERT(pCache != nullptr, "out of memory");
+    memset(pCache, 0, sizeof(ThreadCache));
+    pCache->pOwner = this;
+    {
+        ScopedLock<Mutex> lock(m_cacheListMutex);
+        pCache->pNext = m_pCaches;
+        if(m_pCaches != nullptr)
+            m_pCaches->pPrev = pCache;
+        m_pCaches = pCache;
+    }
+    FlsSetValue(m_cacheIndex, pCache);
+    return pCache;
+}
+
+void gep::ThreadCachingAllocator::retireThreadCache(ThreadCache* pCache)
+{
+    for(size_t sizeClass = 0; sizeClass < NUM_SIZE_CLASSES; sizeClass++)
+    {
+        if(pCache->freeCounts[sizeClass] > 0)
+            releaseToCentral(pCache, sizeClass, pCache->freeCounts[sizeClass]);
+    }
+
+    {
+        ScopedLock<Mutex> lock(m_cacheListMutex);
+        m_retiredNumAllocations += pCache->numAllocations;
+        m_retiredNumFrees += pCache->numFrees;
+        m_retiredBytesUsed += pCache->bytesUsed;
+        if(pCache->pPrev != nullptr)
+            pCache->pPrev->pNext = pCache->pNext;
+        else
+            m_pCaches = pCache->pNext;
+        if(pCache->pNext != nullptr)
+            pCache->pNext->pPrev = pCache->pPrev;
+    }
+    free(pCache);
+}
+
+gep::Result gep::ThreadCachingAllocator::allocateChunk(size_t sizeClass)
+{
+    // called with the central lock held
+    auto& central = m_central[sizeClass];
+    const size_t blockSize = sizeof(BlockHeader) + g_sizeClassSizes[sizeClass];
+    size_t chunkSize = sizeof(ChunkHeader) + batchSize(sizeClass) * blockSize;
+    if(chunkSize < MIN_CHUNK_SIZE)
+        chunkSize = MIN_CHUNK_SIZE;
+
+    auto pChunk = static_cast<ChunkHeader*>(malloc(chunkSize));
+    if(pChunk == nullptr)
+        return FAILURE;
+    pChunk->pNext = central.pChunks;
+    pChunk->size = chunkSize;
+    central.pChunks = pChunk;
+    InterlockedExchangeAdd64(&m_chunkBytesReserved, chunkSize);
+
+    // carve the chunk into blocks
+    char* pBlockMemory = reinterpret_cast<char*>(pChunk + 1);
+    const size_t numBlocks = (chunkSize - sizeof(ChunkHeader)) / blockSize;
+    for(size_t i=0; i < numBlocks; i++)
+    {
+        auto pBlock = reinterpret_cast<FreeBlock*>(pBlockMemory + i * blockSize);
+        pBlock->pNext = central.pFirst;
+        central.pFirst = pBlock;
+    }
+    central.count += numBlocks;
+    return SUCCESS;
+}
+
+gep::Result gep::ThreadCachingAllocator::fetchFromCentral(ThreadCache* pCache, size_t sizeClass)
 {
-    ScopedLock<Mutex> lock(m_allocationLock);
-    if(mem != nullptr)
+    auto& central = m_central[sizeClass];
+    size_t numBlocks = batchSize(sizeClass);
+
+    ScopedLock<Mutex> lock(central.mutex);
+    if(central.count < numBlocks && allocateChunk(sizeClass) == FAILURE)
+    {
+        if(central.count == 0)
+            return FAILURE;
+        numBlocks = central.count;
+    }
+
+    FreeBlock* pFirst = central.pFirst;
+    FreeBlock* pLast = pFirst;
+    for(size_t i=1; i < numBlocks; i++)
+        pLast = pLast->pNext;
+    central.pFirst = pLast->pNext;
+    central.count -= numBlocks;
+
+    pLast->pNext = pCache->freeLists[sizeClass];
+    pCache->freeLists[sizeClass] = pFirst;
+    pCache->freeCounts[sizeClass] += numBlocks;
+    return SUCCESS;
+}
+
+void gep::ThreadCachingAllocator::releaseToCentral(ThreadCache* pCache, size_t sizeClass, size_t numBlocks)
+{
+    GEP_ASSERT(numBlocks > 0 && numBlocks <= pCache->freeCounts[sizeClass]);
+    FreeBlock* pFirst = pCache->freeLists[sizeClass];
+    FreeBlock* pLast = pFirst;
+    for(size_t i=1; i < numBlocks; i++)
+        pLast = pLast->pNext;
+    pCache->freeLists[sizeClass] = pLast->pNext;
+    pCache->freeCounts[sizeClass] -= numBlocks;
+
+    auto& central = m_central[sizeClass];
+    ScopedLock<Mutex> lock(central.mutex);
+    pLast->pNext = central.pFirst;
+    central.pFirst = pFirst;
+    central.count += numBlocks;
+}
+
+void* gep::ThreadCachingAllocator::allocateMemory(size_t size)
+{
+    ThreadCache* pCache = getThreadCache();
+    BlockHeader* pHeader = nullptr;
+
+    if(size > MAX_SMALL_SIZE)
     {
-        ++m_numFrees;
-        m_bytesAllocated -= _msize(mem);
-        free(mem);
+        pHeader = static_cast<BlockHeader*>(malloc(sizeof(BlockHeader) + size));
+        if(pHeader == nullptr)
+            return nullptr;
+        pHeader->sizeClass = LARGE_SIZE_CLASS;
+        InterlockedExchangeAdd64(&m_largeBytesReserved, sizeof(BlockHeader) + size);
     }
+    else
+    {
+        const size_t sizeClass = m_sizeClassLookup[(size + 15) / 16];
+        if(pCache->freeLists[sizeClass] == nullptr && fetchFromCentral(pCache, sizeClass) == FAILURE)
+            return nullptr;
+        FreeBlock* pBlock = pCache->freeLists[sizeClass];
+        pCache->freeLists[sizeClass] = pBlock->pNext;
+        pCache->freeCounts[sizeClass]--;
+        pHeader = reinterpret_cast<BlockHeader*>(pBlock);
+        pHeader->sizeClass = sizeClass;
+    }
+
+    pHeader->size = size;
+    pCache->numAllocations++;
+    pCache->bytesUsed += size;
+    return pHeader + 1;
+}
+
+void gep::ThreadCachingAllocator::freeMemory(void* mem)
+{
+    if(mem == nullptr)
+        return;
+
+    ThreadCache* pCache = getThreadCache();
+    BlockHeader* pHeader = static_cast<BlockHeader*>(mem) - 1;
+    const size_t sizeClass = pHeader->sizeClass;
+    pCache->numFrees++;
+    pCache->bytesUsed -= pHeader->size;
+
+    if(sizeClass == LARGE_SIZE_CLASS)
+    {
+        InterlockedExchangeAdd64(&m_largeBytesReserved, -(int64)(sizeof(BlockHeader) + pHeader->size));
+        free(pHeader);
+        return;
+    }
+
+    GEP_ASSERT(sizeClass < NUM_SIZE_CLASSES, "invalid free, memory was not allocated by this allocator");
+    auto pBlock = reinterpret_cast<FreeBlock*>(pHeader);
+    pBlock->pNext = pCache->freeLists[sizeClass];
+    pCache->freeLists[sizeClass] = pBlock;
+    // give memory back to the other threads if this thread only frees
+    const size_t batch = batchSize(sizeClass);
+    if(++pCache->freeCounts[sizeClass] >= 2 * batch)
+        releaseToCentral(pCache, sizeClass, batch);
+}
+
+size_t gep::ThreadCachingAllocator::getNumAllocations() const
+{
+    ScopedLock<Mutex> lock(m_cacheListMutex);
+    size_t result = m_retiredNumAllocations;
+    for(auto pCache = m_pCaches; pCache != nullptr; pCache = pCache->pNext)
+        result += pCache->numAllocations;
+    return result;
+}
+
+size_t gep::ThreadCachingAllocator::getNumFrees() const
+{
+    ScopedLock<Mutex> lock(m_cacheListMutex);
+    size_t result = m_retiredNumFrees;
+    for(auto pCache = m_pCaches; pCache != nullptr; pCache = pCache->pNext)
+        result += pCache->numFrees;
+    return result;
+}
+
+size_t gep::ThreadCachingAllocator::getNumBytesReserved() const
+{
+    return (size_t)(m_chunkBytesReserved + m_largeBytesReserved);
+}
+
+size_t gep::ThreadCachingAllocator::getNumBytesUsed() const
+{
+    // a block can be freed on another thread than it was allocated on,
+    // so the per thread values can be negative, only the sum is meaningful
+    ScopedLock<Mutex> lock(m_cacheListMutex);
+    ptrdiff_t result = m_retiredBytesUsed;
+    for(auto pCache = m_pCaches; pCache != nullptr; pCache = pCache->pNext)
+        result += pCache->bytesUsed;
+    return (size_t)result;
+}
+
+gep::IAllocator* gep::ThreadCachingAllocator::getParentAllocator() const
+{
+    return nullptr;
+}
+
+size_t gep::ThreadCachingAllocator::getSizeClassSize(size_t sizeClass)
+{
+    GEP_ASSERT(sizeClass < NUM_SIZE_CLASSES, "invalid size class", sizeClass);
+    return g_sizeClassSizes[sizeClass];
+}
+
+void* gep::StdAllocator::allocateMemory(size_t size)
+{
+    return m_allocator.allocateMemory(size);
+}
+
+void gep::StdAllocator::freeMemory(void* mem)
+{
+    m_allocator.freeMemory(mem);
 }
 
 size_t gep::StdAllocator::getNumAllocations() const
 {
-    return m_numAllocations;
+    return m_allocator.getNumAllocations();
 }
 
 size_t gep::StdAllocator::getNumFrees() const
 {
-    return m_numFrees;
+    return m_allocator.getNumFrees();
 }
 
 size_t gep::StdAllocator::getNumBytesReserved() const
 {
-    return m_peakBytesAllocated;
+    return m_allocator.getNumBytesReserved();
 }
 
 size_t gep::StdAllocator::getNumBytesUsed() const
 {
-    return m_bytesAllocated;
+    return m_allocator.getNumBytesUsed();
 }
 
 gep::IAllocator* gep::StdAllocator::getParentAllocator() const
@@ -426,3 +426,239 @@ size_t gep::DoubleEndedStackAllocator::getDynamicArraysSize() const
 {
     return m_Front.m_StackAllocator.getDynamicArraySize() + m_Back.m_StackAllocator.getDynamicArraySize();
 }
+
+namespace
+{
+    const size_t g_smallObjectSizeClassSizes[gep::SmallObjectAllocator::NUM_SIZE_CLASSES] = {
+        16, 32, 48, 64, 80, 96, 112, 128,
+        160, 192, 224, 256, 320, 384, 448, 512
+    };
+}
+
+gep::SmallObjectAllocator::SmallObjectAllocator(IAllocator* pParentAllocator) :
+    m_pParentAllocator(pParentAllocator),
+    m_pPages(nullptr),
+    m_numAllocations(0),
+    m_numFrees(0),
+    m_numBytesUsed(0),
+    m_numBytesReserved(0)
+{
+    GEP_ASSERT(pParentAllocator != nullptr, "the small object allocator needs a parent allocator");
+    for(size_t i = 0; i < NUM_SIZE_CLASSES; i++)
+    {
+        m_sizeClasses[i].pFreeList = nullptr;
+        m_sizeClasses[i].pUnused = nullptr;
+        m_sizeClasses[i].pUnusedEnd = nullptr;
+    }
+
+    size_t sizeClass = 0;
+    for(size_t i = 0; i < GEP_ARRAY_SIZE(m_sizeClassLookup); i++)
+    {
+        while(g_smallObjectSizeClassSizes[sizeClass] < i * SIZE_CLASS_GRANULARITY)
+            sizeClass++;
+        m_sizeClassLookup[i] = (uint8)sizeClass;
+    }
+}
+
+gep::SmallObjectAllocator::~SmallObjectAllocator()
+{
+    while(m_pPages != nullptr)
+    {
+        Page* pNext = m_pPages->pNext;
+        m_pParentAllocator->freeMemory(m_pPages);
+        m_pPages = pNext;
+    }
+}
+
+void* gep::SmallObjectAllocator::allocateFromNewPage(size_t sizeClass)
+{
+    Page* pPage = static_cast<Page*>(m_pParentAllocator->allocateMemory(PAGE_SIZE));
+    if(pPage == nullptr)
+    {
+        return nullptr;
+    }
+    pPage->pNext = m_pPages;
+    m_pPages = pPage;
+    m_numBytesReserved += PAGE_SIZE;
+
+    // the rest of the previous page is smaller than a block
+    const size_t blockSize = g_smallObjectSizeClassSizes[sizeClass];
+    char* pFirstBlock = reinterpret_cast<char*>(pPage + 1);
+    SizeClass& sizeClassData = m_sizeClasses[sizeClass];
+    sizeClassData.pUnused = pFirstBlock + blockSize;
+    sizeClassData.pUnusedEnd = pFirstBlock + ((PAGE_SIZE - sizeof(Page)) / blockSize) * blockSize;
+    return pFirstBlock;
+}
+
+void* gep::SmallObjectAllocator::allocate(size_t size)
+{
+    const size_t sizeClass = getSizeClass(size);
+    void* mem = nullptr;
+    if(sizeClass == LARGE_SIZE_CLASS)
+    {
+        mem = m_pParentAllocator->allocateMemory(size);
+        if(mem == nullptr)
+        {
+            return nullptr;
+        }
+        m_numBytesReserved += size;
+    }
+    else
+    {
+        SizeClass& sizeClassData = m_sizeClasses[sizeClass];
+        if(sizeClassData.pFreeList != nullptr)
+        {
+            mem = sizeClassData.pFreeList;
+            sizeClassData.pFreeList = sizeClassData.pFreeList->pNext;
+        }
+        else if(sizeClassData.pUnused != sizeClassData.pUnusedEnd)
+        {
+            mem = sizeClassData.pUnused;
+            sizeClassData.pUnused += g_smallObjectSizeClassSizes[sizeClass];
+        }
+        else
+        {
+            mem = allocateFromNewPage(sizeClass);
+            if(mem == nullptr)
+            {
+                return nullptr;
+            }
+        }
+    }
+
+    m_numAllocations++;
+    m_numBytesUsed += size;
+    return mem;
+}
+
+void gep::SmallObjectAllocator::deallocate(void* mem, size_t size)
+{
+    if(mem == nullptr)
+    {
+        return;
+    }
+
+    const size_t sizeClass = getSizeClass(size);
+    if(sizeClass == LARGE_SIZE_CLASS)
+    {
+        m_pParentAllocator->freeMemory(mem);
+        m_numBytesReserved -= size;
+    }
+    else
+    {
+        FreeBlock* pBlock = static_cast<FreeBlock*>(mem);
+        pBlock->pNext = m_sizeClasses[sizeClass].pFreeList;
+        m_sizeClasses[sizeClass].pFreeList = pBlock;
+    }
+
+    GEP_ASSERT(m_numBytesUsed >= size, "freeing more memory than was allocated", size, m_numBytesUsed);
+    m_numFrees++;
+    m_numBytesUsed -= size;
+}
+
+void* gep::SmallObjectAllocator::reallocate(void* mem, size_t originalSize, size_t newSize)
+{
+    if(mem == nullptr)
+    {
+        return (newSize > 0) ? allocate(newSize) : nullptr;
+    }
+    if(newSize == 0)
+    {
+        deallocate(mem, originalSize);
+        return nullptr;
+    }
+
+    // the block is big enough and not too big, it can stay where it is
+    const size_t sizeClass = getSizeClass(newSize);
+    const size_t originalSizeClass = getSizeClass(originalSize);
+    if(sizeClass != LARGE_SIZE_CLASS && sizeClass == originalSizeClass)
+    {
+        m_numBytesUsed = m_numBytesUsed - originalSize + newSize;
+        return mem;
+    }
+
+    // Lua expects shrinking to never fail, so shrinks do not need a new block.
+    // A block that is freed with a smaller size joins the free list of the smaller size class.
+    if(newSize < originalSize)
+    {
+        if(originalSizeClass == LARGE_SIZE_CLASS)
+        {
+            if(sizeClass != LARGE_SIZE_CLASS)
+            {
+                // moving gives the large block back to the parent allocator
+                void* newMem = allocate(newSize);
+                if(newMem != nullptr)
+                {
+                    memcpy(newMem, mem, newSize);
+                    deallocate(mem, originalSize);
+                    return newMem;
+                }
+                // otherwise the block stays and is reused by the size class, it stays reserved
+            }
+            else
+            {
+                // the parent allocator frees the whole block, the statistics follow the size it is freed with
+                m_numBytesReserved = m_numBytesReserved - originalSize + newSize;
+            }
+        }
+        m_numBytesUsed = m_numBytesUsed - originalSize + newSize;
+        return mem;
+    }
+
+    void* newMem = allocate(newSize);
+    if(newMem == nullptr)
+    {
+        // the caller still owns the old block
+        return nullptr;
+    }
+    memcpy(newMem, mem, GEP_MIN(originalSize, newSize));
+    deallocate(mem, originalSize);
+    return newMem;
+}
+
+void* gep::SmallObjectAllocator::allocateMemory(size_t size)
+{
+    m_numAllocations++;
+    return m_pParentAllocator->allocateMemory(size);
+}
+
+void gep::SmallObjectAllocator::freeMemory(void* mem)
+{
+    if(mem == nullptr)
+    {
+        return;
+    }
+    m_numFrees++;
+    m_pParentAllocator->freeMemory(mem);
+}
+
+size_t gep::SmallObjectAllocator::getNumAllocations() const
+{
+    return m_numAllocations;
+}
+
+size_t gep::SmallObjectAllocator::getNumFrees() const
+{
+    return m_numFrees;
+}
+
+size_t gep::SmallObjectAllocator::getNumBytesReserved() const
+{
+    return m_numBytesReserved;
+}
+
+size_t gep::SmallObjectAllocator::getNumBytesUsed() const
+{
+    return m_numBytesUsed;
+}
+
+gep::IAllocator* gep::SmallObjectAllocator::getParentAllocator() const
+{
+    return m_pParentAllocator;
+}
+
+size_t gep::SmallObjectAllocator::getSizeClassSize(size_t sizeClass)
+{
+    GEP_ASSERT(sizeClass < NUM_SIZE_CLASSES, "invalid size class", sizeClass);
+    return g_smallObjectSizeClassSizes[sizeClass];
+}
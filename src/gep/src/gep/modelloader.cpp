@@ -3,14 +3,130 @@
 #include "gep/file.h"
 #include "gep/exception.h"
 #include "gep/chunkfile.h"
+#include "gep/threading/parallelFor.h"
 #include <sstream>
+#include <emmintrin.h>
 
 namespace {
-    float readCompressedFloat(gep::Chunkfile& file)
+    // returns the next count values of the file, without copying them when the file is mapped
+    template <typename T>
+    gep::ArrayPtr<const T> readValues(gep::Chunkfile& file, size_t count, gep::DynamicArray<T>& buffer)
     {
-        gep::int16 data = 0;
-        file.read(data);
-        return (float)data / (float)std::numeric_limits<gep::int16>::max();
+        if(file.getOperation() == gep::Chunkfile::Operation::mappedRead)
+            return file.readArrayView<T>(count);
+        buffer.resize(count);
+        file.readArray(buffer.toArray());
+        return buffer.toArray();
+    }
+
+    // decodes compressed floats stored as int16, pSource may be the same as pDestination
+    // the values are decoded from the back, so the floats never overwrite int16 which are not decoded yet
+    void decompressFloats(const gep::int16* pSource, float* pDestination, size_t count)
+    {
+        // divide instead of multiplying with the reciprocal, so the results match the scalar decoding bit for bit
+        const float scale = (float)std::numeric_limits<gep::int16>::max();
+        const size_t numBlocks = count / 8;
+        for(size_t i = count; i > numBlocks * 8; i--)
+            pDestination[i - 1] = (float)pSource[i - 1] / scale;
+
+        const __m128 scaleVec = _mm_set1_ps(scale);
+        for(size_t block = numBlocks; block > 0; block--)
+        {
+            const size_t i = (block - 1) * 8;
+            const __m128i values = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pSource + i));
+            // sign extend by putting the values into the upper half and shifting them down
+            const __m128i low = _mm_srai_epi32(_mm_unpacklo_epi16(values, values), 16);
+            const __m128i high = _mm_srai_epi32(_mm_unpackhi_epi16(values, values), 16);
+            _mm_storeu_ps(pDestination + i, _mm_div_ps(_mm_cvtepi32_ps(low), scaleVec));
+            _mm_storeu_ps(pDestination + i + 4, _mm_div_ps(_mm_cvtepi32_ps(high), scaleVec));
+        }
+    }
+
+    // widens 16 bit indices to 32 bit, pSource may be the same as pDestination
+    void widenIndices(const gep::uint16* pSource, gep::uint32* pDestination, size_t count)
+    {
+        const size_t numBlocks = count / 8;
+        for(size_t i = count; i > numBlocks * 8; i--)
+            pDestination[i - 1] = pSource[i - 1];
+
+        const __m128i zero = _mm_setzero_si128();
+        for(size_t block = numBlocks; block > 0; block--)
+        {
+            const size_t i = (block - 1) * 8;
+            const __m128i values = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pSource + i));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(pDestination + i), _mm_unpacklo_epi16(values, zero));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(pDestination + i + 4), _mm_unpackhi_epi16(values, zero));
+        }
+    }
+
+    // mesh data which is decoded after the file was parsed
+    struct DecodeJob
+    {
+        enum Type
+        {
+            copyFloats,
+            decompressFloats,
+            widenIndices
+        };
+
+        Type type;
+        const void* pSource;
+        void* pDestination;
+        size_t count;
+    };
+
+    void runDecodeJob(const DecodeJob& job)
+    {
+        switch(job.type)
+        {
+        case DecodeJob::copyFloats:
+            memcpy(job.pDestination, job.pSource, job.count * sizeof(float));
+            break;
+        case DecodeJob::decompressFloats:
+            decompressFloats(static_cast<const gep::int16*>(job.pSource), static_cast<float*>(job.pDestination), job.count);
+            break;
+        case DecodeJob::widenIndices:
+            widenIndices(static_cast<const gep::uint16*>(job.pSource), static_cast<gep::uint32*>(job.pDestination), job.count);
+            break;
+        }
+    }
+
+    // Reads count values of the type Source for a decode job writing into pDestination.
+    // From a mapped file the job decodes straight from the file, otherwise the values are read into the destination
+    // and decoded in place, so the destination has to be at least as big as the values.
+    template <typename Source>
+    void readForDecoding(gep::Chunkfile& file, size_t count, void* pDestination, DecodeJob::Type type, gep::DynamicArray<DecodeJob>& jobs)
+    {
+        if(count == 0)
+            return;
+        DecodeJob job = { type, pDestination, pDestination, count };
+        if(file.getOperation() == gep::Chunkfile::Operation::mappedRead)
+        {
+            auto values = file.readArrayView<Source>(count);
+            if(values.length() != count)
+                throw gep::LoadingError("Unexpected end of mesh data");
+            job.pSource = values.getPtr();
+        }
+        else
+        {
+            if(file.readArray(gep::ArrayPtr<Source>(static_cast<Source*>(pDestination), count)) != count * sizeof(Source))
+                throw gep::LoadingError("Unexpected end of mesh data");
+            // read as they are
+            if(type == DecodeJob::copyFloats)
+                return;
+        }
+        jobs.append(job);
+    }
+
+    // starts reading the next chunk with the given name, the chunks before it are skipped
+    void startReadChunk(gep::Chunkfile& file, const char* name, const char* pFilename)
+    {
+        if(file.startReadChunk(name) != gep::SUCCESS)
+        {
+            std::ostringstream msg;
+            msg << "Missing '" << name << "' chunk in file '" << pFilename << "'";
+            throw gep::LoadingError(msg.str());
+        }
     }
 }
 
@@ -32,8 +148,10 @@ gep::ModelLoader::~ModelLoader()
     }
 }
 
-void gep::ModelLoader::loadFile(const char* pFilename, uint32 loadWhat)
+void gep::ModelLoader::loadFile(const char* pFilename, uint32 loadWhat, Chunkfile::Operation readOperation, TaskQueue* pTaskQueue)
 {
+    GEP_ASSERT(readOperation == Chunkfile::Operation::read || readOperation == Chunkfile::Operation::mappedRead,
+        "models can only be loaded with a read operation");
     GEP_ASSERT(!m_modelData.hasData,"LoadFile can only be called once");
     m_filename = pFilename;
 
@@ -44,7 +162,16 @@ void gep::ModelLoader::loadFile(const char* pFilename, uint32 loadWhat)
         throw LoadingError(msg.str());
     }
 
-    Chunkfile file(pFilename, Chunkfile::Operation::read);
+    Chunkfile file(pFilename, readOperation);
+    if(!file.isOpen())
+    {
+        std::ostringstream msg;
+        msg << "File '" << pFilename << "' could not be opened";
+        throw LoadingError(msg.str());
+    }
+
+    // the vertex attributes and faces are decoded once the whole file is parsed, in parallel if there is a task queue
+    DynamicArray<DecodeJob> decodeJobs(m_pAllocator);
 
     if(file.startReading("thModel") != SUCCESS)
     {
@@ -244,15 +371,9 @@ memstat.boneDataArray.size += sizeof(BoneInfo)* numBoneInfos; // extend the exis
 
     // Load textures
     {
-        file.startReadChunk();
-        if(file.getCurrentChunkName() != "textures")
-        {
-            std::ostringstream msg;
-            msg << "Expected 'textures' chunk but got '" << file.getCurrentChunkName() << "' chunk in file '" << pFilename << "'";
-            throw LoadingError(msg.str());
-        }
         if(loadWhat & Load::Materials)
         {
+            startReadChunk(file, "textures", pFilename);
             uint32 numTextures = 0;
             file.read(numTextures);
 
@@ -277,24 +398,13 @@ memstat.boneDataArray.size += sizeof(BoneInfo)* numBoneInfos; // extend the exis
 
             file.endReadChunk();
         }
-        else
-        {
-            file.skipCurrentChunk();
-        }
     }
 
     // Read Materials
     {
-        file.startReadChunk();
-        if(file.getCurrentChunkName() != "materials")
-        {
-            std::ostringstream msg;
-            msg << "Expected 'materials' chunk but got '" << file.getCurrentChunkName() << "' chunk in file '" << pFilename << "'";
-            throw LoadingError(msg.str());
-        }
-
         if(loadWhat & Load::Materials)
         {
+            startReadChunk(file, "materials", pFilename);
             uint32 numMaterials = 0;
             file.read(numMaterials);
 
@@ -354,25 +464,14 @@ memstat.boneDataArray.size += sizeof(BoneInfo)* numBoneInfos; // extend the exis
 
             file.endReadChunk();
         }
-        else
-        {
-            file.skipCurrentChunk();
-        }
     }
 
     // Read Bones
     if (file.getFileVersion() >= ModelFormatVersion::Version3)
     {
-        file.startReadChunk();
-        if(file.getCurrentChunkName() != "bones")
-        {
-            std::ostringstream msg;
-            msg << "Expected 'bones' chunk but got '" << file.getCurrentChunkName() << "' chunk in file '" << pFilename << "'";
-            throw LoadingError(msg.str());
-        }
-
         if (loadWhat & Load::Bones)
         {
+            startReadChunk(file, "bones", pFilename);
             uint32 numBones = 0;
             file.read(numBones);
             memstat.boneDataArray += allocationSize<BoneNode>(numBones);
@@ -395,24 +494,13 @@ memstat.boneDataArray.size += sizeof(BoneInfo)* numBoneInfos; // extend the exis
 
             file.endReadChunk();
         }
-        else
-        {
-            file.skipCurrentChunk();
-        }
     }
 
     // Read Meshes
     {
-        file.startReadChunk();
-        if(file.getCurrentChunkName() != "meshes")
-        {
-            std::ostringstream msg;
-            msg << "Expected 'meshes' chunk but got '" << file.getCurrentChunkName() << "' chunk in file '" << pFilename << "'";
-            throw LoadingError(msg.str());
-        }
-
         if(loadWhat & Load::Meshes)
         {
+            startReadChunk(file, "meshes", pFilename);
             uint32 numMeshes;
             file.read(numMeshes);
             memstat.meshDataArray += allocationSize<MeshData>(numMeshes);
@@ -450,7 +538,7 @@ memstat.boneDataArray.size += sizeof(BoneInfo)* numBoneInfos; // extend the exis
                 mesh.vertices = GEP_NEW_ARRAY(m_pModelDataAllocator, vec3, numVertices);
 
                 static_assert(sizeof(vec3) == 3 * sizeof(float), "The following read call assumes that a vec3 is 3 floats big");
-                file.readArray(ArrayPtr<float>(mesh.vertices[0].data, numVertices * 3));
+                readForDecoding<float>(file, numVertices * 3, mesh.vertices.getPtr(), DecodeJob::copyFloats, decodeJobs);
                 file.endReadChunk();
 
                 {
@@ -461,12 +549,7 @@ memstat.boneDataArray.size += sizeof(BoneInfo)* numBoneInfos; // extend the exis
                         {
                             memstat.vertexData += allocationSize<vec3>(numVertices);
                             mesh.normals = GEP_NEW_ARRAY(m_pModelDataAllocator, vec3, numVertices);
-                            for(auto& normal : mesh.normals)
-                            {
-                                normal.x = readCompressedFloat(file);
-                                normal.y = readCompressedFloat(file);
-                                normal.z = readCompressedFloat(file);
-                            }
+                            readForDecoding<int16>(file, numVertices * 3, mesh.normals.getPtr(), DecodeJob::decompressFloats, decodeJobs);
                             file.endReadChunk();
                         }
                         else
@@ -481,12 +564,7 @@ memstat.boneDataArray.size += sizeof(BoneInfo)* numBoneInfos; // extend the exis
                         {
                             memstat.vertexData += allocationSize<vec3>(numVertices);
                             mesh.tangents = GEP_NEW_ARRAY(m_pModelDataAllocator, vec3, numVertices);
-                            for(auto& tangent : mesh.tangents)
-                            {
-                                tangent.x = readCompressedFloat(file);
-                                tangent.y = readCompressedFloat(file);
-                                tangent.z = readCompressedFloat(file);
-                            }
+                            readForDecoding<int16>(file, numVertices * 3, mesh.tangents.getPtr(), DecodeJob::decompressFloats, decodeJobs);
                             file.endReadChunk();
                         }
                         else
@@ -501,12 +579,7 @@ memstat.boneDataArray.size += sizeof(BoneInfo)* numBoneInfos; // extend the exis
                         {
                             memstat.vertexData += allocationSize<vec3>(numVertices);
                             mesh.bitangents = GEP_NEW_ARRAY(m_pModelDataAllocator, vec3, numVertices);
-                            for(auto& bitangent : mesh.bitangents)
-                            {
-                                bitangent.x = readCompressedFloat(file);
-                                bitangent.y = readCompressedFloat(file);
-                                bitangent.z = readCompressedFloat(file);
-                            }
+                            readForDecoding<int16>(file, numVertices * 3, mesh.bitangents.getPtr(), DecodeJob::decompressFloats, decodeJobs);
                             file.endReadChunk();
                         }
                         else
@@ -537,7 +610,7 @@ memstat.boneDataArray.size += sizeof(BoneInfo)* numBoneInfos; // extend the exis
                                     memstat.vertexData += allocationSize<vec2>(numVertices);
                                     mesh.texcoords[i] = GEP_NEW_ARRAY(m_pModelDataAllocator, vec2, numVertices);
                                     static_assert(sizeof(vec2) == 2 * sizeof(float), "the following read call assumes that a vec2 is twice the size of a float");
-                                    file.readArray(ArrayPtr<float>((float*)mesh.texcoords[i].getPtr(), numVertices * numUVComponents));
+                                    readForDecoding<float>(file, numVertices * numUVComponents, mesh.texcoords[i].getPtr(), DecodeJob::copyFloats, decodeJobs);
                                 }
                                 else
                                 {
@@ -581,10 +654,15 @@ memstat.boneDataArray.size += sizeof(BoneInfo)* numBoneInfos; // extend the exis
                             };
 
                             // Read all bone infos
+                            DynamicArray<BoneInfoInFile> boneInfoBuffer(m_pAllocator);
+                            auto boneInfosInFile = readValues(file, numBoneInfos, boneInfoBuffer);
+                            if (boneInfosInFile.length() != numBoneInfos)
+                            {
+                                throw LoadingError("Unexpected end of bone infos");
+                            }
                             for (size_t boneIndex = 0; boneIndex < numBoneInfos; ++boneIndex)
                             {
-                                BoneInfoInFile boneInfoIntermediate;
-                                file.read(boneInfoIntermediate);
+                                const BoneInfoInFile& boneInfoIntermediate = boneInfosInFile[boneIndex];
                                 for (size_t vertexBoneIndex = 0; vertexBoneIndex < BoneInfo::NUM_SUPPORTED_BONES; ++vertexBoneIndex)
                                 {
                                     mesh.boneInfos[boneIndex].boneIds[vertexBoneIndex] = boneInfoIntermediate.boneIds[vertexBoneIndex];
@@ -614,13 +692,7 @@ memstat.boneDataArray.size += sizeof(BoneInfo)* numBoneInfos; // extend the exis
                         }
                         else
                         {
-                            uint16 data = 0;
-                            for(auto& face : mesh.faces)
-                            {
-                                file.read(data); face.indices[0] = (uint32)data;
-                                file.read(data); face.indices[1] = (uint32)data;
-                                file.read(data); face.indices[2] = (uint32)data;
-                            }
+                            readForDecoding<uint16>(file, numFaces * 3, mesh.faces.getPtr(), DecodeJob::widenIndices, decodeJobs);
                         }
                     }
                     else
@@ -637,26 +709,13 @@ memstat.boneDataArray.size += sizeof(BoneInfo)* numBoneInfos; // extend the exis
 
             file.endReadChunk();
         }
-        else
-        {
-            file.skipCurrentChunk();
-        }
     }
 
     // Read Nodes
     {
-        file.startReadChunk();
         if(loadWhat & Load::Nodes)
         {
-            {
-                auto currentChunkName = file.getCurrentChunkName();
-                if(currentChunkName != "nodes")
-                {
-                    std::ostringstream msg;
-                    msg << "Expected 'nodes' chunk but got '" << file.getCurrentChunkName() << "' in file '" << pFilename << "'";
-                    throw LoadingError(msg.str());
-                }
-            }
+            startReadChunk(file, "nodes", pFilename);
             // This is actually superfluous, the data is being read from the size info chunk
             uint32 numNodes;
             file.read(numNodes);
@@ -713,13 +772,23 @@ memstat.boneDataArray.size += sizeof(BoneInfo)* numBoneInfos; // extend the exis
 
             file.endReadChunk();
         }
-        else
-        {
-            file.skipCurrentChunk();
-        }
     }
 
-    file.endReading();
+    // the jobs of a mapped file read from it, so they have to be done before it is closed
+    if(pTaskQueue != nullptr)
+    {
+        parallelFor(*pTaskQueue, 0, decodeJobs.length(), 1, [&](size_t i){
+            runDecodeJob(decodeJobs[i]);
+        });
+    }
+    else
+    {
+        for(auto& job : decodeJobs)
+            runDecodeJob(job);
+    }
+
+    // chunks after the last loaded one are not read at all
+    file.skipCurrentChunk();
     m_modelData.hasData = true;
 }
 void gep::ModelLoader::loadFromData(SmartPtr<ReferenceCounted> pDataHolder, ArrayPtr<vec4> vertices, ArrayPtr<uint32> indices)
@@ -0,0 +1,227 @@
+#include "stdafx.h"
+#include "gep/resourceCache.h"
+#include "gep/file.h"
+
+namespace
+{
+    //
+    // The content hash is XXH64 by Yann Collet (BSD license, https://github.com/Cyan4973/xxHash).
+    // Unlike hashOf it only uses 64 bit arithmetic on little endian reads, so it is the same on x86 and x64.
+    //
+
+    const gep::uint64 PRIME1 = 0x9E3779B185EBCA87ull;
+    const gep::uint64 PRIME2 = 0xC2B2AE3D27D4EB4Full;
+    const gep::uint64 PRIME3 = 0x165667B19E3779F9ull;
+    const gep::uint64 PRIME4 = 0x85EBCA77C2B2AE63ull;
+    const gep::uint64 PRIME5 = 0x27D4EB2F165667C5ull;
+
+    const gep::uint32 CACHE_FILE_MAGIC = 0x31435247; // "GRC1"
+
+    struct CacheFileHeader
+    {
+        gep::uint32 magic;
+        gep::uint32 version;
+        gep::uint64 contentHash;
+        gep::uint64 payloadSize;
+        gep::uint64 payloadHash;
+        float conversionTimeMs;
+        gep::uint32 padding;
+    };
+    static_assert(sizeof(CacheFileHeader) == 40, "the cache file header must not depend on the platform");
+
+    inline gep::uint64 rotateLeft(gep::uint64 value, int bits)
+    {
+        return (value << bits) | (value >> (64 - bits));
+    }
+
+    inline gep::uint64 read64(const gep::uint8* p)
+    {
+        gep::uint64 value;
+        memcpy(&value, p, sizeof(value));
+        return value;
+    }
+
+    inline gep::uint32 read32(const gep::uint8* p)
+    {
+        gep::uint32 value;
+        memcpy(&value, p, sizeof(value));
+        return value;
+    }
+
+    inline gep::uint64 round(gep::uint64 accumulator, gep::uint64 input)
+    {
+        accumulator += input * PRIME2;
+        accumulator = rotateLeft(accumulator, 31);
+        return accumulator * PRIME1;
+    }
+
+    inline gep::uint64 mergeRound(gep::uint64 hash, gep::uint64 accumulator)
+    {
+        hash ^= round(0, accumulator);
+        return hash * PRIME1 + PRIME4;
+    }
+}
+
+gep::uint64 gep::ResourceCache::hashContent(ArrayPtr<const uint8> data, uint64 seed)
+{
+    const uint8* p = data.getPtr();
+    const size_t length = data.length();
+    const uint8* const pEnd = p + length;
+    uint64 hash;
+
+    if(length >= 32)
+    {
+        // four independent lanes, so the multiplications of a stripe can run in parallel
+        uint64 v1 = seed + PRIME1 + PRIME2;
+        uint64 v2 = seed + PRIME2;
+        uint64 v3 = seed;
+        uint64 v4 = seed - PRIME1;
+        const uint8* const pLastStripe = pEnd - 32;
+        do
+        {
+            v1 = round(v1, read64(p));
+            v2 = round(v2, read64(p + 8));
+            v3 = round(v3, read64(p + 16));
+            v4 = round(v4, read64(p + 24));
+            p += 32;
+        } while(p <= pLastStripe);
+
+        hash = rotateLeft(v1, 1) + rotateLeft(v2, 7) + rotateLeft(v3, 12) + rotateLeft(v4, 18);
+        hash = mergeRound(hash, v1);
+        hash = mergeRound(hash, v2);
+        hash = mergeRound(hash, v3);
+        hash = mergeRound(hash, v4);
+    }
+    else
+    {
+        hash = seed + PRIME5;
+    }
+
+    hash += (uint64)length;
+
+    for(; p + 8 <= pEnd; p += 8)
+    {
+        hash ^= round(0, read64(p));
+        hash = rotateLeft(hash, 27) * PRIME1 + PRIME4;
+    }
+    if(p + 4 <= pEnd)
+    {
+        hash ^= (uint64)read32(p) * PRIME1;
+        hash = rotateLeft(hash, 23) * PRIME2 + PRIME3;
+        p += 4;
+    }
+    for(; p < pEnd; p++)
+    {
+        hash ^= (uint64)*p * PRIME5;
+        hash = rotateLeft(hash, 11) * PRIME1;
+    }
+
+    hash ^= hash >> 33;
+    hash *= PRIME2;
+    hash ^= hash >> 29;
+    hash *= PRIME3;
+    hash ^= hash >> 32;
+    return hash;
+}
+
+gep::Result gep::ResourceCache::hashFile(const char* filename, uint64& hash)
+{
+    MappedFile file;
+    if(!file.open(filename))
+        return FAILURE;
+    hash = hashContent(file.getData());
+    return SUCCESS;
+}
+
+gep::ResourceCache::ResourceCache(const char* directory) :
+    m_directory(directory)
+{
+    memset(&m_statistics, 0, sizeof(m_statistics));
+    // fails if it exists already, store reports it if the directory can not be written
+    CreateDirectoryA(directory, nullptr);
+}
+
+std::string gep::ResourceCache::getFilename(const char* resourceType, uint64 contentHash)
+{
+    char name[32];
+    sprintf_s(name, "_%08x%08x.bin", (uint32)(contentHash >> 32), (uint32)contentHash);
+    return m_directory + "/" + resourceType + name;
+}
+
+gep::Result gep::ResourceCache::load(const char* resourceType, uint64 contentHash, uint32 version, DynamicArray<uint8>& payload)
+{
+    MappedFile file;
+    bool isValid = false;
+    CacheFileHeader header;
+    if(file.open(getFilename(resourceType, contentHash).c_str()) && file.getData().length() >= sizeof(CacheFileHeader))
+    {
+        auto data = file.getData();
+        memcpy(&header, data.getPtr(), sizeof(header));
+        auto storedPayload = data(sizeof(CacheFileHeader), data.length());
+        isValid = header.magic == CACHE_FILE_MAGIC &&
+                  header.version == version &&
+                  header.contentHash == contentHash &&
+                  header.payloadSize == storedPayload.length() &&
+                  header.payloadHash == hashContent(storedPayload);
+        if(isValid)
+        {
+            payload.resize(storedPayload.length());
+            memcpy(payload.toArray().getPtr(), storedPayload.getPtr(), storedPayload.length());
+        }
+    }
+
+    ScopedLock<Mutex> lock(m_mutex);
+    if(!isValid)
+    {
+        m_statistics.numMisses++;
+        return FAILURE;
+    }
+    m_statistics.numHits++;
+    m_statistics.savedTimeMs += header.conversionTimeMs;
+    return SUCCESS;
+}
+
+gep::Result gep::ResourceCache::store(const char* resourceType, uint64 contentHash, uint32 version, ArrayPtr<const uint8> payload, float conversionTimeMs)
+{
+    CacheFileHeader header;
+    header.magic = CACHE_FILE_MAGIC;
+    header.version = version;
+    header.contentHash = contentHash;
+    header.payloadSize = payload.length();
+    header.payloadHash = hashContent(payload);
+    header.conversionTimeMs = conversionTimeMs;
+    header.padding = 0;
+
+    // write to a file of our own and move it into place, so concurrent loads never see a half written entry
+    const std::string filename = getFilename(resourceType, contentHash);
+    char suffix[16];
+    sprintf_s(suffix, ".%u.tmp", (uint32)GetCurrentThreadId());
+    const std::string tempFilename = filename + suffix;
+    {
+        RawFile file(tempFilename.c_str(), "wb");
+        if(!file.isOpen())
+            return FAILURE;
+        if(file.write(header) != sizeof(header) ||
+           file.writeArray(payload.getPtr(), payload.length()) != payload.length())
+        {
+            file.close();
+            DeleteFileA(tempFilename.c_str());
+            return FAILURE;
+        }
+    }
+    if(!MoveFileExA(tempFilename.c_str(), filename.c_str(), MOVEFILE_REPLACE_EXISTING))
+    {
+        DeleteFileA(tempFilename.c_str());
+        return FAILURE;
+    }
+
+    ScopedLock<Mutex> lock(m_mutex);
+    m_statistics.numStores++;
+    return SUCCESS;
+}
+
+gep::ResourceCache::Statistics gep::ResourceCache::getStatistics()
+{
+    ScopedLock<Mutex> lock(m_mutex);
+    return m_statistics;
+}
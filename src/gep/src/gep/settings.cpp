@@ -26,6 +26,9 @@ void gep::Settings::loadFromScriptTable(ScriptTableWrapper table)
         scriptsSettings.tryGet("setupScript", m_scripts.setupScript);
         scriptsSettings.tryGet("importantScriptsRoot", m_scripts.importantScriptsRoot);
         scriptsSettings.tryGet("userScriptsRoot", m_scripts.userScriptsRoot);
+        scriptsSettings.tryGet("garbageCollectionBudgetMs", m_scripts.garbageCollectionBudgetMs);
+        scriptsSettings.tryGet("maxGarbageCollectionBudgetMs", m_scripts.maxGarbageCollectionBudgetMs);
+        scriptsSettings.tryGet("generationalGarbageCollection", m_scripts.generationalGarbageCollection);
     }
 
     // Get inner table.
@@ -42,6 +45,30 @@ void gep::Settings::loadFromScriptTable(ScriptTableWrapper table)
         videoSettings.tryGet("clearColor", m_video.clearColor);
     }
 
+    ScriptTableWrapper taskQueueSettings;
+    if (table.tryGet("taskQueue", taskQueueSettings))
+    {
+        taskQueueSettings.tryGet("numWorkers", m_taskQueue.numWorkers);
+        taskQueueSettings.tryGet("pinWorkersToCores", m_taskQueue.pinWorkersToCores);
+    }
+
+    ScriptTableWrapper resourcesSettings;
+    if (table.tryGet("resources", resourcesSettings))
+    {
+        resourcesSettings.tryGet("numLoaderThreads", m_resources.numLoaderThreads);
+        resourcesSettings.tryGet("finalizeBudgetMs", m_resources.finalizeBudgetMs);
+        resourcesSettings.tryGet("finalizeBudgetBytes", m_resources.finalizeBudgetBytes);
+        resourcesSettings.tryGet("shareIdenticalResources", m_resources.shareIdenticalResources);
+        resourcesSettings.tryGet("cacheDirectory", m_resources.cacheDirectory);
+    }
+
+    ScriptTableWrapper loggingSettings;
+    if (table.tryGet("logging", loggingSettings))
+    {
+        loggingSettings.tryGet("deferredFormatting", m_logging.deferredFormatting);
+        loggingSettings.tryGet("binaryLogFile", m_logging.binaryLogFile);
+    }
+
     // NOTE: Make sure to load lua settings last!
     ScriptTableWrapper luaSettings;
     if (table.tryGet("lua", luaSettings))
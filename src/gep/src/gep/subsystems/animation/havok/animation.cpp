@@ -8,6 +8,7 @@
 
 #include "gepimpl/subsystems/renderer/renderer.h"
 #include "gepimpl/subsystems/resourceManager.h"
+#include "gep/resourceCache.h"
 #include "gepimpl/subsystems/logging.h"
 
 #include "gepimpl/subsystems/physics/havok/conversion/vector.h"
@@ -236,6 +237,11 @@ void gep::AnimationFileLoader::release()
     delete this;
 }
 
+bool gep::AnimationFileLoader::getContentHash( uint64& hash )
+{
+    return ResourceCache::hashFile(m_path.c_str(), hash) == SUCCESS;
+}
+
 //////////////////////////////////////////////////////////////////////////
 
 gep::AnimatedSkeleton::AnimatedSkeleton(AnimationResource* skeleton) :
@@ -496,4 +502,6 @@ gep::Quaternion gep::Bone::getWorldRotation() const
 void gep::Bone::update(float elapsedSeconds)
 {
     m_pBone = &m_pPose->getBoneModelSpace(m_boneID);
+    // the pose was sampled again, transforms attached to the bone have to follow
+    markChanged();
 }
@@ -1,16 +1,83 @@
 #include "stdafx.h"
 #include "gepimpl/subsystems/logging.h"
+#include "gep/utils.h"
+#include "gep/binaryLog.h"
 #include <stdarg.h>
 #include <stdio.h>
 
-gep::Logging::Logging()
+#ifndef va_copy
+// va_list is a plain pointer on Windows
+#define va_copy(destination, source) ((destination) = (source))
+#endif
+
+gep::Logging* volatile gep::Logging::s_pCrashLogging = nullptr;
+
+void gep::Logging::WriterThread::run()
 {
+    m_logging.runWriter();
+}
+
+gep::Logging::Logging(uint32 capacity) :
+    m_records(nullptr),
+    m_mask(capacity - 1),
+    m_enqueuePosition(0),
+    m_dequeuePosition(0),
+    m_consumerThreadId(0),
+    m_writerThread(*this),
+    m_wakeUpWriter(0),
+    m_writerIsSleeping(0),
+    m_stopWriter(false),
+    m_deferFormatting(false),
+    m_previousExceptionFilter(nullptr)
+{
+    GEP_ASSERT(capacity > 0 && (capacity & (capacity - 1)) == 0, "capacity has to be a power of two", capacity);
+    m_records = new Record[capacity];
+    for(uint32 i = 0; i < capacity; i++)
+    {
+        m_records[i].sequence = (LONG)i;
+        m_records[i].pLongMessage = nullptr;
+        m_records[i].format = nullptr;
+    }
+
+    for(size_t i = 0; i < NUM_CHANNELS; i++)
+    {
+        m_overflowPolicies[i] = LogOverflowPolicy::dropMessage;
+        m_numDropped[i] = 0;
+        m_numWritten[i] = 0;
+        m_totalLatency[i] = 0;
+        m_maxLatency[i] = 0;
+    }
+    // errors are rare and usually explain what went wrong afterwards
+    m_overflowPolicies[(size_t)LogChannel::error] = LogOverflowPolicy::waitForSpace;
+
+    m_writerThread.start();
+
+    if(InterlockedCompareExchangePointer(reinterpret_cast<void* volatile*>(&s_pCrashLogging), this, nullptr) == nullptr)
+    {
+        m_previousExceptionFilter = SetUnhandledExceptionFilter(&unhandledExceptionFilter);
+    }
 }
 
 gep::Logging::~Logging()
 {
     // avoid virtual function call in destructor
     this->gep::Logging::logMessage("logging system shutdown");
+
+    if(s_pCrashLogging == this)
+    {
+        SetUnhandledExceptionFilter(m_previousExceptionFilter);
+        s_pCrashLogging = nullptr;
+    }
+
+    m_stopWriter = true;
+    m_wakeUpWriter.increment();
+    m_writerThread.join();
+
+    {
+        ScopedLock<Mutex> lock(m_sinkMutex);
+        writeAllRecords();
+    }
+    delete[] m_records;
 }
 
 void gep::Logging::logMessage(const char* fmt, ...)
@@ -18,12 +85,7 @@ void gep::Logging::logMessage(const char* fmt, ...)
     va_list argptr;
     va_start(argptr, fmt);
     SCOPE_EXIT{ va_end(argptr); });
-    auto msg = vformat(fmt, argptr);
-    ScopedLock<Mutex> lock(m_sinkMutex);
-    for(auto pSink : m_sinks)
-    {
-        pSink->take(LogChannel::message, msg.c_str());
-    }
+    log(LogChannel::message, fmt, argptr);
 }
 
 void gep::Logging::logWarning(const char* fmt, ...)
@@ -31,12 +93,7 @@ void gep::Logging::logWarning(const char* fmt, ...)
     va_list argptr;
     va_start(argptr, fmt);
     SCOPE_EXIT{ va_end(argptr); });
-    auto msg = vformat(fmt, argptr);
-    ScopedLock<Mutex> lock(m_sinkMutex);
-    for(auto pSink : m_sinks)
-    {
-        pSink->take(LogChannel::warning, msg.c_str());
-    }
+    log(LogChannel::warning, fmt, argptr);
 }
 
 void gep::Logging::logError(const char* fmt, ...)
@@ -44,14 +101,251 @@ void gep::Logging::logError(const char* fmt, ...)
     va_list argptr;
     va_start(argptr, fmt);
     SCOPE_EXIT{ va_end(argptr); });
-    auto msg = vformat(fmt, argptr);
-    ScopedLock<Mutex> lock(m_sinkMutex);
-    for(auto pSink : m_sinks)
+    log(LogChannel::error, fmt, argptr);
+}
+
+void gep::Logging::log(LogChannel channel, const char* fmt, va_list argptr)
+{
+    Record* pRecord = beginRecord(channel);
+    if(pRecord == nullptr)
     {
-        pSink->take(LogChannel::error, msg.c_str());
+        return;
+    }
+
+    if(m_deferFormatting)
+    {
+        va_list argptrCopy;
+        va_copy(argptrCopy, argptr);
+        const size_t argumentsSize = encodeLogArguments(fmt, argptrCopy, ArrayPtr<uint8>(reinterpret_cast<uint8*>(pRecord->message), INLINE_MESSAGE_SIZE));
+        va_end(argptrCopy);
+        if(argumentsSize != INVALID_LOG_ARGUMENTS_SIZE)
+        {
+            pRecord->format = fmt;
+            pRecord->argumentsSize = argumentsSize;
+            endRecord(pRecord);
+            return;
+        }
+    }
+
+    // format directly into the buffer, only long messages need an allocation
+    va_list argptrCopy;
+    va_copy(argptrCopy, argptr);
+    int length = vsnprintf(pRecord->message, INLINE_MESSAGE_SIZE, fmt, argptrCopy);
+    va_end(argptrCopy);
+    if(length < 0 || length >= (int)INLINE_MESSAGE_SIZE)
+    {
+        pRecord->pLongMessage = new std::string(vformat(fmt, argptr));
+    }
+    endRecord(pRecord);
+}
+
+gep::Logging::Record* gep::Logging::beginRecord(LogChannel channel)
+{
+    const size_t channelIndex = (size_t)channel;
+    LONG position = m_enqueuePosition;
+    for(;;)
+    {
+        Record& record = m_records[position & m_mask];
+        const LONG difference = record.sequence - position;
+        if(difference == 0)
+        {
+            // the record is free, try to claim it
+            const LONG previousPosition = InterlockedCompareExchange(&m_enqueuePosition, position + 1, position);
+            if(previousPosition == position)
+            {
+                record.channel = channel;
+                record.logTime = m_timer.getTime();
+                record.pLongMessage = nullptr;
+                record.format = nullptr;
+                record.argumentsSize = 0;
+                return &record;
+            }
+            position = previousPosition;
+        }
+        else if(difference < 0)
+        {
+            // The buffer is full.
+            // The thread writing to the sinks can not wait for itself.
+            if(m_overflowPolicies[channelIndex] == LogOverflowPolicy::dropMessage || m_consumerThreadId == GetCurrentThreadId())
+            {
+                InterlockedIncrement(&m_numDropped[channelIndex]);
+                return nullptr;
+            }
+
+            // help the writer thread if it does not keep up
+            if(m_sinkMutex.tryLock() == SUCCESS)
+            {
+                writeRecords(MAX_BATCH_SIZE);
+                m_sinkMutex.unlock();
+            }
+            else
+            {
+                SwitchToThread();
+            }
+            position = m_enqueuePosition;
+        }
+        else
+        {
+            // another producer was faster
+            position = m_enqueuePosition;
+        }
+    }
+}
+
+void gep::Logging::endRecord(Record* pRecord)
+{
+    // publish the record to the consumer
+    InterlockedExchange(&pRecord->sequence, pRecord->sequence + 1);
+
+    if(m_writerIsSleeping != 0 && InterlockedExchange(&m_writerIsSleeping, 0) != 0)
+    {
+        m_wakeUpWriter.increment();
     }
 }
 
+bool gep::Logging::hasReadyRecord() const
+{
+    return m_records[m_dequeuePosition & m_mask].sequence == m_dequeuePosition + 1;
+}
+
+size_t gep::Logging::writeRecords(size_t maxRecords)
+{
+    const DWORD previousConsumerThreadId = m_consumerThreadId;
+    m_consumerThreadId = GetCurrentThreadId();
+
+    uint64 numWrittenPerChannel[NUM_CHANNELS] = {};
+    uint64 totalLatency[NUM_CHANNELS] = {};
+    uint64 maxLatency[NUM_CHANNELS] = {};
+
+    size_t numWritten = 0;
+    // stops at the first record that is still being formatted, to keep the order of the messages
+    for(; numWritten < maxRecords && hasReadyRecord(); numWritten++)
+    {
+        Record& record = m_records[m_dequeuePosition & m_mask];
+        const char* msg = nullptr;
+        if(record.format == nullptr)
+        {
+            msg = (record.pLongMessage != nullptr) ? record.pLongMessage->c_str() : record.message;
+        }
+        const ArrayPtr<const uint8> arguments(reinterpret_cast<const uint8*>(record.message), record.argumentsSize);
+        for(auto pSink : m_sinks)
+        {
+            if(record.format != nullptr && pSink->takesDeferredMessages())
+            {
+                pSink->takeDeferred(record.channel, record.format, arguments);
+                continue;
+            }
+            // deferred messages are only formatted if a sink wants the text
+            if(msg == nullptr)
+            {
+                formatLogArguments(m_formattedMessage, record.format, arguments);
+                msg = m_formattedMessage.c_str();
+            }
+            pSink->take(record.channel, msg);
+        }
+
+        const size_t channelIndex = (size_t)record.channel;
+        const uint64 latency = m_timer.getTime() - record.logTime;
+        numWrittenPerChannel[channelIndex]++;
+        totalLatency[channelIndex] += latency;
+        maxLatency[channelIndex] = GEP_MAX(maxLatency[channelIndex], latency);
+
+        delete record.pLongMessage;
+        record.pLongMessage = nullptr;
+        // free the record for the producer one round later
+        InterlockedExchange(&record.sequence, m_dequeuePosition + (LONG)m_mask + 1);
+        m_dequeuePosition++;
+    }
+
+    if(numWritten > 0)
+    {
+        for(auto pSink : m_sinks)
+        {
+            pSink->flush();
+        }
+
+        ScopedLock<Mutex> lock(m_statisticsMutex);
+        for(size_t i = 0; i < NUM_CHANNELS; i++)
+        {
+            m_numWritten[i] += numWrittenPerChannel[i];
+            m_totalLatency[i] += totalLatency[i];
+            m_maxLatency[i] = GEP_MAX(m_maxLatency[i], maxLatency[i]);
+        }
+    }
+
+    m_consumerThreadId = previousConsumerThreadId;
+    return numWritten;
+}
+
+void gep::Logging::writeAllRecords()
+{
+    while(writeRecords(MAX_BATCH_SIZE) > 0)
+    {
+    }
+}
+
+void gep::Logging::runWriter()
+{
+    while(!m_stopWriter)
+    {
+        size_t numWritten = 0;
+        {
+            ScopedLock<Mutex> lock(m_sinkMutex);
+            numWritten = writeRecords(MAX_BATCH_SIZE);
+        }
+
+        if(numWritten == 0)
+        {
+            InterlockedExchange(&m_writerIsSleeping, 1);
+            // a message published before the flag was set did not wake us up
+            if(!hasReadyRecord())
+            {
+                m_wakeUpWriter.waitAndDecrement(WRITER_SLEEP_MS);
+            }
+            InterlockedExchange(&m_writerIsSleeping, 0);
+        }
+    }
+}
+
+LONG WINAPI gep::Logging::unhandledExceptionFilter(EXCEPTION_POINTERS* pExceptionInfo)
+{
+    Logging* pLogging = s_pCrashLogging;
+    if(pLogging == nullptr)
+    {
+        return EXCEPTION_CONTINUE_SEARCH;
+    }
+
+    pLogging->logError("Unhandled exception 0x%08X at address %p",
+                       pExceptionInfo->ExceptionRecord->ExceptionCode,
+                       pExceptionInfo->ExceptionRecord->ExceptionAddress);
+
+    // If the crash happened while writing to the sinks, they can not be used anymore.
+    if(pLogging->m_consumerThreadId != GetCurrentThreadId())
+    {
+        // the writer thread might be in the middle of a batch, give it some time to finish
+        bool isLocked = false;
+        for(int i = 0; i < 100 && !isLocked; i++)
+        {
+            isLocked = (pLogging->m_sinkMutex.tryLock() == SUCCESS);
+            if(!isLocked)
+            {
+                Sleep(1);
+            }
+        }
+        if(isLocked)
+        {
+            pLogging->writeAllRecords();
+            pLogging->m_sinkMutex.unlock();
+        }
+    }
+
+    if(pLogging->m_previousExceptionFilter != nullptr)
+    {
+        return pLogging->m_previousExceptionFilter(pExceptionInfo);
+    }
+    return EXCEPTION_CONTINUE_SEARCH;
+}
+
 void gep::Logging::registerSink(ILogSink* pSink)
 {
     ScopedLock<Mutex> lock(m_sinkMutex);
@@ -61,6 +355,10 @@ void gep::Logging::registerSink(ILogSink* pSink)
 void gep::Logging::deregisterSink(ILogSink* pSink)
 {
     ScopedLock<Mutex> lock(m_sinkMutex);
+    // the sink still gets everything that was logged while it was registered
+    writeAllRecords();
+    pSink->flush();
+
     size_t i=0;
     for(; i<m_sinks.length(); i++)
     {
@@ -73,6 +371,38 @@ void gep::Logging::deregisterSink(ILogSink* pSink)
     }
 }
 
+void gep::Logging::flush()
+{
+    ScopedLock<Mutex> lock(m_sinkMutex);
+    writeAllRecords();
+}
+
+void gep::Logging::setDeferredFormatting(bool deferFormatting)
+{
+    m_deferFormatting = deferFormatting;
+}
+
+void gep::Logging::setOverflowPolicy(LogChannel channel, LogOverflowPolicy policy)
+{
+    m_overflowPolicies[(size_t)channel] = policy;
+}
+
+gep::LogChannelStatistics gep::Logging::getStatistics(LogChannel channel)
+{
+    const size_t channelIndex = (size_t)channel;
+    const double msPerTick = m_timer.getResolution() * 1000.0;
+
+    ScopedLock<Mutex> lock(m_statisticsMutex);
+    LogChannelStatistics statistics;
+    statistics.numWritten = m_numWritten[channelIndex];
+    statistics.numDropped = (uint64)m_numDropped[channelIndex];
+    statistics.averageLatencyMs = (m_numWritten[channelIndex] > 0)
+        ? (float)((double)m_totalLatency[channelIndex] / (double)m_numWritten[channelIndex] * msPerTick)
+        : 0.0f;
+    statistics.maxLatencyMs = (float)((double)m_maxLatency[channelIndex] * msPerTick);
+    return statistics;
+}
+
 void gep::ConsoleLogSink::take(LogChannel channel, const char* msg)
 {
     const char* channelName = "Unkown: ";
@@ -134,8 +464,73 @@ void gep::FileLogSink::take(LogChannel channel, const char* msg)
 
     if(m_autoFlush)
     {
-        // If we don't flush immediately, all logging information is lost when the program crashes!
         m_LogFile.flush();
     }
 }
 
+void gep::FileLogSink::flush()
+{
+    // The logging flushes after every batch and on crashes, so nothing is lost when the program crashes.
+    m_LogFile.flush();
+}
+
+
+gep::BinaryFileLogSink::BinaryFileLogSink(const char* filename)
+{
+    m_LogFile.open(filename, std::ios::out | std::ios::binary);
+    const uint32 pointerSize = sizeof(void*);
+    m_LogFile.write(BinaryLogFile::MAGIC, sizeof(BinaryLogFile::MAGIC));
+    m_LogFile.write(reinterpret_cast<const char*>(&BinaryLogFile::VERSION), sizeof(BinaryLogFile::VERSION));
+    m_LogFile.write(reinterpret_cast<const char*>(&pointerSize), sizeof(pointerSize));
+}
+
+gep::BinaryFileLogSink::~BinaryFileLogSink()
+{
+    m_LogFile.close();
+}
+
+void gep::BinaryFileLogSink::writeFormatString(const char* fmt, uint32 id)
+{
+    const uint8 entryType = (uint8)BinaryLogFile::EntryType::formatString;
+    const uint32 length = (uint32)strlen(fmt);
+    m_LogFile.write(reinterpret_cast<const char*>(&entryType), sizeof(entryType));
+    m_LogFile.write(reinterpret_cast<const char*>(&id), sizeof(id));
+    m_LogFile.write(reinterpret_cast<const char*>(&length), sizeof(length));
+    m_LogFile.write(fmt, length);
+}
+
+void gep::BinaryFileLogSink::take(LogChannel channel, const char* msg)
+{
+    const uint8 entryType = (uint8)BinaryLogFile::EntryType::message;
+    const uint8 channelValue = (uint8)channel;
+    const uint32 length = (uint32)strlen(msg);
+    m_LogFile.write(reinterpret_cast<const char*>(&entryType), sizeof(entryType));
+    m_LogFile.write(reinterpret_cast<const char*>(&channelValue), sizeof(channelValue));
+    m_LogFile.write(reinterpret_cast<const char*>(&length), sizeof(length));
+    m_LogFile.write(msg, length);
+}
+
+void gep::BinaryFileLogSink::takeDeferred(LogChannel channel, const char* fmt, ArrayPtr<const uint8> arguments)
+{
+    uint32 formatId;
+    if(m_formatIds.tryGet(fmt, formatId) != SUCCESS)
+    {
+        formatId = (uint32)m_formatIds.count();
+        m_formatIds[fmt] = formatId;
+        writeFormatString(fmt, formatId);
+    }
+
+    const uint8 entryType = (uint8)BinaryLogFile::EntryType::deferredMessage;
+    const uint8 channelValue = (uint8)channel;
+    const uint16 argumentsSize = (uint16)arguments.length();
+    m_LogFile.write(reinterpret_cast<const char*>(&entryType), sizeof(entryType));
+    m_LogFile.write(reinterpret_cast<const char*>(&channelValue), sizeof(channelValue));
+    m_LogFile.write(reinterpret_cast<const char*>(&formatId), sizeof(formatId));
+    m_LogFile.write(reinterpret_cast<const char*>(&argumentsSize), sizeof(argumentsSize));
+    m_LogFile.write(reinterpret_cast<const char*>(arguments.getPtr()), arguments.length());
+}
+
+void gep::BinaryFileLogSink::flush()
+{
+    m_LogFile.flush();
+}
@@ -4,6 +4,7 @@
 
 #include "gep/globalManager.h"
 #include "gep/interfaces/renderer.h"
+#include "gep/interfaces/scripting.h"
 
 void gep::MemoryManager::initialize()
 {
@@ -113,6 +114,17 @@ void gep::MemoryManager::update(float elapsedTime)
 
         m_message << " | " << allocatorInfo.name << '\n';
     }
+
+    {
+        auto& statistics = g_globalManager.getScriptingManager()->getGarbageCollectionStatistics();
+        const char* suffix = nullptr;
+        auto bytesFreed = statistics.bytesFreed;
+        reduceToSmallestUnitWithBinarySuffix(bytesFreed, suffix);
+        m_message << "Lua GC: " << statistics.timeMs << " / " << statistics.budgetMs << " ms"
+                  << " | " << statistics.numSteps << " steps"
+                  << " | -" << bytesFreed << ' ' << suffix << 'B'
+                  << " | " << statistics.numCycles << " cycles\n";
+    }
     g_globalManager.getRenderer()->getDebugRenderer().printText(vec2(-0.95f, 0.0f),
                                                                 m_message.str().c_str());
     // Clear the string stream
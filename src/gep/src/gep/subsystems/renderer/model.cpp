@@ -7,6 +7,7 @@
 #include "gepimpl/subsystems/renderer/vertexbuffer.h"
 #include "gepimpl/subsystems/renderer/extractor.h"
 #include "gep/exception.h"
+#include "gep/resourceCache.h"
 
 void gep::ModelMaterial::setShader(ResourcePtr<Shader> pShader)
 {
@@ -127,7 +128,7 @@ void gep::Model::draw(const mat4& modelMatrix, ArrayPtr<mat4> bones, mat4& viewM
 
 void gep::Model::loadFile(const char* filename)
 {
-    m_modelLoader.loadFile(filename, ModelLoader::Load::Everything);
+    m_modelLoader.loadFile(filename, ModelLoader::Load::Everything, Chunkfile::Operation::mappedRead, g_globalManager.getTaskQueue());
     m_materials.resize(getMaterialInfo().length());
 }
 void gep::Model::loadFromData(SmartPtr<ReferenceCounted> pDataHolder, ArrayPtr<vec4> vertices, ArrayPtr<uint32> indices)
@@ -377,6 +378,20 @@ gep::uint32 gep::Model::getFinalizeOptions()
     return ResourceFinalize::FromRenderer;
 }
 
+size_t gep::Model::getFinalizeSize()
+{
+    // the vertex buffer holds the vertex attributes and the indices of all meshes
+    size_t size = 0;
+    for(auto& mesh : m_modelLoader.getModelData().meshes)
+    {
+        size += mesh.faces.length() * sizeof(ModelLoader::FaceData);
+        size += (mesh.vertices.length() + mesh.normals.length() + mesh.tangents.length() + mesh.bitangents.length()) * sizeof(vec3);
+        for(auto& texcoords : mesh.texcoords)
+            size += texcoords.length() * sizeof(vec2);
+    }
+    return size;
+}
+
 void gep::Model::extract(IRendererExtractor& extractor, mat4 modelMatrix)
 {
     auto& cmd = static_cast<RendererExtractor&>(extractor).makeCommand<CommandRenderModel>();
@@ -545,6 +560,11 @@ const char* gep::ModelFileLoader::getResourceId()
     return m_filename.c_str();
 }
 
+bool gep::ModelFileLoader::getContentHash(uint64& hash)
+{
+    return ResourceCache::hashFile(m_filename.c_str(), hash) == SUCCESS;
+}
+
 gep::ModelLoaderFromData::ModelLoaderFromData(SmartPtr<ReferenceCounted> dataHolder, ArrayPtr<vec4> vertices, ArrayPtr<uint32> indices, const char* resourceId) :
     m_vertices(vertices),
     m_indices(indices),
@@ -10,6 +10,8 @@
 #include "gep/exception.h"
 #include "gep/globalManager.h"
 #include "gep/interfaces/logging.h"
+#include "gep/resourceCache.h"
+#include "gep/timer.h"
 
 #include <d3d11.h>
 #include <D3DX11.h>
@@ -68,7 +70,25 @@ gep::Shader* gep::ShaderFileLoader::loadResource(Shader* pInPlace)
         isInPlace = false;
     }
     try {
+        ResourceCache* pCache = g_globalManager.getResourceManager()->getResourceCache();
+        uint64 hash;
+        if(pCache == nullptr || !getContentHash(hash))
+        {
+            result->loadFromFX(m_filename.c_str());
+            return result;
+        }
+        DynamicArray<uint8> byteCode;
+        if(pCache->load(getResourceType(), hash, CACHE_VERSION, byteCode) == SUCCESS)
+        {
+            result->loadFromByteCode(byteCode.toArray());
+            return result;
+        }
+        Timer timer;
+        const double startTime = timer.getTimeAsDouble();
         result->loadFromFX(m_filename.c_str());
+        const float compileTimeMs = (float)((timer.getTimeAsDouble() - startTime) * 1000.0);
+        if(pCache->store(getResourceType(), hash, CACHE_VERSION, result->getByteCode(), compileTimeMs) == FAILURE)
+            g_globalManager.getLogging()->logWarning("Could not store the compiled shader '%s' in the resource cache '%s'", m_filename.c_str(), pCache->getDirectory());
         return result;
     }
     catch(LoadingError& ex)
@@ -100,6 +120,11 @@ const char* gep::ShaderFileLoader::getResourceId()
     return m_filename.c_str();
 }
 
+bool gep::ShaderFileLoader::getContentHash(uint64& hash)
+{
+    return ResourceCache::hashFile(m_filename.c_str(), hash) == SUCCESS;
+}
+
 gep::Shader::Shader(ID3D11Device* pDevice)
     : m_pEffect(nullptr),
     m_pLoader(nullptr),
@@ -177,6 +202,11 @@ gep::uint32 gep::Shader::getFinalizeOptions()
     return ResourceFinalize::FromRenderer;
 }
 
+size_t gep::Shader::getFinalizeSize()
+{
+    return (m_pByteCode != nullptr) ? m_pByteCode->GetBufferSize() : 0;
+}
+
 void gep::Shader::loadFromFX(const char* filename)
 {
     ID3D10Blob* pByteCode = nullptr;
@@ -212,6 +242,28 @@ void gep::Shader::loadFromFX(const char* filename)
     if(pErrors) pErrors->Release();
 }
 
+void gep::Shader::loadFromByteCode(ArrayPtr<const uint8> byteCode)
+{
+    ID3D10Blob* pByteCode = nullptr;
+    HRESULT hr = D3DCreateBlob(byteCode.length(), &pByteCode);
+    if( FAILED(hr) )
+    {
+        throw LoadingError("Failed to create the byte code blob");
+    }
+    memcpy(pByteCode->GetBufferPointer(), byteCode.getPtr(), byteCode.length());
+    if(m_pByteCode != nullptr)
+    {
+        m_pByteCode->Release();
+    }
+    m_pByteCode = pByteCode;
+}
+
+gep::ArrayPtr<const gep::uint8> gep::Shader::getByteCode()
+{
+    GEP_ASSERT(m_pByteCode != nullptr, "the shader is not loaded or already finalized");
+    return ArrayPtr<const uint8>(static_cast<const uint8*>(m_pByteCode->GetBufferPointer()), m_pByteCode->GetBufferSize());
+}
+
 void gep::Shader::use(ID3D11DeviceContext* pContext, Vertexbuffer* pVertexbuffer)
 {
     GEP_ASSERT(m_pEffect != nullptr, "not finalized yet");
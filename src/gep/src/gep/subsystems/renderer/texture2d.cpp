@@ -4,6 +4,7 @@
 #include "gep/interfaces/logging.h"
 #include "gepimpl/subsystems/renderer/renderer.h"
 #include "gepimpl/subsystems/renderer/ddsLoader.h"
+#include "gep/resourceCache.h"
 
 gep::IResource* gep::ITexture2DLoader::loadResource(IResource* pInPlace)
 {
@@ -149,6 +150,11 @@ const char* gep::Texture2DFileLoader::getResourceId()
     return m_filename.c_str();
 }
 
+bool gep::Texture2DFileLoader::getContentHash(uint64& hash)
+{
+    return ResourceCache::hashFile(m_filename.c_str(), hash) == SUCCESS;
+}
+
 gep::GeneratorTextureLoader::GeneratorTextureLoader(uint32 width, uint32 height, std::function<void(ArrayPtr<uint8>)>& generatorFunction, const char* resourceId)
     : m_generatorFunction(generatorFunction),
     m_resourceId(resourceId),
@@ -221,6 +227,14 @@ gep::uint32 gep::Texture2D::getFinalizeOptions()
     return ResourceFinalize::FromRenderer;
 }
 
+size_t gep::Texture2D::getFinalizeSize()
+{
+    size_t size = 0;
+    for(auto& mipmapLevel : m_data.getData())
+        size += mipmapLevel.length();
+    return size;
+}
+
 gep::IResource* gep::Texture2D::getSuperResource()
 {
     return nullptr;
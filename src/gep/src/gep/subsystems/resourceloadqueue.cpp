@@ -0,0 +1,242 @@
+#include "stdafx.h"
+#include "gepimpl/subsystems/resourceLoadQueue.h"
+#include <algorithm>
+
+gep::ResourceLoadQueue::ResourceLoadQueue() :
+    m_wakeUp(0),
+    m_nextSequence(0),
+    m_numLoaded(0),
+    m_numFailed(0),
+    m_numCanceled(0),
+    m_numLatencies(0)
+{
+    for(size_t i=0; i < NUM_LOAD_PRIORITIES; i++)
+        m_firstRequest[i] = 0;
+}
+
+void gep::ResourceLoadQueue::compact(size_t priority)
+{
+    auto& requests = m_requests[priority];
+    const size_t first = m_firstRequest[priority];
+    if(first == 0)
+        return;
+    const size_t numWaiting = requests.length() - first;
+    for(size_t i=0; i < numWaiting; i++)
+        requests[i] = requests[first + i];
+    requests.resize(numWaiting);
+    m_firstRequest[priority] = 0;
+}
+
+bool gep::ResourceLoadQueue::find(const std::string& resourceId, size_t& priority, size_t& index)
+{
+    for(priority = 0; priority < NUM_LOAD_PRIORITIES; priority++)
+    {
+        auto& requests = m_requests[priority];
+        for(index = m_firstRequest[priority]; index < requests.length(); index++)
+        {
+            if(requests[index].resourceId == resourceId)
+                return true;
+        }
+    }
+    return false;
+}
+
+void gep::ResourceLoadQueue::push(const Request& request)
+{
+    {
+        ScopedLock<Mutex> lock(m_mutex);
+        size_t priority, index;
+        if(find(request.resourceId, priority, index))
+        {
+            GEP_ASSERT(false, "the resource is already waiting to be loaded", request.resourceId.c_str());
+            return;
+        }
+        // do not let the taken requests pile up in front of the waiting ones
+        const size_t newPriority = (size_t)request.priority;
+        if(m_firstRequest[newPriority] > 0 && m_firstRequest[newPriority] * 2 >= m_requests[newPriority].length())
+            compact(newPriority);
+        m_requests[newPriority].append(request);
+        m_requests[newPriority].lastElement().sequence = m_nextSequence++;
+    }
+    m_wakeUp.increment();
+}
+
+bool gep::ResourceLoadQueue::raisePriority(const std::string& resourceId, LoadPriority priority)
+{
+    ScopedLock<Mutex> lock(m_mutex);
+    size_t oldPriority, index;
+    if(!find(resourceId, oldPriority, index))
+        return false;
+    if((size_t)priority < oldPriority)
+    {
+        Request request = m_requests[oldPriority][index];
+        m_requests[oldPriority].removeAtIndex(index);
+        request.priority = priority;
+        m_requests[(size_t)priority].append(request);
+    }
+    return true;
+}
+
+gep::Result gep::ResourceLoadQueue::take(Request& request, uint32 millisecondsToWait)
+{
+    // the semaphore saturates, so it is only used to sleep while there are no requests
+    for(int attempt = 0; attempt < 2; attempt++)
+    {
+        {
+            ScopedLock<Mutex> lock(m_mutex);
+            for(size_t priority = 0; priority < NUM_LOAD_PRIORITIES; priority++)
+            {
+                auto& requests = m_requests[priority];
+                size_t& first = m_firstRequest[priority];
+                if(first < requests.length())
+                {
+                    request = requests[first];
+                    requests[first] = Request();
+                    first++;
+                    if(first == requests.length())
+                    {
+                        requests.resize(0);
+                        first = 0;
+                    }
+
+                    LoadingInfo info;
+                    info.sequence = request.sequence;
+                    info.resourceId = request.resourceId;
+                    info.priority = request.priority;
+                    info.isCanceled = false;
+                    m_loading.append(info);
+                    return SUCCESS;
+                }
+            }
+        }
+        if(attempt == 0)
+            m_wakeUp.waitAndDecrement(millisecondsToWait);
+    }
+    return FAILURE;
+}
+
+bool gep::ResourceLoadQueue::finishLoading(const Request& request, bool succeeded)
+{
+    ScopedLock<Mutex> lock(m_mutex);
+    for(size_t i=0; i < m_loading.length(); i++)
+    {
+        if(m_loading[i].sequence == request.sequence)
+        {
+            const bool isCanceled = m_loading[i].isCanceled;
+            m_loading.removeAtIndexUnordered(i);
+            if(!isCanceled)
+            {
+                if(succeeded)
+                    m_numLoaded++;
+                else
+                    m_numFailed++;
+            }
+            return !isCanceled;
+        }
+    }
+    GEP_ASSERT(false, "the request is not loading", request.resourceId.c_str());
+    return false;
+}
+
+bool gep::ResourceLoadQueue::cancel(const std::string& resourceId, DynamicArray<Request>& canceled)
+{
+    ScopedLock<Mutex> lock(m_mutex);
+    bool found = false;
+    size_t priority, index;
+    if(find(resourceId, priority, index))
+    {
+        canceled.append(m_requests[priority][index]);
+        m_requests[priority].removeAtIndex(index);
+        m_numCanceled++;
+        found = true;
+    }
+    for(auto& info : m_loading)
+    {
+        if(!info.isCanceled && info.resourceId == resourceId)
+        {
+            info.isCanceled = true;
+            m_numCanceled++;
+            found = true;
+        }
+    }
+    return found;
+}
+
+size_t gep::ResourceLoadQueue::cancel(LoadPriority priority, DynamicArray<Request>& canceled, DynamicArray<std::string>& canceledLoading)
+{
+    ScopedLock<Mutex> lock(m_mutex);
+    size_t numCanceled = 0;
+    auto& requests = m_requests[(size_t)priority];
+    for(size_t i = m_firstRequest[(size_t)priority]; i < requests.length(); i++)
+    {
+        canceled.append(requests[i]);
+        numCanceled++;
+    }
+    requests.resize(0);
+    m_firstRequest[(size_t)priority] = 0;
+    for(auto& info : m_loading)
+    {
+        if(!info.isCanceled && info.priority == priority)
+        {
+            info.isCanceled = true;
+            canceledLoading.append(info.resourceId);
+            numCanceled++;
+        }
+    }
+    m_numCanceled += numCanceled;
+    return numCanceled;
+}
+
+void gep::ResourceLoadQueue::wakeUp()
+{
+    m_wakeUp.increment();
+}
+
+void gep::ResourceLoadQueue::addLatency(float latencyMs)
+{
+    ScopedLock<Mutex> lock(m_mutex);
+    m_latencies[m_numLatencies % NUM_LATENCY_SAMPLES] = latencyMs;
+    m_numLatencies++;
+}
+
+void gep::ResourceLoadQueue::addCanceled()
+{
+    ScopedLock<Mutex> lock(m_mutex);
+    m_numCanceled++;
+}
+
+void gep::ResourceLoadQueue::getStatistics(ResourceLoadingStatistics& statistics)
+{
+    float latencies[NUM_LATENCY_SAMPLES];
+    size_t numLatencies;
+    {
+        ScopedLock<Mutex> lock(m_mutex);
+        for(size_t i=0; i < NUM_LOAD_PRIORITIES; i++)
+            statistics.queueDepth[i] = m_requests[i].length() - m_firstRequest[i];
+        statistics.numLoading = m_loading.length();
+        statistics.numLoaded = m_numLoaded;
+        statistics.numFailed = m_numFailed;
+        statistics.numCanceled = m_numCanceled;
+        numLatencies = GEP_MIN(m_numLatencies, NUM_LATENCY_SAMPLES);
+        memcpy(latencies, m_latencies, numLatencies * sizeof(float));
+    }
+
+    if(numLatencies == 0)
+    {
+        statistics.latencyMedianMs = 0.0f;
+        statistics.latency90Ms = 0.0f;
+        statistics.latency99Ms = 0.0f;
+        statistics.latencyMaxMs = 0.0f;
+        return;
+    }
+    std::sort(latencies, latencies + numLatencies);
+    // nearest rank
+    auto percentile = [&](size_t percent) -> float {
+        const size_t rank = (percent * numLatencies + 99) / 100;
+        return latencies[GEP_MAX(rank, (size_t)1) - 1];
+    };
+    statistics.latencyMedianMs = percentile(50);
+    statistics.latency90Ms = percentile(90);
+    statistics.latency99Ms = percentile(99);
+    statistics.latencyMaxMs = latencies[numLatencies - 1];
+}
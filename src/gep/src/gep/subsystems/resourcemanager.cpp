@@ -9,26 +9,67 @@
 
 DefineWeakRefStaticMembersExport(gep::IResource)
 
-gep::ResourceManager::ResourceManager()
+gep::ResourceManager::ResourceManager(const settings::Resources& settings)
   : m_dataDirWatcher("data", DirectoryWatcher::WatchSubdirs::yes, DirectoryWatcher::Watch::writes),
     m_timeSinceLastCheck(0.1f),
     m_updateNum(0)
-    , m_pResourceLoader(nullptr)
+    , m_settings(settings)
+    , m_lastFinalizeTimeMs(0.0f)
+    , m_lastFinalizeBytes(0)
+    , m_numShared(0)
+    , m_sharedBytes(0)
+    , m_sharedLoadTimeMs(0.0f)
+    , m_pResourceCache(nullptr)
     , m_pHkResourceLoader(nullptr)
 {
 }
 
 void gep::ResourceManager::initialize()
 {
-    m_pResourceLoader = new ResourceLoaderThread(this);
-    m_pResourceLoader->start();
+    if(!m_settings.cacheDirectory.empty())
+        m_pResourceCache = new ResourceCache(m_settings.cacheDirectory.c_str());
+
+    const size_t numLoaderThreads = GEP_MAX(m_settings.numLoaderThreads, (size_t)1);
+    for(size_t i=0; i < numLoaderThreads; i++)
+    {
+        auto pLoaderThread = new ResourceLoaderThread(this, &m_loadQueue);
+        pLoaderThread->start();
+        m_loaderThreads.append(pLoaderThread);
+    }
 }
 
 void gep::ResourceManager::destroy()
 {
-    m_pResourceLoader->stop();
-    m_pResourceLoader->join();
-    delete m_pResourceLoader;
+    for(auto pLoaderThread : m_loaderThreads)
+        pLoaderThread->stop();
+    for(auto pLoaderThread : m_loaderThreads)
+    {
+        pLoaderThread->join();
+        delete pLoaderThread;
+    }
+    m_loaderThreads.clear();
+    {
+        // release the loaders of the requests which never started loading
+        DynamicArray<ResourceLoadQueue::Request> canceled;
+        DynamicArray<std::string> canceledLoading;
+        for(size_t priority=0; priority < NUM_LOAD_PRIORITIES; priority++)
+            m_loadQueue.cancel((LoadPriority)priority, canceled, canceledLoading);
+        for(auto& request : canceled)
+            request.pLoader->release();
+    }
+
+    {
+        auto statistics = getLoadingStatistics();
+        g_globalManager.getLogging()->logMessage("Shared %u resources with the same content, saved %u KB and %.1f ms of loading.",
+            (uint32)statistics.numShared, (uint32)(statistics.sharedBytes / 1024), statistics.sharedLoadTimeMs);
+        if(m_pResourceCache != nullptr)
+        {
+            g_globalManager.getLogging()->logMessage("Resource cache '%s': %u hits, %u misses, saved %.1f ms of converting.",
+                m_pResourceCache->getDirectory(), (uint32)statistics.numCacheHits, (uint32)statistics.numCacheMisses, statistics.cacheSavedTimeMs);
+        }
+    }
+    // the aliases point to resources which are deleted below through their own index
+    replaceAliases(nullptr, nullptr);
 
     // Make a copy to allow safe iterating
     auto resourceToPatchCopy = m_resourcesToPatch;
@@ -77,6 +118,8 @@ void gep::ResourceManager::destroy()
     m_resourceDummies.clear();
     m_fileChangedListener.clear();
     m_loadedResources.clear();
+    m_sharedContent.clear();
+    DELETE_AND_NULL(m_pResourceCache);
 }
 
 void gep::ResourceManager::update(float elapsedTime)
@@ -91,7 +134,33 @@ void gep::ResourceManager::update(float elapsedTime)
             {
                 GEP_ASSERT(false, "resource type not registered yet");
             }
-            if(info.pResource == nullptr) // failed load
+            if(info.isShared) // the source has the same content as a loaded resource
+            {
+                IResource* pShared = shareContent(info.pLoader->getResourceType(), info.contentHash);
+                if(pShared != nullptr)
+                {
+                    setAlias(info.ptr, pShared);
+                    {
+                        ScopedLock<Mutex> lock(m_sharedContentMutex);
+                        m_aliases.append(info.ptr);
+                    }
+                    m_loadQueue.addLatency((float)((m_timer.getTimeAsDouble() - info.requestTime) * 1000.0));
+                    info.pLoader->release();
+                }
+                else
+                {
+                    // the shared resource was deleted in the meantime, load it after all
+                    ResourceLoadQueue::Request request;
+                    request.ptr = info.ptr;
+                    request.pLoader = info.pLoader;
+                    request.resourceId = info.pLoader->getResourceId();
+                    request.priority = info.priority;
+                    request.requestTime = info.requestTime;
+                    m_loadQueue.push(request);
+                }
+                m_resourcesToPatch.removeAtIndexUnordered(i); //instead of i++
+            }
+            else if(info.pResource == nullptr) // failed load
             {
                 if(info.ptr == pDummyResource)
                     m_failedInitialLoad[info.pLoader] = true;
@@ -109,13 +178,18 @@ void gep::ResourceManager::update(float elapsedTime)
                     //replacing a dummy resource
                     invalidateAndReplace(info.ptr, info.pResource);
                     GEP_ASSERT(info.ptr == info.pResource);
+                    m_loadQueue.addLatency((float)((m_timer.getTimeAsDouble() - info.requestTime) * 1000.0));
+                    if(info.hasContentHash)
+                        registerContent(info.pResource, info.contentHash, info.contentSize, info.loadTimeMs);
                 }
                 else
                 {
-                    // replacing a valid resource
+                    // replacing a valid resource, its content changed
+                    IResource* pResourceToReplace = info.ptr;
+                    forgetContent(pResourceToReplace);
                     if(info.ptr != info.pResource) // do not swap on inplace reloading
                     {
-                        IResource* pResourceToReplace = info.ptr;
+                        replaceAliases(pResourceToReplace, info.pResource);
                         pResourceToReplace->swapPlaces(*info.pResource);
                         info.pLoader->deleteResource(pResourceToReplace);
                         GEP_ASSERT(info.ptr == info.pResource);
@@ -173,9 +247,11 @@ void gep::ResourceManager::update(float elapsedTime)
                             m_failedInitialLoad.remove(info.pLoader);
                         if(pResourceToReload != nullptr && pResourceToReload != pDummyResource)
                         {
+                            forgetContent(pResourceToReload);
                             // swap if it did not reload inplace
                             if(pResourceToReload != pNewResource)
                             {
+                                replaceAliases(pResourceToReload, pNewResource);
                                 pNewResource->swapPlaces(*pResourceToReload);
                                 removeFromNewList(pResourceToReload);
                                 info.pLoader->deleteResource(pResourceToReload);
@@ -219,7 +295,7 @@ void gep::ResourceManager::destroyInGameThread()
     DELETE_AND_NULL(m_pHkResourceLoader);
 }
 
-gep::ResourcePtr<gep::IResource> gep::ResourceManager::doLoadResource(IResourceLoader& loader, LoadAsync loadAsync)
+gep::ResourcePtr<gep::IResource> gep::ResourceManager::doLoadResource(IResourceLoader& loader, LoadAsync loadAsync, LoadPriority priority)
 {
     // Because of the insert and lookup into m_loadedResources we have to lock the entire method
     // This is only going to be a problem for synchronous loads because they will block for a long time
@@ -228,6 +304,8 @@ gep::ResourcePtr<gep::IResource> gep::ResourceManager::doLoadResource(IResourceL
     std::string resourceId(loader.getResourceId());
     if(m_loadedResources.tryGet(resourceId, alreadyLoaded))
     {
+        // a more urgent request moves the resource forward if it is still waiting for a loader thread
+        m_loadQueue.raisePriority(resourceId, (loadAsync == LoadAsync::No) ? LoadPriority::Critical : priority);
         g_globalManager.getLogging()->logMessage("Reusing already loaded resource '%s'", resourceId.c_str());
         return alreadyLoaded;
     }
@@ -235,10 +313,31 @@ gep::ResourcePtr<gep::IResource> gep::ResourceManager::doLoadResource(IResourceL
     GEP_ASSERT(pLoader != nullptr);
     if(loadAsync == LoadAsync::No)
     {
+        bool hasContentHash;
+        uint64 contentHash = 0;
+        if(findSharedContent(pLoader, hasContentHash, contentHash))
+        {
+            IResource* pShared = shareContent(pLoader->getResourceType(), contentHash);
+            if(pShared != nullptr)
+            {
+                g_globalManager.getLogging()->logMessage("Resource '%s' has the same content as '%s', sharing it",
+                    resourceId.c_str(), pShared->getLoader()->getResourceId());
+                auto result = makeResourcePtr(pShared, false);
+                m_loadedResources[resourceId] = result;
+                pLoader->release();
+                return result;
+            }
+        }
         try {
+            const double startTime = m_timer.getTimeAsDouble();
             IResource* pResult = pLoader->loadResource(nullptr);
             if(pResult != nullptr)
             {
+                if(hasContentHash)
+                {
+                    registerContent(pResult, contentHash, pResult->getFinalizeSize(),
+                                    (float)((m_timer.getTimeAsDouble() - startTime) * 1000.0));
+                }
                 if(pResult->getFinalizeOptions() > 0)
                 {
                     ScopedLock<Mutex> lock(m_newResourceMutex);
@@ -270,7 +369,13 @@ gep::ResourcePtr<gep::IResource> gep::ResourceManager::doLoadResource(IResourceL
     if(loadAsync == LoadAsync::Yes)
     {
         GEP_ASSERT(result == pResult);
-        m_pResourceLoader->loadResource(result, pLoader);
+        ResourceLoadQueue::Request request;
+        request.ptr = result;
+        request.pLoader = pLoader;
+        request.resourceId = resourceId;
+        request.priority = priority;
+        request.requestTime = m_timer.getTimeAsDouble();
+        m_loadQueue.push(request);
     }
     else
     {
@@ -331,6 +436,18 @@ void gep::ResourceManager::deleteResource(IResource* pResource)
     }
     if(pResource != pDummyResource)
     {
+        // the resource might be shared by loads with other ids
+        forgetContent(pResource);
+        replaceAliases(pResource, nullptr);
+        DynamicArray<std::string> sharingIds;
+        for(auto& loaded : m_loadedResources)
+        {
+            if(loaded.value.get() == pResource)
+                sharingIds.append(loaded.key);
+        }
+        for(auto& sharingId : sharingIds)
+            m_loadedResources.remove(sharingId);
+
         removeFromNewList(pResource);
         {
             // remove the resource from the to patch table
@@ -362,6 +479,10 @@ void gep::ResourceManager::registerResourceType(const char* name, IResource* pDu
 
 void gep::ResourceManager::finalizeResourcesWithFlags(uint32 flags)
 {
+    const double startTime = m_timer.getTimeAsDouble();
+    size_t numBytes = 0;
+
+    // resources which were loaded synchronously are always finalized
     {
     ScopedLock<Mutex> lock(m_newResourceMutex);
     for(size_t i=0; i < m_newResources.length(); )
@@ -370,6 +491,7 @@ void gep::ResourceManager::finalizeResourcesWithFlags(uint32 flags)
         uint32 resourceFlags = pResource->getFinalizeOptions();
         if((resourceFlags & ResourceFinalize::NotYet) == 0 && (resourceFlags & flags) > 0)
         {
+            numBytes += pResource->getFinalizeSize();
             pResource->finalize();
             m_newResources.removeAtIndexUnordered(i); // this removes a element => we don't need to increment the index
         }
@@ -382,19 +504,45 @@ void gep::ResourceManager::finalizeResourcesWithFlags(uint32 flags)
 
     {
         ScopedLock<Mutex> lock(m_patchResourceMutex);
+        DynamicArray<PatchInfo*> toFinalize;
         for(auto& toPatch : m_resourcesToPatch)
         {
             if(!toPatch.isFinalized)
             {
                 uint32 resourceFlags = toPatch.pResource->getFinalizeOptions();
                 if((resourceFlags & ResourceFinalize::NotYet) == 0 && (resourceFlags & flags) > 0)
-                {
-                    toPatch.pResource->finalize();
-                    toPatch.isFinalized = true;
-                }
+                    toFinalize.append(&toPatch);
+            }
+        }
+        // the most urgent and oldest requests first
+        std::sort(toFinalize.begin(), toFinalize.end(), [](const PatchInfo* lhs, const PatchInfo* rhs){
+            if(lhs->priority != rhs->priority)
+                return lhs->priority < rhs->priority;
+            return lhs->requestTime < rhs->requestTime;
+        });
+
+        // critical resources ignore the budget, and at least one resource is finalized per call
+        // so huge resources do not starve
+        size_t numFinalized = 0;
+        for(auto pToPatch : toFinalize)
+        {
+            const size_t size = pToPatch->pResource->getFinalizeSize();
+            if(pToPatch->priority != LoadPriority::Critical && numFinalized > 0)
+            {
+                const float elapsedMs = (float)((m_timer.getTimeAsDouble() - startTime) * 1000.0);
+                if((m_settings.finalizeBudgetMs > 0.0f && elapsedMs >= m_settings.finalizeBudgetMs) ||
+                   (m_settings.finalizeBudgetBytes > 0 && numBytes + size > m_settings.finalizeBudgetBytes))
+                    break;
             }
+            pToPatch->pResource->finalize();
+            pToPatch->isFinalized = true;
+            numBytes += size;
+            numFinalized++;
         }
     }
+
+    m_lastFinalizeTimeMs = (float)((m_timer.getTimeAsDouble() - startTime) * 1000.0);
+    m_lastFinalizeBytes = numBytes;
 }
 
 void gep::ResourceManager::registerLoaderForReload(const std::string& filename, IResourceLoader* pLoader, ResourcePtr<IResource> pResource)
@@ -431,73 +579,329 @@ void gep::ResourceManager::deregisterLoaderForReload(const std::string& filename
     }
 }
 
-void gep::ResourceManager::resourceFinishedLoading(ResourcePtr<IResource> ptr, IResource* pResource, IResourceLoader* pLoader)
+void gep::ResourceManager::resourceFinishedLoading(ResourcePtr<IResource> ptr, IResource* pResource, IResourceLoader* pLoader,
+                                                   LoadPriority priority)
 {
     PatchInfo info;
     info.ptr = ptr;
     info.pResource = pResource;
     info.pLoader = pLoader;
     info.isFinalized = (pResource->getFinalizeOptions() == 0);
+    info.priority = priority;
+    info.requestTime = m_timer.getTimeAsDouble();
+    info.isShared = false;
+    info.hasContentHash = false;
     ScopedLock<Mutex> lock(m_patchResourceMutex);
     m_resourcesToPatch.append(info);
 }
 
-gep::ResourceLoaderThread::ResourceLoaderThread(ResourceManager* pResourceManager) :
-    m_toLoadCounter(0),
-    m_pResourceManager(pResourceManager),
-    m_isRunning(false)
+void gep::ResourceManager::resourceFinishedLoading(const ResourceLoadQueue::Request& request, IResource* pResource,
+                                                   bool hasContentHash, uint64 contentHash, float loadTimeMs)
+{
+    PatchInfo info;
+    info.ptr = request.ptr;
+    info.pResource = pResource;
+    info.pLoader = request.pLoader;
+    info.isFinalized = (pResource->getFinalizeOptions() == 0);
+    info.priority = request.priority;
+    info.requestTime = request.requestTime;
+    info.isShared = false;
+    info.hasContentHash = hasContentHash;
+    info.contentHash = contentHash;
+    // finalizing might free the data the size is computed from
+    info.contentSize = hasContentHash ? pResource->getFinalizeSize() : 0;
+    info.loadTimeMs = loadTimeMs;
+    ScopedLock<Mutex> lock(m_patchResourceMutex);
+    m_resourcesToPatch.append(info);
+}
+
+void gep::ResourceManager::resourceShared(const ResourceLoadQueue::Request& request, uint64 contentHash)
 {
+    PatchInfo info;
+    info.ptr = request.ptr;
+    info.pResource = nullptr;
+    info.pLoader = request.pLoader;
+    info.isFinalized = true;
+    info.priority = request.priority;
+    info.requestTime = request.requestTime;
+    info.isShared = true;
+    info.hasContentHash = true;
+    info.contentHash = contentHash;
+    ScopedLock<Mutex> lock(m_patchResourceMutex);
+    m_resourcesToPatch.append(info);
+}
 
+bool gep::ResourceManager::findSharedContent(IResourceLoader* pLoader, bool& hasContentHash, uint64& contentHash)
+{
+    hasContentHash = m_settings.shareIdenticalResources && pLoader->getContentHash(contentHash);
+    if(!hasContentHash)
+        return false;
+    ScopedLock<Mutex> lock(m_sharedContentMutex);
+    SharedContent content;
+    return m_sharedContent.tryGet(contentHash, content) == SUCCESS &&
+           content.resourceType == pLoader->getResourceType();
 }
 
-gep::ResourceLoaderThread::~ResourceLoaderThread()
+void gep::ResourceManager::registerContent(IResource* pResource, uint64 contentHash, size_t size, float loadTimeMs)
 {
-    GEP_ASSERT(m_isRunning == false, "resource loader should not be running");
-    while(m_resourcesToLoad.count() > 0)
+    ScopedLock<Mutex> lock(m_sharedContentMutex);
+    // two loads of the same content which ran at the same time, the first one is shared from now on
+    if(m_sharedContent.exists(contentHash))
+        return;
+    SharedContent& content = m_sharedContent[contentHash];
+    content.pResource = pResource;
+    content.resourceType = pResource->getResourceType();
+    content.size = size;
+    content.loadTimeMs = loadTimeMs;
+}
+
+gep::IResource* gep::ResourceManager::shareContent(const char* resourceType, uint64 contentHash)
+{
+    ScopedLock<Mutex> lock(m_sharedContentMutex);
+    SharedContent content;
+    if(m_sharedContent.tryGet(contentHash, content) == FAILURE || content.resourceType != resourceType)
+        return nullptr;
+    m_numShared++;
+    m_sharedBytes += content.size;
+    m_sharedLoadTimeMs += content.loadTimeMs;
+    return content.pResource;
+}
+
+void gep::ResourceManager::forgetContent(IResource* pResource)
+{
+    ScopedLock<Mutex> lock(m_sharedContentMutex);
+    for(auto& content : m_sharedContent)
     {
-        m_resourcesToLoad.take().pLoader->release();
+        if(content.value.pResource == pResource)
+        {
+            const uint64 contentHash = content.key;
+            m_sharedContent.remove(contentHash);
+            return;
+        }
     }
 }
 
-void gep::ResourceLoaderThread::loadResource(ResourcePtr<IResource> ptr, IResourceLoader* pLoader)
+void gep::ResourceManager::replaceAliases(IResource* pOldResource, IResource* pNewResource)
 {
-    ToLoadInfo info;
-    info.ptr = ptr;
-    info.pLoader = pLoader;
-    m_resourcesToLoad.append(info);
-    m_toLoadCounter.increment();
+    ScopedLock<Mutex> lock(m_sharedContentMutex);
+    for(size_t i=0; i < m_aliases.length(); )
+    {
+        auto& alias = m_aliases[i];
+        if(pOldResource != nullptr && alias.get() != pOldResource)
+        {
+            i++;
+        }
+        else if(pNewResource != nullptr)
+        {
+            setAlias(alias, pNewResource);
+            i++;
+        }
+        else
+        {
+            invalidate(alias);
+            m_aliases.removeAtIndexUnordered(i); // instead of i++
+        }
+    }
+}
+
+void gep::ResourceManager::deleteUnpatchedResource(PatchInfo& info)
+{
+    if(info.pResource != nullptr)
+    {
+        info.pResource->unload();
+        info.pLoader->deleteResource(info.pResource);
+    }
+    info.pLoader->release();
+}
+
+void gep::ResourceManager::releaseCanceledRequests(DynamicArray<ResourceLoadQueue::Request>& canceled)
+{
+    for(auto& request : canceled)
+    {
+        if(m_loadedResources.exists(request.resourceId))
+            m_loadedResources.remove(request.resourceId);
+        request.pLoader->release();
+    }
+}
+
+bool gep::ResourceManager::cancelLoading(ResourcePtr<IResource> pResource)
+{
+    ScopedLock<Mutex> outerLock(m_loadingResourceMutex);
+    // the pointer still points to the dummy, find the id it was requested with
+    std::string resourceId;
+    bool isRequested = false;
+    for(auto& loaded : m_loadedResources)
+    {
+        if(loaded.value.getWeakRefIndex() == pResource.getWeakRefIndex())
+        {
+            resourceId = loaded.key;
+            isRequested = true;
+            break;
+        }
+    }
+    if(!isRequested)
+        return false;
+
+    DynamicArray<ResourceLoadQueue::Request> canceled;
+    bool wasCanceled = m_loadQueue.cancel(resourceId, canceled);
+    {
+        // loaded but not finalized yet
+        ScopedLock<Mutex> lock(m_patchResourceMutex);
+        for(size_t i=0; i < m_resourcesToPatch.length(); )
+        {
+            auto& info = m_resourcesToPatch[i];
+            IResource* pDummyResource = nullptr;
+            m_resourceDummies.tryGet(std::string(info.pLoader->getResourceType()), pDummyResource);
+            if(info.ptr.getWeakRefIndex() == pResource.getWeakRefIndex() && info.ptr.get() == pDummyResource)
+            {
+                deleteUnpatchedResource(info);
+                m_resourcesToPatch.removeAtIndexUnordered(i); // instead of i++
+                m_loadQueue.addCanceled();
+                wasCanceled = true;
+            }
+            else
+                i++;
+        }
+    }
+    if(wasCanceled && m_loadedResources.exists(resourceId))
+        m_loadedResources.remove(resourceId);
+    releaseCanceledRequests(canceled);
+    return wasCanceled;
+}
+
+size_t gep::ResourceManager::cancelLoading(LoadPriority priority)
+{
+    ScopedLock<Mutex> outerLock(m_loadingResourceMutex);
+    DynamicArray<ResourceLoadQueue::Request> canceled;
+    DynamicArray<std::string> canceledIds;
+    size_t numCanceled = m_loadQueue.cancel(priority, canceled, canceledIds);
+    {
+        // loaded but not finalized yet
+        ScopedLock<Mutex> lock(m_patchResourceMutex);
+        for(size_t i=0; i < m_resourcesToPatch.length(); )
+        {
+            auto& info = m_resourcesToPatch[i];
+            IResource* pDummyResource = nullptr;
+            m_resourceDummies.tryGet(std::string(info.pLoader->getResourceType()), pDummyResource);
+            if(info.priority == priority && info.ptr.get() == pDummyResource)
+            {
+                canceledIds.append(info.pLoader->getResourceId());
+                deleteUnpatchedResource(info);
+                m_resourcesToPatch.removeAtIndexUnordered(i); // instead of i++
+                m_loadQueue.addCanceled();
+                numCanceled++;
+            }
+            else
+                i++;
+        }
+    }
+    for(auto& resourceId : canceledIds)
+    {
+        if(m_loadedResources.exists(resourceId))
+            m_loadedResources.remove(resourceId);
+    }
+    releaseCanceledRequests(canceled);
+    return numCanceled;
+}
+
+gep::ResourceLoadingStatistics gep::ResourceManager::getLoadingStatistics()
+{
+    ResourceLoadingStatistics statistics;
+    m_loadQueue.getStatistics(statistics);
+    statistics.numWaitingForFinalize = 0;
+    {
+        ScopedLock<Mutex> lock(m_patchResourceMutex);
+        for(auto& info : m_resourcesToPatch)
+        {
+            if(!info.isFinalized)
+                statistics.numWaitingForFinalize++;
+        }
+    }
+    statistics.lastFinalizeTimeMs = m_lastFinalizeTimeMs;
+    statistics.lastFinalizeBytes = m_lastFinalizeBytes;
+    {
+        ScopedLock<Mutex> lock(m_sharedContentMutex);
+        statistics.numShared = m_numShared;
+        statistics.sharedBytes = m_sharedBytes;
+        statistics.sharedLoadTimeMs = m_sharedLoadTimeMs;
+    }
+    ResourceCache::Statistics cacheStatistics = {};
+    if(m_pResourceCache != nullptr)
+        cacheStatistics = m_pResourceCache->getStatistics();
+    statistics.numCacheHits = cacheStatistics.numHits;
+    statistics.numCacheMisses = cacheStatistics.numMisses;
+    statistics.cacheSavedTimeMs = cacheStatistics.savedTimeMs;
+    return statistics;
+}
+
+gep::ResourceCache* gep::ResourceManager::getResourceCache()
+{
+    return m_pResourceCache;
+}
+
+gep::ResourceLoaderThread::ResourceLoaderThread(ResourceManager* pResourceManager, ResourceLoadQueue* pLoadQueue) :
+    m_pResourceManager(pResourceManager),
+    m_pLoadQueue(pLoadQueue),
+    m_isRunning(true)
+{
+
+}
+
+gep::ResourceLoaderThread::~ResourceLoaderThread()
+{
+    GEP_ASSERT(m_isRunning == false, "resource loader should not be running");
 }
 
 void gep::ResourceLoaderThread::run()
 {
-    m_isRunning = true;
     SCOPE_EXIT{ m_isRunning = false; });
     while(m_isRunning)
     {
-//        Sleep(100);
-        m_toLoadCounter.waitAndDecrement();
-        // We might got signaled to quit, check this
-        if(!m_isRunning)
-            break;
-        auto info = m_resourcesToLoad.take();
+        ResourceLoadQueue::Request request;
+        // wake up regularly to check if we got signaled to quit
+        if(m_pLoadQueue->take(request, 100) == FAILURE)
+            continue;
+        bool hasContentHash;
+        uint64 contentHash = 0;
+        if(m_pResourceManager->findSharedContent(request.pLoader, hasContentHash, contentHash))
+        {
+            // nothing to load, the game thread makes the dummy point to the shared resource
+            if(m_pLoadQueue->finishLoading(request, true))
+                m_pResourceManager->resourceShared(request, contentHash);
+            else
+                request.pLoader->release();
+            continue;
+        }
+        const double startTime = m_timer.getTimeAsDouble();
         IResource* pResult = nullptr;
         try
         {
-            pResult = info.pLoader->loadResource(nullptr);
+            pResult = request.pLoader->loadResource(nullptr);
             if(pResult != nullptr)
-                pResult->setLoader(info.pLoader);
+                pResult->setLoader(request.pLoader);
         }
         catch(LoadingError& ex)
         {
             g_globalManager.getLogging()->logError("%s", ex.what());
         }
-        if(pResult != nullptr)
+        if(!m_pLoadQueue->finishLoading(request, pResult != nullptr))
+        {
+            // canceled while loading, nobody waits for the result
+            if(pResult != nullptr)
+            {
+                pResult->unload();
+                request.pLoader->deleteResource(pResult);
+            }
+            request.pLoader->release();
+        }
+        else if(pResult != nullptr)
         {
-            m_pResourceManager->resourceFinishedLoading(info.ptr, pResult, info.pLoader);
+            const float loadTimeMs = (float)((m_timer.getTimeAsDouble() - startTime) * 1000.0);
+            m_pResourceManager->resourceFinishedLoading(request, pResult, hasContentHash, contentHash, loadTimeMs);
         }
         else
         {
-            info.pLoader->release();
+            request.pLoader->release();
         }
     }
 }
@@ -505,7 +909,7 @@ void gep::ResourceLoaderThread::run()
 void gep::ResourceLoaderThread::stop()
 {
     m_isRunning = false;
-    m_toLoadCounter.increment();
+    m_pLoadQueue->wakeUp();
 }
 
 
@@ -5,6 +5,24 @@
 
 namespace helper
 {
+    // registry table of all proxies, created on first use
+    const char* const proxyCacheName = "gep_ProxyCache";
+
+    // state of the scripting manager, destructors of bound objects invalidate their proxies in it
+    lua_State* g_pProxyState = nullptr;
+
+    // pushes the proxy cache, its values are weak so proxies no script references are collected
+    void pushProxyCache(lua_State* L)
+    {
+        if (!luaL_getsubtable(L, LUA_REGISTRYINDEX, proxyCacheName))
+        {
+            lua_createtable(L, 0, 1);
+            lua_pushliteral(L, "v");
+            lua_setfield(L, -2, "__mode");
+            lua_setmetatable(L, -2);
+        }
+    }
+
     void indent(const size_t level, std::ostringstream& output)
     {
         for (size_t i = 0; i < level; i++)
@@ -361,3 +379,100 @@ int lua::utils::nullCheck(lua_State* L)
     lua_pushboolean(L, ptr == nullptr);
     return 1;
 }
+
+void lua::utils::addProxyFunctions(lua_State* L, int metaTableIndex)
+{
+    StackChecker check(L, 0);
+
+    lua_pushcfunction(L, lua::utils::ptrCompare);
+    lua_setfield(L, metaTableIndex, "equals");
+
+    lua_pushcfunction(L, lua::utils::nullCheck);
+    lua_setfield(L, metaTableIndex, "isNull");
+}
+
+bool lua::utils::pushProxy(lua_State* L, void* pObject, const char* metaTableName)
+{
+    StackChecker check(L, 1);
+
+    helper::pushProxyCache(L);
+    auto cacheIndex = lua_gettop(L);
+
+    lua_pushlightuserdata(L, pObject);
+    lua_rawget(L, cacheIndex);
+    if (lua_istable(L, -1))
+    {
+        // the same address may have been pushed as another type
+        luaL_getmetatable(L, metaTableName);
+        if (!lua_getmetatable(L, -2))
+            lua_pushnil(L);
+        bool isSameType = lua_rawequal(L, -1, -2) != 0;
+        lua_pop(L, 2);
+        if (isSameType)
+        {
+            lua_remove(L, cacheIndex);
+            return true;
+        }
+    }
+    lua_pop(L, 1);
+
+    lua_createtable(L, 0, 1);
+    auto proxyIndex = lua_gettop(L);
+    lua_pushlightuserdata(L, pObject);
+    lua_setfield(L, proxyIndex, "__ptr");
+
+    luaL_getmetatable(L, metaTableName);
+    if (lua_isnil(L, -1))
+    {
+        // types without bindings have no metatable to share the functions
+        lua_pop(L, 1);
+        addProxyFunctions(L, proxyIndex);
+    }
+    else
+    {
+        lua_setmetatable(L, proxyIndex);
+    }
+
+    lua_pushlightuserdata(L, pObject);
+    lua_pushvalue(L, proxyIndex);
+    lua_rawset(L, cacheIndex);
+
+    lua_remove(L, cacheIndex);
+    return false;
+}
+
+void lua::utils::invalidateProxy(lua_State* L, void* pObject)
+{
+    // the scripting manager may already be destroyed
+    if (L == nullptr)
+        return;
+
+    StackChecker check(L, 0);
+
+    helper::pushProxyCache(L);
+    auto cacheIndex = lua_gettop(L);
+
+    lua_pushlightuserdata(L, pObject);
+    lua_rawget(L, cacheIndex);
+    if (lua_istable(L, -1))
+    {
+        lua_pushliteral(L, "__ptr");
+        lua_pushlightuserdata(L, nullptr);
+        lua_rawset(L, -3);
+
+        lua_pushlightuserdata(L, pObject);
+        lua_pushnil(L);
+        lua_rawset(L, cacheIndex);
+    }
+    lua_pop(L, 2);
+}
+
+void lua::utils::invalidateProxy(void* pObject)
+{
+    invalidateProxy(helper::g_pProxyState, pObject);
+}
+
+void lua::utils::setProxyState(lua_State* L)
+{
+    helper::g_pProxyState = L;
+}
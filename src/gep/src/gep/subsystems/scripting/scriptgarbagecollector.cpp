@@ -0,0 +1,100 @@
+#include "stdafx.h"
+#include "gepimpl/subsystems/scriptGarbageCollector.h"
+
+#include "gep/globalManager.h"
+#include "gep/interfaces/logging.h"
+#include "gep/timer.h"
+
+gep::ScriptGarbageCollector::ScriptGarbageCollector(const settings::Scripts* pScriptSettings) :
+    m_L(nullptr),
+    m_pScriptSettings(pScriptSettings),
+    m_statistics(),
+    m_bytesUsedAfterLastCycle(0),
+    m_isGenerational(false)
+{
+}
+
+void gep::ScriptGarbageCollector::initialize(lua_State* L)
+{
+    m_L = L;
+    // the collection steps in update do the work, Lua's own collector is the safety net
+    lua_gc(m_L, LUA_GCSETPAUSE, AUTOMATIC_COLLECTION_PAUSE);
+    m_isGenerational = false;
+    m_bytesUsedAfterLastCycle = getBytesUsed();
+    m_statistics = ScriptGarbageCollectionStatistics();
+}
+
+void gep::ScriptGarbageCollector::update(Timer& timer, float elapsedTime, float averageElapsedTime)
+{
+    // the settings are loaded by a script after the Lua state was created
+    if (m_pScriptSettings->generationalGarbageCollection != m_isGenerational)
+        setGenerational(m_pScriptSettings->generationalGarbageCollection);
+
+    m_statistics.budgetMs = calculateBudget(elapsedTime, averageElapsedTime);
+    m_statistics.numSteps = 0;
+
+    const size_t bytesUsedBefore = getBytesUsed();
+    PointInTime start(timer);
+    float timeMs = 0.0f;
+    while (timeMs < m_statistics.budgetMs)
+    {
+        const bool finishedCycle = lua_gc(m_L, LUA_GCSTEP, COLLECTION_STEP_SIZE_KB) != 0;
+        m_statistics.numSteps++;
+        timeMs = (PointInTime(timer) - start) * 1000.0f;
+        if (finishedCycle)
+        {
+            // the next cycle starts next frame, there is little garbage right after a cycle
+            m_statistics.numCycles++;
+            m_bytesUsedAfterLastCycle = getBytesUsed();
+            break;
+        }
+#ifdef LUA_GCGEN
+        // a generational step is a whole minor collection, another one would find almost nothing
+        if (m_isGenerational)
+            break;
+#endif
+    }
+
+    m_statistics.timeMs = timeMs;
+    m_statistics.bytesUsed = getBytesUsed();
+    m_statistics.bytesFreed = bytesUsedBefore > m_statistics.bytesUsed ? bytesUsedBefore - m_statistics.bytesUsed : 0;
+}
+
+void gep::ScriptGarbageCollector::collectFully()
+{
+    lua_gc(m_L, LUA_GCCOLLECT, 0);
+    m_statistics.numCycles++;
+    m_bytesUsedAfterLastCycle = getBytesUsed();
+}
+
+float gep::ScriptGarbageCollector::calculateBudget(float elapsedTime, float averageElapsedTime) const
+{
+    float budgetMs = m_pScriptSettings->garbageCollectionBudgetMs;
+
+    // the more the memory grew since the last cycle, the more time the collector gets to catch up
+    const float growth = float(getBytesUsed()) / float(GEP_MAX(m_bytesUsedAfterLastCycle, size_t(1)));
+    budgetMs *= GEP_MAX(growth, 1.0f);
+
+    // do not make a slow frame even slower, unless the collector is about to fall behind for good
+    const float automaticCollectionGrowth = AUTOMATIC_COLLECTION_PAUSE / 100.0f;
+    if (elapsedTime > averageElapsedTime * 1.25f && growth < automaticCollectionGrowth * 0.5f)
+        budgetMs *= 0.5f;
+
+    return GEP_MIN(budgetMs, m_pScriptSettings->maxGarbageCollectionBudgetMs);
+}
+
+void gep::ScriptGarbageCollector::setGenerational(bool generational)
+{
+    m_isGenerational = generational;
+#ifdef LUA_GCGEN
+    lua_gc(m_L, generational ? LUA_GCGEN : LUA_GCINC, 0);
+#else
+    if (generational)
+        g_globalManager.getLogging()->logWarning("This version of Lua has no generational garbage collector, using the incremental one.");
+#endif
+}
+
+size_t gep::ScriptGarbageCollector::getBytesUsed() const
+{
+    return size_t(lua_gc(m_L, LUA_GCCOUNT, 0)) * 1024 + size_t(lua_gc(m_L, LUA_GCCOUNTB, 0));
+}
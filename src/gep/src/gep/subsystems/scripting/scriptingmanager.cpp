@@ -8,6 +8,7 @@
 #include "gep/globalManager.h"
 #include "gep/interfaces/logging.h"
 #include "gep/interfaces/MemoryManager.h"
+#include "gep/interfaces/updateFramework.h"
 #include "gep/settings.h"
 
 namespace gep
@@ -38,30 +39,9 @@ namespace gep
     void* scriptAllocator(void* userData, void* ptr, size_t originalSize, size_t newSize)
     {
         GEP_ASSERT(userData != nullptr, "Lua allocation called with invalid user data!");
-        auto pAllocator = static_cast<ScriptingAllocator*>(userData);
-
-        if (newSize == 0) // We are supposed to free the pointer.
-        {
-            pAllocator->freeMemory(ptr);
-            return nullptr;
-        }
-
-        if (ptr == nullptr) // we are supposed to allocate new memory.
-        {
-            return pAllocator->allocateMemory(newSize);
-        }
-
-        auto newPtr = pAllocator->allocateMemory(newSize);
-        GEP_ASSERT(newPtr, "Out of memory.");
-
-        auto size = GEP_MIN(originalSize, newSize);
-        GEP_ASSERT(size <= newSize);
-        GEP_ASSERT(size <= originalSize);
-
-        memcpy(newPtr, ptr, size);
-        pAllocator->freeMemory(ptr);
-
-        return newPtr;
+        auto pAllocator = static_cast<SmallObjectAllocator*>(userData);
+        // when allocating, originalSize is not a size but the type of the new object
+        return pAllocator->reallocate(ptr, (ptr != nullptr) ? originalSize : 0, newSize);
     }
 
     int scriptErrorHandler(lua_State* L)
@@ -90,71 +70,14 @@ namespace gep
     }
 }
 
-gep::ScriptingAllocator::ScriptingAllocator(IAllocatorStatistics* pParentAllocator) :
-    m_L(nullptr),
-    m_pParentAllocator(pParentAllocator),
-    m_numAllocations(0),
-    m_numFrees(0)
-{
-}
-
-gep::ScriptingAllocator::~ScriptingAllocator()
-{
-    m_L = nullptr;
-    m_pParentAllocator = nullptr;
-}
-
-size_t gep::ScriptingAllocator::getNumAllocations() const
-{
-    return m_numAllocations;
-}
-
-size_t gep::ScriptingAllocator::getNumFrees() const
-{
-    return m_numFrees;
-}
-
-size_t gep::ScriptingAllocator::getNumBytesReserved() const
-{
-    return 0;
-}
-
-size_t gep::ScriptingAllocator::getNumBytesUsed() const
-{
-    GEP_ASSERT(m_L, "The scripting allocator needs a valid lua state!");
-    return lua_gc(m_L, LUA_GCCOUNT, 0) * 1000 + lua_gc(m_L, LUA_GCCOUNTB, 0);
-}
-
-gep::IAllocator* gep::ScriptingAllocator::getParentAllocator() const
-{
-    return m_pParentAllocator;
-}
-
-void* gep::ScriptingAllocator::allocateMemory(size_t size)
-{
-    auto ptr = m_pParentAllocator->allocateMemory(size);
-    ++m_numAllocations;
-    return ptr;
-}
-
-void gep::ScriptingAllocator::freeMemory(void* mem)
-{
-    if (mem == nullptr)
-    {
-        return;
-    }
-
-    ++m_numFrees;
-    m_pParentAllocator->freeMemory(mem);
-}
-
 //////////////////////////////////////////////////////////////////////////
 
 gep::ScriptingManager::ScriptingManager(settings::Scripts* pScriptSettings) :
     m_allocator(&g_stdAllocator),
     m_L(nullptr),
     m_state(State::LoadingDisabled),
-    m_pScriptSettings(pScriptSettings)
+    m_pScriptSettings(pScriptSettings),
+    m_garbageCollector(pScriptSettings)
 {
 }
 
@@ -170,12 +93,14 @@ void gep::ScriptingManager::initialize()
     // create a Lua state with a custom allocator
     m_L = lua_newstate(&gep::scriptAllocator, &m_allocator);
     lua_atpanic(m_L, &gep::scriptErrorHandler);
+    lua::utils::setProxyState(m_L);
 
-    m_allocator.setLuaState(m_L);
     g_globalManager.getMemoryManager()->registerAllocator("Lua", &m_allocator);
 
     // open all standard libraries
     luaL_openlibs(m_L);
+
+    m_garbageCollector.initialize(m_L);
 }
 
 void gep::ScriptingManager::destroy()
@@ -186,12 +111,18 @@ void gep::ScriptingManager::destroy()
 
     g_globalManager.getMemoryManager()->deregisterAllocator(&m_allocator);
 
+    lua::utils::setProxyState(nullptr);
     lua_close(m_L);
     m_L = nullptr;
 }
 
 void gep::ScriptingManager::update(float elapsedTime)
 {
+    if (m_L == nullptr)
+        return;
+
+    const float averageElapsedTime = g_globalManager.getUpdateFramework()->calcElapsedTimeAverage(NUM_AVERAGED_FRAMES);
+    m_garbageCollector.update(g_globalManager.getTimer(), elapsedTime, averageElapsedTime);
 }
 
 #define GEP_SCRIPT_LOAD_ERROR(scriptFileNameAsCString, context) \
@@ -307,7 +238,7 @@ gep::int32 gep::ScriptingManager::memoryUsed() const
 
 void gep::ScriptingManager::collectGarbage()
 {
-    lua_gc(m_L, LUA_GCCOLLECT, 0);
+    m_garbageCollector.collectFully();
 }
 
 void gep::ScriptingManager::debugBreak(const char* message) const
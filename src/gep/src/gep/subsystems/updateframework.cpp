@@ -7,6 +7,7 @@
 #include "gep/interfaces/inputHandler.h"
 #include "gep/interfaces/sound.h"
 #include "gep/interfaces/physics.h"
+#include "gep/interfaces/scripting.h"
 
 gep::UpdateFramework::UpdateFramework() :
     m_FrameTimesPtr(m_pFrameTimesArray)
@@ -41,12 +42,13 @@ void gep::UpdateFramework::run()
         float elapsedTime = now - m_timeOfLastFrame;
         m_timeOfLastFrame = now;
 
-        m_frameIdx = (m_frameIdx + 1) % m_FrameTimesPtr.length();
-        m_FrameTimesPtr[m_frameIdx] = elapsedTime;
-
         m_gameThread.m_gameEndLock.waitAndDecrement();
         // From here on only 1 thread runs
 
+        // the game thread reads the frame times while it collects Lua garbage
+        m_frameIdx = (m_frameIdx + 1) % m_FrameTimesPtr.length();
+        m_FrameTimesPtr[m_frameIdx] = elapsedTime;
+
         m_gameThread.m_elapsedTime = elapsedTime;
 
         g_globalManager.getInputHandler()->update(elapsedTime);
@@ -76,6 +78,9 @@ void gep::UpdateFramework::runGame(float elapsedTime)
     g_globalManager.getPhysicsSystem()->update(elapsedTime);
 
     g_globalManager.getRendererExtractor()->extract();
+
+    // the scripts ran for this frame, collect their garbage in the time budget of the frame
+    g_globalManager.getScriptingManager()->update(elapsedTime);
 }
 
 
@@ -204,6 +209,7 @@ void gep::GameThread::run()
 {
     try
     {
+        g_globalManager.getTaskQueue()->attachLocalWorker();
         m_pUpdateFramework->initializeGame();
 
         while(m_execute)
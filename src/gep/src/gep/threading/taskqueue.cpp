@@ -2,11 +2,65 @@
 #include "gep/threading/taskQueue.h"
 #include "gep/globalManager.h"
 #include "gep/interfaces/logging.h"
+#include "gep/exception.h"
 #include <thread>
 
+namespace
+{
+    // m_numTasksClaimed of groups which are not executing, so late claims always fail
+    const LONG NO_TASKS_TO_CLAIM = 0x3FFFFFFF;
+}
+
+/// \brief task of a parallel loop which covers a range of chunks
+class gep::TaskQueue::ParallelForNode : public ITask
+{
+public:
+    struct Loop
+    {
+        TaskQueue* pTaskQueue;
+        TaskGroup* pGroup;
+        ParallelForFunction pFunction;
+        void* pContext;
+        size_t begin;
+        size_t end;
+        size_t chunkSize;
+        ParallelForNode* pNodes;
+        volatile LONG numNodesUsed;
+    };
+
+    Loop* pLoop;
+    size_t firstChunk;
+    size_t endChunk;
+    ScheduledTask scheduledTask;
+
+    virtual void execute() override
+    {
+        // split off the upper half until a single chunk is left, idle workers steal the split off parts
+        while(endChunk - firstChunk > 1)
+        {
+            size_t middleChunk = firstChunk + (endChunk - firstChunk) / 2;
+            ParallelForNode& child = pLoop->pNodes[InterlockedIncrement(&pLoop->numNodesUsed) - 1];
+            child.pLoop = pLoop;
+            child.firstChunk = middleChunk;
+            child.endChunk = endChunk;
+            child.scheduledTask.pTask = &child;
+            child.scheduledTask.pGroup = pLoop->pGroup;
+            endChunk = middleChunk;
+            pLoop->pTaskQueue->spawnTask(&child.scheduledTask);
+        }
+
+        size_t chunkBegin = pLoop->begin + firstChunk * pLoop->chunkSize;
+        size_t chunkEnd = GEP_MIN(chunkBegin + pLoop->chunkSize, pLoop->end);
+        pLoop->pFunction(pLoop->pContext, firstChunk, chunkBegin, chunkEnd);
+    }
+};
+
 gep::TaskGroup::TaskGroup(TaskQueue* pTaskQueue) :
     m_isExecuting(false),
-    m_pTaskQueue(pTaskQueue)
+    m_pTaskQueue(pTaskQueue),
+    m_numRemainingTasks(0),
+    m_numTasksClaimed(NO_TASKS_TO_CLAIM),
+    m_numPendingDependencies(1)
 {
 
 }
@@ -17,11 +71,51 @@ void gep::TaskGroup::addTask(ITask* pTask)
     m_tasks.append(pTask);
 }
 
+void gep::TaskGroup::addDependency(TaskGroup* pDependency)
+{
+    GEP_ASSERT(pDependency != nullptr && pDependency != this, "invalid dependency");
+    GEP_ASSERT(!m_isExecuting && !pDependency->m_isExecuting, "can not change dependencies while executing");
+    m_dependencies.append(pDependency);
+    pDependency->m_dependents.append(this);
+    InterlockedIncrement(&m_numPendingDependencies);
+}
+
+void gep::TaskGroup::removeDependency(TaskGroup* pDependency)
+{
+    GEP_ASSERT(!m_isExecuting && !pDependency->m_isExecuting, "can not change dependencies while executing");
+    for(size_t i=0; i < m_dependencies.length(); i++)
+    {
+        if(m_dependencies[i] == pDependency)
+        {
+            m_dependencies.removeAtIndexUnordered(i);
+            InterlockedDecrement(&m_numPendingDependencies);
+            break;
+        }
+    }
+    auto& dependents = pDependency->m_dependents;
+    for(size_t i=0; i < dependents.length(); i++)
+    {
+        if(dependents[i] == this)
+        {
+            dependents.removeAtIndexUnordered(i);
+            break;
+        }
+    }
+}
+
 void gep::TaskGroup::reset()
 {
+    GEP_ASSERT(!m_isExecuting, "can not reset a group while executing");
+    while(m_dependencies.length() > 0)
+        removeDependency(m_dependencies.lastElement());
+    while(m_dependents.length() > 0)
+        m_dependents.lastElement()->removeDependency(this);
     m_numRemainingTasks = 0;
+    m_numTasksClaimed = NO_TASKS_TO_CLAIM;
+    m_numPendingDependencies = 1;
     m_isExecuting = false;
     m_tasks.resize(0);
+    m_scheduledTasks.resize(0);
     m_finishedCallback = nullptr;
 }
 
@@ -30,41 +124,138 @@ void gep::TaskGroup::taskFinished()
     uint32 tasksRemainingInGroup = InterlockedDecrement(&m_numRemainingTasks);
     if(tasksRemainingInGroup == 0)
     {
-        m_isExecuting = false;
+        m_numTasksClaimed = NO_TASKS_TO_CLAIM;
+        m_pTaskQueue->groupFinished(this);
         if(m_finishedCallback)
             m_finishedCallback(m_tasks.toArray());
-        m_pTaskQueue->scheduleNextGroup();
+        for(auto pDependent : m_dependents)
+        {
+            pDependent->dependencyFinished();
+        }
+        // nothing may touch the group after this, the owner might reuse it right away
+        MemoryBarrier();
+        m_isExecuting = false;
     }
 }
 
-gep::TaskWorker::TaskWorker(TaskQueue* pTaskQueue) :
+void gep::TaskGroup::dependencyFinished()
+{
+    if(InterlockedDecrement(&m_numPendingDependencies) == 0)
+    {
+        // arm the counter for the next execution before any dependency can finish again
+        m_numPendingDependencies = (LONG)m_dependencies.length() + 1;
+        m_pTaskQueue->groupReady(this);
+    }
+}
+
+gep::TaskWorker::TaskWorker(TaskQueue* pTaskQueue, size_t coreIndex) :
     m_pTaskQueue(pTaskQueue),
     m_hasWorkSemaphore(0),
-    m_pActiveGroup(nullptr)
+    m_isParked(0),
+    m_randomState((uint32)(reinterpret_cast<uintptr_t>(this) >> 4) | 1),
+    m_maxFailedSteals(MIN_FAILED_STEALS),
+    m_coreIndex(coreIndex),
+    m_numTasksExecuted(0),
+    m_numTasksStolen(0),
+    m_numFailedSteals(0),
+    m_numParks(0),
+    m_busyTicks(0),
+    m_spinTicks(0),
+    m_idleTicks(0)
 {
 }
 
-void gep::TaskWorker::addTasks(ArrayPtr<ITask*> tasks)
+void gep::TaskWorker::runTasks()
 {
-    ScopedLock<Mutex> lock(m_tasksMutex);
-    m_tasks.append(tasks);
+    const Timer& timer = m_pTaskQueue->m_timer;
+    uint64 stateStart = timer.getTime();
+    uint32 numFailedSteals = 0;
+    while(m_pTaskQueue->m_isRunning)
+    {
+        if(runSingleTask() == SUCCESS || stealTask() == SUCCESS)
+        {
+            if(numFailedSteals > 0)
+            {
+                uint64 now = timer.getTime();
+                m_spinTicks += now - stateStart;
+                stateStart = now;
+                // the work came late, spin longer before going to sleep next time
+                if(numFailedSteals > m_maxFailedSteals / 2)
+                    m_maxFailedSteals = GEP_MIN(m_maxFailedSteals * 2, MAX_FAILED_STEALS);
+                numFailedSteals = 0;
+            }
+            continue;
+        }
+
+        if(numFailedSteals == 0)
+        {
+            uint64 now = timer.getTime();
+            m_busyTicks += now - stateStart;
+            stateStart = now;
+        }
+        m_numFailedSteals++;
+
+        // back off before going to sleep, so short gaps between tasks don't cost a wakeup
+        if(numFailedSteals >= m_maxFailedSteals)
+        {
+            // no work came up, spinning was wasted, so spin shorter next time
+            m_maxFailedSteals = GEP_MAX(m_maxFailedSteals / 2, MIN_FAILED_STEALS);
+            break;
+        }
+        if(numFailedSteals < NUM_SPINNING_STEALS)
+        {
+            for(uint32 i=0; i < (1u << numFailedSteals); i++)
+                YieldProcessor();
+        }
+        else
+        {
+            SwitchToThread();
+        }
+        numFailedSteals++;
+    }
+
+    uint64 now = timer.getTime();
+    if(numFailedSteals > 0)
+        m_spinTicks += now - stateStart;
+    else
+        m_busyTicks += now - stateStart;
 }
 
-void gep::TaskWorker::runTasks()
+void gep::TaskWorker::park()
 {
-    do
+    InterlockedExchange(&m_isParked, 1);
+    // work might have been added before we were marked as parked, the waker did not see us then
+    if(claimTasks() == SUCCESS || m_pTaskQueue->hasStealableTasks())
     {
-        while(m_pTaskQueue->m_isRunning && runSingleTask() == SUCCESS) {}
+        // if the flag was already cleared a wakeup is pending, the next park returns right away then
+        InterlockedExchange(&m_isParked, 0);
+        return;
     }
-    while(m_pTaskQueue->m_isRunning && stealTasks() == SUCCESS);
+
+    m_numParks++;
+    uint64 start = m_pTaskQueue->m_timer.getTime();
+    m_hasWorkSemaphore.waitAndDecrement();
+    m_idleTicks += m_pTaskQueue->m_timer.getTime() - start;
+}
+
+gep::Result gep::TaskWorker::wakeUp()
+{
+    if(m_isParked == 0 || InterlockedCompareExchange(&m_isParked, 0, 1) != 1)
+        return FAILURE;
+    m_hasWorkSemaphore.increment();
+    return SUCCESS;
 }
 
 void gep::TaskWorker::run()
 {
     try {
+        FlsSetValue(m_pTaskQueue->m_currentWorkerFlsIndex, this);
+        if(m_coreIndex < sizeof(DWORD_PTR) * 8)
+            SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR)1 << m_coreIndex);
+
         while(m_pTaskQueue->m_isRunning)
         {
-            m_hasWorkSemaphore.waitAndDecrement();
+            park();
             if(!m_pTaskQueue->m_isRunning)
                 break;
             runTasks();
@@ -76,60 +267,140 @@ void gep::TaskWorker::run()
     }
 }
 
+gep::TaskWorkerStatistics gep::TaskWorker::getStatistics() const
+{
+    const double resolution = m_pTaskQueue->m_timer.getResolution();
+    TaskWorkerStatistics result;
+    result.numTasksExecuted = m_numTasksExecuted;
+    result.numTasksStolen = m_numTasksStolen;
+    result.numFailedSteals = m_numFailedSteals;
+    result.numParks = m_numParks;
+    result.busyTime = (float)(m_busyTicks * resolution);
+    result.spinTime = (float)(m_spinTicks * resolution);
+    result.idleTime = (float)(m_idleTicks * resolution);
+    return result;
+}
+
+gep::Result gep::TaskWorker::claimTasks()
+{
+    auto& readyGroups = m_pTaskQueue->m_readyGroups;
+    for(size_t i=0; i < GEP_ARRAY_SIZE(readyGroups); i++)
+    {
+        TaskGroup* pGroup = readyGroups[i];
+        if(pGroup != nullptr && claimTasks(pGroup) == SUCCESS)
+            return SUCCESS;
+    }
+    return FAILURE;
+}
+
+gep::Result gep::TaskWorker::claimTasks(TaskGroup* pGroup)
+{
+    if(pGroup->m_numTasksClaimed >= NO_TASKS_TO_CLAIM)
+        return FAILURE;
+
+    // the claim has to happen before the task array is touched, the group might already be finished
+    LONG numTasksToClaim = (LONG)(pGroup->m_numRemainingTasks / m_pTaskQueue->m_worker.length());
+    if(numTasksToClaim < 1)
+        numTasksToClaim = 1;
+    LONG start = InterlockedExchangeAdd(&pGroup->m_numTasksClaimed, numTasksToClaim);
+    LONG numTasks = (LONG)pGroup->m_scheduledTasks.length();
+    if(start >= numTasks)
+        return FAILURE;
+    LONG end = GEP_MIN(start + numTasksToClaim, numTasks);
+
+    // push in reverse order, so popping runs them in the order they were added
+    for(LONG i = end - 1; i >= start; i--)
+    {
+        m_tasks.push(&pGroup->m_scheduledTasks[i]);
+    }
+    return SUCCESS;
+}
+
+void gep::TaskWorker::executeTask(ScheduledTask* pTask)
+{
+    pTask->pTask->execute();
+    m_numTasksExecuted++;
+    pTask->pGroup->taskFinished();
+}
+
 gep::Result gep::TaskWorker::runSingleTask()
 {
-    ITask* pTaskToExecute = nullptr;
+    ScheduledTask* pTaskToExecute = m_tasks.pop();
+    if(pTaskToExecute == nullptr)
     {
-        // try to get a task from our internal task list
-        ScopedLock<Mutex> lock(m_tasksMutex);
-        if(m_tasks.length() == 0)
+        if(claimTasks() == FAILURE)
+            return FAILURE;
+        pTaskToExecute = m_tasks.pop();
+        if(pTaskToExecute == nullptr)
             return FAILURE;
-        pTaskToExecute = m_tasks.lastElement();
-        m_tasks.resize(m_tasks.length() - 1);
     }
 
-    pTaskToExecute->execute();
-    m_pActiveGroup->taskFinished();
+    executeTask(pTaskToExecute);
     return SUCCESS;
 }
 
-gep::Result gep::TaskWorker::stealTasks()
+gep::Result gep::TaskWorker::stealTask()
 {
-    // try to steal tasks from all other task workers but ourself
-    for(TaskWorker* pOtherWorker : m_pTaskQueue->m_worker)
+    auto& workers = m_pTaskQueue->m_worker;
+    const size_t numWorkers = workers.length();
+
+    // start at a random victim, so the thieves don't all fight over the same worker
+    m_randomState ^= m_randomState << 13;
+    m_randomState ^= m_randomState >> 17;
+    m_randomState ^= m_randomState << 5;
+    const size_t firstVictim = m_randomState % numWorkers;
+
+    for(size_t i=0; i < numWorkers; i++)
     {
-        if(pOtherWorker != this)
-        {
-            ScopedLock<Mutex> lock(pOtherWorker->m_tasksMutex);
-            if(pOtherWorker->m_tasks.length() > 0)
-            {
-                // steal half of the tasks, but at least 1
-                size_t tasksToSteal = pOtherWorker->m_tasks.length() / 2;
-                if(tasksToSteal < 1)
-                    tasksToSteal = 1;
-                auto otherTasks = pOtherWorker->m_tasks.toArray();
-                size_t otherNewLength = otherTasks.length() - tasksToSteal;
-                // Append a sub array to our task queue
-                m_tasks.append( otherTasks(otherNewLength, otherTasks.length()) );
-                // remove the stolen tasks from the other task queue
-                pOtherWorker->m_tasks.resize(otherNewLength);
-                return SUCCESS;
-            }
-        }
+        TaskWorker* pVictim = workers[(firstVictim + i) % numWorkers];
+        if(pVictim != this && stealTask(pVictim) == SUCCESS)
+            return SUCCESS;
+    }
+
+    // threads which are no worker push onto their own deques too
+    const size_t numOutsideWorkers = (size_t)m_pTaskQueue->m_numOutsideWorkers;
+    for(size_t i=0; i < numOutsideWorkers; i++)
+    {
+        TaskWorker* pVictim = m_pTaskQueue->m_outsideWorkers[i];
+        if(pVictim != this && stealTask(pVictim) == SUCCESS)
+            return SUCCESS;
     }
     return FAILURE;
 }
 
-gep::TaskQueue::TaskQueue()
+gep::Result gep::TaskWorker::stealTask(TaskWorker* pVictim)
+{
+    ScheduledTask* pStolenTask = pVictim->m_tasks.steal();
+    if(pStolenTask == nullptr)
+        return FAILURE;
+    m_numTasksStolen++;
+    executeTask(pStolenTask);
+    return SUCCESS;
+}
+
+gep::TaskQueue::TaskQueue(size_t numWorkers, bool pinWorkersToCores)
     : m_localWorker(this),
-    m_currentTaskGroup(nullptr),
+    m_isLocalWorkerUsed(0),
+    m_numOutsideWorkers(0),
     m_isRunning(true)
 {
+    for(size_t i=0; i < MAX_READY_GROUPS; i++)
+        m_readyGroups[i] = nullptr;
+    for(size_t i=0; i < MAX_OUTSIDE_WORKERS; i++)
+        m_outsideWorkers[i] = nullptr;
+    m_currentWorkerFlsIndex = FlsAlloc(&currentWorkerDestructor);
+    GEP_ASSERT(m_currentWorkerFlsIndex != FLS_OUT_OF_INDEXES, "out of fiber local storage indices");
     TaskWorker* localWorker = &m_localWorker;
     m_worker.append(localWorker);
-    for(size_t i=1; i < 8/*std::thread::hardware_concurrency()*/; i++)
+    size_t numCores = std::thread::hardware_concurrency();
+    if(numCores == 0)
+        numCores = 1;
+    if(numWorkers == 0)
+        numWorkers = numCores;
+    // the local worker runs on the thread calling runTasks, it is never pinned
+    for(size_t i=1; i < numWorkers; i++)
     {
-        TaskWorker* newWorker = new TaskWorker(this);
+        TaskWorker* newWorker = new TaskWorker(this, pinWorkersToCores ? i % numCores : (size_t)-1);
         newWorker->start();
         m_worker.append(newWorker);
     }
@@ -144,18 +415,33 @@ gep::TaskQueue::~TaskQueue()
         m_worker[i]->join();
         delete m_worker[i];
     }
+    // calls currentWorkerDestructor for every thread that still has a worker
+    FlsFree(m_currentWorkerFlsIndex);
+    // outside workers never run as a thread of their own
+    for(LONG i=0; i < m_numOutsideWorkers; i++)
+    {
+        delete m_outsideWorkers[i];
+    }
     for(auto group : m_unusedTaskGroups)
     {
         delete group;
     }
-    while(m_remainingTaskGroups.count() > 0)
+}
+
+void gep::TaskQueue::attachLocalWorker()
+{
+    GEP_ASSERT(FlsGetValue(m_currentWorkerFlsIndex) == nullptr, "the thread already has a worker");
+    if(InterlockedCompareExchange(&m_isLocalWorkerUsed, 1, 0) != 0)
     {
-        delete m_remainingTaskGroups.take();
+        GEP_ASSERT(false, "another thread uses the local worker");
+        return;
     }
+    FlsSetValue(m_currentWorkerFlsIndex, &m_localWorker);
 }
 
 gep::TaskGroup* gep::TaskQueue::createGroup()
 {
+    ScopedLock<Mutex> lock(m_schedulingMutex);
     TaskGroup* result = nullptr;
     if(m_unusedTaskGroups.length() > 0)
     {
@@ -170,70 +456,223 @@ gep::TaskGroup* gep::TaskQueue::createGroup()
 void gep::TaskQueue::deleteGroup(TaskGroup* pGroup)
 {
     if(pGroup != nullptr)
+    {
+        ScopedLock<Mutex> lock(m_schedulingMutex);
+        pGroup->reset();
         m_unusedTaskGroups.append(pGroup);
+    }
 }
 
 void gep::TaskQueue::scheduleForExecution(TaskGroup* pGroup)
 {
     GEP_ASSERT(pGroup->m_tasks.length() > 0, "there are no tasks in the group");
+    GEP_ASSERT(!pGroup->m_isExecuting, "the group is already scheduled");
     pGroup->m_isExecuting = true;
     pGroup->m_numRemainingTasks = (uint32)pGroup->m_tasks.length();
+    pGroup->m_scheduledTasks.resize(pGroup->m_tasks.length());
+    for(size_t i=0; i < pGroup->m_tasks.length(); i++)
+    {
+        pGroup->m_scheduledTasks[i].pTask = pGroup->m_tasks[i];
+        pGroup->m_scheduledTasks[i].pGroup = pGroup;
+    }
 
-    ScopedLock<Mutex> lock(m_schedulingMutex);
-    m_remainingTaskGroups.append(pGroup);
-    if(m_currentTaskGroup == nullptr)
+    // being scheduled counts as one dependency, so the group might become ready right away
+    pGroup->dependencyFinished();
+}
+
+void gep::TaskQueue::groupReady(TaskGroup* pGroup)
+{
+    size_t numWorkersToWake = pGroup->m_scheduledTasks.length();
+    InterlockedExchange(&pGroup->m_numTasksClaimed, 0);
     {
-        scheduleNextGroup();
+        ScopedLock<Mutex> lock(m_schedulingMutex);
+        size_t i = 0;
+        while(i < MAX_READY_GROUPS && m_readyGroups[i] != nullptr)
+            i++;
+        if(i < MAX_READY_GROUPS)
+            m_readyGroups[i] = pGroup;
+        else
+            m_waitingGroups.append(pGroup);
+    }
+
+    // wakeup sleeping workers but the first (the first is the local worker),
+    // there is no point in waking up more workers than there are tasks
+    for(size_t i=1; i < m_worker.length() && numWorkersToWake > 0; i++)
+    {
+        if(m_worker[i]->wakeUp() == SUCCESS)
+            numWorkersToWake--;
     }
 }
 
-void gep::TaskQueue::scheduleNextGroup()
+void gep::TaskQueue::groupFinished(TaskGroup* pGroup)
 {
     ScopedLock<Mutex> lock(m_schedulingMutex);
-    if(m_remainingTaskGroups.count() > 0)
-    {
-        m_currentTaskGroup = m_remainingTaskGroups.take();
-        size_t numTasks = m_currentTaskGroup->m_tasks.length();
-        size_t tasksPerWorker = numTasks / m_worker.length();
-        if(tasksPerWorker < 1)
-            tasksPerWorker = 1;
-        size_t taskStart = 0;
-        auto taskArray = m_currentTaskGroup->m_tasks.toArray();
-        // set the active task group on all workers
-        for(auto pWorker : m_worker)
+    for(size_t i=0; i < MAX_READY_GROUPS; i++)
+    {
+        if(m_readyGroups[i] == pGroup)
         {
-            pWorker->m_pActiveGroup = m_currentTaskGroup;
+            // give the slot to a group which is waiting for one
+            m_readyGroups[i] = (m_waitingGroups.count() > 0) ? m_waitingGroups.take() : nullptr;
+            return;
         }
-        // distribute the tasks to the workers
-        for(auto pWorker : m_worker)
+    }
+    GEP_ASSERT(false, "finished group was not ready");
+}
+
+void gep::TaskQueue::waitForGroup(TaskGroup* pGroup)
+{
+    TaskWorker* pWorker = getCurrentWorker();
+    while(pGroup->m_isExecuting && m_isRunning)
+    {
+        if(pWorker->runSingleTask() == FAILURE && pWorker->stealTask() == FAILURE)
+            YieldProcessor();
+    }
+}
+
+gep::TaskWorker* gep::TaskQueue::getCurrentWorker()
+{
+    TaskWorker* pWorker = static_cast<TaskWorker*>(FlsGetValue(m_currentWorkerFlsIndex));
+    if(pWorker == nullptr)
+    {
+        pWorker = addOutsideWorker();
+        FlsSetValue(m_currentWorkerFlsIndex, pWorker);
+    }
+    return pWorker;
+}
+
+gep::TaskWorker* gep::TaskQueue::addOutsideWorker()
+{
+    ScopedLock<Mutex> lock(m_schedulingMutex);
+    if(m_freeOutsideWorkers.length() > 0)
+    {
+        // the previous owner exited, tasks left in the deque are run by the new owner or stolen
+        TaskWorker* pFreeWorker = m_freeOutsideWorkers.lastElement();
+        m_freeOutsideWorkers.removeLastElement();
+        return pFreeWorker;
+    }
+    if((size_t)m_numOutsideWorkers >= MAX_OUTSIDE_WORKERS)
+    {
+        throw Exception("Too many threads which are no task worker call into the task queue at the same time");
+    }
+    TaskWorker* pWorker = new TaskWorker(this);
+    m_outsideWorkers[m_numOutsideWorkers] = pWorker;
+    // the worker has to be visible to the thieves before they can see the new count
+    InterlockedIncrement(&m_numOutsideWorkers);
+    return pWorker;
+}
+
+void __stdcall gep::TaskQueue::currentWorkerDestructor(void* pWorker)
+{
+    TaskWorker* pExitingWorker = static_cast<TaskWorker*>(pWorker);
+    TaskQueue* pTaskQueue = pExitingWorker->m_pTaskQueue;
+    if(pExitingWorker == &pTaskQueue->m_localWorker)
+    {
+        InterlockedExchange(&pTaskQueue->m_isLocalWorkerUsed, 0);
+        return;
+    }
+
+    // the worker threads of the queue exit with their own worker, those are not reused
+    ScopedLock<Mutex> lock(pTaskQueue->m_schedulingMutex);
+    for(LONG i=0; i < pTaskQueue->m_numOutsideWorkers; i++)
+    {
+        if(pTaskQueue->m_outsideWorkers[i] == pExitingWorker)
         {
-            if(taskStart >= numTasks)
-                break;
-            size_t end = taskStart + tasksPerWorker;
-            if(end > numTasks)
-                end = numTasks;
-            pWorker->addTasks( taskArray(taskStart, end) );
-            taskStart += tasksPerWorker;
+            pTaskQueue->m_freeOutsideWorkers.append(pExitingWorker);
+            return;
         }
+    }
+}
+
+void gep::TaskQueue::spawnTask(ScheduledTask* pTask)
+{
+    // the spawning task did not finish yet, so the group can not finish before this increment
+    InterlockedIncrement(&pTask->pGroup->m_numRemainingTasks);
+    getCurrentWorker()->m_tasks.push(pTask);
+    wakeUpWorker();
+}
+
+bool gep::TaskQueue::hasStealableTasks() const
+{
+    for(auto pWorker : m_worker)
+    {
+        if(pWorker->hasTasks())
+            return true;
+    }
+    const LONG numOutsideWorkers = m_numOutsideWorkers;
+    for(LONG i=0; i < numOutsideWorkers; i++)
+    {
+        if(m_outsideWorkers[i]->hasTasks())
+            return true;
+    }
+    return false;
+}
 
-        // wakeup all the workers but the first (the first is the local worker)
-        for(size_t i=1; i < m_worker.length(); i++)
-            m_worker[i]->m_hasWorkSemaphore.increment();
+void gep::TaskQueue::wakeUpWorker()
+{
+    for(size_t i=1; i < m_worker.length(); i++)
+    {
+        if(m_worker[i]->wakeUp() == SUCCESS)
+            return;
     }
-    else
+}
+
+size_t gep::TaskQueue::calculateChunkSize(size_t numElements, size_t grainSize) const
+{
+    // more chunks than workers so stealing can balance uneven work, but not so many that the overhead dominates
+    const size_t maxNumChunks = m_worker.length() * MAX_CHUNKS_PER_WORKER;
+    size_t chunkSize = (numElements + maxNumChunks - 1) / maxNumChunks;
+    return GEP_MAX(GEP_MAX(chunkSize, grainSize), (size_t)1);
+}
+
+void gep::TaskQueue::runParallelFor(size_t begin, size_t end, size_t chunkSize, ParallelForFunction pFunction, void* pContext)
+{
+    GEP_ASSERT(chunkSize > 0, "chunk size has to be at least 1");
+    if(end <= begin)
+        return;
+    const size_t numChunks = (end - begin + chunkSize - 1) / chunkSize;
+    if(numChunks == 1)
     {
-        m_currentTaskGroup = nullptr;
+        pFunction(pContext, 0, begin, end);
+        return;
     }
+
+    // one node per chunk is enough, every split creates one node and ends up with one chunk
+    ArrayPtr<ParallelForNode> nodes = GEP_NEW_ARRAY(g_stdAllocator, ParallelForNode, numChunks);
+    ParallelForNode::Loop loop;
+    loop.pTaskQueue = this;
+    loop.pFunction = pFunction;
+    loop.pContext = pContext;
+    loop.begin = begin;
+    loop.end = end;
+    loop.chunkSize = chunkSize;
+    loop.pNodes = nodes.getPtr();
+    loop.numNodesUsed = 1;
+    loop.pGroup = createGroup();
+
+    nodes[0].pLoop = &loop;
+    nodes[0].firstChunk = 0;
+    nodes[0].endChunk = numChunks;
+    loop.pGroup->addTask(&nodes[0]);
+    scheduleForExecution(loop.pGroup);
+    waitForGroup(loop.pGroup);
+
+    deleteGroup(loop.pGroup);
+    GEP_DELETE_ARRAY(g_stdAllocator, nodes);
 }
 
 gep::Result gep::TaskQueue::runSingleTask()
 {
-    return m_localWorker.runSingleTask();
+    return getCurrentWorker()->runSingleTask();
 }
 
 void gep::TaskQueue::runTasks()
 {
-    m_localWorker.runTasks();
+    getCurrentWorker()->runTasks();
+}
+
+gep::TaskWorkerStatistics gep::TaskQueue::getWorkerStatistics(size_t workerIndex) const
+{
+    return m_worker[workerIndex]->getStatistics();
 }
 
 void gep::TaskQueue::stop()
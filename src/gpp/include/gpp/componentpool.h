@@ -0,0 +1,224 @@
+#pragma once
+
+#include "gep/container/DynamicArray.h"
+#include "gep/threading/parallelFor.h"
+#include <intrin.h>
+#include <type_traits>
+
+namespace gpp
+{
+    /// \brief type independent interface of a ComponentPool
+    class IComponentPool
+    {
+    public:
+        virtual ~IComponentPool() {}
+
+        /// \brief calls update on every component whose update is enabled
+        virtual void updateComponents(float elapsedMs) = 0;
+
+        /// \brief returns the number of blocks the components are stored in
+        virtual size_t getNumBlocks() const = 0;
+
+        /// \brief calls update on the components in the blocks [begin, end) whose update is enabled
+        ///
+        /// Different block ranges can be updated on different threads at the same time,
+        /// as long as T::update is thread safe and no components are created or destroyed meanwhile.
+        virtual void updateBlocks(size_t begin, size_t end, float elapsedMs) = 0;
+
+        /// \brief destructs the component in the given slot and frees the slot
+        virtual void destroyComponent(gep::uint32 slot) = 0;
+
+        /// \brief enables or disables the update of the component in the given slot
+        virtual void setUpdateEnabled(gep::uint32 slot, bool enabled) = 0;
+
+        /// \brief returns the number of alive components
+        virtual size_t count() const = 0;
+    };
+
+    /// \brief stores all components of the type T
+    ///
+    /// Components are stored in blocks of COMPONENTS_PER_BLOCK components, so their addresses
+    /// never change (game objects and Lua keep pointers to them) while they are still packed together.
+    /// Freed slots are reused, new components are placed into the first block that has a free slot.
+    /// updateComponents walks the blocks in memory order and calls T::update without virtual dispatch.
+    template <class T>
+    class ComponentPool : public IComponentPool
+    {
+    public:
+        static const gep::uint32 COMPONENTS_PER_BLOCK = 32;
+
+    private:
+        struct Block
+        {
+            typename std::aligned_storage<sizeof(T), std::alignment_of<T>::value>::type components[COMPONENTS_PER_BLOCK];
+            // one bit per slot
+            gep::uint32 usedMask;
+            gep::uint32 updateMask;
+
+            inline T* get(gep::uint32 index) { return reinterpret_cast<T*>(&components[index]); }
+        };
+
+        gep::DynamicArray<Block*> m_blocks;
+        // all blocks before this one are full
+        size_t m_firstFreeBlock;
+        size_t m_count;
+
+        GEP_DISALLOW_COPY_AND_ASSIGNMENT(ComponentPool);
+
+        inline Block* getBlock(gep::uint32 slot, gep::uint32& outIndex)
+        {
+            GEP_ASSERT(slot / COMPONENTS_PER_BLOCK < m_blocks.length(), "invalid slot", slot);
+            outIndex = slot % COMPONENTS_PER_BLOCK;
+            Block* pBlock = m_blocks[slot / COMPONENTS_PER_BLOCK];
+            GEP_ASSERT((pBlock->usedMask & (1u << outIndex)) != 0, "slot is not in use", slot);
+            return pBlock;
+        }
+
+    public:
+        ComponentPool() :
+            m_firstFreeBlock(0),
+            m_count(0)
+        {
+        }
+
+        virtual ~ComponentPool()
+        {
+            GEP_ASSERT(m_count == 0, "components have not been destroyed", m_count);
+            for(auto pBlock : m_blocks)
+            {
+                unsigned long mask = pBlock->usedMask;
+                unsigned long index;
+                while(_BitScanForward(&index, mask))
+                {
+                    mask &= mask - 1;
+                    pBlock->get(index)->~T();
+                }
+                GEP_DELETE(g_stdAllocator, pBlock);
+            }
+        }
+
+        /// \brief default constructs a new component, its update is disabled
+        T* createComponent(gep::uint32& outSlot)
+        {
+            while(m_firstFreeBlock < m_blocks.length() && m_blocks[m_firstFreeBlock]->usedMask == 0xFFFFFFFF)
+                m_firstFreeBlock++;
+
+            if(m_firstFreeBlock == m_blocks.length())
+            {
+                Block* pNewBlock = GEP_NEW(g_stdAllocator, Block);
+                pNewBlock->usedMask = 0;
+                pNewBlock->updateMask = 0;
+                m_blocks.append(pNewBlock);
+            }
+
+            Block* pBlock = m_blocks[m_firstFreeBlock];
+            unsigned long index;
+            _BitScanForward(&index, ~pBlock->usedMask);
+            T* pComponent = new (pBlock->get(index)) T();
+            pBlock->usedMask |= 1u << index;
+            m_count++;
+            outSlot = (gep::uint32)(m_firstFreeBlock * COMPONENTS_PER_BLOCK + index);
+            return pComponent;
+        }
+
+        virtual void destroyComponent(gep::uint32 slot) override
+        {
+            gep::uint32 index;
+            Block* pBlock = getBlock(slot, index);
+            pBlock->get(index)->~T();
+            pBlock->usedMask &= ~(1u << index);
+            pBlock->updateMask &= ~(1u << index);
+            m_count--;
+            m_firstFreeBlock = GEP_MIN(m_firstFreeBlock, slot / COMPONENTS_PER_BLOCK);
+        }
+
+        virtual void setUpdateEnabled(gep::uint32 slot, bool enabled) override
+        {
+            gep::uint32 index;
+            Block* pBlock = getBlock(slot, index);
+            if(enabled)
+                pBlock->updateMask |= 1u << index;
+            else
+                pBlock->updateMask &= ~(1u << index);
+        }
+
+        virtual void updateComponents(float elapsedMs) override
+        {
+            // components might create new components while updating, which can add blocks
+            for(size_t i = 0; i < m_blocks.length(); i++)
+            {
+                updateBlocks(i, i + 1, elapsedMs);
+            }
+        }
+
+        virtual size_t getNumBlocks() const override
+        {
+            return m_blocks.length();
+        }
+
+        virtual void updateBlocks(size_t begin, size_t end, float elapsedMs) override
+        {
+            GEP_ASSERT(begin <= end && end <= m_blocks.length(), "invalid block range", begin, end);
+            for(size_t i = begin; i < end; i++)
+            {
+                Block* pBlock = m_blocks[i];
+                unsigned long mask = pBlock->updateMask;
+                unsigned long index;
+                while(_BitScanForward(&index, mask))
+                {
+                    mask &= mask - 1;
+                    pBlock->get(index)->T::update(elapsedMs);
+                }
+            }
+        }
+
+        virtual size_t count() const override
+        {
+            return m_count;
+        }
+
+        /// \brief returns the component in the given slot
+        inline T* getComponent(gep::uint32 slot)
+        {
+            gep::uint32 index;
+            return getBlock(slot, index)->get(index);
+        }
+    };
+
+    /// \brief the pool GameObjectManager creates for the components of type T
+    ///
+    /// Specialize it next to ComponentMetaInfo to store or update a component type differently.
+    /// The pool has to derive from ComponentPool<T>.
+    template <class T>
+    struct ComponentPoolType
+    {
+        typedef ComponentPool<T> Type;
+    };
+
+    /// \brief updates all given pools at the same time on the task queue
+    ///
+    /// The blocks of all pools are split into tasks of blocksPerTask blocks.
+    /// Returns when all components are updated, the calling thread helps updating them.
+    inline void updateComponentPoolsInParallel(gep::TaskQueue& taskQueue, gep::ArrayPtr<IComponentPool*> pools, float elapsedMs, size_t blocksPerTask = 4)
+    {
+        size_t numBlocks = 0;
+        for(auto pPool : pools)
+        {
+            numBlocks += pPool->getNumBlocks();
+        }
+
+        gep::parallelForRange(taskQueue, 0, numBlocks, blocksPerTask, [&](size_t begin, size_t end){
+            // map the range of all blocks back to the pools it overlaps with
+            size_t poolBegin = 0;
+            for(auto pPool : pools)
+            {
+                const size_t poolEnd = poolBegin + pPool->getNumBlocks();
+                if(begin < poolEnd && end > poolBegin)
+                {
+                    pPool->updateBlocks(GEP_MAX(begin, poolBegin) - poolBegin, GEP_MIN(end, poolEnd) - poolBegin, elapsedMs);
+                }
+                poolBegin = poolEnd;
+            }
+        });
+    }
+}
@@ -19,5 +19,7 @@ namespace gpp
 
         virtual void registerSink(gep::ILogSink* pSink) override {}
         virtual void deregisterSink(gep::ILogSink* pSink) override {}
+
+        virtual void flush() override {}
     };
 }
@@ -95,8 +95,11 @@ namespace gpp
     struct ComponentMetaInfo<AnimationComponent>
     {
         static const char* name(){ return "AnimationComponent"; }
+        static gep::StringHash nameHash() { return "AnimationComponent"; }
         static const gep::int32 initializationPriority() { return 23; }
         static const gep::int32 updatePriority() { return 1; }
+        // samples with Havok, which is not initialized on the task workers, and writes into the render component
+        static const bool isUpdateThreadSafe() { return false; }
     };
 
 }
@@ -41,8 +41,10 @@ namespace gpp
     struct ComponentMetaInfo<AudioComponent>
     {
         static const char* name(){ return "AudioCComponent"; }
+        static gep::StringHash nameHash() { return "AudioCComponent"; }
         static const gep::int32 initializationPriority() { return 65; }
         static const gep::int32 updatePriority() { return 42; }
+        static const bool isUpdateThreadSafe() { return false; }
     };
 
     class SoundInstanceWrapper
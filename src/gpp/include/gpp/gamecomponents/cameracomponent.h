@@ -89,6 +89,7 @@ namespace gpp
         virtual       gep::ITransform* getParent()       override;
         virtual const gep::ITransform* getParent() const override;
         virtual void setParent(gep::ITransform* parent) override;
+        virtual gep::uint64 getWorldChangeStamp() const override;
 
         void setViewTarget(gep::ITransform* view);
         void setUpTarget(gep::ITransform* view);
@@ -156,7 +157,9 @@ namespace gpp
     struct ComponentMetaInfo<CameraComponent>
     {
         static const char* name(){ return "CameraComponent"; }
+        static gep::StringHash nameHash() { return "CameraComponent"; }
         static const gep::int32 initializationPriority() { return 0; }
         static const gep::int32 updatePriority() { return 23; }
+        static const bool isUpdateThreadSafe() { return false; }
     };
 }
@@ -46,8 +46,10 @@ namespace gpp
     struct ComponentMetaInfo<CharacterComponent>
     {
         static const char* name() { return "CharacterComponent"; }
+        static gep::StringHash nameHash() { return "CharacterComponent"; }
         static const gep::int32 initializationPriority() { return 0; }
         static const gep::int32 updatePriority() { return 20; }
+        static const bool isUpdateThreadSafe() { return false; }
     };
 
 }
@@ -20,6 +20,8 @@ namespace gpp
         virtual void initalize() override;
         virtual void update(float elapsedMS) override;
         virtual void destroy() override;
+        /// \brief stops the rigid body, it keeps its shape and settings
+        virtual void recycle() override;
 
         virtual void setPosition(const gep::vec3& pos) override;
         virtual void setRotation(const gep::Quaternion& rot) override;
@@ -66,6 +68,7 @@ namespace gpp
         virtual       gep::ITransform* getParent()       override;
         virtual const gep::ITransform* getParent() const override;
         virtual void setParent(gep::ITransform* parent) override;
+        virtual gep::uint64 getWorldChangeStamp() const override;
 
     protected:
         gep::Quaternion m_baseOrientation;
@@ -85,8 +88,11 @@ namespace gpp
     struct ComponentMetaInfo<PhysicsComponent>
     {
         static const char* name(){ return "PhysicsComponent"; }
+        static gep::StringHash nameHash() { return "PhysicsComponent"; }
         static const gep::int32 initializationPriority() { return 0; }
         static const gep::int32 updatePriority() { return 7; }
+        // calls Havok, which is not initialized on the task workers, and holds the world lock anyway
+        static const bool isUpdateThreadSafe() { return false; }
     };
 
 }
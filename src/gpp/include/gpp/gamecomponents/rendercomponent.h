@@ -67,7 +67,9 @@ namespace gpp
     struct ComponentMetaInfo<RenderComponent>
     {
         static const char* name(){ return "RenderComponent"; }
+        static gep::StringHash nameHash() { return "RenderComponent"; }
         static const gep::int32 initializationPriority() { return -10; }
         static const gep::int32 updatePriority() { return std::numeric_limits<gep::int32>::max(); }
+        static const bool isUpdateThreadSafe() { return false; }
     };
 }
@@ -1,9 +1,15 @@
 #pragma once
 
 #include "gpp/gameObjectSystem.h"
+#include "gpp/scriptUpdateBatch.h"
 
 namespace gpp
 {
+    /// \brief calls Lua functions when its game object is initialized, updated and destroyed
+    ///
+    /// The update functions are not called by the components themselves. Every frame the components queue
+    /// their game objects in the batch of their update function and ScriptComponentPool calls each batch once,
+    /// see ScriptUpdateBatch. All objects of a batch are collected before its function is called.
     class ScriptComponent : public Component
     {
     public:
@@ -16,12 +22,18 @@ namespace gpp
 
         void setInitializationFunction(gep::ScriptFunctionWrapper funcRef);
         void setDestroyFunction(gep::ScriptFunctionWrapper funcRef);
+        /// \brief the function is called with (guid, elapsedTime) for every game object that uses it
         void setUpdateFunction(gep::ScriptFunctionWrapper funcRef);
+        /// \brief the function is called once with (gameObjects, numGameObjects, elapsedTime) for all game objects that use it
+        ///
+        /// gameObjects is an array of the game objects, it is reused every frame and must not be changed.
+        void setBatchUpdateFunction(gep::ScriptFunctionWrapper funcRef);
 
         LUA_BIND_REFERENCE_TYPE_BEGIN
             LUA_BIND_FUNCTION(setInitializationFunction)
             LUA_BIND_FUNCTION(setDestroyFunction)
             LUA_BIND_FUNCTION(setUpdateFunction)
+            LUA_BIND_FUNCTION(setBatchUpdateFunction)
             LUA_BIND_FUNCTION(setState)
         LUA_BIND_REFERENCE_TYPE_END
 
@@ -29,14 +41,55 @@ namespace gpp
 
         gep::ScriptFunctionWrapper m_funcRef_initialize;
         gep::ScriptFunctionWrapper m_funcRef_destroy;
-        gep::ScriptFunctionWrapper m_funcRef_update;
+        /// batch of the update function, null if there is none
+        ScriptUpdateBatch* m_pUpdateBatch;
+
+        void setUpdateBatch(gep::ScriptFunctionWrapper& funcRef, ScriptUpdateBatch::CallMode::Enum callMode);
+    };
+
+    /// \brief stores the script components and calls their update functions in batches
+    ///
+    /// There is one batch per update function and call mode, the batches are called in the order they were created.
+    class ScriptComponentPool : public ComponentPool<ScriptComponent>
+    {
+    public:
+        ScriptComponentPool();
+        virtual ~ScriptComponentPool();
+
+        /// \brief queues the active components in their batches, then calls every batch
+        virtual void updateComponents(float elapsedMs) override;
+
+        /// \brief returns the batch of the given update function, creates it on first use
+        ScriptUpdateBatch* getUpdateBatch(gep::ScriptFunctionWrapper& funcRef, ScriptUpdateBatch::CallMode::Enum callMode);
+
+    private:
+        typedef gep::Hashmap<const void*, ScriptUpdateBatch*, gep::PointerHashPolicy> BatchMap;
+
+        gep::DynamicArray<ScriptUpdateBatch*> m_updateBatches;
+        BatchMap m_perObjectBatches;
+        BatchMap m_forAllBatches;
+
+        inline BatchMap& getBatchMap(ScriptUpdateBatch::CallMode::Enum callMode)
+        {
+            return callMode == ScriptUpdateBatch::CallMode::OncePerObject ? m_perObjectBatches : m_forAllBatches;
+        }
+
+        void removeUnusedBatches();
+    };
+
+    template<>
+    struct ComponentPoolType<ScriptComponent>
+    {
+        typedef ScriptComponentPool Type;
     };
 
     template<>
     struct ComponentMetaInfo<ScriptComponent>
     {
         static const char* name(){ return "ScriptComponent"; }
+        static gep::StringHash nameHash() { return "ScriptComponent"; }
         static const gep::int32 initializationPriority() { return 0; }
         static const gep::int32 updatePriority() { return 42; }
+        static const bool isUpdateThreadSafe() { return false; }
     };
 }
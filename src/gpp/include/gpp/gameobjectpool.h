@@ -0,0 +1,64 @@
+#pragma once
+
+#include "gpp/gameObjectSystem.h"
+#include "gpp/objectPool.h"
+
+namespace gpp
+{
+    /// \brief game objects with the same components that are reused instead of created and destroyed
+    ///
+    /// The game objects of a pool are created by calling the Lua create function of the pool with a new,
+    /// empty game object, which adds and sets up the components, like every game object of the pool needs them.
+    /// A free game object is kept with all its components and their resources (models, rigid bodies, ...),
+    /// its components are inactive and not updated, and its handle is stale, see GameObject::getHandle.
+    /// acquire and release are O(1) and allocate nothing as long as the pool has a free game object.
+    /// Lua values stored in a game object stay with it, so the Lua side of a pooled object can live there too.
+    /// Create pools with GameObjectManager::createGameObjectPool.
+    class GameObjectPool
+    {
+        friend class GameObjectManager;
+    public:
+        inline const std::string& getName() const { return m_name; }
+
+        /// \brief creates game objects until the pool has the given number of them
+        void prewarm(gep::uint32 numGameObjects);
+
+        /// \brief returns a free game object, its components are in the state they had before the release and it has a new handle
+        ///
+        /// Creates a new game object if none is free, which is slow and logs a warning, prewarm the pool instead.
+        /// The game object keeps the position it had when it was released.
+        /// Game objects acquired before the initialization are initialized together with all other game objects.
+        GameObject* acquire();
+
+        /// \brief puts the game object back into the pool
+        ///
+        /// Its components are deactivated and recycled, see IComponent::recycle, and its handle becomes stale.
+        void release(GameObject* pGameObject);
+
+        inline gep::uint32 getNumGameObjects() const { return gep::uint32(m_gameObjects.getNumObjects()); }
+        inline gep::uint32 getNumFree() const { return gep::uint32(m_gameObjects.getNumFree()); }
+
+        LUA_BIND_REFERENCE_TYPE_BEGIN
+            LUA_BIND_FUNCTION(acquire)
+            LUA_BIND_FUNCTION(release)
+            LUA_BIND_FUNCTION(prewarm)
+            LUA_BIND_FUNCTION(getNumGameObjects)
+            LUA_BIND_FUNCTION(getNumFree)
+            LUA_BIND_FUNCTION_NAMED(getNameCopy, "getName")
+        LUA_BIND_REFERENCE_TYPE_END;
+
+    private:
+        std::string m_name;
+        gep::ScriptFunctionWrapper m_createFunction;
+        ObjectPool<GameObject> m_gameObjects;
+
+        GameObjectPool(const std::string& name, gep::ScriptFunctionWrapper createFunction);
+        ~GameObjectPool();
+
+        inline std::string getNameCopy() { return m_name; }
+
+        void createGameObject();
+
+        GEP_DISALLOW_COPY_AND_ASSIGNMENT(GameObjectPool);
+    };
+}
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "gep/math3d/transform.h"
+#include "gep/math3d/transformStore.h"
 
 #include "gep/singleton.h"
 #include "gep/utils.h"
@@ -15,14 +16,22 @@
 #include "gep/memory/allocators.h"
 
 #include "gep/math3d/transform.h"
+#include "gpp/componentPool.h"
+#include "gpp/handleTable.h"
 
 namespace gpp
 {
     class GameObject;
+    class GameObjectPool;
+    typedef Handle<GameObject> GameObjectHandle;
+
+    template<typename T>
+    struct ComponentMetaInfo;
 
     class GameObjectManager: public gep::DoubleLockingSingleton<GameObjectManager>
     {
         friend class gep::DoubleLockingSingleton<GameObjectManager>;
+        friend class GameObjectPool;
     public:
 
         struct State
@@ -43,6 +52,19 @@ namespace gpp
         void destroyGameObject(GameObject* pGameObject);
         GameObject* getGameObject(const std::string& guid);
 
+        /// \brief creates a pool of game objects that are reused, see GameObjectPool
+        ///
+        /// createFunction is called with every new game object of the pool and adds its components.
+        /// The game objects are named after the pool, their guids are "<name>-<index>".
+        /// Unlike game objects, pools can also be created after the initialization.
+        GameObjectPool* createGameObjectPool(const std::string& name, gep::uint32 numGameObjects, gep::ScriptFunctionWrapper createFunction);
+        /// \brief returns the pool of the given name or nullptr if there is none
+        GameObjectPool* getGameObjectPool(const std::string& name);
+
+        /// \brief returns the game object of the handle or nullptr if it has been destroyed
+        inline GameObject* getGameObjectByHandle(GameObjectHandle handle) { return m_gameObjectHandles.get(handle); }
+        inline bool isAlive(GameObjectHandle handle) const { return m_gameObjectHandles.isAlive(handle); }
+
         GameObject* getCurrentCameraObject(){return m_pCurrentCameraObject;}
         void setCurrentCameraObject(GameObject* object) {m_pCurrentCameraObject = object;}
 
@@ -54,22 +76,60 @@ namespace gpp
 
         inline gep::StackAllocator* getTempAllocator() { return &m_tempAllocator; }
 
+        /// \brief returns the store of the default transforms of all game objects, it is updated at the end of every frame
+        inline gep::TransformStore& getTransformStore() { return m_transformStore; }
+
+        /// \brief returns the pool all components of type T live in, creates it on first use
+        template<typename T>
+        ComponentPool<T>& getComponentPool()
+        {
+            IComponentPool* pPool = nullptr;
+            const gep::StringHash typeName = ComponentMetaInfo<T>::nameHash();
+            if(m_componentPools.tryGet(typeName, pPool) == gep::FAILURE)
+            {
+                pPool = new typename ComponentPoolType<T>::Type();
+                m_componentPools[typeName] = pPool;
+                addComponentPool(pPool, ComponentMetaInfo<T>::updatePriority(), ComponentMetaInfo<T>::isUpdateThreadSafe());
+            }
+            return *static_cast<ComponentPool<T>*>(pPool);
+        }
+
         LUA_BIND_REFERENCE_TYPE_BEGIN
             LUA_BIND_FUNCTION(createGameObject)
             LUA_BIND_FUNCTION(createGameObjectUninitialized)
             LUA_BIND_FUNCTION(destroyGameObject)
             LUA_BIND_FUNCTION(getGameObject)
+            LUA_BIND_FUNCTION(createGameObjectPool)
+            LUA_BIND_FUNCTION(getGameObjectPool)
+            LUA_BIND_FUNCTION_NAMED(getGameObjectByHandleValue, "getGameObjectByHandle")
+            LUA_BIND_FUNCTION_NAMED(isAliveHandleValue, "isAlive")
         LUA_BIND_REFERENCE_TYPE_END;
 
     protected:
         GameObjectManager();
         virtual ~GameObjectManager();
     private:
+        struct ComponentPoolEntry
+        {
+            gep::int32 updatePriority;
+            bool updateInParallel;
+            IComponentPool* pPool;
+        };
+
+        HandleTable<GameObject> m_gameObjectHandles;
+        /// secondary index to look up game objects by their guid
         gep::Hashmap<std::string, GameObject*, gep::StringHashPolicy> m_gameObjects;
         gep::DynamicArray<GameObject*> m_garbage;
+        gep::Hashmap<std::string, GameObjectPool*, gep::StringHashPolicy> m_gameObjectPools;
+        gep::Hashmap<gep::StringHash, IComponentPool*, gep::StringHashPolicy> m_componentPools;
+        /// pools of all component types that are updated, sorted by their update priority
+        gep::DynamicArray<ComponentPoolEntry> m_updatedComponentPools;
+        /// pools of the current update priority that are updated in parallel
+        gep::DynamicArray<IComponentPool*> m_parallelComponentPools;
         State::Enum m_state;
         gep::StackAllocator m_tempAllocator;
         GameObject* m_pCurrentCameraObject;
+        gep::TransformStore m_transformStore;
 
         GameObject* createGameObjectUninitialized(const std::string& guid)
         {
@@ -78,7 +138,12 @@ namespace gpp
             return doCreateGameObject(guid);
         }
 
+        // Lua only has numbers, the handles are passed as their value
+        GameObject* getGameObjectByHandleValue(gep::uint32 handle) { return getGameObjectByHandle(GameObjectHandle::fromValue(handle)); }
+        bool isAliveHandleValue(gep::uint32 handle) { return isAlive(GameObjectHandle::fromValue(handle)); }
+
         GameObject* doCreateGameObject(const std::string& guid);
+        void addComponentPool(IComponentPool* pPool, gep::int32 updatePriority, bool updateInParallel);
     };
 
     class IComponent
@@ -104,6 +169,12 @@ namespace gpp
         virtual void update(float elapsedMS) = 0;
         virtual void destroy() = 0;
 
+        /// \brief called when the game object is released to its GameObjectPool, after the component was deactivated
+        ///
+        /// Resets what was changed while the game object was in use, so the next user gets it like it was created.
+        /// Resources are kept, they are what the pool saves.
+        virtual void recycle() = 0;
+
         virtual void setState(State::Enum state) = 0;
         virtual State::Enum getState() const = 0;
 
@@ -122,6 +193,8 @@ namespace gpp
         Component() : m_pParentGameObject(nullptr), m_state(State::Initial) {}
         virtual ~Component() {}
 
+        virtual void recycle() override {}
+
         virtual       GameObject* getParentGameObject()       override { return m_pParentGameObject; }
         virtual const GameObject* getParentGameObject() const override { return m_pParentGameObject; }
 
@@ -140,16 +213,26 @@ namespace gpp
     class GameObject : public gep::ITransform
     {
         friend class GameObjectManager;
+        friend class GameObjectPool;
         struct ComponentWrapper
         {
             int initializationPriority;
             int updatePriority;
             IComponent* component;
+            gep::StringHash typeName;
+            IComponentPool* pPool;
+            gep::uint32 poolSlot;
+            /// state of the component right after its game object was initialized, pooled game objects get it back when they are acquired
+            IComponent::State::Enum initialState;
 
             ComponentWrapper() :
                 initializationPriority(-1),
                 updatePriority(-1),
-                component(nullptr)
+                component(nullptr),
+                typeName(""),
+                pPool(nullptr),
+                poolSlot(0),
+                initialState(IComponent::State::Initial)
             {
             }
         };
@@ -158,7 +241,6 @@ namespace gpp
         GameObject();
         ~GameObject();
 
-        void update(float elapsedMs);
         void initialize();
         void destroy();
 
@@ -166,12 +248,14 @@ namespace gpp
         T* createComponent()
         {
             GEP_ASSERT(!m_isInitialized, "Cannot create a new component on an initialized game object.");
-            auto pInstance = new T();
-            if(addComponent(pInstance))
+            auto& pool = GameObjectManager::instance().getComponentPool<T>();
+            gep::uint32 slot = 0;
+            auto pInstance = pool.createComponent(slot);
+            if(addComponent(pInstance, pool, slot))
             {
                 return pInstance;
             }
-            gep::deleteAndNull(pInstance);
+            pool.destroyComponent(slot);
             GEP_ASSERT(false, "Failed to add component. Check the log for more information.");
             return nullptr;
         }
@@ -179,12 +263,15 @@ namespace gpp
         template<typename T>
         T* getComponent()
         {
-            T* pComponent = nullptr;
-            auto name = ComponentMetaInfo<T>::name();
-            m_components.ifExists(name, [&](const ComponentWrapper& wrapper){
-                pComponent = static_cast<T*>(wrapper.component);
-            });
-            return pComponent;
+            const gep::StringHash typeName = ComponentMetaInfo<T>::nameHash();
+            for(auto& wrapper : m_components)
+            {
+                if(wrapper.typeName == typeName)
+                {
+                    return static_cast<T*>(wrapper.component);
+                }
+            }
+            return nullptr;
         }
 
         virtual void setPosition(const gep::vec3& pos) override;
@@ -207,14 +294,23 @@ namespace gpp
         void setComponentStates(IComponent::State::Enum value);
 
         inline const std::string& getGuid() const { return m_guid; }
+        /// \brief handle that stays safe to use after this game object has been destroyed
+        ///
+        /// Game objects of a GameObjectPool get a new handle whenever they are acquired,
+        /// the handle of a released game object is stale like the one of a destroyed game object.
+        inline GameObjectHandle getHandle() const { return m_handle; }
 
         inline       gep::ITransform& getTransform()       { return *m_transform; }
         inline const gep::ITransform& getTransform() const { return *m_transform; }
-        inline void setTransform(gep::ITransform& transform) { m_transform = &transform; }
+        /// \brief lets the game object use another transform, children of its default transform follow it
+        void setTransform(gep::ITransform& transform);
 
         virtual       gep::ITransform* getParent()       override;
         virtual const gep::ITransform* getParent() const override;
+        /// \brief sets the parent, if both game objects use their default transform the parent's one is used directly,
+        /// so the child is part of the batched update of the TransformStore
         virtual void setParent(gep::ITransform* parent) override;
+        virtual gep::uint64 getWorldChangeStamp() const override;
 
         LUA_BIND_REFERENCE_TYPE_BEGIN
             LUA_BIND_FUNCTION_NAMED(createComponent<CameraComponent>, "createCameraComponent")
@@ -245,17 +341,25 @@ namespace gpp
             LUA_BIND_FUNCTION(setBaseOrientation)
             LUA_BIND_FUNCTION(setBaseViewDirection)
             LUA_BIND_FUNCTION_NAMED(getGuidCopy, "getGuid")
+            LUA_BIND_FUNCTION_NAMED(getHandleValue, "getHandle")
             LUA_BIND_FUNCTION(setParent)
         LUA_BIND_REFERENCE_TYPE_END;
 
     private:
         std::string m_guid;
+        GameObjectHandle m_handle;
         bool m_isInitialized; ///< Used for checks/asserts.
         bool m_isActive;
-        gep::Transform m_defaultTransform;
+        /// the pool this game object was created by, or nullptr
+        GameObjectPool* m_pPool;
+        /// whether this game object is free in its pool
+        bool m_isInPool;
+        gep::StoredTransform m_defaultTransform;
         gep::ITransform* m_transform;
-        gep::Hashmap<const char*, ComponentWrapper> m_components;
-        gep::DynamicArray<ComponentWrapper> m_updateQueue;
+        /// stamp of the last setTransform
+        gep::uint64 m_transformChangeStamp;
+        /// a game object only has a few components, searching them is faster than a hash map lookup
+        gep::DynamicArray<ComponentWrapper> m_components;
 
         void initializeManually()
         {
@@ -265,10 +369,17 @@ namespace gpp
             initialize();
         }
 
+        /// \brief deactivates the components and stops their updates, for game objects that go back to their pool
+        void recycleComponents();
+        /// \brief gives the components back the states they had right after initialization and starts their updates,
+        /// for game objects taken from their pool
+        void reactivateComponents();
+
         inline std::string getGuidCopy() { return getGuid(); }
+        inline gep::uint32 getHandleValue() { return m_handle.getValue(); }
 
         template<typename T>
-        bool addComponent(T* specializedComponent)
+        bool addComponent(T* specializedComponent, IComponentPool& pool, gep::uint32 poolSlot)
         {
             //check weather T is really an ICompontent
             auto component = static_cast<IComponent*>(specializedComponent);
@@ -276,34 +387,20 @@ namespace gpp
             wrapper.initializationPriority = ComponentMetaInfo<T>::initializationPriority();
             wrapper.updatePriority = ComponentMetaInfo<T>::updatePriority();
             wrapper.component = component;
+            wrapper.typeName = ComponentMetaInfo<T>::nameHash();
+            wrapper.pPool = &pool;
+            wrapper.poolSlot = poolSlot;
 
             const char* const typeName = ComponentMetaInfo<T>::name();
-            if(m_components[typeName].component != nullptr)
+            GEP_ASSERT(strcmp(wrapper.typeName.c_str(), typeName) == 0, "ComponentMetaInfo name and nameHash do not match", typeName);
+            if(getComponent<T>() != nullptr)
             {
                 GEP_ASSERT(false, "A component of the same type has already been added to this gameObject", typeName, m_guid);
                 g_globalManager.getLogging()->logError("The component %s has already been added to gameObject %s", typeName, m_guid);
                 return false;
             }
             component->setParentGameObject(this);
-            m_components[typeName] = wrapper;
-
-            if (wrapper.updatePriority == std::numeric_limits<gep::int32>::max())
-            {
-                // Component needs no update
-                return true;
-            }
-            //insert into update Queue
-            size_t index = 0;
-
-            for (auto entry : m_updateQueue)
-            {
-                if(entry.updatePriority > wrapper.updatePriority)
-                {
-                    break;
-                }
-                ++index;
-            }
-            m_updateQueue.insertAtIndex(index, wrapper);
+            m_components.append(wrapper);
             return true;
         }
     };
@@ -317,6 +414,13 @@ namespace gpp
             return nullptr;
         }
 
+        /// Hash of name(), return the same string literal so it is hashed at compile time.
+        static gep::StringHash nameHash()
+        {
+            static_assert(false, "Please specialize this template in the specific component class!");
+            return "";
+        }
+
         /// The smaller this value, the earlier this component type will be initialized.
         static const gep::int32 initializationPriority()
         {
@@ -331,6 +435,17 @@ namespace gpp
             static_assert(false, "Please specialize this template in the specific component class!");
             return std::numeric_limits<gep::int32>::max();
         }
+
+        /// If true, the components of this type are updated in parallel on the task queue.
+        /// update may then only touch the component itself and must not call into Lua.
+        /// No engine component does this at the moment: their updates call into Havok, which the task workers do not
+        /// initialize, or into Lua, FMOD or the renderer.
+        /// A camera may look at another camera, whose transform changes while it is updated.
+        static const bool isUpdateThreadSafe()
+        {
+            static_assert(false, "Please specialize this template in the specific component class!");
+            return false;
+        }
     };
 
 }
@@ -0,0 +1,160 @@
+#pragma once
+
+#include "gep/container/DynamicArray.h"
+
+namespace gpp
+{
+    /// \brief 32 bit generational handle to an object of type T stored in a HandleTable<T>
+    ///
+    /// The low INDEX_BITS bits are the slot index, the high GENERATION_BITS bits the generation of the slot.
+    /// When the object is removed from the table the generation of its slot changes,
+    /// so old handles are detected as stale instead of pointing to a destroyed or reused object.
+    /// A handle fits into a Lua number without loss, the value 0 is never a valid handle.
+    template <class T>
+    class Handle
+    {
+    public:
+        static const gep::uint32 INDEX_BITS = 20;
+        static const gep::uint32 GENERATION_BITS = 32 - INDEX_BITS;
+        static const gep::uint32 INDEX_MASK = (1u << INDEX_BITS) - 1;
+        static const gep::uint32 GENERATION_MASK = (1u << GENERATION_BITS) - 1;
+
+        Handle() : m_value(0) {}
+        Handle(gep::uint32 index, gep::uint32 generation) :
+            m_value((generation << INDEX_BITS) | index)
+        {
+            GEP_ASSERT(index <= INDEX_MASK && generation <= GENERATION_MASK, "invalid handle", index, generation);
+        }
+
+        /// \brief restores a handle from the value returned by getValue
+        static Handle fromValue(gep::uint32 value)
+        {
+            Handle handle;
+            handle.m_value = value;
+            return handle;
+        }
+
+        inline gep::uint32 getValue() const { return m_value; }
+        inline gep::uint32 getIndex() const { return m_value & INDEX_MASK; }
+        inline gep::uint32 getGeneration() const { return m_value >> INDEX_BITS; }
+        /// \brief returns false for default constructed handles, says nothing about whether the object is still alive
+        inline bool isSet() const { return m_value != 0; }
+
+        inline bool operator == (const Handle& other) const { return m_value == other.m_value; }
+        inline bool operator != (const Handle& other) const { return m_value != other.m_value; }
+
+    private:
+        gep::uint32 m_value;
+    };
+
+    /// \brief dense array of object pointers that are accessed by generational handles
+    ///
+    /// Lookups are a bounds check and a generation compare.
+    /// Freed slots are reused in the order they were freed, so a slot goes through as few generations as possible
+    /// and it takes a long time until a stale handle could match a reused slot again.
+    template <class T>
+    class HandleTable
+    {
+    public:
+        typedef Handle<T> HandleType;
+
+    private:
+        static const gep::uint32 INVALID_INDEX = 0xFFFFFFFF;
+
+        struct Slot
+        {
+            T* pObject;
+            gep::uint32 generation;
+            gep::uint32 nextFree;
+        };
+
+        gep::DynamicArray<Slot> m_slots;
+        gep::uint32 m_firstFree;
+        gep::uint32 m_lastFree;
+        size_t m_count;
+
+        GEP_DISALLOW_COPY_AND_ASSIGNMENT(HandleTable);
+
+    public:
+        HandleTable() :
+            m_firstFree(INVALID_INDEX),
+            m_lastFree(INVALID_INDEX),
+            m_count(0)
+        {
+        }
+
+        /// \brief stores the object in a free slot and returns its handle
+        HandleType insert(T* pObject)
+        {
+            GEP_ASSERT(pObject != nullptr, "can not insert null");
+            gep::uint32 index;
+            if(m_firstFree != INVALID_INDEX)
+            {
+                index = m_firstFree;
+                m_firstFree = m_slots[index].nextFree;
+                if(m_firstFree == INVALID_INDEX)
+                    m_lastFree = INVALID_INDEX;
+            }
+            else
+            {
+                GEP_ASSERT(m_slots.length() <= HandleType::INDEX_MASK, "too many objects in the handle table", m_slots.length());
+                index = (gep::uint32)m_slots.length();
+                Slot slot;
+                // generation 0 is never used, so the handle value 0 stays invalid
+                slot.generation = 1;
+                m_slots.append(slot);
+            }
+
+            Slot& slot = m_slots[index];
+            slot.pObject = pObject;
+            slot.nextFree = INVALID_INDEX;
+            m_count++;
+            return HandleType(index, slot.generation);
+        }
+
+        /// \brief returns the object of the handle or nullptr if the handle is stale
+        inline T* get(HandleType handle) const
+        {
+            const gep::uint32 index = handle.getIndex();
+            if(index >= m_slots.length())
+                return nullptr;
+            const Slot& slot = m_slots[index];
+            return (slot.generation == handle.getGeneration()) ? slot.pObject : nullptr;
+        }
+
+        inline bool isAlive(HandleType handle) const
+        {
+            return get(handle) != nullptr;
+        }
+
+        /// \brief invalidates the handle and all its copies, the object itself is not touched
+        void remove(HandleType handle)
+        {
+            GEP_ASSERT(isAlive(handle), "removing a stale handle", handle.getValue());
+            const gep::uint32 index = handle.getIndex();
+            Slot& slot = m_slots[index];
+            slot.pObject = nullptr;
+            slot.generation = (slot.generation == HandleType::GENERATION_MASK) ? 1 : slot.generation + 1;
+            slot.nextFree = INVALID_INDEX;
+            if(m_lastFree == INVALID_INDEX)
+                m_firstFree = index;
+            else
+                m_slots[m_lastFree].nextFree = index;
+            m_lastFree = index;
+            m_count--;
+        }
+
+        /// \brief number of objects in the table
+        inline size_t count() const { return m_count; }
+
+        /// \brief removes all objects, all handles become stale
+        void clear()
+        {
+            for(size_t i = 0; i < m_slots.length(); i++)
+            {
+                if(m_slots[i].pObject != nullptr)
+                    remove(HandleType((gep::uint32)i, m_slots[i].generation));
+            }
+        }
+    };
+}
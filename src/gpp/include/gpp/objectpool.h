@@ -0,0 +1,68 @@
+#pragma once
+
+#include "gep/container/DynamicArray.h"
+
+namespace gpp
+{
+    /// \brief hands out objects that were created up front and takes them back for reuse
+    ///
+    /// acquire and release are O(1) and never allocate: the free objects are kept on a stack
+    /// whose capacity is reserved when the objects are added, so only add allocates.
+    /// The object released last is acquired first, it is the one most likely still in the cache.
+    /// The pool does not own the objects, it neither constructs nor deletes them.
+    template <class T>
+    class ObjectPool
+    {
+    private:
+        /// all objects, in use or not
+        gep::DynamicArray<T*> m_objects;
+        gep::DynamicArray<T*> m_freeObjects;
+
+        GEP_DISALLOW_COPY_AND_ASSIGNMENT(ObjectPool);
+
+    public:
+        ObjectPool()
+        {
+        }
+
+        explicit ObjectPool(gep::IAllocator* pAllocator) :
+            m_objects(pAllocator),
+            m_freeObjects(pAllocator)
+        {
+        }
+
+        /// \brief adds a free object to the pool
+        void add(T* pObject)
+        {
+            GEP_ASSERT(pObject != nullptr, "can not add null");
+            m_objects.append(pObject);
+            m_freeObjects.reserve(m_objects.length());
+            m_freeObjects.append(pObject);
+        }
+
+        /// \brief returns a free object or nullptr if all objects are in use
+        T* acquire()
+        {
+            if(m_freeObjects.length() == 0)
+                return nullptr;
+            T* pObject = m_freeObjects.lastElement();
+            m_freeObjects.removeLastElement();
+            return pObject;
+        }
+
+        /// \brief gives an acquired object back to the pool
+        void release(T* pObject)
+        {
+            GEP_ASSERT(pObject != nullptr, "can not release null");
+            GEP_ASSERT(m_freeObjects.length() < m_objects.length(), "released more objects than were acquired");
+            m_freeObjects.append(pObject);
+        }
+
+        /// \brief all objects of the pool, the ones in use and the free ones
+        inline gep::ArrayPtr<T*> getObjects() { return m_objects.toArray(); }
+
+        inline size_t getNumObjects() const { return m_objects.length(); }
+        inline size_t getNumFree() const { return m_freeObjects.length(); }
+        inline size_t getNumInUse() const { return m_objects.length() - m_freeObjects.length(); }
+    };
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include "gep/container/DynamicArray.h"
+
+namespace gpp
+{
+    /// \brief calls one Lua update function for many objects with a single protected call
+    ///
+    /// The objects are queued anew every frame and handed to Lua in a table which is kept between the calls.
+    /// Only the entries of the table which differ from the last call are written again, so objects that are
+    /// updated every frame are pushed to Lua once and not once per frame.
+    /// The function is either called once per object with (object, elapsedTime), by a loop that runs in Lua,
+    /// or once for all objects with (objects, numObjects, elapsedTime). The function must not change the table.
+    /// Errors are raised as gep::ScriptExecutionException after the Lua stack has been cleaned up.
+    class GPP_API ScriptUpdateBatch
+    {
+    public:
+        struct CallMode
+        {
+            enum Enum
+            {
+                OncePerObject,
+                OnceForAll
+            };
+
+            GEP_DISALLOW_CONSTRUCTION(CallMode);
+        };
+
+        /// \brief pushes the value the update function gets for the object
+        typedef void (*PushObjectFunction)(lua_State* L, void* pObject);
+
+        /// \brief creates a batch for the function at functionIndex, the function stays on the stack
+        ScriptUpdateBatch(lua_State* L, int functionIndex, CallMode::Enum callMode, PushObjectFunction pushObject);
+        ~ScriptUpdateBatch();
+
+        /// \brief adds the object to the next call
+        inline void queue(void* pObject) { m_queuedObjects.append(pObject); }
+        inline size_t getNumQueued() const { return m_queuedObjects.length(); }
+        void clearQueue() { m_queuedObjects.resize(0); }
+
+        /// \brief calls the function for all queued objects in the order they were queued and clears the queue
+        ///
+        /// Does nothing if no object is queued.
+        void call(float elapsedTime);
+
+        /// \brief call this when a queued object is destroyed
+        ///
+        /// Its table entry is written again even if another object at the same address is queued in its place.
+        void forgetObject(void* pObject);
+
+        /// \brief returns the number of table entries the last call had to write
+        inline size_t getNumObjectsPushed() const { return m_numObjectsPushed; }
+
+        /// \brief identifies the Lua function, equal for all batches of the same function
+        inline const void* getFunctionIdentity() const { return m_functionIdentity; }
+        inline CallMode::Enum getCallMode() const { return m_callMode; }
+
+        /// \brief counts the users of this batch, e.g. the script components whose update function it calls
+        inline void addUser() { m_numUsers++; }
+        inline void removeUser() { GEP_ASSERT(m_numUsers > 0, "batch has no users"); m_numUsers--; }
+        inline gep::uint32 getNumUsers() const { return m_numUsers; }
+
+    private:
+        lua_State* m_L;
+        CallMode::Enum m_callMode;
+        PushObjectFunction m_pushObject;
+        const void* m_functionIdentity;
+        int m_functionReference;
+        /// the table of objects that is passed to Lua
+        int m_objectsReference;
+        /// the objects the entries of the table were pushed for
+        gep::DynamicArray<void*> m_objectsInTable;
+        gep::DynamicArray<void*> m_queuedObjects;
+        size_t m_numObjectsPushed;
+        gep::uint32 m_numUsers;
+
+        void updateObjectTable();
+
+        GEP_DISALLOW_COPY_AND_ASSIGNMENT(ScriptUpdateBatch);
+    };
+}
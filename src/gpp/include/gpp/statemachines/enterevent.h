@@ -12,6 +12,7 @@ namespace gpp { namespace sm {
 
     public:
         EnterEventData();
+        ~EnterEventData();
 
         State* getEnteredState();
         State* getLeftState();
@@ -13,6 +13,7 @@ namespace gpp { namespace sm {
 
     public:
         LeaveEventData();
+        ~LeaveEventData();
 
         State* getCurrentState();
 
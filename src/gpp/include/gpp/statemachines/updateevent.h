@@ -12,6 +12,7 @@ namespace gpp { namespace sm {
 
     public:
         UpdateEventData();
+        ~UpdateEventData();
 
         State* getCurrentState();
         float getElapsedTime();
@@ -215,6 +215,11 @@ void gpp::CameraComponent::setParent(gep::ITransform* parent)
     m_pCamera->setParent(parent);
 }
 
+gep::uint64 gpp::CameraComponent::getWorldChangeStamp() const
+{
+    return m_pCamera->getWorldChangeStamp();
+}
+
 void gpp::CameraComponent::setViewTarget(gep::ITransform* viewTarget)
 {
     m_viewTarget.setParent(viewTarget);
@@ -49,6 +49,12 @@ void gpp::PhysicsComponent::destroy()
     setState(State::Inactive);
 }
 
+void gpp::PhysicsComponent::recycle()
+{
+    m_pRigidBody->setLinearVelocity(gep::vec3(0, 0, 0));
+    m_pRigidBody->setAngularVelocity(gep::vec3(0, 0, 0));
+}
+
 void gpp::PhysicsComponent::setBaseOrientation(const gep::Quaternion& viewDir)
 {
     m_baseOrientation = viewDir;
@@ -123,6 +129,11 @@ const gep::ITransform* gpp::PhysicsComponent::getParent() const
     return m_transform.getParent();
 }
 
+gep::uint64 gpp::PhysicsComponent::getWorldChangeStamp() const
+{
+    return m_transform.getWorldChangeStamp();
+}
+
 gep::IRigidBody* gpp::PhysicsComponent::getRigidBody()
 {
     return m_pRigidBody.get();
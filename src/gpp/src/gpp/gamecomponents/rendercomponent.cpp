@@ -53,10 +53,17 @@ void gpp::RenderComponent::update(float elapsedMS)
 void gpp::RenderComponent::destroy()
 {
     setState(State::Inactive);
+    if (m_extractionCallbackId.id != 0)
+    {
+        g_globalManager.getRendererExtractor()->deregisterExtractionCallback(m_extractionCallbackId);
+        m_extractionCallbackId.id = 0;
+    }
 }
 
 void gpp::RenderComponent::extract(gep::IRendererExtractor& extractor)
 {
+    if (m_state != State::Active) { return; }
+
     m_pModel->setBones(m_bones.toArray());
     m_pModel->extract(extractor, m_pParentGameObject->getWorldTransformationMatrix() * gep::mat4::scaleMatrix(m_scale));
 }
@@ -91,6 +98,8 @@ void gpp::RenderComponent::setState(State::Enum state)
 
     m_state = state;
 
+    // The extraction callback stays registered until the component is destroyed, inactive components skip the extraction.
+    // Registering it searches all callbacks and allocates, switching the state on and off, like pooled game objects do, should not.
     switch (state)
     {
     case State::Active:
@@ -103,13 +112,6 @@ void gpp::RenderComponent::setState(State::Enum state)
         }
         break;
     case State::Inactive:
-        {
-            if (m_extractionCallbackId.id != 0)
-            {
-                g_globalManager.getRendererExtractor()->deregisterExtractionCallback(m_extractionCallbackId);
-                m_extractionCallbackId.id = 0;
-            }
-        }
         break;
     default:
         GEP_ASSERT(false, "Invalid State!", m_state, state);
@@ -3,16 +3,37 @@
 #include "gep/globalManager.h"
 #include "gep/interfaces/scripting.h"
 
+namespace
+{
+    // setUpdateFunction: the functions get the guid like before the updates were batched
+    void pushGuid(lua_State* L, void* pComponent)
+    {
+        const std::string& guid = static_cast<gpp::ScriptComponent*>(pComponent)->getParentGameObject()->getGuid();
+        lua_pushlstring(L, guid.c_str(), guid.length());
+    }
+
+    // setBatchUpdateFunction: the game object itself, its proxy is cached
+    void pushGameObject(lua_State* L, void* pComponent)
+    {
+        lua::push(L, static_cast<gpp::ScriptComponent*>(pComponent)->getParentGameObject());
+    }
+}
 
 gpp::ScriptComponent::ScriptComponent() :
     m_funcRef_initialize(),
     m_funcRef_destroy(),
-    m_funcRef_update()
+    m_pUpdateBatch(nullptr)
 {
 }
 
 gpp::ScriptComponent::~ScriptComponent()
 {
+    if (m_pUpdateBatch != nullptr)
+    {
+        // a new component at this address must not get the table entry of this one
+        m_pUpdateBatch->forgetObject(this);
+        m_pUpdateBatch->removeUser();
+    }
 }
 
 void gpp::ScriptComponent::initalize()
@@ -46,13 +67,10 @@ void gpp::ScriptComponent::update(float deltaSeconds)
 {
     if(m_state == State::Inactive) { return; }
 
-    if (m_funcRef_update.isValid())
+    // ScriptComponentPool calls the batch after all components were queued
+    if (m_pUpdateBatch != nullptr)
     {
-        g_globalManager.getScriptingManager()->callFunction<void>(
-            m_funcRef_update,               ///< Function reference
-            m_pParentGameObject->getGuid(), ///< ID of the game object
-            deltaSeconds
-        );
+        m_pUpdateBatch->queue(this);
     }
 }
 
@@ -68,5 +86,98 @@ void gpp::ScriptComponent::setDestroyFunction(gep::ScriptFunctionWrapper funcRef
 
 void gpp::ScriptComponent::setUpdateFunction(gep::ScriptFunctionWrapper funcRef)
 {
-    m_funcRef_update = funcRef;
+    setUpdateBatch(funcRef, ScriptUpdateBatch::CallMode::OncePerObject);
+}
+
+void gpp::ScriptComponent::setBatchUpdateFunction(gep::ScriptFunctionWrapper funcRef)
+{
+    setUpdateBatch(funcRef, ScriptUpdateBatch::CallMode::OnceForAll);
+}
+
+void gpp::ScriptComponent::setUpdateBatch(gep::ScriptFunctionWrapper& funcRef, ScriptUpdateBatch::CallMode::Enum callMode)
+{
+    ScriptUpdateBatch* pBatch = nullptr;
+    if (funcRef.isValid())
+    {
+        auto& pool = static_cast<ScriptComponentPool&>(g_gameObjectManager.getComponentPool<ScriptComponent>());
+        pBatch = pool.getUpdateBatch(funcRef, callMode);
+        pBatch->addUser();
+    }
+
+    if (m_pUpdateBatch != nullptr)
+    {
+        m_pUpdateBatch->removeUser();
+    }
+    m_pUpdateBatch = pBatch;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+gpp::ScriptComponentPool::ScriptComponentPool() :
+    m_updateBatches(),
+    m_perObjectBatches(),
+    m_forAllBatches()
+{
+}
+
+gpp::ScriptComponentPool::~ScriptComponentPool()
+{
+    for (auto pBatch : m_updateBatches)
+    {
+        delete pBatch;
+    }
+}
+
+void gpp::ScriptComponentPool::updateComponents(float elapsedMs)
+{
+    // a failed call leaves the following batches queued
+    for (auto pBatch : m_updateBatches)
+    {
+        pBatch->clearQueue();
+    }
+    removeUnusedBatches();
+
+    // the components only queue their game objects
+    ComponentPool<ScriptComponent>::updateComponents(elapsedMs);
+
+    // The update functions may set update functions, which creates batches.
+    // Those have nothing queued, and unused batches are only removed before the next update.
+    for (size_t i = 0; i < m_updateBatches.length(); i++)
+    {
+        m_updateBatches[i]->call(elapsedMs);
+    }
+}
+
+gpp::ScriptUpdateBatch* gpp::ScriptComponentPool::getUpdateBatch(gep::ScriptFunctionWrapper& funcRef, ScriptUpdateBatch::CallMode::Enum callMode)
+{
+    auto L = g_globalManager.getScriptingManager()->getState();
+    lua::utils::StackCleaner cleaner(L, 0);
+
+    funcRef.push();
+    auto& batches = getBatchMap(callMode);
+    ScriptUpdateBatch* pBatch = nullptr;
+    // the batch references the function, so no other function can get its address
+    if (batches.tryGet(lua_topointer(L, -1), pBatch) == gep::FAILURE)
+    {
+        pBatch = new ScriptUpdateBatch(L, -1, callMode, callMode == ScriptUpdateBatch::CallMode::OncePerObject ? &pushGuid : &pushGameObject);
+        batches[pBatch->getFunctionIdentity()] = pBatch;
+        m_updateBatches.append(pBatch);
+    }
+    return pBatch;
+}
+
+void gpp::ScriptComponentPool::removeUnusedBatches()
+{
+    size_t numUsed = 0;
+    for (auto pBatch : m_updateBatches)
+    {
+        if (pBatch->getNumUsers() > 0)
+        {
+            m_updateBatches[numUsed++] = pBatch;
+            continue;
+        }
+        getBatchMap(pBatch->getCallMode()).remove(pBatch->getFunctionIdentity());
+        delete pBatch;
+    }
+    m_updateBatches.resize(numUsed);
 }
@@ -0,0 +1,91 @@
+#include "stdafx.h"
+#include "gpp/gameObjectPool.h"
+
+#include "gep/globalManager.h"
+#include "gep/interfaces/logging.h"
+
+gpp::GameObjectPool::GameObjectPool(const std::string& name, gep::ScriptFunctionWrapper createFunction) :
+    m_name(name),
+    m_createFunction(createFunction),
+    m_gameObjects()
+{
+    GEP_ASSERT(m_createFunction.isValid(), "The game object pool needs a function that creates the components", name);
+}
+
+gpp::GameObjectPool::~GameObjectPool()
+{
+    // the game objects are deleted by the GameObjectManager like all others
+}
+
+void gpp::GameObjectPool::prewarm(gep::uint32 numGameObjects)
+{
+    while(m_gameObjects.getNumObjects() < numGameObjects)
+    {
+        createGameObject();
+    }
+}
+
+gpp::GameObject* gpp::GameObjectPool::acquire()
+{
+    GameObject* pGameObject = m_gameObjects.acquire();
+    if(pGameObject == nullptr)
+    {
+        g_globalManager.getLogging()->logWarning("Game object pool '%s' is empty, creating game object number %u."
+                                                 " Prewarm the pool with more game objects!",
+                                                 m_name.c_str(), getNumGameObjects() + 1);
+        createGameObject();
+        pGameObject = m_gameObjects.acquire();
+    }
+    GEP_ASSERT(pGameObject->m_isInPool, "Acquired a game object that is in use", pGameObject->getGuid());
+
+    auto& manager = GameObjectManager::instance();
+    pGameObject->m_handle = manager.m_gameObjectHandles.insert(pGameObject);
+    pGameObject->m_isInPool = false;
+    if(pGameObject->m_isInitialized)
+    {
+        pGameObject->reactivateComponents();
+    }
+    return pGameObject;
+}
+
+void gpp::GameObjectPool::release(GameObject* pGameObject)
+{
+    GEP_ASSERT(pGameObject != nullptr, "Invalid input");
+    GEP_ASSERT(pGameObject->m_pPool == this, "The game object does not belong to this pool", pGameObject->getGuid(), m_name);
+    GEP_ASSERT(!pGameObject->m_isInPool, "The game object was released twice", pGameObject->getGuid());
+
+    auto& manager = GameObjectManager::instance();
+    manager.m_gameObjectHandles.remove(pGameObject->m_handle);
+    pGameObject->m_handle = GameObjectHandle();
+    pGameObject->m_isInPool = true;
+    if(pGameObject->m_isInitialized)
+    {
+        pGameObject->recycleComponents();
+    }
+    m_gameObjects.release(pGameObject);
+}
+
+void gpp::GameObjectPool::createGameObject()
+{
+    auto& manager = GameObjectManager::instance();
+
+    char index[16];
+    sprintf_s(index, "-%u", getNumGameObjects());
+    GameObject* pGameObject = manager.doCreateGameObject(m_name + index);
+    pGameObject->m_pPool = this;
+
+    // free game objects have no handle
+    manager.m_gameObjectHandles.remove(pGameObject->m_handle);
+    pGameObject->m_handle = GameObjectHandle();
+    pGameObject->m_isInPool = true;
+
+    g_globalManager.getScriptingManager()->callFunction<void>(m_createFunction, pGameObject);
+
+    // Before the initialization, the GameObjectManager initializes the game object and recycles its components.
+    if(manager.getState() == GameObjectManager::State::PostInitialization)
+    {
+        pGameObject->initialize();
+        pGameObject->recycleComponents();
+    }
+    m_gameObjects.add(pGameObject);
+}
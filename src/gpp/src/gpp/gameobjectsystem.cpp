@@ -1,9 +1,11 @@
 #include "stdafx.h"
 #include "gpp/gameObjectSystem.h"
+#include "gpp/gameObjectPool.h"
 #include <algorithm>
 
 #include "gep/globalManager.h"
 #include "gep/interfaces/logging.h"
+#include "gep/threading/taskQueue.h"
 
 //GameObjectManager
 
@@ -12,10 +14,16 @@ gpp::GameObjectManager* volatile gep::DoubleLockingSingleton<gpp::GameObjectMana
 gep::Mutex gep::DoubleLockingSingleton<gpp::GameObjectManager>::s_creationMutex;
 
 gpp::GameObjectManager::GameObjectManager():
+    m_gameObjectHandles(),
     m_gameObjects(),
+    m_gameObjectPools(),
+    m_componentPools(),
+    m_updatedComponentPools(),
+    m_parallelComponentPools(),
     m_state(State::PreInitialization),
     m_tempAllocator(true, 1024),
-    m_pCurrentCameraObject(nullptr)
+    m_pCurrentCameraObject(nullptr),
+    m_transformStore()
 {
 }
 
@@ -29,18 +37,46 @@ gpp::GameObject* gpp::GameObjectManager::doCreateGameObject(const std::string& g
     GEP_ASSERT(!m_gameObjects.tryGet(guid, pGameObject), "GameObject already exists!", guid);
     pGameObject = new GameObject();
     pGameObject->m_guid = guid;
+    pGameObject->m_handle = m_gameObjectHandles.insert(pGameObject);
     m_gameObjects[guid] = pGameObject;
     return pGameObject;
 }
 
+void gpp::GameObjectManager::addComponentPool(IComponentPool* pPool, gep::int32 updatePriority, bool updateInParallel)
+{
+    if (updatePriority == std::numeric_limits<gep::int32>::max())
+    {
+        // Component type needs no update
+        return;
+    }
+
+    ComponentPoolEntry entry;
+    entry.updatePriority = updatePriority;
+    entry.updateInParallel = updateInParallel;
+    entry.pPool = pPool;
+
+    size_t index = 0;
+    for (auto& other : m_updatedComponentPools)
+    {
+        if(other.updatePriority > updatePriority)
+        {
+            break;
+        }
+        ++index;
+    }
+    m_updatedComponentPools.insertAtIndex(index, entry);
+}
+
 void gpp::GameObjectManager::destroyGameObject(GameObject* pGameObject)
 {
     GEP_ASSERT(pGameObject, "Invalid input");
     GEP_ASSERT(m_gameObjects.exists(pGameObject->getGuid()), "Trying to delete non-existant game object!");
     GEP_ASSERT(m_gameObjects[pGameObject->getGuid()] == pGameObject, "Detected same GUID but different pointers!");
+    GEP_ASSERT(pGameObject->m_pPool == nullptr, "Release game objects of a pool to their pool instead of destroying them!", pGameObject->getGuid());
     g_globalManager.getLogging()->logWarning("Deleting game object '%s' at the end of the frame."
                                              " All references to this object "
-                                             "(including the ones in your Lua code) will be invalid!",
+                                             "(including the ones in your Lua code) will be invalid,"
+                                             " use its handle to refer to it safely!",
                                              pGameObject->getGuid().c_str());
     m_garbage.append(pGameObject);
 }
@@ -52,11 +88,31 @@ gpp::GameObject* gpp::GameObjectManager::getGameObject(const std::string& guid)
     return pGameObject;
 }
 
+gpp::GameObjectPool* gpp::GameObjectManager::createGameObjectPool(const std::string& name, gep::uint32 numGameObjects, gep::ScriptFunctionWrapper createFunction)
+{
+    GEP_ASSERT(!m_gameObjectPools.exists(name), "GameObjectPool already exists!", name);
+    auto pPool = new GameObjectPool(name, createFunction);
+    m_gameObjectPools[name] = pPool;
+    pPool->prewarm(numGameObjects);
+    return pPool;
+}
+
+gpp::GameObjectPool* gpp::GameObjectManager::getGameObjectPool(const std::string& name)
+{
+    GameObjectPool* pPool = nullptr;
+    m_gameObjectPools.tryGet(name, pPool);
+    return pPool;
+}
+
 void gpp::GameObjectManager::initialize()
 {
     for(auto pGameObject : m_gameObjects.values())
     {
         pGameObject->initialize();
+        if(pGameObject->m_isInPool)
+        {
+            pGameObject->recycleComponents();
+        }
     }
     m_state = State::PostInitialization;
 }
@@ -72,24 +128,65 @@ void gpp::GameObjectManager::destroy()
         }
     }
     m_gameObjects.clear();
+    m_gameObjectHandles.clear();
+
+    // the game objects of the pools were deleted with all others
+    for(auto pPool : m_gameObjectPools.values())
+    {
+        delete pPool;
+    }
+    m_gameObjectPools.clear();
+
+    for(auto pPool : m_componentPools.values())
+    {
+        delete pPool;
+    }
+    m_componentPools.clear();
+    m_updatedComponentPools.clear();
+    m_parallelComponentPools.clear();
 }
 
 void gpp::GameObjectManager::update(float elapsedMs)
 {
-    for(auto pGameObject : m_gameObjects.values())
+    // All components of one type are updated at once, the types in the order of their update priority.
+    // Only components of initialized game objects are updated.
+    // Types with a thread safe update are updated in parallel, all types of one priority finish before the next priority starts.
+    size_t levelBegin = 0;
+    while(levelBegin < m_updatedComponentPools.length())
     {
-        if (pGameObject)
+        const gep::int32 updatePriority = m_updatedComponentPools[levelBegin].updatePriority;
+        size_t levelEnd = levelBegin;
+        m_parallelComponentPools.resize(0);
+        for(; levelEnd < m_updatedComponentPools.length() && m_updatedComponentPools[levelEnd].updatePriority == updatePriority; levelEnd++)
+        {
+            auto& entry = m_updatedComponentPools[levelEnd];
+            if(entry.updateInParallel)
+            {
+                m_parallelComponentPools.append(entry.pPool);
+            }
+            else
+            {
+                entry.pPool->updateComponents(elapsedMs);
+            }
+        }
+
+        if(m_parallelComponentPools.length() > 0)
         {
-            pGameObject->update(elapsedMs);
+            updateComponentPoolsInParallel(*g_globalManager.getTaskQueue(), m_parallelComponentPools.toArray(), elapsedMs);
         }
+        levelBegin = levelEnd;
     }
 
+    // The components are done moving the game objects, compute all world transformations which changed at once.
+    m_transformStore.update();
+
     // Collect garbage
     for (auto pGarbage : m_garbage)
     {
         const auto& guid = pGarbage->getGuid();
         auto result = m_gameObjects.remove(guid);
         GEP_ASSERT(result == gep::SUCCESS, "Failed to remove game object from list of all game objects?!?!");
+        m_gameObjectHandles.remove(pGarbage->getHandle());
         pGarbage->destroy();
     }
     m_garbage.clear();
@@ -97,12 +194,15 @@ void gpp::GameObjectManager::update(float elapsedMs)
 
 gpp::GameObject::GameObject() :
     m_guid(),
+    m_handle(),
     m_isInitialized(false),
     m_isActive(true),
-    m_defaultTransform(),
+    m_pPool(nullptr),
+    m_isInPool(false),
+    m_defaultTransform(GameObjectManager::instance().getTransformStore()),
     m_transform(&m_defaultTransform),
-    m_components(),
-    m_updateQueue()
+    m_transformChangeStamp(0),
+    m_components()
 {
 }
 
@@ -151,18 +251,6 @@ gep::Quaternion gpp::GameObject::getRotation() const
     return m_transform->getRotation();
 }
 
-void gpp::GameObject::update(float elapsedMs)
-{
-    GEP_ASSERT(m_isInitialized,
-               "Game object not initialized. "
-               "You have to call :initialize() on game objects created by :createGameObjectUninitialized()");
-
-    for(auto component : m_updateQueue)
-    {
-        component.component->update(elapsedMs);
-    }
-}
-
 void gpp::GameObject::initialize()
 {
     GEP_ASSERT(!m_isInitialized, "Cannot initialize a game object twice.");
@@ -170,9 +258,9 @@ void gpp::GameObject::initialize()
     auto pAllocator = GameObjectManager::instance().getTempAllocator();
 
     auto toInit = gep::DynamicArray<ComponentWrapper*>(pAllocator);
-    toInit.reserve(m_components.count());
+    toInit.reserve(m_components.length());
 
-    for(auto& wrapper : m_components.values())
+    for(auto& wrapper : m_components)
     {
         toInit.append(&wrapper);
     }
@@ -188,6 +276,13 @@ void gpp::GameObject::initialize()
             "A game component must set its state within its initialize function!");
     }
 
+    // From now on the component pools update the components, pooled game objects return to these states when they are acquired
+    for(auto& wrapper : m_components)
+    {
+        wrapper.pPool->setUpdateEnabled(wrapper.poolSlot, true);
+        wrapper.initialState = wrapper.component->getState();
+    }
+
     m_isInitialized = true;
 }
 
@@ -197,9 +292,9 @@ void gpp::GameObject::destroy()
 
     // Create a sorted array of all component instances.
     auto toDestroy = gep::DynamicArray<ComponentWrapper*>(pAllocator);
-    toDestroy.reserve(m_components.count());
+    toDestroy.reserve(m_components.length());
 
-    for(auto& wrapper : m_components.values())
+    for(auto& wrapper : m_components)
     {
         toDestroy.append(&wrapper);
     }
@@ -215,14 +310,32 @@ void gpp::GameObject::destroy()
         wrapper->component->destroy();
     }
 
+    // Scripts may still hold the components and this game object, they see null objects from now on.
+    // Every component type derives from Component first, so its address is the one that was pushed to Lua.
+    // Does nothing when the scripting manager was destroyed first.
+    for(auto wrapper : toDestroy)
+    {
+        lua::utils::invalidateProxy(wrapper->component);
+    }
+    lua::utils::invalidateProxy(this);
+
     // Delete the components.
     for(auto wrapper : toDestroy)
     {
-        gep::deleteAndNull(wrapper->component);
+        wrapper->pPool->destroyComponent(wrapper->poolSlot);
+        wrapper->component = nullptr;
     }
 
-    m_components.clear();
-    m_updateQueue.resize(0);
+    m_components.resize(0);
+
+    // Destroyed game objects are never deleted, their default transform would stay in the store and be updated every frame.
+    // Children in the store fall back to the identity transform, the same as the ones which still have this game object as parent.
+    if(m_defaultTransform.isInStore())
+    {
+        m_defaultTransform.removeFromStore();
+    }
+    m_transform = gep::getIdentityTransform();
+    m_transformChangeStamp = gep::nextTransformChangeStamp();
 
     m_isInitialized = false;
 }
@@ -249,12 +362,34 @@ gep::vec3 gpp::GameObject::getRightDirection() const
 
 void gpp::GameObject::setComponentStates(IComponent::State::Enum value)
 {
-    for (auto& wrapper : m_components.values())
+    for (auto& wrapper : m_components)
     {
         wrapper.component->setState(value);
     }
 }
 
+void gpp::GameObject::recycleComponents()
+{
+    // The game object is not updated or drawn anymore, but it keeps its components and their resources.
+    for (auto& wrapper : m_components)
+    {
+        wrapper.pPool->setUpdateEnabled(wrapper.poolSlot, false);
+        wrapper.component->setState(IComponent::State::Inactive);
+        wrapper.component->recycle();
+    }
+}
+
+void gpp::GameObject::reactivateComponents()
+{
+    // Every user of a pooled game object starts with the states the create function and the initialization left,
+    // not with the ones the previous user left behind.
+    for (auto& wrapper : m_components)
+    {
+        wrapper.component->setState(wrapper.initialState);
+        wrapper.pPool->setUpdateEnabled(wrapper.poolSlot, true);
+    }
+}
+
 void gpp::GameObject::setBaseViewDirection(const gep::vec3& direction)
 {
     m_transform->setBaseViewDirection(direction);
@@ -272,5 +407,30 @@ const gep::ITransform* gpp::GameObject::getParent() const
 
 void gpp::GameObject::setParent(gep::ITransform* parent)
 {
-   m_transform->setParent(parent);
+    // A parent game object only forwards to its transform, in the store the child uses that transform directly.
+    // Should the parent switch to another transform later, setTransform gives the child the game object back.
+    auto pParentObject = dynamic_cast<GameObject*>(parent);
+    if(pParentObject != nullptr && pParentObject->m_transform == &pParentObject->m_defaultTransform &&
+       m_transform == &m_defaultTransform)
+    {
+        parent = &pParentObject->m_defaultTransform;
+    }
+    m_transform->setParent(parent);
+}
+
+gep::uint64 gpp::GameObject::getWorldChangeStamp() const
+{
+    // switching to another transform is a change too
+    const gep::uint64 transformStamp = m_transform->getWorldChangeStamp();
+    return GEP_MAX(m_transformChangeStamp, transformStamp);
+}
+
+void gpp::GameObject::setTransform(gep::ITransform& transform)
+{
+    if(m_transform == &m_defaultTransform && &transform != &m_defaultTransform)
+    {
+        m_defaultTransform.setParentOfChildren(this);
+    }
+    m_transform = &transform;
+    m_transformChangeStamp = gep::nextTransformChangeStamp();
 }
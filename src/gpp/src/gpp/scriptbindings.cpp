@@ -27,6 +27,7 @@
 #include "gpp/gameComponents/characterComponent.h"
 #include "gpp/gameComponents/animationComponent.h"
 #include "gpp/gameComponents/audioComponent.h"
+#include "gpp/gameObjectPool.h"
 
 
 #include "gep/interfaces/events.h"
@@ -129,6 +130,7 @@ void gpp::Game::bindOther()
 
     scripting->bind<gpp::GameObject>("GameObject");
     scripting->bind<gpp::GameObjectManager>("GameObjectManager", &g_gameObjectManager);
+    scripting->bind<gpp::GameObjectPool>("GameObjectPool");
 
     scripting->bind<gep::IGamepad>("Gamepad");
     scripting->bind<gep::IInputHandler>("InputHandler", g_globalManager.getInputHandler());
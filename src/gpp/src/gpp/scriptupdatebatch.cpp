@@ -0,0 +1,150 @@
+#include "stdafx.h"
+#include "gpp/scriptUpdateBatch.h"
+#include "gep/interfaces/scripting.h"
+#include "gep/exception.h"
+
+namespace
+{
+    const char* const callOncePerObjectName = "gpp.ScriptUpdateBatch.callOncePerObject";
+
+    // one protected call runs the loop over all objects, instead of one call per object from C++
+    const char* const callOncePerObjectCode =
+        "local update, objects, numObjects, elapsedTime = ...\n"
+        "for i = 1, numObjects do\n"
+        "    update(objects[i], elapsedTime)\n"
+        "end\n";
+
+    // message handler of the protected call, adds the Lua call stack to the error
+    int addTraceback(lua_State* L)
+    {
+        const char* message = lua_tostring(L, 1);
+        luaL_traceback(L, L, message != nullptr ? message : "(error object is not a string)", 1);
+        return 1;
+    }
+}
+
+gpp::ScriptUpdateBatch::ScriptUpdateBatch(lua_State* L, int functionIndex, CallMode::Enum callMode, PushObjectFunction pushObject) :
+    m_L(L),
+    m_callMode(callMode),
+    m_pushObject(pushObject),
+    m_functionIdentity(nullptr),
+    m_functionReference(LUA_NOREF),
+    m_objectsReference(LUA_NOREF),
+    m_objectsInTable(),
+    m_queuedObjects(),
+    m_numObjectsPushed(0),
+    m_numUsers(0)
+{
+    lua::utils::StackChecker check(L, 0);
+    GEP_ASSERT(lua_isfunction(L, functionIndex), "Expected a function", functionIndex, lua_typename(L, lua_type(L, functionIndex)));
+
+    m_functionIdentity = lua_topointer(L, functionIndex);
+    lua_pushvalue(L, functionIndex);
+    m_functionReference = luaL_ref(L, LUA_REGISTRYINDEX);
+
+    lua_newtable(L);
+    m_objectsReference = luaL_ref(L, LUA_REGISTRYINDEX);
+
+    if(callMode == CallMode::OncePerObject)
+    {
+        // all batches share the loop
+        lua_getfield(L, LUA_REGISTRYINDEX, callOncePerObjectName);
+        const bool isLoaded = !lua_isnil(L, -1);
+        lua_pop(L, 1);
+        if(!isLoaded)
+        {
+            const int result = luaL_loadstring(L, callOncePerObjectCode);
+            GEP_ASSERT(result == LUA_OK, "Failed to compile the update loop", lua_tostring(L, -1));
+            lua_setfield(L, LUA_REGISTRYINDEX, callOncePerObjectName);
+        }
+    }
+}
+
+gpp::ScriptUpdateBatch::~ScriptUpdateBatch()
+{
+    luaL_unref(m_L, LUA_REGISTRYINDEX, m_objectsReference);
+    luaL_unref(m_L, LUA_REGISTRYINDEX, m_functionReference);
+}
+
+void gpp::ScriptUpdateBatch::call(float elapsedTime)
+{
+    if(m_queuedObjects.length() == 0)
+        return;
+
+    // also cleans up the stack when the call fails
+    lua::utils::StackCleaner cleaner(m_L, 0);
+
+    const int numObjects = int(m_queuedObjects.length());
+    updateObjectTable();
+
+    lua_pushcfunction(m_L, &addTraceback);
+    const int messageHandlerIndex = lua_gettop(m_L);
+
+    int numArguments = 3;
+    if(m_callMode == CallMode::OncePerObject)
+    {
+        // the loop gets the update function as its first argument
+        lua_getfield(m_L, LUA_REGISTRYINDEX, callOncePerObjectName);
+        numArguments++;
+    }
+    lua_rawgeti(m_L, LUA_REGISTRYINDEX, m_functionReference);
+    lua_rawgeti(m_L, LUA_REGISTRYINDEX, m_objectsReference);
+    lua_pushinteger(m_L, numObjects);
+    lua_pushnumber(m_L, elapsedTime);
+
+    if(lua_pcall(m_L, numArguments, 0, messageHandlerIndex) != LUA_OK)
+    {
+        std::string message("in Lua: ");
+        message += lua_tostring(m_L, -1);
+        throw gep::ScriptExecutionException(message);
+    }
+}
+
+void gpp::ScriptUpdateBatch::updateObjectTable()
+{
+    lua_rawgeti(m_L, LUA_REGISTRYINDEX, m_objectsReference);
+    const size_t numQueued = m_queuedObjects.length();
+    const size_t numInTable = m_objectsInTable.length();
+
+    m_numObjectsPushed = 0;
+    for(size_t i = 0; i < numQueued; i++)
+    {
+        void* pObject = m_queuedObjects[i];
+        if(i < numInTable && m_objectsInTable[i] == pObject)
+            continue;
+
+        m_pushObject(m_L, pObject);
+        lua_rawseti(m_L, -2, int(i + 1));
+        m_numObjectsPushed++;
+    }
+
+    // entries behind the queued objects would keep their values alive
+    for(size_t i = numQueued; i < numInTable; i++)
+    {
+        lua_pushnil(m_L);
+        lua_rawseti(m_L, -2, int(i + 1));
+    }
+    lua_pop(m_L, 1);
+
+    // the queue is what the table holds now, the old content is reused as the next queue
+    std::swap(m_objectsInTable, m_queuedObjects);
+    m_queuedObjects.resize(0);
+}
+
+void gpp::ScriptUpdateBatch::forgetObject(void* pObject)
+{
+    for(auto& pInTable : m_objectsInTable)
+    {
+        if(pInTable == pObject)
+            pInTable = nullptr;
+    }
+
+    size_t i = 0;
+    while(i < m_queuedObjects.length())
+    {
+        if(m_queuedObjects[i] == pObject)
+            m_queuedObjects.removeAtIndex(i);
+        else
+            i++;
+    }
+}
@@ -21,6 +21,7 @@ gpp::sm::State::State(const NameInfo& nameInfo, gep::IAllocator* pAllocator) :
 
 gpp::sm::State::~State()
 {
+    lua::utils::invalidateProxy(this);
     m_pLogging = nullptr;
     m_pAllocator = nullptr;
 }
@@ -7,6 +7,12 @@ gpp::sm::EnterEventData::EnterEventData() :
 {
 }
 
+gpp::sm::EnterEventData::~EnterEventData()
+{
+    // the data lives on the stack of the state machine, scripts which keep it see a null object
+    lua::utils::invalidateProxy(this);
+}
+
 gpp::sm::State* gpp::sm::EnterEventData::getEnteredState()
 {
     return m_pEnteredState;
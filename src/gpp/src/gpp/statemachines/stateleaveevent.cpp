@@ -13,6 +13,11 @@ gpp::sm::LeaveEventData::LeaveEventData() :
 {
 }
 
+gpp::sm::LeaveEventData::~LeaveEventData()
+{
+    lua::utils::invalidateProxy(this);
+}
+
 gpp::sm::State* gpp::sm::LeaveEventData::getCurrentState()
 {
     return m_pCurrentState;
@@ -9,6 +9,11 @@ gpp::sm::UpdateEventData::UpdateEventData() :
 {
 }
 
+gpp::sm::UpdateEventData::~UpdateEventData()
+{
+    lua::utils::invalidateProxy(this);
+}
+
 gpp::sm::State* gpp::sm::UpdateEventData::getCurrentState()
 {
     return m_pCurrentState;
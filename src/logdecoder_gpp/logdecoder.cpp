@@ -0,0 +1,70 @@
+#include "stdafx.h"
+#include "gep/binaryLog.h"
+
+// implement new/delete
+#include "gep/memory/newdelete.inl"
+
+namespace
+{
+    // the same prefixes as the FileLogSink
+    const char* getChannelName(gep::LogChannel channel)
+    {
+        switch(channel)
+        {
+        case gep::LogChannel::message:
+            return "";
+        case gep::LogChannel::warning:
+            return "Warning: ";
+        case gep::LogChannel::error:
+            return "Error: ";
+        default:
+            return "Unkown: ";
+        }
+    }
+}
+
+int main(int argc, const char* argv[])
+{
+    if(argc < 2 || argc > 3)
+    {
+        printf("Usage: logdecoder_gpp <binary log> [<text log>]\n"
+               "Turns a log written by a BinaryFileLogSink into text.\n"
+               "The text is written to the console if no text log is given.\n");
+        return -1;
+    }
+
+    gep::BinaryLogReader reader(argv[1]);
+    if(!reader.isValid())
+    {
+        printf("%s could not be opened or is not a binary log\n", argv[1]);
+        return -1;
+    }
+
+    FILE* pOutput = stdout;
+    if(argc == 3)
+    {
+        pOutput = fopen(argv[2], "w");
+        if(pOutput == nullptr)
+        {
+            printf("could not open %s for writing\n", argv[2]);
+            return -1;
+        }
+    }
+    SCOPE_EXIT{ if(pOutput != stdout) fclose(pOutput); });
+
+    // a log that was not flushed completely ends in the middle of an entry, everything before it is still decoded
+    size_t numMessages = 0;
+    gep::LogChannel channel;
+    std::string msg;
+    while(reader.readMessage(channel, msg))
+    {
+        fprintf(pOutput, "%s%s\n", getChannelName(channel), msg.c_str());
+        numMessages++;
+    }
+
+    if(pOutput != stdout)
+    {
+        printf("decoded %u messages\n", (gep::uint32)numMessages);
+    }
+    return 0;
+}
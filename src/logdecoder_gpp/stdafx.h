@@ -0,0 +1,14 @@
+#pragma once
+
+// disable security warnings
+#define _CRT_SECURE_NO_WARNINGS
+
+#include <string>
+#include <stdio.h>
+
+#include "gep/gepmodule.h"
+#include "gep/common.h"
+#include "gep/memory/allocator.h"
+#include "gep/ArrayPtr.h"
+
+#include <Windows.h>
@@ -0,0 +1,63 @@
+#pragma once
+
+#include "gep/threading/thread.h"
+#include "gep/timer.h"
+#include <functional>
+#include <vector>
+
+// Helpers for the unittests that measure performance.
+// Results are printed with UnittestLog::logMessage, there are no hard timing limits
+// because the numbers depend too much on the machine the tests run on.
+
+/// \brief thread that runs a function
+class FunctionThread : public gep::Thread
+{
+    std::function<void()> m_function;
+public:
+    FunctionThread(const std::function<void()>& function) : m_function(function) {}
+
+    virtual void run() override { m_function(); }
+};
+
+/// \brief runs the given function on numThreads threads at the same time and returns the wall clock time in seconds
+inline float runOnThreads(size_t numThreads, const std::function<void(size_t threadIndex)>& function)
+{
+    volatile LONG numReady = 0;
+    volatile bool go = false;
+    std::vector<FunctionThread*> threads;
+    for(size_t i=0; i < numThreads; i++)
+    {
+        threads.push_back(new FunctionThread([&, i](){
+            InterlockedIncrement(&numReady);
+            while(!go) { YieldProcessor(); }
+            function(i);
+        }));
+        threads.back()->start();
+    }
+    while(numReady < (LONG)numThreads) { Sleep(0); }
+
+    gep::Timer timer;
+    gep::PointInTime start(timer);
+    go = true;
+    for(auto pThread : threads)
+    {
+        pThread->join();
+    }
+    gep::PointInTime end(timer);
+
+    for(auto pThread : threads)
+    {
+        delete pThread;
+    }
+    return end - start;
+}
+
+/// \brief measures how long it takes to run the given function in seconds
+inline float measureTime(const std::function<void()>& function)
+{
+    gep::Timer timer;
+    gep::PointInTime start(timer);
+    function();
+    gep::PointInTime end(timer);
+    return end - start;
+}
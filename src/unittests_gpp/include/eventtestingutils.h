@@ -112,6 +112,11 @@ class TestScriptingManager : public gep::IScriptingManager
     virtual void setImportantScriptsRoot(const std::string&) override {}
     virtual gep::int32 memoryUsed() const override { return 0; }
     virtual void collectGarbage() override {}
+    virtual const gep::ScriptGarbageCollectionStatistics& getGarbageCollectionStatistics() const override
+    {
+        static gep::ScriptGarbageCollectionStatistics statistics;
+        return statistics;
+    }
     virtual void debugBreak(const char*) const override {}
     virtual void bindEnum(const char* enumName, ...) override {}
     virtual void initialize() override {}
@@ -50,6 +50,10 @@ namespace gpp
         virtual void deregisterSink(gep::ILogSink* pSink) override
         {
         }
+        virtual void flush() override
+        {
+            fflush(stdout);
+        }
 
     private:
 
@@ -0,0 +1,570 @@
+#include "stdafx.h"
+#include "Test_Container.h"
+#include "benchmarkUtils.h"
+#include "gep/container/hashmap.h"
+#include <unordered_map>
+#include <string>
+
+namespace
+{
+    // The linear probing hash map with tombstones that the Hashmap used before robin hood probing, used as a baseline
+    template <class K, class V, class HashPolicy>
+    class LinearProbingHashmap
+    {
+        enum class State : char { Free, Deleted, Data };
+
+        struct Pair
+        {
+            K key;
+            V value;
+        };
+
+        Pair* m_data;
+        State* m_states;
+        size_t m_reserved;
+        size_t m_fullCount;
+        size_t m_numDeletedEntries;
+
+        size_t getFreeIndex(const K& key) const
+        {
+            size_t index = HashPolicy::hash(key) % m_reserved;
+            while(m_states[index] == State::Data)
+            {
+                index++;
+                if(index == m_reserved)
+                    index = 0;
+            }
+            return index;
+        }
+
+        size_t getIndex(const K& key) const
+        {
+            size_t index = HashPolicy::hash(key) % m_reserved;
+            size_t searched = 0;
+            while(m_states[index] != State::Free && searched < m_reserved)
+            {
+                if(m_states[index] == State::Data && HashPolicy::equals(m_data[index].key, key))
+                    return index;
+                index++;
+                if(index == m_reserved)
+                    index = 0;
+                searched++;
+            }
+            return std::numeric_limits<size_t>::max();
+        }
+
+    public:
+        LinearProbingHashmap() : m_reserved(4), m_fullCount(0), m_numDeletedEntries(0)
+        {
+            m_data = (Pair*)malloc(sizeof(Pair) * m_reserved);
+            m_states = (State*)malloc(m_reserved);
+            memset(m_states, 0, m_reserved);
+        }
+
+        ~LinearProbingHashmap()
+        {
+            for(size_t i=0; i < m_reserved; i++)
+            {
+                if(m_states[i] == State::Data)
+                    m_data[i].~Pair();
+            }
+            free(m_data);
+            free(m_states);
+        }
+
+        V& operator[](const K& key)
+        {
+            size_t index = getIndex(key);
+            if(index == std::numeric_limits<size_t>::max())
+            {
+                m_fullCount++;
+                auto pseudoFullCount = m_fullCount + m_numDeletedEntries;
+                if(pseudoFullCount > ((m_reserved * 3) / 4) || pseudoFullCount >= m_reserved)
+                {
+                    Pair* oldData = m_data;
+                    State* oldStates = m_states;
+                    size_t oldLength = m_reserved;
+                    m_reserved = oldLength * 2;
+                    m_data = (Pair*)malloc(m_reserved * sizeof(Pair));
+                    m_states = (State*)malloc(m_reserved);
+                    memset(m_states, (int)State::Free, m_reserved);
+                    for(size_t i=0; i < oldLength; i++)
+                    {
+                        if(oldStates[i] == State::Data)
+                        {
+                            size_t newIndex = getFreeIndex(oldData[i].key);
+                            new (m_data + newIndex) Pair(std::move(oldData[i]));
+                            m_states[newIndex] = State::Data;
+                            oldData[i].~Pair();
+                        }
+                    }
+                    free(oldData);
+                    free(oldStates);
+                }
+                index = getFreeIndex(key);
+                new (m_data + index) Pair();
+                m_data[index].key = key;
+                if(m_states[index] == State::Deleted)
+                    m_numDeletedEntries--;
+                m_states[index] = State::Data;
+            }
+            return m_data[index].value;
+        }
+
+        bool exists(const K& key) const
+        {
+            return getIndex(key) != std::numeric_limits<size_t>::max();
+        }
+
+        gep::Result remove(const K& key)
+        {
+            size_t index = getIndex(key);
+            if(index == std::numeric_limits<size_t>::max())
+                return gep::FAILURE;
+            if(m_states[(index + 1) % m_reserved] != State::Free)
+            {
+                m_states[index] = State::Deleted;
+                m_numDeletedEntries++;
+            }
+            else
+            {
+                m_states[index] = State::Free;
+            }
+            m_data[index].~Pair();
+            m_fullCount--;
+            return gep::SUCCESS;
+        }
+
+        size_t reserved() const { return m_reserved; }
+    };
+
+    // Paul Hsieh's SuperFastHash, which hashOf used before, used as a baseline
+    unsigned int superFastHash(const void* buf, size_t len, unsigned int seed)
+    {
+        auto data = reinterpret_cast<const unsigned char*>(buf);
+        unsigned int hash = seed;
+        if(len <= 0 || data == nullptr)
+            return 0;
+        int rem = len & 3;
+        len >>= 2;
+        for( ; len > 0; len--)
+        {
+            hash += *reinterpret_cast<const unsigned short*>(data);
+            auto tmp = (*reinterpret_cast<const unsigned short*>(data + 2) << 11) ^ hash;
+            hash = (hash << 16) ^ tmp;
+            data += 2 * sizeof(unsigned short);
+            hash += hash >> 11;
+        }
+        switch(rem)
+        {
+        case 3: hash += *reinterpret_cast<const unsigned short*>(data);
+            hash ^= hash << 16;
+            hash ^= data[sizeof(unsigned short)] << 18;
+            hash += hash >> 11;
+            break;
+        case 2: hash += *reinterpret_cast<const unsigned short*>(data);
+            hash ^= hash << 11;
+            hash += hash >> 17;
+            break;
+        case 1: hash += *data;
+            hash ^= hash << 10;
+            hash += hash >> 1;
+            break;
+        default:
+            break;
+        }
+        hash ^= hash << 3;
+        hash += hash >> 5;
+        hash ^= hash << 4;
+        hash += hash >> 17;
+        hash ^= hash << 25;
+        hash += hash >> 6;
+        return hash;
+    }
+
+    // std::unordered_map with the same hash function as the other maps
+    template <class K, class HashPolicy>
+    struct StdHasher
+    {
+        size_t operator()(const K& key) const { return HashPolicy::hash(key); }
+    };
+
+    template <class K, class V, class HashPolicy>
+    class StdUnorderedMap : public std::unordered_map<K, V, StdHasher<K, HashPolicy>>
+    {
+    public:
+        bool exists(const K& key) const { return this->find(key) != this->end(); }
+        gep::Result remove(const K& key) { return this->erase(key) > 0 ? gep::SUCCESS : gep::FAILURE; }
+        size_t reserved() const { return this->bucket_count(); }
+    };
+
+    template <class K, class V, class HashPolicy>
+    class RobinHoodHashmap : public gep::Hashmap<K, V, HashPolicy>
+    {
+    };
+
+    // simple deterministic random numbers, so every map sees the same keys
+    struct XorShift
+    {
+        gep::uint32 state;
+        XorShift(gep::uint32 seed) : state(seed) {}
+        gep::uint32 next()
+        {
+            state ^= state << 13;
+            state ^= state >> 17;
+            state ^= state << 5;
+            return state;
+        }
+    };
+
+    std::string makeStringKey(gep::uint32 value)
+    {
+        char buffer[32];
+        sprintf_s(buffer, GEP_ARRAY_SIZE(buffer), "object_%08x", value);
+        return buffer;
+    }
+
+    struct HashmapTimings
+    {
+        float insert, hit, miss, churn;
+        size_t reserved;
+    };
+
+    // keys[0, count) are inserted, keys[count, 2 * count) are never inserted
+    template <class Map, class K>
+    HashmapTimings measureHashmap(const std::vector<K>& keys, size_t count, size_t numChurnOperations, size_t& checksum)
+    {
+        HashmapTimings timings;
+        Map map;
+        timings.insert = measureTime([&](){
+            for(size_t i=0; i < count; i++)
+                map[keys[i]] = (gep::uint32)i;
+        });
+        timings.hit = measureTime([&](){
+            for(size_t i=0; i < count; i++)
+                checksum += map[keys[i]];
+        });
+        timings.miss = measureTime([&](){
+            for(size_t i=count; i < 2 * count; i++)
+                checksum += map.exists(keys[i]) ? 1 : 0;
+        });
+        // remove a present key and insert a missing one, the number of elements stays the same
+        timings.churn = measureTime([&](){
+            XorShift random(1234);
+            std::vector<size_t> present(count), missing(count);
+            for(size_t i=0; i < count; i++)
+            {
+                present[i] = i;
+                missing[i] = count + i;
+            }
+            for(size_t i=0; i < numChurnOperations; i++)
+            {
+                size_t& presentKey = present[random.next() % count];
+                size_t& missingKey = missing[i % count];
+                map.remove(keys[presentKey]);
+                map[keys[missingKey]] = (gep::uint32)i;
+                std::swap(presentKey, missingKey);
+            }
+        });
+        timings.reserved = map.reserved();
+        return timings;
+    }
+
+    template <class K, class HashPolicy>
+    void runHashmapBenchmark(gep::UnittestLog& log, const char* keyName, const std::function<K(gep::uint32)>& makeKey)
+    {
+        const char* mapNames[] = { "linear probing", "robin hood", "std::unordered_map" };
+        size_t sizes[] = { 1000, 100000 };
+
+        log.logMessage("  %s keys, ns per operation:\n", keyName);
+        log.logMessage("    elements | map                | insert |    hit |   miss |  churn | slots after churn\n");
+        for(size_t s=0; s < GEP_ARRAY_SIZE(sizes); s++)
+        {
+            const size_t count = sizes[s];
+            const size_t numChurnOperations = count * 4;
+
+            // unique keys, the first half gets inserted
+            std::vector<K> keys;
+            std::unordered_map<K, bool, StdHasher<K, HashPolicy>> used;
+            XorShift random(42);
+            while(keys.size() < 2 * count)
+            {
+                K key = makeKey(random.next());
+                if(used.insert(std::make_pair(key, true)).second)
+                    keys.push_back(key);
+            }
+
+            size_t checksum = 0;
+            HashmapTimings timings[3];
+            timings[0] = measureHashmap<LinearProbingHashmap<K, gep::uint32, HashPolicy>>(keys, count, numChurnOperations, checksum);
+            timings[1] = measureHashmap<RobinHoodHashmap<K, gep::uint32, HashPolicy>>(keys, count, numChurnOperations, checksum);
+            timings[2] = measureHashmap<StdUnorderedMap<K, gep::uint32, HashPolicy>>(keys, count, numChurnOperations, checksum);
+
+            for(size_t m=0; m < GEP_ARRAY_SIZE(timings); m++)
+            {
+                const float toNs = 1e9f / count;
+                log.logMessage("    %8u | %-18s | %6.1f | %6.1f | %6.1f | %6.1f | %u\n",
+                    (gep::uint32)count, mapNames[m],
+                    timings[m].insert * toNs,
+                    timings[m].hit * toNs,
+                    timings[m].miss * toNs,
+                    timings[m].churn * 1e9f / numChurnOperations,
+                    (gep::uint32)timings[m].reserved);
+            }
+            GEP_ASSERT(checksum != 0);
+        }
+    }
+}
+
+GEP_UNITTEST_TEST(Container, Hashmap)
+{
+    // insert, lookup and remove
+    {
+        gep::Hashmap<int, int> map;
+        for(int i=0; i < 1000; i++)
+            map[i] = i * 2;
+        GEP_ASSERT(map.count() == 1000);
+        GEP_ASSERT((map.reserved() & (map.reserved() - 1)) == 0, "capacity is not a power of two", map.reserved());
+        for(int i=0; i < 1000; i++)
+        {
+            int value = 0;
+            GEP_ASSERT(map.tryGet(i, value) == gep::SUCCESS);
+            GEP_ASSERT(value == i * 2, "wrong value", i, value);
+        }
+        GEP_ASSERT(!map.exists(1000));
+        GEP_ASSERT(!map.exists(-1));
+
+        for(int i=0; i < 1000; i += 2)
+            GEP_ASSERT(map.remove(i) == gep::SUCCESS);
+        GEP_ASSERT(map.remove(0) == gep::FAILURE);
+        GEP_ASSERT(map.count() == 500);
+        for(int i=0; i < 1000; i++)
+            GEP_ASSERT(map.exists(i) == (i % 2 == 1), "wrong entry after remove", i);
+
+        size_t numIterated = 0;
+        for(auto& pair : map)
+        {
+            GEP_ASSERT(pair.value == pair.key * 2);
+            numIterated++;
+        }
+        GEP_ASSERT(numIterated == 500);
+
+        map.clear();
+        GEP_ASSERT(map.count() == 0);
+        GEP_ASSERT(map.begin() == map.end());
+        GEP_ASSERT(!map.exists(1));
+    }
+
+    // random operations compared against std::unordered_map, with a hash that produces many collisions
+    {
+        struct CollidingHashPolicy
+        {
+            static unsigned int hash(const gep::uint32& key) { return key & 0xFF; }
+            static bool equals(const gep::uint32& lhs, const gep::uint32& rhs) { return lhs == rhs; }
+        };
+        gep::Hashmap<gep::uint32, gep::uint32, CollidingHashPolicy> map;
+        std::unordered_map<gep::uint32, gep::uint32> reference;
+        XorShift random(7);
+        for(size_t i=0; i < 20000; i++)
+        {
+            gep::uint32 key = random.next() % 2048;
+            if(random.next() % 3 == 0)
+            {
+                bool removed = map.remove(key) == gep::SUCCESS;
+                GEP_ASSERT(removed == (reference.erase(key) > 0), "remove result differs", key);
+            }
+            else
+            {
+                map[key] = (gep::uint32)i;
+                reference[key] = (gep::uint32)i;
+            }
+        }
+        GEP_ASSERT(map.count() == reference.size());
+        for(gep::uint32 key=0; key < 2048; key++)
+        {
+            auto it = reference.find(key);
+            gep::uint32 value = 0;
+            if(it == reference.end())
+            {
+                GEP_ASSERT(map.tryGet(key, value) == gep::FAILURE, "removed key is still there", key);
+            }
+            else
+            {
+                GEP_ASSERT(map.tryGet(key, value) == gep::SUCCESS, "key is missing", key);
+                GEP_ASSERT(value == it->second, "wrong value", key, value, it->second);
+            }
+        }
+    }
+
+    // removeWhere visits every entry exactly once, even though removing shifts entries back
+    {
+        gep::Hashmap<gep::uint32, gep::uint32, gep::DontHashPolicy> map;
+        for(gep::uint32 i=0; i < 3000; i++)
+            map[i * 7] = i;
+        std::unordered_map<gep::uint32, int> visited;
+        size_t removed = map.removeWhere([&](gep::uint32& key, gep::uint32& value){
+            visited[key]++;
+            return value % 3 == 0;
+        });
+        GEP_ASSERT(removed == 1000, "wrong number of removed entries", removed);
+        GEP_ASSERT(visited.size() == 3000);
+        for(auto& entry : visited)
+            GEP_ASSERT(entry.second == 1, "entry visited more than once", entry.first, entry.second);
+        for(gep::uint32 i=0; i < 3000; i++)
+            GEP_ASSERT(map.exists(i * 7) == (i % 3 != 0), "wrong entry after removeWhere", i);
+    }
+
+    // non trivial keys and values, copy and move
+    {
+        gep::Hashmap<std::string, std::string, gep::StringHashPolicy> map;
+        for(gep::uint32 i=0; i < 500; i++)
+            map[makeStringKey(i)] = makeStringKey(i * 3);
+
+        gep::Hashmap<std::string, std::string, gep::StringHashPolicy> copy(map);
+        for(gep::uint32 i=0; i < 500; i += 5)
+            map.remove(makeStringKey(i));
+        GEP_ASSERT(copy.count() == 500);
+        GEP_ASSERT(map.count() == 400);
+        for(gep::uint32 i=0; i < 500; i++)
+            GEP_ASSERT(copy[makeStringKey(i)] == makeStringKey(i * 3));
+
+        gep::Hashmap<std::string, std::string, gep::StringHashPolicy> moved(std::move(map));
+        GEP_ASSERT(map.count() == 0);
+        GEP_ASSERT(moved.count() == 400);
+        GEP_ASSERT(!moved.exists(makeStringKey(0)));
+        GEP_ASSERT(moved.exists(makeStringKey(1)));
+
+        // a moved from map can be used again
+        map[makeStringKey(1)] = "reused";
+        GEP_ASSERT(map.count() == 1);
+        GEP_ASSERT(map[makeStringKey(1)] == "reused");
+
+        size_t numKeys = 0;
+        for(auto& key : moved.keys())
+        {
+            GEP_ASSERT(moved.exists(key));
+            numKeys++;
+        }
+        GEP_ASSERT(numKeys == 400);
+    }
+}
+
+GEP_UNITTEST_TEST(Container, HashmapPerformance)
+{
+    log.logMessage("Hashmap performance, churn removes a random element and inserts a new one:\n");
+    runHashmapBenchmark<gep::uint32, gep::StdHashPolicy>(log, "uint32", [](gep::uint32 value){ return value; });
+    runHashmapBenchmark<std::string, gep::StringHashPolicy>(log, "string", &makeStringKey);
+}
+
+GEP_UNITTEST_TEST(Container, HashOf)
+{
+    std::vector<unsigned char> data(8192 + 16);
+    XorShift random(99);
+    for(auto& byte : data)
+        byte = (unsigned char)random.next();
+
+    // the hash only depends on the content, not on the alignment
+    for(size_t len=0; len <= 1100; len++)
+    {
+        const unsigned int hash = gep::hashOf(&data[0], len);
+        GEP_ASSERT(hash == gep::hashOf(&data[0], len), "hash is not deterministic", len);
+        std::vector<unsigned char> copy(data.begin(), data.begin() + len + 3);
+        GEP_ASSERT(hash == gep::hashOf(&copy[3], len) || memcmp(&copy[3], &data[0], len) != 0);
+        memmove(&copy[3], &copy[0], len);
+        GEP_ASSERT(hash == gep::hashOf(&copy[3], len), "hash depends on the alignment", len);
+    }
+
+    // no collisions between the prefixes of the data, every byte changes the hash, the seed changes the hash
+    {
+        std::unordered_map<unsigned int, size_t> seen;
+        for(size_t len=0; len <= 4096; len++)
+        {
+            const unsigned int hash = gep::hashOf(&data[0], len);
+            GEP_ASSERT(seen.insert(std::make_pair(hash, len)).second, "prefixes have the same hash", len, seen[hash]);
+        }
+        size_t lengths[] = { 1, 3, 4, 7, 8, 15, 16, 17, 33, 48, 49, 64, 100, 256, 257, 300, 1024, 1025, 4000 };
+        for(size_t l=0; l < GEP_ARRAY_SIZE(lengths); l++)
+        {
+            const size_t len = lengths[l];
+            const unsigned int hash = gep::hashOf(&data[0], len);
+            GEP_ASSERT(hash != gep::hashOf(&data[0], len, 1), "seed does not change the hash", len);
+            for(size_t i=0; i < len; i++)
+            {
+                data[i] ^= 0x10;
+                GEP_ASSERT(hash != gep::hashOf(&data[0], len), "byte does not change the hash", len, i);
+                data[i] ^= 0x10;
+            }
+        }
+    }
+
+    // the bits of the hash are evenly distributed for small integer keys
+    {
+        size_t bitCounts[32] = {};
+        const gep::uint32 numKeys = 1 << 16;
+        for(gep::uint32 key=0; key < numKeys; key++)
+        {
+            const unsigned int hash = gep::hashOf(&key, sizeof(key));
+            for(int bit=0; bit < 32; bit++)
+                bitCounts[bit] += (hash >> bit) & 1;
+        }
+        for(int bit=0; bit < 32; bit++)
+            GEP_ASSERT(bitCounts[bit] > numKeys * 48 / 100 && bitCounts[bit] < numKeys * 52 / 100, "hash bit is biased", bit, bitCounts[bit]);
+    }
+}
+
+GEP_UNITTEST_TEST(Container, StringHash)
+{
+    char buffer[32];
+    strcpy_s(buffer, GEP_ARRAY_SIZE(buffer), "RenderComponent");
+    const gep::StringHash literal("RenderComponent");
+    const gep::StringHash runtime = gep::StringHash::fromString(buffer);
+    GEP_ASSERT(literal.getHash() == runtime.getHash(), "compile time and runtime hash differ", literal.getHash(), runtime.getHash());
+    GEP_ASSERT(literal == runtime);
+    GEP_ASSERT(gep::StringHash("") == gep::StringHash::fromString(""));
+    GEP_ASSERT(gep::StringHash("RenderComponent") != gep::StringHash("ScriptComponent"));
+    GEP_ASSERT(gep::StringHash("a").getHash() != gep::StringHash("b").getHash());
+
+    gep::Hashmap<gep::StringHash, int, gep::StringHashPolicy> map;
+    map["CameraComponent"] = 1;
+    map["RenderComponent"] = 2;
+    map["ScriptComponent"] = 3;
+    GEP_ASSERT(map.count() == 3);
+    GEP_ASSERT(map[runtime] == 2);
+    GEP_ASSERT(map.exists("CameraComponent"));
+    GEP_ASSERT(!map.exists("AudioComponent"));
+}
+
+GEP_UNITTEST_TEST(Container, HashOfPerformance)
+{
+    const size_t totalBytes = 64 * 1024 * 1024;
+    std::vector<unsigned char> data(4096 + 64);
+    XorShift random(5);
+    for(auto& byte : data)
+        byte = (unsigned char)random.next();
+
+    log.logMessage("hashOf throughput in MB/s:\n");
+    log.logMessage("    key bytes | superFastHash |    hashOf | speedup\n");
+    for(size_t len = 4; len <= 4096; len *= 2)
+    {
+        const size_t numKeys = totalBytes / len;
+        unsigned int checksum = 0;
+        // called through a pointer, so neither function gets inlined into the loop
+        unsigned int (*volatile pHashFunction)(const void*, size_t, unsigned int) = nullptr;
+        auto measureHashFunction = [&](){
+            auto hashFunction = pHashFunction;
+            return measureTime([&](){
+                // vary the offset, so the keys are not all aligned
+                for(size_t i=0; i < numKeys; i++)
+                    checksum += hashFunction(&data[i & 63], len, 0);
+            });
+        };
+        pHashFunction = &superFastHash;
+        const float oldTime = measureHashFunction();
+        pHashFunction = &gep::hashOf;
+        const float newTime = measureHashFunction();
+        const float megabytes = (float)(numKeys * len) / (1024.0f * 1024.0f);
+        log.logMessage("    %9u | %13.0f | %9.0f | %6.2fx\n",
+            (gep::uint32)len, megabytes / oldTime, megabytes / newTime, oldTime / GEP_MAX(newTime, 1e-6f));
+        GEP_ASSERT(checksum != 0);
+    }
+}
@@ -0,0 +1,401 @@
+#include "stdafx.h"
+#include "Test_GameObjects.h"
+#include "benchmarkUtils.h"
+#include "gpp/componentPool.h"
+#include "gep/container/hashmap.h"
+#include "gep/threading/taskQueue.h"
+#include <thread>
+#include <vector>
+
+namespace
+{
+    class BenchmarkComponentBase
+    {
+    public:
+        virtual ~BenchmarkComponentBase() {}
+        virtual void update(float elapsedMs) = 0;
+    };
+
+    // integrates a position, similar to what a simple physics component does
+    class MovementComponent : public BenchmarkComponentBase
+    {
+    public:
+        float position[3];
+        float velocity[3];
+
+        MovementComponent()
+        {
+            for(int i=0; i < 3; i++)
+            {
+                position[i] = 0.0f;
+                velocity[i] = 1.0f + i;
+            }
+        }
+
+        virtual void update(float elapsedMs) override
+        {
+            for(int i=0; i < 3; i++)
+                position[i] += velocity[i] * elapsedMs;
+        }
+    };
+
+    // advances a time, similar to what a simple animation component does
+    class AnimationTimeComponent : public BenchmarkComponentBase
+    {
+    public:
+        float time;
+        float speed;
+        float length;
+
+        AnimationTimeComponent() : time(0.0f), speed(1.0f), length(1000.0f) {}
+
+        virtual void update(float elapsedMs) override
+        {
+            time += elapsedMs * speed;
+            if(time > length)
+                time -= length;
+        }
+    };
+
+    // The storage the game objects used before component pools:
+    // every object has a heap allocated update queue of heap allocated components
+    // and the objects are updated by walking the guid hash map.
+    struct LegacyGameObject
+    {
+        gep::DynamicArray<BenchmarkComponentBase*> updateQueue;
+
+        void update(float elapsedMs)
+        {
+            for(auto pComponent : updateQueue)
+                pComponent->update(elapsedMs);
+        }
+    };
+
+    struct TestComponent
+    {
+        static int s_numAlive;
+        int numUpdates;
+
+        TestComponent() : numUpdates(0) { s_numAlive++; }
+        ~TestComponent() { s_numAlive--; }
+
+        void update(float elapsedMs) { numUpdates++; }
+    };
+
+    int TestComponent::s_numAlive = 0;
+
+    struct ParallelTestComponent
+    {
+        volatile LONG numUpdates;
+
+        ParallelTestComponent() : numUpdates(0) {}
+
+        void update(float elapsedMs) { InterlockedIncrement(&numUpdates); }
+    };
+
+    // integrates a rigid body with gravity and damping, similar to what the physics component simulates
+    struct SimulatedPhysicsComponent
+    {
+        float position[3];
+        float velocity[3];
+        float damping;
+
+        SimulatedPhysicsComponent() : damping(0.99f)
+        {
+            for(int i=0; i < 3; i++)
+            {
+                position[i] = 0.0f;
+                velocity[i] = 1.0f + i;
+            }
+        }
+
+        void update(float elapsedMs)
+        {
+            const float seconds = elapsedMs * 0.001f;
+            velocity[1] -= 9.81f * seconds;
+            for(int i=0; i < 3; i++)
+            {
+                velocity[i] *= damping;
+                position[i] += velocity[i] * seconds;
+            }
+            if(position[1] < 0.0f)
+            {
+                position[1] = 0.0f;
+                velocity[1] = -velocity[1];
+            }
+        }
+    };
+
+    // blends two poses of a small skeleton, similar to what the animation component does
+    struct SimulatedAnimationComponent
+    {
+        static const int NUM_BONES = 16;
+        float time;
+        float pose[NUM_BONES][4];
+
+        SimulatedAnimationComponent() : time(0.0f)
+        {
+            for(int bone=0; bone < NUM_BONES; bone++)
+            {
+                for(int i=0; i < 4; i++)
+                    pose[bone][i] = 0.0f;
+            }
+        }
+
+        void update(float elapsedMs)
+        {
+            time += elapsedMs * 0.001f;
+            if(time > 1.0f)
+                time -= 1.0f;
+            for(int bone=0; bone < NUM_BONES; bone++)
+            {
+                const float from = (float)bone;
+                const float to = (float)(bone + 1);
+                for(int i=0; i < 4; i++)
+                    pose[bone][i] = from + (to - from) * time * (i + 1) * 0.25f;
+            }
+        }
+    };
+}
+
+GEP_UNITTEST_TEST(GameObjects, ComponentPool)
+{
+    {
+        gpp::ComponentPool<TestComponent> pool;
+        const gep::uint32 numComponents = gpp::ComponentPool<TestComponent>::COMPONENTS_PER_BLOCK * 3 + 5;
+        std::vector<TestComponent*> components;
+        std::vector<gep::uint32> slots;
+        for(gep::uint32 i=0; i < numComponents; i++)
+        {
+            gep::uint32 slot = 0;
+            components.push_back(pool.createComponent(slot));
+            slots.push_back(slot);
+            GEP_ASSERT(pool.getComponent(slot) == components.back());
+        }
+        GEP_ASSERT(pool.count() == numComponents);
+        GEP_ASSERT(TestComponent::s_numAlive == (int)numComponents);
+
+        // new components are not updated until they are enabled
+        pool.updateComponents(1.0f);
+        for(auto pComponent : components)
+            GEP_ASSERT(pComponent->numUpdates == 0);
+
+        for(gep::uint32 i=0; i < numComponents; i += 2)
+            pool.setUpdateEnabled(slots[i], true);
+        pool.updateComponents(1.0f);
+        pool.updateComponents(1.0f);
+        for(gep::uint32 i=0; i < numComponents; i++)
+            GEP_ASSERT(components[i]->numUpdates == ((i % 2 == 0) ? 2 : 0), "wrong number of updates", i, components[i]->numUpdates);
+
+        // freed slots are reused, the other components keep their address
+        pool.destroyComponent(slots[3]);
+        pool.destroyComponent(slots[40]);
+        GEP_ASSERT(pool.count() == numComponents - 2);
+        GEP_ASSERT(TestComponent::s_numAlive == (int)numComponents - 2);
+        gep::uint32 slot = 0;
+        auto pReused = pool.createComponent(slot);
+        GEP_ASSERT(slot == slots[3], "first free slot was not reused", slot);
+        GEP_ASSERT(pReused == components[3]);
+        GEP_ASSERT(pReused->numUpdates == 0);
+        pool.createComponent(slot);
+        GEP_ASSERT(slot == slots[40], "first free slot was not reused", slot);
+        for(gep::uint32 i=0; i < numComponents; i++)
+            GEP_ASSERT(pool.getComponent(slots[i]) == components[i], "component moved", i);
+
+        // destroyed components are not updated anymore
+        pool.destroyComponent(slots[0]);
+        pool.updateComponents(1.0f);
+        GEP_ASSERT(components[2]->numUpdates == 3);
+        GEP_ASSERT(components[40]->numUpdates == 0);
+
+        for(gep::uint32 i=1; i < numComponents; i++)
+            pool.destroyComponent(slots[i]);
+        GEP_ASSERT(pool.count() == 0);
+    }
+    GEP_ASSERT(TestComponent::s_numAlive == 0);
+}
+
+GEP_UNITTEST_TEST(GameObjects, ComponentPoolPerformance)
+{
+    const int numFrames = 10;
+    size_t numObjectsToTest[] = { 10000, 100000, 1000000 };
+
+    log.logMessage("Updating a movement and an animation component per game object, ms per frame:\n");
+    log.logMessage("    game objects | per object components | component pools | speedup\n");
+    for(size_t n=0; n < GEP_ARRAY_SIZE(numObjectsToTest); n++)
+    {
+        const size_t numObjects = numObjectsToTest[n];
+        float checksum = 0.0f;
+
+        float legacyTime;
+        {
+            gep::Hashmap<std::string, LegacyGameObject*, gep::StringHashPolicy> gameObjects;
+            char guid[32];
+            for(size_t i=0; i < numObjects; i++)
+            {
+                auto pGameObject = new LegacyGameObject();
+                pGameObject->updateQueue.append(new MovementComponent());
+                pGameObject->updateQueue.append(new AnimationTimeComponent());
+                sprintf_s(guid, GEP_ARRAY_SIZE(guid), "object%u", (gep::uint32)i);
+                gameObjects[guid] = pGameObject;
+            }
+
+            legacyTime = measureTime([&](){
+                for(int frame=0; frame < numFrames; frame++)
+                {
+                    for(auto pGameObject : gameObjects.values())
+                        pGameObject->update(16.0f);
+                }
+            });
+
+            for(auto pGameObject : gameObjects.values())
+            {
+                checksum += static_cast<MovementComponent*>(pGameObject->updateQueue[0])->position[0];
+                for(auto pComponent : pGameObject->updateQueue)
+                    delete pComponent;
+                delete pGameObject;
+            }
+        }
+
+        float poolTime;
+        {
+            gpp::ComponentPool<MovementComponent> movementPool;
+            gpp::ComponentPool<AnimationTimeComponent> animationPool;
+            std::vector<gep::uint32> movementSlots(numObjects), animationSlots(numObjects);
+            for(size_t i=0; i < numObjects; i++)
+            {
+                movementPool.createComponent(movementSlots[i]);
+                movementPool.setUpdateEnabled(movementSlots[i], true);
+                animationPool.createComponent(animationSlots[i]);
+                animationPool.setUpdateEnabled(animationSlots[i], true);
+            }
+
+            poolTime = measureTime([&](){
+                for(int frame=0; frame < numFrames; frame++)
+                {
+                    movementPool.updateComponents(16.0f);
+                    animationPool.updateComponents(16.0f);
+                }
+            });
+
+            for(size_t i=0; i < numObjects; i++)
+            {
+                checksum -= movementPool.getComponent(movementSlots[i])->position[0];
+                movementPool.destroyComponent(movementSlots[i]);
+                animationPool.destroyComponent(animationSlots[i]);
+            }
+        }
+
+        GEP_ASSERT(checksum == 0.0f, "both storages have to produce the same result", checksum);
+        log.logMessage("    %12u | %21.3f | %15.3f | %6.2fx\n",
+            (gep::uint32)numObjects,
+            legacyTime * 1000.0f / numFrames,
+            poolTime * 1000.0f / numFrames,
+            legacyTime / GEP_MAX(poolTime, 1e-6f));
+    }
+}
+
+GEP_UNITTEST_TEST(GameObjects, ComponentPoolParallelUpdate)
+{
+    gep::TaskQueue queue(4);
+    const gep::uint32 COMPONENTS_PER_BLOCK = gpp::ComponentPool<ParallelTestComponent>::COMPONENTS_PER_BLOCK;
+    const size_t numComponentsPerPool[] = { 0, 1, COMPONENTS_PER_BLOCK, COMPONENTS_PER_BLOCK * 7 + 3, COMPONENTS_PER_BLOCK * 40 };
+
+    gpp::ComponentPool<ParallelTestComponent> pools[GEP_ARRAY_SIZE(numComponentsPerPool)];
+    gep::DynamicArray<gpp::IComponentPool*> poolPtrs;
+    std::vector<ParallelTestComponent*> components[GEP_ARRAY_SIZE(numComponentsPerPool)];
+    std::vector<gep::uint32> slots[GEP_ARRAY_SIZE(numComponentsPerPool)];
+    for(size_t p=0; p < GEP_ARRAY_SIZE(numComponentsPerPool); p++)
+    {
+        poolPtrs.append(&pools[p]);
+        for(size_t i=0; i < numComponentsPerPool[p]; i++)
+        {
+            gep::uint32 slot = 0;
+            components[p].push_back(pools[p].createComponent(slot));
+            slots[p].push_back(slot);
+            // leave some components disabled
+            if(i % 5 != 4)
+                pools[p].setUpdateEnabled(slot, true);
+        }
+    }
+
+    const size_t blocksPerTask[] = { 1, 3, 100 };
+    for(size_t b=0; b < GEP_ARRAY_SIZE(blocksPerTask); b++)
+    {
+        gpp::updateComponentPoolsInParallel(queue, poolPtrs.toArray(), 1.0f, blocksPerTask[b]);
+    }
+
+    for(size_t p=0; p < GEP_ARRAY_SIZE(numComponentsPerPool); p++)
+    {
+        for(size_t i=0; i < components[p].size(); i++)
+        {
+            const LONG expected = (i % 5 != 4) ? (LONG)GEP_ARRAY_SIZE(blocksPerTask) : 0;
+            GEP_ASSERT(components[p][i]->numUpdates == expected, "component was not updated exactly once per call", p, i, components[p][i]->numUpdates);
+        }
+        for(auto slot : slots[p])
+            pools[p].destroyComponent(slot);
+    }
+
+    // no pools and empty pools
+    gpp::updateComponentPoolsInParallel(queue, gep::ArrayPtr<gpp::IComponentPool*>(), 1.0f);
+    gpp::updateComponentPoolsInParallel(queue, poolPtrs.toArray(), 1.0f);
+}
+
+GEP_UNITTEST_TEST(GameObjects, ComponentPoolParallelPerformance)
+{
+    const int numFrames = 20;
+    const size_t numObjects = 25000;
+    const size_t numWorkersToTest[] = { 1, 2, 4, 8 };
+
+    gpp::ComponentPool<SimulatedPhysicsComponent> physicsPool;
+    gpp::ComponentPool<SimulatedAnimationComponent> animationPool;
+    std::vector<gep::uint32> physicsSlots(numObjects), animationSlots(numObjects);
+    for(size_t i=0; i < numObjects; i++)
+    {
+        physicsPool.createComponent(physicsSlots[i]);
+        physicsPool.setUpdateEnabled(physicsSlots[i], true);
+        animationPool.createComponent(animationSlots[i]);
+        animationPool.setUpdateEnabled(animationSlots[i], true);
+    }
+    gep::DynamicArray<gpp::IComponentPool*> pools;
+    pools.append(&physicsPool);
+    pools.append(&animationPool);
+
+    // without several cores the workers only add their overhead
+    log.logMessage("Updating %u simulated physics and %u simulated animation components on %u hardware threads:\n",
+        (gep::uint32)numObjects, (gep::uint32)numObjects, std::thread::hardware_concurrency());
+    log.logMessage("    workers | ms per frame | speedup\n");
+
+    const float serialTime = measureTime([&](){
+        for(int frame=0; frame < numFrames; frame++)
+        {
+            physicsPool.updateComponents(16.0f);
+            animationPool.updateComponents(16.0f);
+        }
+    });
+    log.logMessage("     serial | %12.3f | %6.2fx\n", serialTime * 1000.0f / numFrames, 1.0f);
+
+    for(size_t n=0; n < GEP_ARRAY_SIZE(numWorkersToTest); n++)
+    {
+        gep::TaskQueue queue(numWorkersToTest[n]);
+        // warm up, so the workers are running
+        gpp::updateComponentPoolsInParallel(queue, pools.toArray(), 16.0f);
+
+        const float parallelTime = measureTime([&](){
+            for(int frame=0; frame < numFrames; frame++)
+            {
+                gpp::updateComponentPoolsInParallel(queue, pools.toArray(), 16.0f);
+            }
+        });
+        log.logMessage("    %7u | %12.3f | %6.2fx\n",
+            (gep::uint32)numWorkersToTest[n],
+            parallelTime * 1000.0f / numFrames,
+            serialTime / GEP_MAX(parallelTime, 1e-6f));
+    }
+
+    for(size_t i=0; i < numObjects; i++)
+    {
+        physicsPool.destroyComponent(physicsSlots[i]);
+        animationPool.destroyComponent(animationSlots[i]);
+    }
+}
@@ -0,0 +1,132 @@
+#include "stdafx.h"
+#include "Test_GameObjects.h"
+#include "benchmarkUtils.h"
+#include "gpp/handleTable.h"
+#include "gep/container/hashmap.h"
+#include <vector>
+
+namespace
+{
+    struct TestObject
+    {
+        int value;
+    };
+}
+
+GEP_UNITTEST_TEST(GameObjects, HandleTable)
+{
+    typedef gpp::HandleTable<TestObject>::HandleType TestHandle;
+
+    gpp::HandleTable<TestObject> table;
+    GEP_ASSERT(!table.isAlive(TestHandle()), "default constructed handles are never alive");
+    GEP_ASSERT(!TestHandle().isSet());
+
+    TestObject objects[8];
+    std::vector<TestHandle> handles;
+    for(int i=0; i < 8; i++)
+    {
+        objects[i].value = i;
+        handles.push_back(table.insert(&objects[i]));
+        GEP_ASSERT(handles.back().isSet());
+    }
+    GEP_ASSERT(table.count() == 8);
+    for(int i=0; i < 8; i++)
+    {
+        GEP_ASSERT(table.get(handles[i]) == &objects[i], "wrong object", i);
+        GEP_ASSERT(TestHandle::fromValue(handles[i].getValue()) == handles[i], "handle did not survive the round trip", i);
+    }
+
+    // removed handles are stale, the others stay valid
+    table.remove(handles[2]);
+    table.remove(handles[5]);
+    GEP_ASSERT(table.count() == 6);
+    GEP_ASSERT(table.get(handles[2]) == nullptr);
+    GEP_ASSERT(!table.isAlive(handles[5]));
+    GEP_ASSERT(table.get(handles[3]) == &objects[3]);
+
+    // slots are reused in the order they were freed, with a new generation
+    auto reused = table.insert(&objects[2]);
+    GEP_ASSERT(reused.getIndex() == handles[2].getIndex(), "first freed slot was not reused", reused.getIndex());
+    GEP_ASSERT(reused != handles[2]);
+    GEP_ASSERT(table.get(handles[2]) == nullptr, "stale handle matches a reused slot");
+    GEP_ASSERT(table.get(reused) == &objects[2]);
+    reused = table.insert(&objects[5]);
+    GEP_ASSERT(reused.getIndex() == handles[5].getIndex(), "second freed slot was not reused", reused.getIndex());
+
+    // handles with an index outside of the table are stale
+    GEP_ASSERT(table.get(TestHandle(1000, 1)) == nullptr);
+
+    // a slot only runs through all generations after being reused very often
+    TestObject churnObject;
+    auto first = table.insert(&churnObject);
+    auto churned = first;
+    for(gep::uint32 i=0; i < TestHandle::GENERATION_MASK - 2; i++)
+    {
+        table.remove(churned);
+        churned = table.insert(&churnObject);
+        GEP_ASSERT(churned != first, "generation repeated too early", i);
+        GEP_ASSERT(churned.isSet());
+    }
+
+    table.clear();
+    GEP_ASSERT(table.count() == 0);
+    for(auto handle : handles)
+        GEP_ASSERT(!table.isAlive(handle));
+}
+
+GEP_UNITTEST_TEST(GameObjects, HandleTablePerformance)
+{
+    const size_t numObjects = 100000;
+    const size_t numLookups = 1000000;
+
+    std::vector<TestObject> objects(numObjects);
+    gpp::HandleTable<TestObject> table;
+    gep::Hashmap<std::string, TestObject*, gep::StringHashPolicy> guids;
+    std::vector<gpp::HandleTable<TestObject>::HandleType> handles;
+    std::vector<std::string> guidStrings;
+    char guid[32];
+    for(size_t i=0; i < numObjects; i++)
+    {
+        objects[i].value = (int)i;
+        handles.push_back(table.insert(&objects[i]));
+        sprintf_s(guid, GEP_ARRAY_SIZE(guid), "gameObject%u", (gep::uint32)i);
+        guidStrings.push_back(guid);
+        guids[guid] = &objects[i];
+    }
+
+    // the same pseudo random access pattern for both
+    std::vector<gep::uint32> order(numLookups);
+    gep::uint32 random = 12345;
+    for(size_t i=0; i < numLookups; i++)
+    {
+        random = random * 1664525u + 1013904223u;
+        order[i] = random % numObjects;
+    }
+
+    volatile int guidSum = 0;
+    const float guidTime = measureTime([&](){
+        int sum = 0;
+        for(size_t i=0; i < numLookups; i++)
+        {
+            TestObject* pObject = nullptr;
+            guids.tryGet(guidStrings[order[i]], pObject);
+            sum += pObject->value;
+        }
+        guidSum = sum;
+    });
+
+    volatile int handleSum = 0;
+    const float handleTime = measureTime([&](){
+        int sum = 0;
+        for(size_t i=0; i < numLookups; i++)
+        {
+            sum += table.get(handles[order[i]])->value;
+        }
+        handleSum = sum;
+    });
+
+    GEP_ASSERT(guidSum == handleSum, "both lookups have to find the same objects");
+    log.logMessage("%u lookups in %u objects:\n", (gep::uint32)numLookups, (gep::uint32)numObjects);
+    log.logMessage("    guid hash map: %8.3f ms\n", guidTime * 1000.0f);
+    log.logMessage("    handle table:  %8.3f ms (%.2fx)\n", handleTime * 1000.0f, guidTime / GEP_MAX(handleTime, 1e-6f));
+}
@@ -0,0 +1,137 @@
+#include "stdafx.h"
+#include "Test_GameObjects.h"
+#include "benchmarkUtils.h"
+#include "gpp/objectPool.h"
+#include <vector>
+
+namespace
+{
+    struct TestObject
+    {
+        int value;
+    };
+
+    // counts the allocations of the pool
+    class CountingAllocator : public gep::IAllocator
+    {
+    public:
+        size_t numAllocations;
+
+        CountingAllocator() : numAllocations(0) {}
+
+        virtual void* allocateMemory(size_t size) override
+        {
+            numAllocations++;
+            return malloc(size);
+        }
+
+        virtual void freeMemory(void* mem) override
+        {
+            free(mem);
+        }
+    };
+
+    // stands in for a game object with a few components that own some memory
+    struct SpawnedObject
+    {
+        gep::DynamicArray<float> componentData;
+
+        SpawnedObject() { componentData.resize(64); }
+    };
+}
+
+GEP_UNITTEST_TEST(GameObjects, ObjectPool)
+{
+    CountingAllocator allocator;
+    gpp::ObjectPool<TestObject> pool(&allocator);
+    GEP_ASSERT(pool.acquire() == nullptr, "an empty pool returned an object");
+
+    TestObject objects[8];
+    for(int i=0; i < 8; i++)
+    {
+        objects[i].value = i;
+        pool.add(&objects[i]);
+    }
+    GEP_ASSERT(pool.getNumObjects() == 8);
+    GEP_ASSERT(pool.getNumFree() == 8);
+    GEP_ASSERT(pool.getObjects().length() == 8);
+
+    // every object is handed out once
+    bool acquired[8] = {};
+    std::vector<TestObject*> inUse;
+    for(int i=0; i < 8; i++)
+    {
+        TestObject* pObject = pool.acquire();
+        GEP_ASSERT(pObject != nullptr, "the pool ran out of objects too early", i);
+        GEP_ASSERT(!acquired[pObject->value], "an object was handed out twice", pObject->value);
+        acquired[pObject->value] = true;
+        inUse.push_back(pObject);
+    }
+    GEP_ASSERT(pool.acquire() == nullptr, "an exhausted pool returned an object");
+    GEP_ASSERT(pool.getNumInUse() == 8);
+
+    // the object released last comes back first
+    pool.release(inUse[3]);
+    pool.release(inUse[5]);
+    GEP_ASSERT(pool.getNumFree() == 2);
+    GEP_ASSERT(pool.acquire() == inUse[5]);
+    GEP_ASSERT(pool.acquire() == inUse[3]);
+
+    // spawning and despawning never allocates
+    const size_t numAllocations = allocator.numAllocations;
+    for(int frame=0; frame < 1000; frame++)
+    {
+        for(auto pObject : inUse)
+            pool.release(pObject);
+        for(size_t i=0; i < inUse.size(); i++)
+            inUse[i] = pool.acquire();
+    }
+    GEP_ASSERT(allocator.numAllocations == numAllocations, "acquire or release allocated", allocator.numAllocations - numAllocations);
+    GEP_ASSERT(pool.getNumInUse() == 8);
+
+    // objects can be added while others are in use
+    TestObject added;
+    added.value = 8;
+    pool.add(&added);
+    GEP_ASSERT(pool.acquire() == &added);
+}
+
+GEP_UNITTEST_TEST(GameObjects, ObjectPoolPerformance)
+{
+    const size_t numObjects = 64;
+    const size_t numFrames = 10000;
+
+    std::vector<SpawnedObject*> spawned(numObjects);
+
+    // what scripts had to do before: create the objects when they spawn and destroy them when they despawn
+    const float newDeleteTime = measureTime([&](){
+        for(size_t frame=0; frame < numFrames; frame++)
+        {
+            for(size_t i=0; i < numObjects; i++)
+                spawned[i] = new SpawnedObject();
+            for(size_t i=0; i < numObjects; i++)
+                delete spawned[i];
+        }
+    });
+
+    std::vector<SpawnedObject> objects(numObjects);
+    gpp::ObjectPool<SpawnedObject> pool;
+    for(auto& object : objects)
+        pool.add(&object);
+
+    const float poolTime = measureTime([&](){
+        for(size_t frame=0; frame < numFrames; frame++)
+        {
+            for(size_t i=0; i < numObjects; i++)
+                spawned[i] = pool.acquire();
+            for(size_t i=0; i < numObjects; i++)
+                pool.release(spawned[i]);
+        }
+    });
+    GEP_ASSERT(pool.getNumFree() == numObjects);
+
+    const float scale = 1e9f / (numObjects * numFrames);
+    log.logMessage("spawning and despawning %u objects %u times, ns per object:\n", (gep::uint32)numObjects, (gep::uint32)numFrames);
+    log.logMessage("    new and delete:         %8.1f\n", newDeleteTime * scale);
+    log.logMessage("    acquire and release:    %8.1f (%.2fx)\n", poolTime * scale, newDeleteTime / GEP_MAX(poolTime, 1e-9f));
+}
@@ -0,0 +1,444 @@
+#include "stdafx.h"
+#include "Test_Logging.h"
+#include "benchmarkUtils.h"
+#include "gepimpl/subsystems/logging.h"
+#include "gep/threading/mutex.h"
+#include "gep/utils.h"
+#include "gep/binaryLog.h"
+#include <stdarg.h>
+#include <vector>
+
+namespace
+{
+    // stores every message it takes
+    class CollectingSink : public gep::ILogSink
+    {
+    public:
+        gep::Mutex mutex;
+        std::vector<gep::LogChannel> channels;
+        std::vector<std::string> messages;
+        volatile LONG numFlushes;
+
+        CollectingSink() : numFlushes(0) {}
+
+        virtual void take(gep::LogChannel channel, const char* msg) override
+        {
+            gep::ScopedLock<gep::Mutex> lock(mutex);
+            channels.push_back(channel);
+            messages.push_back(msg);
+        }
+
+        virtual void flush() override
+        {
+            InterlockedIncrement(&numFlushes);
+        }
+    };
+
+    // blocks in take while blocked is set, to simulate a sink that does not keep up
+    class BlockingSink : public gep::ILogSink
+    {
+    public:
+        volatile bool blocked;
+        volatile LONG numWaiting;
+        volatile LONG numTaken;
+
+        BlockingSink() : blocked(false), numWaiting(0), numTaken(0) {}
+
+        virtual void take(gep::LogChannel channel, const char* msg) override
+        {
+            InterlockedIncrement(&numWaiting);
+            while(blocked)
+            {
+                Sleep(0);
+            }
+            InterlockedDecrement(&numWaiting);
+            InterlockedIncrement(&numTaken);
+        }
+
+        void waitUntilBlocking()
+        {
+            while(numWaiting == 0)
+            {
+                Sleep(0);
+            }
+        }
+    };
+
+    // simulates a sink that writes and flushes every message to disk
+    class SlowSink : public gep::ILogSink
+    {
+        float m_secondsPerMessage;
+    public:
+        SlowSink(float secondsPerMessage) : m_secondsPerMessage(secondsPerMessage) {}
+
+        virtual void take(gep::LogChannel channel, const char* msg) override
+        {
+            gep::Timer timer;
+            gep::PointInTime start(timer);
+            while(gep::PointInTime(timer) - start < m_secondsPerMessage)
+            {
+            }
+        }
+    };
+
+    // stores the format string of every deferred message it takes
+    class DeferredCollectingSink : public gep::ILogSink
+    {
+    public:
+        std::vector<const char*> formats;
+        std::vector<std::string> messages;
+
+        virtual void take(gep::LogChannel channel, const char* msg) override
+        {
+            formats.push_back(nullptr);
+            messages.push_back(msg);
+        }
+
+        virtual bool takesDeferredMessages() const override { return true; }
+
+        virtual void takeDeferred(gep::LogChannel channel, const char* fmt, gep::ArrayPtr<const gep::uint8> arguments) override
+        {
+            std::string msg;
+            GEP_ASSERT(gep::formatLogArguments(msg, fmt, arguments), "arguments are missing", fmt);
+            formats.push_back(fmt);
+            messages.push_back(msg);
+        }
+    };
+
+    // a sink that archives deferred messages without formatting them
+    class NullDeferredSink : public gep::ILogSink
+    {
+    public:
+        virtual void take(gep::LogChannel channel, const char* msg) override {}
+        virtual bool takesDeferredMessages() const override { return true; }
+        virtual void takeDeferred(gep::LogChannel channel, const char* fmt, gep::ArrayPtr<const gep::uint8> arguments) override {}
+    };
+
+    // encodes the arguments and formats them again, the result has to be the same as formatting them directly
+    void checkDeferredFormatting(const char* fmt, ...)
+    {
+        gep::uint8 buffer[gep::Logging::INLINE_MESSAGE_SIZE];
+        va_list argptr;
+        va_start(argptr, fmt);
+        const size_t argumentsSize = gep::encodeLogArguments(fmt, argptr, buffer);
+        va_end(argptr);
+        GEP_ASSERT(argumentsSize != gep::INVALID_LOG_ARGUMENTS_SIZE, "arguments could not be encoded", fmt);
+
+        std::string decoded;
+        GEP_ASSERT(gep::formatLogArguments(decoded, fmt, gep::ArrayPtr<const gep::uint8>(buffer, argumentsSize)), "arguments are missing", fmt);
+
+        va_start(argptr, fmt);
+        const std::string expected = gep::vformat(fmt, argptr);
+        va_end(argptr);
+        GEP_ASSERT(decoded == expected, "deferred formatting gives a different message", fmt, decoded, expected);
+    }
+
+    size_t encodeArguments(gep::ArrayPtr<gep::uint8> buffer, const char* fmt, ...)
+    {
+        va_list argptr;
+        va_start(argptr, fmt);
+        SCOPE_EXIT{ va_end(argptr); });
+        return gep::encodeLogArguments(fmt, argptr, buffer);
+    }
+
+    // the logging before messages were written on a background thread
+    class SynchronousLogging
+    {
+        gep::DynamicArray<gep::ILogSink*> m_sinks;
+        gep::Mutex m_sinkMutex;
+    public:
+        void registerSink(gep::ILogSink* pSink) { m_sinks.append(pSink); }
+
+        void logMessage(const char* fmt, ...)
+        {
+            va_list argptr;
+            va_start(argptr, fmt);
+            SCOPE_EXIT{ va_end(argptr); });
+            auto msg = gep::vformat(fmt, argptr);
+            gep::ScopedLock<gep::Mutex> lock(m_sinkMutex);
+            for(auto pSink : m_sinks)
+            {
+                pSink->take(gep::LogChannel::message, msg.c_str());
+            }
+        }
+    };
+}
+
+GEP_UNITTEST_TEST(Logging, AsyncLogging)
+{
+    const size_t numThreads = 4;
+    const size_t numMessagesPerThread = 2000;
+
+    CollectingSink sink;
+    {
+        gep::Logging logging(64);
+        logging.registerSink(&sink);
+        // nothing may get lost, even though the buffer is much smaller than the number of messages
+        logging.setOverflowPolicy(gep::LogChannel::message, gep::LogOverflowPolicy::waitForSpace);
+
+        runOnThreads(numThreads, [&](size_t threadIndex){
+            for(size_t i=0; i < numMessagesPerThread; i++)
+                logging.logMessage("thread %u message %u", (gep::uint32)threadIndex, (gep::uint32)i);
+        });
+        logging.logWarning("a warning");
+        logging.logError("an error with a long message: %s", std::string(500, 'x').c_str());
+        logging.flush();
+
+        GEP_ASSERT(sink.messages.size() == numThreads * numMessagesPerThread + 2, "messages got lost", sink.messages.size());
+        GEP_ASSERT(sink.numFlushes > 0, "the sink was never flushed");
+
+        // the messages of every thread arrive in the order they were logged
+        std::vector<size_t> nextMessage(numThreads, 0);
+        for(size_t i=0; i < numThreads * numMessagesPerThread; i++)
+        {
+            unsigned int threadIndex, messageIndex;
+            GEP_ASSERT(sscanf_s(sink.messages[i].c_str(), "thread %u message %u", &threadIndex, &messageIndex) == 2, "message was corrupted", sink.messages[i]);
+            GEP_ASSERT(sink.channels[i] == gep::LogChannel::message);
+            GEP_ASSERT(messageIndex == nextMessage[threadIndex], "messages are out of order", threadIndex, messageIndex);
+            nextMessage[threadIndex]++;
+        }
+        GEP_ASSERT(sink.messages[numThreads * numMessagesPerThread] == "a warning");
+        GEP_ASSERT(sink.channels[numThreads * numMessagesPerThread] == gep::LogChannel::warning);
+        GEP_ASSERT(sink.messages.back() == "an error with a long message: " + std::string(500, 'x'), "long message was truncated");
+        GEP_ASSERT(sink.channels.back() == gep::LogChannel::error);
+
+        auto statistics = logging.getStatistics(gep::LogChannel::message);
+        GEP_ASSERT(statistics.numWritten == numThreads * numMessagesPerThread, "wrong number of written messages", statistics.numWritten);
+        GEP_ASSERT(statistics.numDropped == 0);
+        GEP_ASSERT(statistics.maxLatencyMs >= statistics.averageLatencyMs);
+        GEP_ASSERT(logging.getStatistics(gep::LogChannel::error).numWritten == 1);
+
+        // deregistering writes the pending messages to the sink first
+        logging.logMessage("last message");
+        logging.deregisterSink(&sink);
+        GEP_ASSERT(sink.messages.back() == "last message", "pending message was not written before deregistering");
+        logging.logMessage("not received");
+    }
+    GEP_ASSERT(sink.messages.back() == "last message", "sink got a message after it was deregistered");
+}
+
+GEP_UNITTEST_TEST(Logging, Overflow)
+{
+    const gep::uint32 capacity = 16;
+    BlockingSink sink;
+    gep::Logging logging(capacity);
+    logging.registerSink(&sink);
+
+    // the writer thread is stuck in the sink with the first message, the others fill up the buffer
+    sink.blocked = true;
+    logging.logMessage("blocking message");
+    sink.waitUntilBlocking();
+    for(gep::uint32 i=0; i < capacity * 2; i++)
+        logging.logMessage("message %u", i);
+
+    auto statistics = logging.getStatistics(gep::LogChannel::message);
+    GEP_ASSERT(statistics.numDropped == capacity + 1, "wrong number of dropped messages", statistics.numDropped);
+    sink.blocked = false;
+    logging.flush();
+    statistics = logging.getStatistics(gep::LogChannel::message);
+    GEP_ASSERT(statistics.numWritten == capacity, "wrong number of written messages", statistics.numWritten);
+    GEP_ASSERT(sink.numTaken == (LONG)capacity);
+
+    // errors wait until there is space again
+    sink.blocked = true;
+    logging.logError("blocking error");
+    sink.waitUntilBlocking();
+    volatile bool done = false;
+    FunctionThread producer([&](){
+        for(gep::uint32 i=0; i < capacity * 2; i++)
+            logging.logError("error %u", i);
+        done = true;
+    });
+    producer.start();
+    Sleep(20);
+    GEP_ASSERT(!done, "the producer did not wait for space");
+    sink.blocked = false;
+    producer.join();
+    logging.flush();
+
+    statistics = logging.getStatistics(gep::LogChannel::error);
+    GEP_ASSERT(statistics.numDropped == 0, "errors were dropped", statistics.numDropped);
+    GEP_ASSERT(statistics.numWritten == capacity * 2 + 1, "wrong number of written errors", statistics.numWritten);
+    logging.deregisterSink(&sink);
+}
+
+GEP_UNITTEST_TEST(Logging, AsyncLoggingPerformance)
+{
+    const size_t numMessages = 2000;
+    // roughly what writing and flushing a line to a file costs
+    const float secondsPerSinkMessage = 0.00002f;
+    SlowSink sink(secondsPerSinkMessage);
+
+    float synchronousTime;
+    {
+        SynchronousLogging logging;
+        logging.registerSink(&sink);
+        synchronousTime = measureTime([&](){
+            for(size_t i=0; i < numMessages; i++)
+                logging.logMessage("Deleting game object '%s%u' at the end of the frame.", "gameObject", (gep::uint32)i);
+        });
+    }
+
+    float asyncTime;
+    gep::LogChannelStatistics statistics;
+    {
+        gep::Logging logging;
+        logging.registerSink(&sink);
+        asyncTime = measureTime([&](){
+            for(size_t i=0; i < numMessages; i++)
+                logging.logMessage("Deleting game object '%s%u' at the end of the frame.", "gameObject", (gep::uint32)i);
+        });
+        logging.flush();
+        statistics = logging.getStatistics(gep::LogChannel::message);
+        logging.deregisterSink(&sink);
+    }
+
+    log.logMessage("Logging %u messages to a sink that takes %.0f us per message, time spent in the logging calls:\n",
+        (gep::uint32)numMessages, secondsPerSinkMessage * 1000000.0f);
+    log.logMessage("    synchronous: %8.3f ms\n", synchronousTime * 1000.0f);
+    log.logMessage("    async:       %8.3f ms (%.2fx)\n", asyncTime * 1000.0f, synchronousTime / GEP_MAX(asyncTime, 1e-6f));
+    log.logMessage("    async written %u, dropped %u, latency average %.3f ms, max %.3f ms\n",
+        (gep::uint32)statistics.numWritten, (gep::uint32)statistics.numDropped, statistics.averageLatencyMs, statistics.maxLatencyMs);
+}
+
+GEP_UNITTEST_TEST(Logging, DeferredFormatting)
+{
+    checkDeferredFormatting("no arguments");
+    checkDeferredFormatting("100%% done");
+    checkDeferredFormatting("%d %i %u %d", -42, 17, 4000000000u, 0);
+    checkDeferredFormatting("[%5d] [%-5d] [%05d] [%+d] [% d] [%.3d]", 42, 42, -42, 42, 42, 7);
+    checkDeferredFormatting("%x %X %#x %o %#o", 0xbeefu, 0xbeefu, 255u, 8u, 8u);
+    checkDeferredFormatting("%hhd %hhu %hd %hu", 300, 300, 70000, 70000);
+    checkDeferredFormatting("%lld %llu %llx", -1234567890123ll, 12345678901234567ull, 0xFFFFFFFFFFFFull);
+    checkDeferredFormatting("%c%c%c [%3c]", 'a', 'b', 'c', 'd');
+    checkDeferredFormatting("%f %.3f %10.2f %-10.1f| %e %E %.2e", 3.14159, -2.5, 1.0 / 3.0, 2.25f, 12345.678, 0.00012, 1e100);
+    checkDeferredFormatting("%g %G %.10g %#g", 0.0001, 1e-10, 3.14159265358979, 1.0);
+    checkDeferredFormatting("[%s] [%10s] [%-10s] [%.3s] [%s]", "text", "right", "left", "truncated", "");
+    checkDeferredFormatting("[%*d] [%-*d] [%.*f] [%*.*f]", 6, 42, 6, 42, 2, 3.14159, 10, 4, 2.71828);
+    checkDeferredFormatting("Deleting game object '%s%u' at the end of the frame.", "gameObject", 17u);
+
+    // pointers are formatted the same on every platform
+    int value = 0;
+    gep::uint8 buffer[gep::Logging::INLINE_MESSAGE_SIZE];
+    size_t argumentsSize = encodeArguments(buffer, "pointer %p", &value);
+    std::string decoded;
+    gep::formatLogArguments(decoded, "pointer %p", gep::ArrayPtr<const gep::uint8>(buffer, argumentsSize));
+    GEP_ASSERT(decoded == gep::format("pointer %0*llX", (int)sizeof(void*) * 2, (unsigned long long)(size_t)&value), "wrong pointer", decoded);
+
+    // strings are copied, the message does not change when the string does
+    char str[] = "original";
+    argumentsSize = encodeArguments(buffer, "%s", str);
+    str[0] = 'X';
+    gep::formatLogArguments(decoded, "%s", gep::ArrayPtr<const gep::uint8>(buffer, argumentsSize));
+    GEP_ASSERT(decoded == "original", "string was not copied", decoded);
+
+    // things that can not be encoded
+    const std::string longString(gep::Logging::INLINE_MESSAGE_SIZE, 'x');
+    GEP_ASSERT(encodeArguments(buffer, "%s", longString.c_str()) == gep::INVALID_LOG_ARGUMENTS_SIZE, "arguments do not fit into the buffer");
+    GEP_ASSERT(encodeArguments(buffer, "%ls", L"wide") == gep::INVALID_LOG_ARGUMENTS_SIZE, "wide strings are not supported");
+    int numWritten = 0;
+    GEP_ASSERT(encodeArguments(buffer, "%d%n", 1, &numWritten) == gep::INVALID_LOG_ARGUMENTS_SIZE, "%%n is not supported");
+
+    // missing arguments are marked
+    argumentsSize = encodeArguments(buffer, "%d %s", 1, "two");
+    GEP_ASSERT(!gep::formatLogArguments(decoded, "%d %s", gep::ArrayPtr<const gep::uint8>(buffer, argumentsSize - 1)), "missing argument was not detected");
+    GEP_ASSERT(decoded == "1 <missing>", "wrong message for missing arguments", decoded);
+}
+
+GEP_UNITTEST_TEST(Logging, BinaryLog)
+{
+    const char* filename = "binarylogtest.bin";
+    CollectingSink textSink;
+    DeferredCollectingSink deferredSink;
+    {
+        gep::BinaryFileLogSink binarySink(filename);
+        gep::Logging logging;
+        logging.setDeferredFormatting(true);
+        logging.registerSink(&textSink);
+        logging.registerSink(&deferredSink);
+        logging.registerSink(&binarySink);
+
+        for(gep::uint32 i=0; i < 3; i++)
+            logging.logMessage("frame %u took %.2f ms", i, 16.5f + i);
+        logging.logWarning("game object '%s' has no transform", "player");
+        // does not fit into the buffer, so it is formatted immediately
+        const std::string longString(gep::Logging::INLINE_MESSAGE_SIZE, 'x');
+        logging.logError("long %s", longString.c_str());
+        logging.flush();
+
+        logging.deregisterSink(&binarySink);
+        logging.deregisterSink(&deferredSink);
+        logging.deregisterSink(&textSink);
+    }
+
+    const char* expected[] = {
+        "frame 0 took 16.50 ms",
+        "frame 1 took 17.50 ms",
+        "frame 2 took 18.50 ms",
+        "game object 'player' has no transform",
+        nullptr
+    };
+    const std::string longMessage = "long " + std::string(gep::Logging::INLINE_MESSAGE_SIZE, 'x');
+    expected[4] = longMessage.c_str();
+    const gep::LogChannel expectedChannels[] = {
+        gep::LogChannel::message, gep::LogChannel::message, gep::LogChannel::message, gep::LogChannel::warning, gep::LogChannel::error
+    };
+
+    // the text sink gets the formatted messages, the deferred sink the format strings
+    GEP_ASSERT(textSink.messages.size() == GEP_ARRAY_SIZE(expected), "wrong number of messages", textSink.messages.size());
+    GEP_ASSERT(deferredSink.messages.size() == GEP_ARRAY_SIZE(expected), "wrong number of deferred messages", deferredSink.messages.size());
+    for(size_t i=0; i < GEP_ARRAY_SIZE(expected); i++)
+    {
+        GEP_ASSERT(textSink.messages[i] == expected[i], "wrong message", i, textSink.messages[i]);
+        GEP_ASSERT(deferredSink.messages[i] == expected[i], "wrong deferred message", i, deferredSink.messages[i]);
+    }
+    GEP_ASSERT(deferredSink.formats[0] == deferredSink.formats[2], "format string of the same call site changed");
+    GEP_ASSERT(strcmp(deferredSink.formats[3], "game object '%s' has no transform") == 0);
+    GEP_ASSERT(deferredSink.formats[4] == nullptr, "the long message should have been formatted immediately");
+
+    // the binary log decodes to the same messages
+    {
+        gep::BinaryLogReader reader(filename);
+        GEP_ASSERT(reader.isValid(), "could not read the binary log");
+        GEP_ASSERT(reader.getPointerSize() == sizeof(void*));
+        gep::LogChannel channel;
+        std::string msg;
+        for(size_t i=0; i < GEP_ARRAY_SIZE(expected); i++)
+        {
+            GEP_ASSERT(reader.readMessage(channel, msg), "binary log ended early", i);
+            GEP_ASSERT(msg == expected[i], "wrong decoded message", i, msg);
+            GEP_ASSERT(channel == expectedChannels[i], "wrong decoded channel", i);
+        }
+        GEP_ASSERT(!reader.readMessage(channel, msg), "binary log has too many messages");
+    }
+    remove(filename);
+}
+
+GEP_UNITTEST_TEST(Logging, DeferredFormattingPerformance)
+{
+    const size_t numMessages = 4000;
+    NullDeferredSink sink;
+
+    float times[2];
+    for(int deferFormatting = 0; deferFormatting < 2; deferFormatting++)
+    {
+        gep::Logging logging(8192);
+        logging.setDeferredFormatting(deferFormatting != 0);
+        logging.registerSink(&sink);
+        times[deferFormatting] = measureTime([&](){
+            for(size_t i=0; i < numMessages; i++)
+            {
+                const float x = (float)i;
+                logging.logMessage("Entity '%s' at (%.3f, %.3f, %.3f) moves with %.2f m/s in frame %u",
+                    "character", x * 0.5f, x * 0.25f, -x, x * 0.125f, (gep::uint32)i);
+            }
+        });
+        logging.flush();
+        GEP_ASSERT(logging.getStatistics(gep::LogChannel::message).numDropped == 0, "messages were dropped");
+        logging.deregisterSink(&sink);
+    }
+
+    log.logMessage("Logging %u messages with 4 floats each to a binary sink, time spent in the logging calls:\n", (gep::uint32)numMessages);
+    log.logMessage("    formatted immediately: %8.3f ms\n", times[0] * 1000.0f);
+    log.logMessage("    deferred formatting:   %8.3f ms (%.2fx)\n", times[1] * 1000.0f, times[0] / GEP_MAX(times[1], 1e-6f));
+}
@@ -0,0 +1,252 @@
+#include "stdafx.h"
+#include "Test_Math.h"
+#include "benchmarkUtils.h"
+#include "gep/math3d/batch.h"
+#include <vector>
+
+namespace
+{
+    // The scalar code the SSE versions replace, they have to compute exactly the same.
+
+    gep::mat4 referenceMultiply(const gep::mat4& lh, const gep::mat4& m)
+    {
+        gep::mat4 result(gep::DO_NOT_INITIALIZE);
+        for(int i=0;i<4;i++){
+            result.data[i*4]   = lh.data[0] * m.data[i*4] + lh.data[4] * m.data[i*4+1] + lh.data[ 8] * m.data[i*4+2] + lh.data[12] * m.data[i*4+3];
+            result.data[i*4+1] = lh.data[1] * m.data[i*4] + lh.data[5] * m.data[i*4+1] + lh.data[ 9] * m.data[i*4+2] + lh.data[13] * m.data[i*4+3];
+            result.data[i*4+2] = lh.data[2] * m.data[i*4] + lh.data[6] * m.data[i*4+1] + lh.data[10] * m.data[i*4+2] + lh.data[14] * m.data[i*4+3];
+            result.data[i*4+3] = lh.data[3] * m.data[i*4] + lh.data[7] * m.data[i*4+1] + lh.data[11] * m.data[i*4+2] + lh.data[15] * m.data[i*4+3];
+        }
+        return result;
+    }
+
+    gep::vec4 referenceMultiply(const gep::mat4& m, const gep::vec4& v)
+    {
+        gep::vec4 temp(gep::DO_NOT_INITIALIZE);
+        temp.x = v.x * m.data[0] + v.y * m.data[4] + v.z * m.data[8] + v.w * m.data[12];
+        temp.y = v.x * m.data[1] + v.y * m.data[5] + v.z * m.data[9] + v.w * m.data[13];
+        temp.z = v.x * m.data[2] + v.y * m.data[6] + v.z * m.data[10] + v.w * m.data[14];
+        temp.w = v.x * m.data[3] + v.y * m.data[7] + v.z * m.data[11] + v.w * m.data[15];
+        return temp;
+    }
+
+    gep::vec3 referenceTransformDirection(const gep::mat4& m, const gep::vec3& v)
+    {
+        gep::vec3 temp(gep::DO_NOT_INITIALIZE);
+        temp.x = v.x * m.data[0] + v.y * m.data[4] + v.z * m.data[8];
+        temp.y = v.x * m.data[1] + v.y * m.data[5] + v.z * m.data[9];
+        temp.z = v.x * m.data[2] + v.y * m.data[6] + v.z * m.data[10];
+        return temp;
+    }
+
+    gep::vec3 referenceTransformPosition(const gep::mat4& m, const gep::vec3& v)
+    {
+        gep::vec3 temp(gep::DO_NOT_INITIALIZE);
+        temp.x = v.x * m.data[0] + v.y * m.data[4] + v.z * m.data[8]  + m.data[12];
+        temp.y = v.x * m.data[1] + v.y * m.data[5] + v.z * m.data[9]  + m.data[13];
+        temp.z = v.x * m.data[2] + v.y * m.data[6] + v.z * m.data[10] + m.data[14];
+        return temp;
+    }
+
+    gep::Quaternion referenceMultiply(const gep::Quaternion& lh, const gep::Quaternion& rh)
+    {
+        gep::Quaternion res(gep::DO_NOT_INITIALIZE);
+        res.x     = lh.angle * rh.x     + lh.x * rh.angle + lh.y * rh.z - lh.z * rh.y;
+        res.y     = lh.angle * rh.y     + lh.y * rh.angle + lh.z * rh.x - lh.x * rh.z;
+        res.z     = lh.angle * rh.z     + lh.z * rh.angle + lh.x * rh.y - lh.y * rh.x;
+        res.angle = lh.angle * rh.angle - lh.x * rh.x     - lh.y * rh.y - lh.z * rh.z;
+        return res;
+    }
+
+    template <class T>
+    bool isIdentical(const T& a, const T& b)
+    {
+        return memcmp(&a, &b, sizeof(T)) == 0;
+    }
+
+    // deterministic values with mixed signs and magnitudes, every 16th one is a zero of either sign
+    struct RandomFloats
+    {
+        gep::uint32 state;
+
+        RandomFloats() : state(12345) {}
+
+        float next()
+        {
+            state = state * 1664525u + 1013904223u;
+            const gep::uint32 bits = state >> 8;
+            if((bits & 15) == 0)
+                return (bits & 16) ? -0.0f : 0.0f;
+            const float value = (float)(bits & 0xFFFF) / 256.0f - 128.0f;
+            return (bits & 0x10000) ? value / 1000.0f : value;
+        }
+
+        gep::vec3 nextVec3() { gep::vec3 v(gep::DO_NOT_INITIALIZE); v.x = next(); v.y = next(); v.z = next(); return v; }
+        gep::vec4 nextVec4() { return gep::vec4(next(), next(), next(), next()); }
+
+        gep::mat4 nextMat4()
+        {
+            gep::mat4 m(gep::DO_NOT_INITIALIZE);
+            for(size_t i=0; i < 16; i++)
+                m.data[i] = next();
+            return m;
+        }
+
+        gep::Quaternion nextQuaternion()
+        {
+            gep::Quaternion q(gep::DO_NOT_INITIALIZE);
+            do
+            {
+                q.x = next(); q.y = next(); q.z = next(); q.angle = next();
+            } while(q.x * q.x + q.y * q.y + q.z * q.z + q.angle * q.angle < 0.01f);
+            return q;
+        }
+    };
+}
+
+GEP_UNITTEST_TEST(Math, SimdEquivalence)
+{
+    RandomFloats random;
+    const size_t numValues = 10000;
+
+    for(size_t i=0; i < numValues; i++)
+    {
+        const gep::mat4 a = random.nextMat4();
+        const gep::mat4 b = random.nextMat4();
+        const gep::vec4 v4 = random.nextVec4();
+        const gep::vec3 v3 = random.nextVec3();
+        const gep::Quaternion p = random.nextQuaternion();
+        const gep::Quaternion q = random.nextQuaternion();
+        GEP_ASSERT(isIdentical(a * b, referenceMultiply(a, b)), "matrix times matrix differs", i);
+        GEP_ASSERT(isIdentical(a * v4, referenceMultiply(a, v4)), "matrix times vector differs", i);
+        GEP_ASSERT(isIdentical(a.transformPosition(v3), referenceTransformPosition(a, v3)), "transformPosition differs", i);
+        GEP_ASSERT(isIdentical(a.transformDirection(v3), referenceTransformDirection(a, v3)), "transformDirection differs", i);
+        GEP_ASSERT(isIdentical(p * q, referenceMultiply(p, q)), "quaternion times quaternion differs", i);
+    }
+
+    // the batches, with every length of the last incomplete group and in place
+    for(size_t length=0; length < 10; length++)
+    {
+        const gep::mat4 matrix = random.nextMat4();
+        std::vector<gep::vec3> positions(length + 1), transformed(length + 1);
+        std::vector<gep::vec4> vectors(length + 1), transformedVectors(length + 1);
+        std::vector<gep::mat4> matrices(length + 1), others(length + 1), products(length + 1);
+        std::vector<gep::Quaternion> rotations(length + 1);
+        for(size_t i=0; i < length; i++)
+        {
+            positions[i] = random.nextVec3();
+            vectors[i] = random.nextVec4();
+            matrices[i] = random.nextMat4();
+            others[i] = random.nextMat4();
+            rotations[i] = random.nextQuaternion();
+        }
+        // the element behind the batch must stay untouched
+        const gep::vec3 sentinel(1.0f, 2.0f, 3.0f);
+        transformed[length] = sentinel;
+
+        gep::transformPositions(matrix, gep::ArrayPtr<const gep::vec3>(&positions[0], length), gep::ArrayPtr<gep::vec3>(&transformed[0], length));
+        for(size_t i=0; i < length; i++)
+            GEP_ASSERT(isIdentical(transformed[i], referenceTransformPosition(matrix, positions[i])), "transformPositions differs", length, i);
+        GEP_ASSERT(isIdentical(transformed[length], sentinel), "transformPositions wrote past the end", length);
+
+        gep::transformDirections(matrix, gep::ArrayPtr<const gep::vec3>(&positions[0], length), gep::ArrayPtr<gep::vec3>(&transformed[0], length));
+        for(size_t i=0; i < length; i++)
+            GEP_ASSERT(isIdentical(transformed[i], referenceTransformDirection(matrix, positions[i])), "transformDirections differs", length, i);
+        GEP_ASSERT(isIdentical(transformed[length], sentinel), "transformDirections wrote past the end", length);
+
+        gep::transformVectors(matrix, gep::ArrayPtr<const gep::vec4>(&vectors[0], length), gep::ArrayPtr<gep::vec4>(&transformedVectors[0], length));
+        for(size_t i=0; i < length; i++)
+            GEP_ASSERT(isIdentical(transformedVectors[i], referenceMultiply(matrix, vectors[i])), "transformVectors differs", length, i);
+
+        gep::multiplyMatrices(matrix, gep::ArrayPtr<const gep::mat4>(&matrices[0], length), gep::ArrayPtr<gep::mat4>(&products[0], length));
+        for(size_t i=0; i < length; i++)
+            GEP_ASSERT(isIdentical(products[i], referenceMultiply(matrix, matrices[i])), "multiplyMatrices differs", length, i);
+
+        gep::multiplyMatrices(gep::ArrayPtr<const gep::mat4>(&matrices[0], length), gep::ArrayPtr<const gep::mat4>(&others[0], length),
+                              gep::ArrayPtr<gep::mat4>(&products[0], length));
+        for(size_t i=0; i < length; i++)
+            GEP_ASSERT(isIdentical(products[i], referenceMultiply(matrices[i], others[i])), "pairwise multiplyMatrices differs", length, i);
+
+        gep::toRotationMatrices(gep::ArrayPtr<const gep::Quaternion>(&rotations[0], length), gep::ArrayPtr<gep::mat4>(&products[0], length));
+        for(size_t i=0; i < length; i++)
+            GEP_ASSERT(isIdentical(products[i], rotations[i].toMat4()), "toRotationMatrices differs", length, i);
+
+        // in place
+        std::vector<gep::vec3> expectedPositions(length + 1);
+        std::vector<gep::mat4> expectedMatrices(length + 1);
+        for(size_t i=0; i < length; i++)
+        {
+            expectedPositions[i] = referenceTransformPosition(matrix, positions[i]);
+            expectedMatrices[i] = referenceMultiply(matrix, matrices[i]);
+        }
+        gep::transformPositions(matrix, gep::ArrayPtr<const gep::vec3>(&positions[0], length), gep::ArrayPtr<gep::vec3>(&positions[0], length));
+        gep::multiplyMatrices(matrix, gep::ArrayPtr<const gep::mat4>(&matrices[0], length), gep::ArrayPtr<gep::mat4>(&matrices[0], length));
+        for(size_t i=0; i < length; i++)
+        {
+            GEP_ASSERT(isIdentical(positions[i], expectedPositions[i]), "transformPositions in place differs", length, i);
+            GEP_ASSERT(isIdentical(matrices[i], expectedMatrices[i]), "multiplyMatrices in place differs", length, i);
+        }
+    }
+}
+
+GEP_UNITTEST_TEST(Math, SimdPerformance)
+{
+    RandomFloats random;
+    const size_t numValues = 4096;
+    const size_t numRepetitions = 100;
+    std::vector<gep::mat4> matrices(numValues), others(numValues), products(numValues);
+    std::vector<gep::vec4> vectors(numValues), transformedVectors(numValues);
+    std::vector<gep::vec3> positions(numValues), transformed(numValues);
+    std::vector<gep::Quaternion> rotations(numValues), others2(numValues), rotationProducts(numValues);
+    for(size_t i=0; i < numValues; i++)
+    {
+        matrices[i] = random.nextMat4();
+        others[i] = random.nextMat4();
+        vectors[i] = random.nextVec4();
+        positions[i] = random.nextVec3();
+        rotations[i] = random.nextQuaternion();
+        others2[i] = random.nextQuaternion();
+    }
+    const gep::mat4 matrix = random.nextMat4();
+
+    const float scale = 1e9f / (numValues * numRepetitions);
+    log.logMessage("ns per element, the scalar reference against the SSE version:\n");
+    log.logMessage("    %-36s | scalar |    sse | speedup\n", "operation");
+    auto report = [&](const char* name, const std::function<void()>& scalar, const std::function<void()>& sse)
+    {
+        const float scalarTime = measureTime([&](){
+            for(size_t r=0; r < numRepetitions; r++)
+                scalar();
+        });
+        const float sseTime = measureTime([&](){
+            for(size_t r=0; r < numRepetitions; r++)
+                sse();
+        });
+        log.logMessage("    %-36s | %6.2f | %6.2f | %6.2fx\n", name, scalarTime * scale, sseTime * scale, scalarTime / GEP_MAX(sseTime, 1e-9f));
+    };
+
+    report("mat4 * mat4",
+        [&](){ for(size_t i=0; i < numValues; i++) products[i] = referenceMultiply(matrices[i], others[i]); },
+        [&](){ for(size_t i=0; i < numValues; i++) products[i] = matrices[i] * others[i]; });
+    report("mat4 * vec4",
+        [&](){ for(size_t i=0; i < numValues; i++) transformedVectors[i] = referenceMultiply(matrices[i], vectors[i]); },
+        [&](){ for(size_t i=0; i < numValues; i++) transformedVectors[i] = matrices[i] * vectors[i]; });
+    report("mat4::transformPosition",
+        [&](){ for(size_t i=0; i < numValues; i++) transformed[i] = referenceTransformPosition(matrices[i], positions[i]); },
+        [&](){ for(size_t i=0; i < numValues; i++) transformed[i] = matrices[i].transformPosition(positions[i]); });
+    report("Quaternion * Quaternion",
+        [&](){ for(size_t i=0; i < numValues; i++) rotationProducts[i] = referenceMultiply(rotations[i], others2[i]); },
+        [&](){ for(size_t i=0; i < numValues; i++) rotationProducts[i] = rotations[i] * others2[i]; });
+    report("transformPositions (batch)",
+        [&](){ for(size_t i=0; i < numValues; i++) transformed[i] = referenceTransformPosition(matrix, positions[i]); },
+        [&](){ gep::transformPositions(matrix, gep::ArrayPtr<const gep::vec3>(&positions[0], numValues), gep::ArrayPtr<gep::vec3>(&transformed[0], numValues)); });
+    report("transformVectors (batch)",
+        [&](){ for(size_t i=0; i < numValues; i++) transformedVectors[i] = referenceMultiply(matrix, vectors[i]); },
+        [&](){ gep::transformVectors(matrix, gep::ArrayPtr<const gep::vec4>(&vectors[0], numValues), gep::ArrayPtr<gep::vec4>(&transformedVectors[0], numValues)); });
+    report("multiplyMatrices (batch)",
+        [&](){ for(size_t i=0; i < numValues; i++) products[i] = referenceMultiply(matrix, matrices[i]); },
+        [&](){ gep::multiplyMatrices(matrix, gep::ArrayPtr<const gep::mat4>(&matrices[0], numValues), gep::ArrayPtr<gep::mat4>(&products[0], numValues)); });
+    report("toRotationMatrices (batch) vs toMat4",
+        [&](){ for(size_t i=0; i < numValues; i++) products[i] = rotations[i].toMat4(); },
+        [&](){ gep::toRotationMatrices(gep::ArrayPtr<const gep::Quaternion>(&rotations[0], numValues), gep::ArrayPtr<gep::mat4>(&products[0], numValues)); });
+}
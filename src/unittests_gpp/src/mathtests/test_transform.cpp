@@ -0,0 +1,512 @@
+#include "stdafx.h"
+#include "Test_Math.h"
+#include "benchmarkUtils.h"
+#include "gep/math3d/transform.h"
+#include "gep/math3d/transformStore.h"
+#include <vector>
+
+namespace
+{
+    // The transform as it was before the world transformation was cached:
+    // every query walks up to the root and multiplies all the way down again.
+    class UncachedTransform : public gep::ITransform
+    {
+    public:
+        UncachedTransform() : m_pParent(gep::getIdentityTransform()) {}
+
+        virtual void setPosition(const gep::vec3& pos) override { m_position = pos; }
+        virtual void setRotation(const gep::Quaternion& rot) override { m_rotation = rot; }
+        virtual void setBaseOrientation(const gep::Quaternion& orientation) override { m_baseOrientation = orientation; }
+        virtual void setBaseViewDirection(const gep::vec3& direction) override { m_baseOrientation = gep::Quaternion(direction, gep::vec3(0, 1, 0)); }
+
+        virtual gep::mat4 getWorldTransformationMatrix() const override { return m_pParent->getWorldTransformationMatrix() * getTransformationMatrix(); }
+        virtual gep::vec3 getWorldPosition() const override { return getWorldTransformationMatrix().translationPart(); }
+        virtual gep::Quaternion getWorldRotation() const override { return m_pParent->getWorldRotation() * m_rotation; }
+
+        virtual gep::mat4 getTransformationMatrix() const override { return gep::mat4::translationMatrix(m_position) * m_rotation.toMat4(); }
+        virtual gep::vec3 getPosition() const override { return m_position; }
+        virtual gep::Quaternion getRotation() const override { return m_rotation; }
+
+        virtual gep::vec3 getViewDirection() const override { return (getWorldRotation() * m_baseOrientation).toMat3() * gep::vec3(0, 1, 0); }
+        virtual gep::vec3 getUpDirection() const override { return (getWorldRotation() * m_baseOrientation).toMat3() * gep::vec3(0, 0, 1); }
+        virtual gep::vec3 getRightDirection() const override { return (getWorldRotation() * m_baseOrientation).toMat3() * gep::vec3(1, 0, 0); }
+
+        virtual void setParent(gep::ITransform* parent) override { m_pParent = parent; }
+        virtual gep::ITransform* getParent() override { return m_pParent; }
+        virtual const gep::ITransform* getParent() const override { return m_pParent; }
+
+    private:
+        gep::vec3 m_position;
+        gep::Quaternion m_rotation;
+        gep::Quaternion m_baseOrientation;
+        gep::ITransform* m_pParent;
+    };
+
+    // forwards to another transform which can be switched, like a game object does
+    class ForwardingTransform : public UncachedTransform
+    {
+    public:
+        gep::ITransform* pTarget;
+        gep::uint64 switchStamp;
+
+        ForwardingTransform(gep::ITransform* pTarget) : pTarget(pTarget), switchStamp(0) {}
+
+        void switchTo(gep::ITransform* pNewTarget)
+        {
+            pTarget = pNewTarget;
+            switchStamp = gep::nextTransformChangeStamp();
+        }
+
+        virtual gep::mat4 getWorldTransformationMatrix() const override { return pTarget->getWorldTransformationMatrix(); }
+        virtual gep::Quaternion getWorldRotation() const override { return pTarget->getWorldRotation(); }
+        virtual gep::uint64 getWorldChangeStamp() const override
+        {
+            const gep::uint64 targetStamp = pTarget->getWorldChangeStamp();
+            return GEP_MAX(switchStamp, targetStamp);
+        }
+    };
+
+    bool isEqual(const gep::mat4& a, const gep::mat4& b)
+    {
+        return memcmp(&a, &b, sizeof(gep::mat4)) == 0;
+    }
+
+    bool isEqual(const gep::vec3& a, const gep::vec3& b)
+    {
+        return a.x == b.x && a.y == b.y && a.z == b.z;
+    }
+
+    // the cached transform has to give exactly the same results as the uncached one
+    bool isSame(const gep::ITransform& cached, const gep::ITransform& uncached)
+    {
+        return isEqual(cached.getWorldTransformationMatrix(), uncached.getWorldTransformationMatrix()) &&
+               isEqual(cached.getWorldPosition(), uncached.getWorldPosition()) &&
+               isEqual(cached.getTransformationMatrix(), uncached.getTransformationMatrix()) &&
+               isEqual(cached.getViewDirection(), uncached.getViewDirection()) &&
+               isEqual(cached.getUpDirection(), uncached.getUpDirection()) &&
+               isEqual(cached.getRightDirection(), uncached.getRightDirection());
+    }
+
+    gep::Quaternion rotationFor(size_t i)
+    {
+        return gep::Quaternion(gep::vec3(0.3f, 0.5f, 1.0f), 5.0f + (float)(i % 17));
+    }
+
+    // transforms and their parent indices, the parents come before their children
+    template <class T>
+    struct Scene
+    {
+        std::vector<T> transforms;
+        std::vector<size_t> parents;
+
+        Scene(size_t numRoots, size_t depth)
+        {
+            transforms.resize(numRoots * depth);
+            parents.resize(transforms.size());
+            for(size_t i=0; i < transforms.size(); i++)
+            {
+                const size_t level = i / numRoots;
+                parents[i] = level == 0 ? (size_t)-1 : i - numRoots;
+                if(level > 0)
+                    transforms[i].setParent(&transforms[parents[i]]);
+                transforms[i].setPosition(gep::vec3(1.0f, (float)(i % 7), 0.5f));
+                transforms[i].setRotation(rotationFor(i));
+            }
+        }
+
+        // moves every moveEvery-th root, then reads what extracting the scene for rendering reads
+        float simulateFrame(size_t frame, size_t moveEvery, size_t numRoots)
+        {
+            for(size_t i=frame % moveEvery; i < numRoots; i += moveEvery)
+                transforms[i].setPosition(gep::vec3((float)frame, 0.0f, 0.0f));
+            float sum = 0.0f;
+            for(size_t i=0; i < transforms.size(); i++)
+            {
+                sum += transforms[i].getWorldTransformationMatrix().data[12];
+                sum += transforms[i].getWorldPosition().y;
+                sum += transforms[i].getViewDirection().z;
+            }
+            return sum;
+        }
+    };
+}
+
+GEP_UNITTEST_TEST(Math, TransformCache)
+{
+    // a chain of cached transforms next to the same chain uncached
+    const size_t depth = 8;
+    gep::Transform cached[depth];
+    UncachedTransform uncached[depth];
+    for(size_t i=0; i < depth; i++)
+    {
+        if(i > 0)
+        {
+            cached[i].setParent(&cached[i - 1]);
+            uncached[i].setParent(&uncached[i - 1]);
+        }
+        cached[i].setPosition(gep::vec3((float)i, 1.0f, 2.0f));
+        uncached[i].setPosition(gep::vec3((float)i, 1.0f, 2.0f));
+        cached[i].setRotation(rotationFor(i));
+        uncached[i].setRotation(rotationFor(i));
+        cached[i].setBaseViewDirection(gep::vec3(1.0f, 0.0f, 0.0f));
+        uncached[i].setBaseViewDirection(gep::vec3(1.0f, 0.0f, 0.0f));
+    }
+    for(size_t i=0; i < depth; i++)
+        GEP_ASSERT(isSame(cached[i], uncached[i]), "the cached transform differs", i);
+
+    // asking again without a change uses the cache
+    for(size_t i=0; i < depth; i++)
+        GEP_ASSERT(isSame(cached[i], uncached[i]), "the cached transform differs when asked again", i);
+
+    // changing a parent moves all children, whichever is asked first
+    cached[2].setRotation(rotationFor(100));
+    uncached[2].setRotation(rotationFor(100));
+    GEP_ASSERT(isSame(cached[depth - 1], uncached[depth - 1]), "the leaf did not follow its parent");
+    for(size_t i=0; i < depth; i++)
+        GEP_ASSERT(isSame(cached[i], uncached[i]), "the chain did not follow its parent", i);
+
+    cached[0].setPosition(gep::vec3(10.0f, 0.0f, 0.0f));
+    uncached[0].setPosition(gep::vec3(10.0f, 0.0f, 0.0f));
+    cached[5].setBaseOrientation(rotationFor(3));
+    uncached[5].setBaseOrientation(rotationFor(3));
+    for(size_t i=0; i < depth; i++)
+        GEP_ASSERT(isSame(cached[i], uncached[i]), "the chain did not follow the root", i);
+
+    // reparenting
+    cached[4].setParent(&cached[1]);
+    uncached[4].setParent(&uncached[1]);
+    for(size_t i=0; i < depth; i++)
+        GEP_ASSERT(isSame(cached[i], uncached[i]), "the chain did not follow the new parent", i);
+    cached[4].setParent(gep::getIdentityTransform());
+    uncached[4].setParent(gep::getIdentityTransform());
+    for(size_t i=0; i < depth; i++)
+        GEP_ASSERT(isSame(cached[i], uncached[i]), "the chain did not follow the detach", i);
+
+    // a parent which does not track its changes is asked every time
+    {
+        UncachedTransform untracked;
+        gep::Transform child;
+        UncachedTransform uncachedChild;
+        child.setParent(&untracked);
+        uncachedChild.setParent(&untracked);
+        child.setPosition(gep::vec3(1.0f, 2.0f, 3.0f));
+        uncachedChild.setPosition(gep::vec3(1.0f, 2.0f, 3.0f));
+        GEP_ASSERT(isSame(child, uncachedChild));
+        untracked.setPosition(gep::vec3(5.0f, 0.0f, 0.0f));
+        GEP_ASSERT(isSame(child, uncachedChild), "the child did not follow an untracked parent");
+        untracked.setRotation(rotationFor(7));
+        GEP_ASSERT(isSame(child, uncachedChild), "the child did not follow an untracked parent");
+    }
+
+    // a parent which switches the transform it forwards to, like a game object getting a physics component
+    {
+        gep::Transform first, second;
+        first.setPosition(gep::vec3(1.0f, 0.0f, 0.0f));
+        second.setPosition(gep::vec3(0.0f, 1.0f, 0.0f));
+        ForwardingTransform forwarder(&first);
+        gep::Transform child;
+        child.setParent(&forwarder);
+        GEP_ASSERT(isEqual(child.getWorldPosition(), gep::vec3(1.0f, 0.0f, 0.0f)));
+        forwarder.switchTo(&second);
+        GEP_ASSERT(isEqual(child.getWorldPosition(), gep::vec3(0.0f, 1.0f, 0.0f)), "the child did not follow the switch");
+        second.setPosition(gep::vec3(0.0f, 2.0f, 0.0f));
+        GEP_ASSERT(isEqual(child.getWorldPosition(), gep::vec3(0.0f, 2.0f, 0.0f)), "the child did not follow the forwarded transform");
+    }
+}
+
+GEP_UNITTEST_TEST(Math, TransformHierarchyPerformance)
+{
+    struct Case
+    {
+        const char* name;
+        size_t numRoots;
+        size_t depth;
+        size_t moveEvery;
+    };
+    // deep chains like bones or camera rigs, wide scenes with shallow hierarchies
+    const Case cases[] = {
+        { "deep, 64 chains of 64, all move", 64, 64, 1 },
+        { "deep, 64 chains of 64, 1/8 move", 64, 64, 8 },
+        { "wide, 10000 objects, all move", 10000, 1, 1 },
+        { "wide, 5000 objects + child, 1/8 move", 5000, 2, 8 },
+        { "mostly static, 5000 chains of 4", 5000, 4, 100000 },
+    };
+    const size_t numFrames = 20;
+
+    log.logMessage("Moving roots and reading world matrix, position and view direction of every transform, ms per frame:\n");
+    log.logMessage("    %-36s | uncached | cached | speedup\n", "scene");
+    for(size_t c=0; c < GEP_ARRAY_SIZE(cases); c++)
+    {
+        const Case& testCase = cases[c];
+        Scene<UncachedTransform> uncachedScene(testCase.numRoots, testCase.depth);
+        Scene<gep::Transform> cachedScene(testCase.numRoots, testCase.depth);
+
+        float uncachedSum = 0.0f, cachedSum = 0.0f;
+        const float uncachedTime = measureTime([&](){
+            for(size_t frame=0; frame < numFrames; frame++)
+                uncachedSum += uncachedScene.simulateFrame(frame, testCase.moveEvery, testCase.numRoots);
+        });
+        const float cachedTime = measureTime([&](){
+            for(size_t frame=0; frame < numFrames; frame++)
+                cachedSum += cachedScene.simulateFrame(frame, testCase.moveEvery, testCase.numRoots);
+        });
+        GEP_ASSERT(uncachedSum == cachedSum, "the cached scene computed something else", uncachedSum, cachedSum);
+        for(size_t i=0; i < cachedScene.transforms.size(); i++)
+            GEP_ASSERT(isSame(cachedScene.transforms[i], uncachedScene.transforms[i]), "the cached scene differs", i);
+
+        log.logMessage("    %-36s | %8.3f | %6.3f | %6.2fx\n", testCase.name,
+            uncachedTime * 1000.0f / numFrames, cachedTime * 1000.0f / numFrames, uncachedTime / GEP_MAX(cachedTime, 1e-9f));
+    }
+}
+
+namespace
+{
+    bool isEquivalent(const gep::mat4& a, const gep::mat4& b)
+    {
+        for(size_t i=0; i < 16; i++)
+        {
+            if(a.data[i] != b.data[i])
+                return false;
+        }
+        return true;
+    }
+
+    // The store builds the local matrix directly instead of multiplying with a translation matrix,
+    // so zeros can have another sign. Everything else has to be exactly the same.
+    bool isEquivalent(const gep::ITransform& stored, const gep::ITransform& other)
+    {
+        return isEquivalent(stored.getWorldTransformationMatrix(), other.getWorldTransformationMatrix()) &&
+               isEqual(stored.getWorldPosition(), other.getWorldPosition()) &&
+               isEquivalent(stored.getTransformationMatrix(), other.getTransformationMatrix()) &&
+               isEqual(stored.getViewDirection(), other.getViewDirection()) &&
+               isEqual(stored.getUpDirection(), other.getUpDirection()) &&
+               isEqual(stored.getRightDirection(), other.getRightDirection());
+    }
+
+    // Scene with its transforms in a transform store. The children are created first,
+    // so the store has to sort them before the first pass.
+    struct StoredScene
+    {
+        gep::TransformStore store;
+        std::vector<gep::StoredTransform*> transforms;
+
+        StoredScene(size_t numRoots, size_t depth)
+        {
+            transforms.resize(numRoots * depth);
+            for(size_t i=transforms.size(); i > 0; i--)
+                transforms[i - 1] = new gep::StoredTransform(store);
+            for(size_t i=0; i < transforms.size(); i++)
+            {
+                if(i >= numRoots)
+                    transforms[i]->setParent(transforms[i - numRoots]);
+                transforms[i]->setPosition(gep::vec3(1.0f, (float)(i % 7), 0.5f));
+                transforms[i]->setRotation(rotationFor(i));
+            }
+        }
+
+        ~StoredScene()
+        {
+            for(size_t i=0; i < transforms.size(); i++)
+                delete transforms[i];
+        }
+    };
+}
+
+GEP_UNITTEST_TEST(Math, TransformStore)
+{
+    // a chain in the store next to the same chain of transforms
+    const size_t depth = 8;
+    gep::TransformStore store;
+    gep::StoredTransform* stored[depth];
+    for(size_t i=depth; i > 0; i--)
+        stored[i - 1] = new gep::StoredTransform(store);
+    SCOPE_EXIT{ for(size_t i=0; i < depth; i++) delete stored[i]; });
+    gep::Transform transforms[depth];
+    for(size_t i=0; i < depth; i++)
+    {
+        if(i > 0)
+        {
+            stored[i]->setParent(stored[i - 1]);
+            transforms[i].setParent(&transforms[i - 1]);
+        }
+        stored[i]->setPosition(gep::vec3((float)i, 1.0f, 2.0f));
+        transforms[i].setPosition(gep::vec3((float)i, 1.0f, 2.0f));
+        stored[i]->setRotation(rotationFor(i));
+        transforms[i].setRotation(rotationFor(i));
+        stored[i]->setBaseViewDirection(gep::vec3(1.0f, 0.0f, 0.0f));
+        transforms[i].setBaseViewDirection(gep::vec3(1.0f, 0.0f, 0.0f));
+    }
+    GEP_ASSERT(store.getNumTransforms() == depth);
+    GEP_ASSERT(stored[3]->getParent() == stored[2] && stored[0]->getParent() == gep::getIdentityTransform());
+
+    // asking before the first pass computes on demand, the pass then has nothing left to do
+    for(size_t i=0; i < depth; i++)
+        GEP_ASSERT(isEquivalent(*stored[i], transforms[i]), "the stored transform differs", i);
+    GEP_ASSERT(store.update() == 0, "the pass computed world transformations which were valid already");
+
+    // the pass computes the same as asking on demand
+    stored[0]->setRotation(rotationFor(100));
+    transforms[0].setRotation(rotationFor(100));
+    GEP_ASSERT(store.update() == depth, "the pass did not follow the root");
+    for(size_t i=0; i < depth; i++)
+        GEP_ASSERT(isEquivalent(*stored[i], transforms[i]), "the chain did not follow the root", i);
+
+    // only the changed part of the hierarchy is computed again
+    stored[5]->setPosition(gep::vec3(0.0f, 3.0f, 0.0f));
+    transforms[5].setPosition(gep::vec3(0.0f, 3.0f, 0.0f));
+    GEP_ASSERT(store.update() == depth - 5, "the pass computed unchanged transforms");
+    for(size_t i=0; i < depth; i++)
+        GEP_ASSERT(isEquivalent(*stored[i], transforms[i]), "the chain did not follow its parent", i);
+
+    // reparenting sorts the store again
+    stored[4]->setParent(stored[1]);
+    transforms[4].setParent(&transforms[1]);
+    store.update();
+    for(size_t i=0; i < depth; i++)
+        GEP_ASSERT(isEquivalent(*stored[i], transforms[i]), "the chain did not follow the new parent", i);
+    stored[4]->setParent(gep::getIdentityTransform());
+    transforms[4].setParent(gep::getIdentityTransform());
+    for(size_t i=0; i < depth; i++)
+        GEP_ASSERT(isEquivalent(*stored[i], transforms[i]), "the chain did not follow the detach", i);
+    GEP_ASSERT(stored[4]->getParent() == gep::getIdentityTransform());
+
+    // children of a destroyed transform fall back to the identity, its entry is used again
+    delete stored[6];
+    stored[6] = nullptr;
+    transforms[7].setParent(gep::getIdentityTransform());
+    GEP_ASSERT(store.getNumTransforms() == depth - 1);
+    GEP_ASSERT(isEquivalent(*stored[7], transforms[7]), "the child of a destroyed transform differs");
+    stored[6] = new gep::StoredTransform(store);
+    stored[6]->setParent(stored[5]);
+    stored[6]->setPosition(gep::vec3(1.0f, 1.0f, 1.0f));
+    transforms[6].setPosition(gep::vec3(1.0f, 1.0f, 1.0f));
+    transforms[6].setRotation(gep::Quaternion());
+    transforms[6].setBaseOrientation(gep::Quaternion());
+    store.update();
+    for(size_t i=0; i < depth; i++)
+        GEP_ASSERT(isEquivalent(*stored[i], transforms[i]), "the chain differs after destroying a transform", i);
+
+    // children can be handed to another parent, a removed transform leaves the store right away
+    {
+        gep::StoredTransform* pParent = new gep::StoredTransform(store);
+        gep::StoredTransform child(store);
+        gep::Transform otherParent;
+        gep::Transform expected;
+        child.setParent(pParent);
+        pParent->setPosition(gep::vec3(3.0f, 0.0f, 0.0f));
+        otherParent.setPosition(gep::vec3(0.0f, 4.0f, 0.0f));
+        child.setPosition(gep::vec3(1.0f, 2.0f, 3.0f));
+        expected.setPosition(gep::vec3(1.0f, 2.0f, 3.0f));
+        pParent->setParentOfChildren(&otherParent);
+        expected.setParent(&otherParent);
+        GEP_ASSERT(child.getParent() == &otherParent);
+        store.update();
+        GEP_ASSERT(isEquivalent(child, expected), "the child did not follow its new parent");
+
+        child.setParent(pParent);
+        const size_t numTransforms = store.getNumTransforms();
+        pParent->removeFromStore();
+        GEP_ASSERT(!pParent->isInStore());
+        GEP_ASSERT(store.getNumTransforms() == numTransforms - 1);
+        GEP_ASSERT(child.getParent() == gep::getIdentityTransform());
+        delete pParent;
+        GEP_ASSERT(store.getNumTransforms() == numTransforms - 1, "deleting a removed transform changed the store");
+    }
+
+    // parents outside of the store are asked for their change stamp
+    {
+        gep::Transform parent;
+        UncachedTransform untracked;
+        gep::TransformStore otherStore;
+        gep::StoredTransform otherParent(otherStore);
+        gep::ITransform* parents[] = { &parent, &untracked, &otherParent };
+        for(size_t p=0; p < GEP_ARRAY_SIZE(parents); p++)
+        {
+            gep::StoredTransform child(store);
+            gep::Transform expected;
+            child.setParent(parents[p]);
+            expected.setParent(parents[p]);
+            child.setPosition(gep::vec3(1.0f, 2.0f, 3.0f));
+            expected.setPosition(gep::vec3(1.0f, 2.0f, 3.0f));
+            GEP_ASSERT(child.getParent() == parents[p]);
+            store.update();
+            GEP_ASSERT(isEquivalent(child, expected), "the child of an outside parent differs", p);
+            parents[p]->setPosition(gep::vec3(5.0f, 0.0f, (float)p));
+            GEP_ASSERT(isEquivalent(child, expected), "the child did not follow an outside parent", p);
+            parents[p]->setRotation(rotationFor(p + 7));
+            store.update();
+            GEP_ASSERT(isEquivalent(child, expected), "the pass did not follow an outside parent", p);
+        }
+    }
+
+    // groups of four with an incomplete last group
+    {
+        StoredScene storedScene(10, 3);
+        Scene<gep::Transform> scene(10, 3);
+        storedScene.store.update();
+        // the first root was created last, it ends up in the incomplete group of its level, like its children
+        storedScene.transforms[0]->setPosition(gep::vec3(2.0f, 0.0f, 0.0f));
+        scene.transforms[0].setPosition(gep::vec3(2.0f, 0.0f, 0.0f));
+        GEP_ASSERT(storedScene.store.update() == 2 * 3, "the pass did not skip the unchanged groups");
+        for(size_t i=0; i < scene.transforms.size(); i++)
+            GEP_ASSERT(isEquivalent(*storedScene.transforms[i], scene.transforms[i]), "the stored scene differs", i);
+    }
+}
+
+GEP_UNITTEST_TEST(Math, TransformStorePerformance)
+{
+    struct Case
+    {
+        const char* name;
+        size_t numRoots;
+        size_t depth;
+        size_t moveEvery;
+    };
+    const Case cases[] = {
+        { "deep, 64 chains of 64, all move", 64, 64, 1 },
+        { "wide, 10000 objects, all move", 10000, 1, 1 },
+        { "wide, 5000 objects + child, all move", 5000, 2, 1 },
+        { "wide, 5000 objects + child, 1/8 move", 5000, 2, 8 },
+        { "mostly static, 5000 chains of 4", 5000, 4, 100000 },
+    };
+    const size_t numFrames = 20;
+
+    log.logMessage("Moving roots and reading the world matrix of every transform, ms per frame:\n");
+    log.logMessage("    %-36s | transform | store | speedup | world matrices per second\n", "scene");
+    for(size_t c=0; c < GEP_ARRAY_SIZE(cases); c++)
+    {
+        const Case& testCase = cases[c];
+        Scene<gep::Transform> scene(testCase.numRoots, testCase.depth);
+        StoredScene storedScene(testCase.numRoots, testCase.depth);
+        const size_t numTransforms = scene.transforms.size();
+
+        float sum = 0.0f, storedSum = 0.0f;
+        const float transformTime = measureTime([&](){
+            for(size_t frame=0; frame < numFrames; frame++)
+            {
+                for(size_t i=frame % testCase.moveEvery; i < testCase.numRoots; i += testCase.moveEvery)
+                    scene.transforms[i].setPosition(gep::vec3((float)frame, 0.0f, 0.0f));
+                for(size_t i=0; i < numTransforms; i++)
+                    sum += scene.transforms[i].getWorldTransformationMatrix().data[12];
+            }
+        });
+        size_t numComputed = 0;
+        const float storeTime = measureTime([&](){
+            for(size_t frame=0; frame < numFrames; frame++)
+            {
+                for(size_t i=frame % testCase.moveEvery; i < testCase.numRoots; i += testCase.moveEvery)
+                    storedScene.transforms[i]->setPosition(gep::vec3((float)frame, 0.0f, 0.0f));
+                numComputed += storedScene.store.update();
+                for(size_t i=0; i < numTransforms; i++)
+                    storedSum += storedScene.transforms[i]->getWorldTransformationMatrix().data[12];
+            }
+        });
+        GEP_ASSERT(sum == storedSum, "the store computed something else", sum, storedSum);
+        for(size_t i=0; i < numTransforms; i++)
+            GEP_ASSERT(isEquivalent(*storedScene.transforms[i], scene.transforms[i]), "the stored scene differs", i);
+
+        log.logMessage("    %-36s | %9.3f | %5.3f | %6.2fx | %.1f million\n", testCase.name,
+            transformTime * 1000.0f / numFrames, storeTime * 1000.0f / numFrames, transformTime / GEP_MAX(storeTime, 1e-9f),
+            numComputed / GEP_MAX(storeTime, 1e-9f) / 1e6f);
+    }
+}
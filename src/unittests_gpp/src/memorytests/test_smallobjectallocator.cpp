@@ -0,0 +1,173 @@
+#include "stdafx.h"
+#include "Test_Memory.h"
+#include "benchmarkUtils.h"
+#include "gep/memory/allocators.h"
+
+namespace
+{
+    // The Lua allocation function before the small object allocator, used as a baseline:
+    // every resize allocates a new block and copies the old one.
+    void* copyingLuaAllocator(void* userData, void* ptr, size_t originalSize, size_t newSize)
+    {
+        auto pAllocator = static_cast<gep::IAllocator*>(userData);
+        if(newSize == 0)
+        {
+            pAllocator->freeMemory(ptr);
+            return nullptr;
+        }
+        void* newPtr = pAllocator->allocateMemory(newSize);
+        if(ptr != nullptr)
+        {
+            memcpy(newPtr, ptr, GEP_MIN(originalSize, newSize));
+            pAllocator->freeMemory(ptr);
+        }
+        return newPtr;
+    }
+
+    void* smallObjectLuaAllocator(void* userData, void* ptr, size_t originalSize, size_t newSize)
+    {
+        auto pAllocator = static_cast<gep::SmallObjectAllocator*>(userData);
+        return pAllocator->reallocate(ptr, (ptr != nullptr) ? originalSize : 0, newSize);
+    }
+
+    // what a script heavy frame does: every reference type pushed to Lua is a new table with a metatable,
+    // components build strings, create small tables and closures, and a few of them survive the frame
+    const char* g_frameScript =
+        "local proxyMeta = { __index = function(t, k) return rawget(t, '__ptr') end }\n"
+        "local survivors = {}\n"
+        "function frame(numObjects)\n"
+        "    for i = 1, numObjects do\n"
+        "        local proxy = setmetatable({ __ptr = i }, proxyMeta)\n"
+        "        local position = { x = i * 0.5, y = i * 0.25, z = -i }\n"
+        "        local name = 'gameObject' .. i\n"
+        "        local path = {}\n"
+        "        for j = 1, i % 8 do path[j] = position.x + j end\n"
+        "        survivors[i % 128 + 1] = { proxy = proxy, name = name, path = path, update = function() return position.x end }\n"
+        "    end\n"
+        "end\n";
+
+    // runs the frames in a new Lua state and returns the time it took
+    float runScriptFrames(lua_Alloc allocationFunction, void* userData, size_t numFrames, size_t numObjects)
+    {
+        lua_State* L = lua_newstate(allocationFunction, userData);
+        luaL_openlibs(L);
+        GEP_ASSERT(luaL_dostring(L, g_frameScript) == 0, "frame script did not load", lua_tostring(L, -1));
+
+        const float time = measureTime([&](){
+            for(size_t i=0; i < numFrames; i++)
+            {
+                lua_getglobal(L, "frame");
+                lua_pushinteger(L, (lua_Integer)numObjects);
+                GEP_ASSERT(lua_pcall(L, 1, 0, 0) == 0, "frame script failed", lua_tostring(L, -1));
+            }
+        });
+        lua_close(L);
+        return time;
+    }
+}
+
+GEP_UNITTEST_TEST(Memory, SmallObjectAllocator)
+{
+    gep::SmallObjectAllocator allocator(&g_stdAllocator);
+
+    // all sizes up to the biggest size class, plus some large ones
+    const size_t numBlocks = 600;
+    void* blocks[numBlocks];
+    size_t expectedBytesUsed = 0;
+    for(size_t i=0; i < numBlocks; i++)
+    {
+        const size_t size = i + 1;
+        blocks[i] = allocator.allocate(size);
+        GEP_ASSERT(blocks[i] != nullptr);
+        GEP_ASSERT(((size_t)blocks[i] % sizeof(double)) == 0, "block is not aligned", size);
+        memset(blocks[i], (int)(i & 0xFF), size);
+        expectedBytesUsed += size;
+    }
+    GEP_ASSERT(allocator.getNumBytesUsed() == expectedBytesUsed, "wrong number of used bytes", allocator.getNumBytesUsed(), expectedBytesUsed);
+    GEP_ASSERT(allocator.getNumBytesReserved() >= expectedBytesUsed);
+    for(size_t i=0; i < numBlocks; i++)
+    {
+        const unsigned char* bytes = static_cast<const unsigned char*>(blocks[i]);
+        for(size_t j=0; j <= i; j++)
+            GEP_ASSERT(bytes[j] == (i & 0xFF), "blocks overlap", i, j);
+    }
+
+    // freed blocks are reused
+    allocator.deallocate(blocks[40], 41);
+    void* reused = allocator.allocate(45);
+    GEP_ASSERT(reused == blocks[40], "freed block was not reused");
+    blocks[40] = reused;
+    expectedBytesUsed += 45 - 41;
+
+    // resizing within the size class does not move the block
+    void* resized = allocator.reallocate(blocks[100], 101, 112);
+    GEP_ASSERT(resized == blocks[100], "block moved although it stayed in its size class");
+    resized = allocator.reallocate(resized, 112, 97);
+    GEP_ASSERT(resized == blocks[100], "block moved although it stayed in its size class");
+    expectedBytesUsed += 97 - 101;
+    GEP_ASSERT(allocator.getNumBytesUsed() == expectedBytesUsed, "wrong number of used bytes after resizing", allocator.getNumBytesUsed(), expectedBytesUsed);
+
+    // resizing into another size class moves the block and keeps its content
+    resized = allocator.reallocate(resized, 97, 300);
+    GEP_ASSERT(resized != blocks[100], "block has to move into the bigger size class");
+    for(size_t j=0; j < 97; j++)
+        GEP_ASSERT(static_cast<unsigned char*>(resized)[j] == 100, "content was not copied", j);
+    resized = allocator.reallocate(resized, 300, 2000);
+    for(size_t j=0; j < 97; j++)
+        GEP_ASSERT(static_cast<unsigned char*>(resized)[j] == 100, "content was not copied into a large block", j);
+    blocks[100] = resized;
+    expectedBytesUsed += 2000 - 97;
+    GEP_ASSERT(allocator.getNumBytesUsed() == expectedBytesUsed, "wrong number of used bytes after moving", allocator.getNumBytesUsed(), expectedBytesUsed);
+
+    // shrinking does not move the block, unless a large block can go back to the parent allocator
+    resized = allocator.reallocate(blocks[200], 201, 40);
+    GEP_ASSERT(resized == blocks[200], "block moved although it shrank into a smaller size class");
+    resized = allocator.reallocate(blocks[549], 550, 530);
+    GEP_ASSERT(resized == blocks[549], "large block moved although it shrank");
+    resized = allocator.reallocate(blocks[100], 2000, 90);
+    GEP_ASSERT(resized != blocks[100], "large block was not moved into a size class");
+    for(size_t j=0; j < 90; j++)
+        GEP_ASSERT(static_cast<unsigned char*>(resized)[j] == 100, "content was not copied into the smaller block", j);
+    blocks[100] = resized;
+    expectedBytesUsed += (40 - 201) + (530 - 550) + (90 - 2000);
+    GEP_ASSERT(allocator.getNumBytesUsed() == expectedBytesUsed, "wrong number of used bytes after shrinking", allocator.getNumBytesUsed(), expectedBytesUsed);
+
+    // reallocate follows the rules of lua_Alloc
+    void* luaBlock = allocator.reallocate(nullptr, 0, 24);
+    GEP_ASSERT(luaBlock != nullptr);
+    GEP_ASSERT(allocator.reallocate(luaBlock, 24, 0) == nullptr);
+
+    for(size_t i=0; i < numBlocks; i++)
+    {
+        size_t size = i + 1;
+        if(i == 40) size = 45;
+        if(i == 100) size = 90;
+        if(i == 200) size = 40;
+        if(i == 549) size = 530;
+        allocator.deallocate(blocks[i], size);
+    }
+    GEP_ASSERT(allocator.getNumBytesUsed() == 0, "bytes are still in use", allocator.getNumBytesUsed());
+    GEP_ASSERT(allocator.getNumAllocations() == allocator.getNumFrees(), "number of allocations and frees do not match",
+        allocator.getNumAllocations(), allocator.getNumFrees());
+    // large blocks went back to the parent, pages are kept
+    GEP_ASSERT(allocator.getNumBytesReserved() % gep::SmallObjectAllocator::PAGE_SIZE == 0);
+}
+
+GEP_UNITTEST_TEST(Memory, LuaAllocatorPerformance)
+{
+    const size_t numFrames = 60;
+    const size_t numObjects = 2000;
+
+    const float copyingTime = runScriptFrames(&copyingLuaAllocator, &g_stdAllocator, numFrames, numObjects);
+
+    gep::SmallObjectAllocator allocator(&g_stdAllocator);
+    const float smallObjectTime = runScriptFrames(&smallObjectLuaAllocator, &allocator, numFrames, numObjects);
+    GEP_ASSERT(allocator.getNumBytesUsed() == 0, "the Lua state did not free all its memory", allocator.getNumBytesUsed());
+
+    log.logMessage("%u script frames creating %u objects each:\n", (gep::uint32)numFrames, (gep::uint32)numObjects);
+    log.logMessage("    copying realloc on the std allocator: %8.3f ms per frame\n", copyingTime * 1000.0f / numFrames);
+    log.logMessage("    small object allocator:               %8.3f ms per frame (%.2fx)\n",
+        smallObjectTime * 1000.0f / numFrames, copyingTime / GEP_MAX(smallObjectTime, 1e-6f));
+    log.logMessage("    %u allocations, %u KB reserved in pages\n",
+        (gep::uint32)allocator.getNumAllocations(), (gep::uint32)(allocator.getNumBytesReserved() / 1024));
+}
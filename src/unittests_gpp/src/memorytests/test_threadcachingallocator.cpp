@@ -0,0 +1,132 @@
+#include "stdafx.h"
+#include "Test_Memory.h"
+#include "benchmarkUtils.h"
+#include "gep/threading/mutex.h"
+
+namespace
+{
+    // The allocation path of the StdAllocator before it got thread caches, used as a baseline
+    class LockingMallocAllocator : public gep::IAllocator
+    {
+        gep::Mutex m_mutex;
+        size_t m_numAllocations;
+        size_t m_numFrees;
+        size_t m_bytesAllocated;
+    public:
+        LockingMallocAllocator() : m_numAllocations(0), m_numFrees(0), m_bytesAllocated(0) {}
+
+        virtual void* allocateMemory(size_t size) override
+        {
+            gep::ScopedLock<gep::Mutex> lock(m_mutex);
+            m_bytesAllocated += size;
+            m_numAllocations++;
+            return malloc(size);
+        }
+
+        virtual void freeMemory(void* mem) override
+        {
+            gep::ScopedLock<gep::Mutex> lock(m_mutex);
+            if(mem != nullptr)
+            {
+                ++m_numFrees;
+                m_bytesAllocated -= _msize(mem);
+                free(mem);
+            }
+        }
+    };
+
+    // every thread keeps a small working set of allocations and replaces a random one each iteration
+    void allocationWorkload(gep::IAllocator& allocator, size_t threadIndex, size_t numIterations)
+    {
+        const size_t workingSetSize = 64;
+        void* workingSet[workingSetSize] = { nullptr };
+        unsigned int random = (unsigned int)threadIndex * 7919 + 1;
+        for(size_t i=0; i < numIterations; i++)
+        {
+            random = random * 1103515245 + 12345;
+            size_t slot = (random >> 8) % workingSetSize;
+            size_t size = 8 + (random >> 16) % 256;
+            allocator.freeMemory(workingSet[slot]);
+            workingSet[slot] = allocator.allocateMemory(size);
+            static_cast<char*>(workingSet[slot])[0] = (char)i;
+        }
+        for(size_t i=0; i < workingSetSize; i++)
+            allocator.freeMemory(workingSet[i]);
+    }
+}
+
+GEP_UNITTEST_TEST(Memory, ThreadCachingAllocator)
+{
+    gep::ThreadCachingAllocator allocator;
+
+    // every size class and some large allocations
+    const size_t sizes[] = { 0, 1, 16, 17, 100, 128, 129, 500, 1024, 2000, 2048, 2049, 10000, 1024 * 1024 };
+    void* allocations[GEP_ARRAY_SIZE(sizes)];
+    size_t bytesRequested = 0;
+    for(size_t i=0; i < GEP_ARRAY_SIZE(sizes); i++)
+    {
+        allocations[i] = allocator.allocateMemory(sizes[i]);
+        GEP_ASSERT(allocations[i] != nullptr, "allocation failed", sizes[i]);
+        GEP_ASSERT(((uintptr_t)allocations[i] % sizeof(void*)) == 0, "allocation is not aligned", sizes[i]);
+        memset(allocations[i], (int)i, sizes[i]);
+        bytesRequested += sizes[i];
+    }
+    GEP_ASSERT(allocator.getNumAllocations() == GEP_ARRAY_SIZE(sizes));
+    GEP_ASSERT(allocator.getNumBytesUsed() == bytesRequested, "wrong number of used bytes", allocator.getNumBytesUsed(), bytesRequested);
+    GEP_ASSERT(allocator.getNumBytesReserved() >= bytesRequested);
+
+    for(size_t i=0; i < GEP_ARRAY_SIZE(sizes); i++)
+    {
+        for(size_t j=0; j < sizes[i]; j++)
+        {
+            GEP_ASSERT(static_cast<unsigned char*>(allocations[i])[j] == (unsigned char)i, "allocations overlap", i, j);
+        }
+        allocator.freeMemory(allocations[i]);
+    }
+    GEP_ASSERT(allocator.getNumFrees() == GEP_ARRAY_SIZE(sizes));
+    GEP_ASSERT(allocator.getNumBytesUsed() == 0);
+
+    // memory freed on another thread than it was allocated on and statistics of finished threads
+    const size_t numCrossThreadAllocations = 1000;
+    void* crossThreadAllocations[numCrossThreadAllocations];
+    runOnThreads(1, [&](size_t){
+        for(size_t i=0; i < numCrossThreadAllocations; i++)
+            crossThreadAllocations[i] = allocator.allocateMemory(i % 300);
+    });
+    GEP_ASSERT(allocator.getNumAllocations() == GEP_ARRAY_SIZE(sizes) + numCrossThreadAllocations);
+    for(size_t i=0; i < numCrossThreadAllocations; i++)
+        allocator.freeMemory(crossThreadAllocations[i]);
+    GEP_ASSERT(allocator.getNumAllocations() == allocator.getNumFrees());
+    GEP_ASSERT(allocator.getNumBytesUsed() == 0, "statistics were not merged correctly", allocator.getNumBytesUsed());
+}
+
+GEP_UNITTEST_TEST(Memory, AllocatorContention)
+{
+    const size_t numOperations = 1000000;
+    const size_t threadCounts[] = { 1, 2, 4, 8, 16 };
+
+    log.logMessage("    threads | locking malloc ops/s | thread caching ops/s | speedup\n");
+    for(size_t threadCount : threadCounts)
+    {
+        const size_t iterationsPerThread = numOperations / threadCount;
+
+        LockingMallocAllocator lockingAllocator;
+        float lockingTime = runOnThreads(threadCount, [&](size_t threadIndex){
+            allocationWorkload(lockingAllocator, threadIndex, iterationsPerThread);
+        });
+
+        gep::ThreadCachingAllocator cachingAllocator;
+        float cachingTime = runOnThreads(threadCount, [&](size_t threadIndex){
+            allocationWorkload(cachingAllocator, threadIndex, iterationsPerThread);
+        });
+        GEP_ASSERT(cachingAllocator.getNumAllocations() == cachingAllocator.getNumFrees(), "thread caches leaked memory");
+        GEP_ASSERT(cachingAllocator.getNumBytesUsed() == 0, "thread caches leaked memory");
+
+        // every iteration is one allocation and one free
+        log.logMessage("    %7u | %20.0f | %20.0f | %6.2fx\n",
+            (unsigned int)threadCount,
+            (2 * numOperations) / lockingTime,
+            (2 * numOperations) / cachingTime,
+            lockingTime / cachingTime);
+    }
+}
@@ -0,0 +1,392 @@
+#include "stdafx.h"
+#include "Test_Resources.h"
+#include "benchmarkUtils.h"
+#include "gep/chunkfile.h"
+#include "gep/modelloader.h"
+#include "gep/resourceCache.h"
+#include "gep/threading/taskQueue.h"
+#include <vector>
+#include <string>
+
+namespace
+{
+    const char* g_testFilename = "chunkfile_test.tmp";
+
+    void writeTestFile(bool writeIndex = false)
+    {
+        gep::Chunkfile file(g_testFilename, gep::Chunkfile::Operation::write);
+        file.startWriting("testFile", 3, writeIndex);
+
+        file.startWriteChunk("header");
+        file.write<gep::uint32>(42);
+        file.write<gep::uint8>(7); // leaves everything after it unaligned
+        file.endWriteChunk();
+
+        file.startWriteChunk("skipped");
+        for(gep::uint32 i=0; i < 1000; i++)
+            file.write(i);
+        file.endWriteChunk();
+
+        file.startWriteChunk("data");
+        gep::int16 values[300];
+        for(int i=0; i < GEP_ARRAY_SIZE(values); i++)
+            values[i] = (gep::int16)(i * 100 - 15000);
+        file.writeArrayWithLength<gep::int16, gep::uint32>(values);
+        file.startWriteChunk("inner");
+        file.write(1.5f);
+        file.endWriteChunk();
+        file.endWriteChunk();
+
+        file.endWriting();
+    }
+
+    // reads the test file and checks its content, views are only used in mapped read operation
+    void readTestFile(gep::Chunkfile::Operation operation)
+    {
+        gep::Chunkfile file(g_testFilename, operation);
+        GEP_ASSERT(file.isOpen());
+        GEP_ASSERT(file.startReading("testFile") == gep::SUCCESS);
+        GEP_ASSERT(file.getFileVersion() == 3);
+
+        GEP_ASSERT(file.startReadChunk() == gep::SUCCESS);
+        GEP_ASSERT(file.getCurrentChunkName() == "header");
+        gep::uint32 answer = 0;
+        gep::uint8 small = 0;
+        GEP_ASSERT(file.read(answer) == sizeof(answer) && answer == 42);
+        GEP_ASSERT(file.read(small) == sizeof(small) && small == 7);
+        file.endReadChunk();
+
+        GEP_ASSERT(file.startReadChunk() == gep::SUCCESS);
+        GEP_ASSERT(file.getCurrentChunkName() == "skipped");
+        file.skipCurrentChunk();
+
+        GEP_ASSERT(file.startReadChunk() == gep::SUCCESS);
+        GEP_ASSERT(file.getCurrentChunkName() == "data");
+        gep::uint32 numValues = 0;
+        file.read(numValues);
+        GEP_ASSERT(numValues == 300, "wrong number of values", numValues);
+
+        gep::int16 copies[300];
+        gep::ArrayPtr<const gep::int16> values;
+        if(operation == gep::Chunkfile::Operation::mappedRead)
+        {
+            values = file.readArrayView<gep::int16>(numValues);
+        }
+        else
+        {
+            GEP_ASSERT(file.readArray(gep::ArrayPtr<gep::int16>(copies)) == sizeof(copies));
+            values = gep::ArrayPtr<gep::int16>(copies);
+        }
+        GEP_ASSERT(values.length() == numValues);
+        for(size_t i=0; i < values.length(); i++)
+            GEP_ASSERT(values[i] == (gep::int16)(i * 100 - 15000), "wrong value", i, values[i]);
+
+        GEP_ASSERT(file.startReadChunk() == gep::SUCCESS);
+        GEP_ASSERT(file.getCurrentChunkName() == "inner");
+        float innerValue = 0.0f;
+        file.read(innerValue);
+        GEP_ASSERT(innerValue == 1.5f);
+        file.endReadChunk();
+        GEP_ASSERT(!file.currentChunkHasMoreData());
+        file.endReadChunk();
+
+        // reading at the end of the file fails like fread
+        GEP_ASSERT(!file.currentChunkHasMoreData());
+        file.endReading();
+        gep::uint8 pastTheEnd = 0;
+        GEP_ASSERT(file.read(pastTheEnd) == 0);
+    }
+
+    // opens chunks by name, with an index they are found without reading the chunks before them
+    void readTestFileByName(gep::Chunkfile::Operation operation, bool hasIndex)
+    {
+        gep::Chunkfile file(g_testFilename, operation);
+        GEP_ASSERT(file.hasIndex() == hasIndex);
+        GEP_ASSERT(file.startReading("testFile") == gep::SUCCESS);
+
+        GEP_ASSERT(file.startReadChunk("data") == gep::SUCCESS);
+        GEP_ASSERT(file.getCurrentChunkName() == "data");
+        gep::uint32 numValues = 0;
+        file.read(numValues);
+        GEP_ASSERT(numValues == 300, "wrong number of values", numValues);
+        file.skipRead(numValues * sizeof(gep::int16));
+
+        GEP_ASSERT(file.startReadChunk("inner") == gep::SUCCESS);
+        float innerValue = 0.0f;
+        gep::uint64 hash = 0;
+        if(hasIndex)
+        {
+            GEP_ASSERT(file.getCurrentChunkHash(hash) == gep::SUCCESS);
+            const float expectedValue = 1.5f;
+            gep::ArrayPtr<const gep::uint8> expectedData(reinterpret_cast<const gep::uint8*>(&expectedValue), sizeof(expectedValue));
+            GEP_ASSERT(hash == gep::ResourceCache::hashContent(expectedData), "wrong chunk hash", hash);
+        }
+        else
+        {
+            GEP_ASSERT(file.getCurrentChunkHash(hash) == gep::FAILURE);
+        }
+        file.read(innerValue);
+        GEP_ASSERT(innerValue == 1.5f);
+        file.endReadChunk();
+        file.endReadChunk();
+
+        // chunks are only searched after the current position
+        GEP_ASSERT(file.startReadChunk("header") == gep::FAILURE);
+        GEP_ASSERT(!file.currentChunkHasMoreData());
+        file.endReading();
+    }
+
+    // all models below the given directory
+    void findModels(const std::string& directory, std::vector<std::string>& models)
+    {
+        WIN32_FIND_DATAA findData;
+        HANDLE findHandle = FindFirstFileA((directory + "/*").c_str(), &findData);
+        if(findHandle == INVALID_HANDLE_VALUE)
+            return;
+        do
+        {
+            std::string name = findData.cFileName;
+            if(findData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
+            {
+                if(name != "." && name != "..")
+                    findModels(directory + "/" + name, models);
+            }
+            else if(name.size() > 8 && _stricmp(name.c_str() + name.size() - 8, ".thmodel") == 0)
+            {
+                models.push_back(directory + "/" + name);
+            }
+        } while(FindNextFileA(findHandle, &findData));
+        FindClose(findHandle);
+    }
+
+    // the models in the first of the directories that has any, the tests run in the project or in the bin directory
+    std::string findModelDirectory(const char* directory, std::vector<std::string>& models)
+    {
+        const char* prefixes[] = { "", "../", "../../" };
+        for(size_t i=0; i < GEP_ARRAY_SIZE(prefixes) && models.empty(); i++)
+        {
+            std::string path = std::string(prefixes[i]) + directory;
+            findModels(path, models);
+            if(!models.empty())
+                return path;
+        }
+        return std::string();
+    }
+
+    template <typename T>
+    bool isEqual(gep::ArrayPtr<T> lhs, gep::ArrayPtr<T> rhs)
+    {
+        return lhs.length() == rhs.length() && memcmp(lhs.getPtr(), rhs.getPtr(), lhs.length() * sizeof(T)) == 0;
+    }
+
+    void checkEqualMeshes(const gep::ModelLoader& lhs, const gep::ModelLoader& rhs, const std::string& model)
+    {
+        auto& lhsMeshes = lhs.getModelData().meshes;
+        auto& rhsMeshes = rhs.getModelData().meshes;
+        GEP_ASSERT(lhsMeshes.length() == rhsMeshes.length(), "different number of meshes", model.c_str());
+        for(size_t i=0; i < lhsMeshes.length(); i++)
+        {
+            GEP_ASSERT(isEqual(lhsMeshes[i].vertices, rhsMeshes[i].vertices), "different vertices", model.c_str(), i);
+            GEP_ASSERT(isEqual(lhsMeshes[i].normals, rhsMeshes[i].normals), "different normals", model.c_str(), i);
+            GEP_ASSERT(isEqual(lhsMeshes[i].tangents, rhsMeshes[i].tangents), "different tangents", model.c_str(), i);
+            GEP_ASSERT(isEqual(lhsMeshes[i].bitangents, rhsMeshes[i].bitangents), "different bitangents", model.c_str(), i);
+            GEP_ASSERT(isEqual(lhsMeshes[i].faces, rhsMeshes[i].faces), "different faces", model.c_str(), i);
+            for(size_t j=0; j < GEP_ARRAY_SIZE(lhsMeshes[i].texcoords); j++)
+                GEP_ASSERT(isEqual(lhsMeshes[i].texcoords[j], rhsMeshes[i].texcoords[j]), "different texcoords", model.c_str(), i, j);
+        }
+    }
+}
+
+GEP_UNITTEST_TEST(Resources, MappedChunkfile)
+{
+    writeTestFile();
+    SCOPE_EXIT{ DeleteFileA(g_testFilename); });
+
+    readTestFile(gep::Chunkfile::Operation::read);
+    readTestFile(gep::Chunkfile::Operation::mappedRead);
+
+    gep::Chunkfile missing("does_not_exist.tmp", gep::Chunkfile::Operation::mappedRead);
+    GEP_ASSERT(!missing.isOpen());
+    GEP_ASSERT(missing.startReading("testFile") == gep::FAILURE);
+}
+
+GEP_UNITTEST_TEST(Resources, ChunkIndex)
+{
+    SCOPE_EXIT{ DeleteFileA(g_testFilename); });
+
+    writeTestFile(true);
+    readTestFileByName(gep::Chunkfile::Operation::read, true);
+    readTestFileByName(gep::Chunkfile::Operation::mappedRead, true);
+    // readers that walk the chunks do not see the index
+    {
+        gep::Chunkfile file(g_testFilename, gep::Chunkfile::Operation::mappedRead);
+        GEP_ASSERT(file.startReading("testFile") == gep::SUCCESS);
+        const char* names[] = { "header", "skipped", "data" };
+        for(size_t i=0; i < GEP_ARRAY_SIZE(names); i++)
+        {
+            GEP_ASSERT(file.startReadChunk() == gep::SUCCESS);
+            GEP_ASSERT(file.getCurrentChunkName() == names[i]);
+            file.skipCurrentChunk();
+        }
+        GEP_ASSERT(!file.currentChunkHasMoreData());
+        file.endReading();
+    }
+
+    // without an index the chunks before are walked
+    writeTestFile(false);
+    readTestFileByName(gep::Chunkfile::Operation::read, false);
+    readTestFileByName(gep::Chunkfile::Operation::mappedRead, false);
+}
+
+GEP_UNITTEST_TEST(Resources, ChunkIndexPerformance)
+{
+    SCOPE_EXIT{ DeleteFileA(g_testFilename); });
+
+    // lots of small chunks before the one a partial load wants, like materials and bones before the meshes
+    const gep::uint32 numChunks = 5000;
+    const size_t numRepetitions = 100;
+    auto writeFile = [&](bool writeIndex){
+        gep::Chunkfile file(g_testFilename, gep::Chunkfile::Operation::write);
+        file.startWriting("testFile", 1, writeIndex);
+        for(gep::uint32 i=0; i < numChunks; i++)
+        {
+            file.startWriteChunk("skipped");
+            file.write(i);
+            file.endWriteChunk();
+        }
+        file.startWriteChunk("wanted");
+        file.write(numChunks);
+        file.endWriteChunk();
+        file.endWriting();
+    };
+    auto openWanted = [&](){
+        for(size_t repetition=0; repetition < numRepetitions; repetition++)
+        {
+            gep::Chunkfile file(g_testFilename, gep::Chunkfile::Operation::read);
+            GEP_ASSERT(file.startReading("testFile") == gep::SUCCESS);
+            GEP_ASSERT(file.startReadChunk("wanted") == gep::SUCCESS);
+            gep::uint32 value = 0;
+            file.read(value);
+            GEP_ASSERT(value == numChunks);
+            file.endReadChunk();
+            file.endReading();
+        }
+    };
+
+    writeFile(false);
+    const float walkTime = measureTime(openWanted);
+    writeFile(true);
+    const float indexTime = measureTime(openWanted);
+
+    log.logMessage("opening the last of %u chunks %u times:\n", numChunks + 1, (gep::uint32)numRepetitions);
+    log.logMessage("    walking the chunks: %8.3f ms per file\n", walkTime * 1000.0f / numRepetitions);
+    log.logMessage("    chunk index:        %8.3f ms per file (%.2fx)\n",
+        indexTime * 1000.0f / numRepetitions, walkTime / GEP_MAX(indexTime, 1e-6f));
+}
+
+GEP_UNITTEST_TEST(Resources, ModelLoadingPerformance)
+{
+    std::vector<std::string> models;
+    findModelDirectory("data/models", models);
+    if(models.empty())
+    {
+        log.logMessage("data/models was not found, skipping the benchmark\n");
+        return;
+    }
+
+    // the models are small, a pass takes less than a millisecond
+    const size_t numRepetitions = 100;
+    auto loadAll = [&](gep::Chunkfile::Operation operation){
+        for(size_t repetition=0; repetition < numRepetitions; repetition++)
+        {
+            for(auto& model : models)
+            {
+                gep::ModelLoader loader;
+                loader.loadFile(model.c_str(), gep::ModelLoader::Load::Everything, operation);
+                GEP_ASSERT(loader.getModelData().hasData);
+            }
+        }
+    };
+
+    // the same data either way
+    for(auto& model : models)
+    {
+        gep::ModelLoader readLoader, mappedLoader;
+        readLoader.loadFile(model.c_str(), gep::ModelLoader::Load::Everything, gep::Chunkfile::Operation::read);
+        mappedLoader.loadFile(model.c_str(), gep::ModelLoader::Load::Everything, gep::Chunkfile::Operation::mappedRead);
+        checkEqualMeshes(readLoader, mappedLoader, model);
+    }
+
+    // warm up the file cache, so both measure the same thing
+    loadAll(gep::Chunkfile::Operation::read);
+    const float readTime = measureTime([&](){ loadAll(gep::Chunkfile::Operation::read); });
+    const float mappedTime = measureTime([&](){ loadAll(gep::Chunkfile::Operation::mappedRead); });
+
+    log.logMessage("loading the %u models of data/models %u times:\n", (gep::uint32)models.size(), (gep::uint32)numRepetitions);
+    log.logMessage("    read:        %8.3f ms per pass\n", readTime * 1000.0f / numRepetitions);
+    log.logMessage("    mapped read: %8.3f ms per pass (%.2fx)\n",
+        mappedTime * 1000.0f / numRepetitions, readTime / GEP_MAX(mappedTime, 1e-6f));
+}
+
+GEP_UNITTEST_TEST(Resources, ParallelModelLoading)
+{
+    // the sponza scene if it was exported, all models otherwise
+    std::vector<std::string> models;
+    std::string directory = findModelDirectory("data/sponza", models);
+    if(models.empty())
+        directory = findModelDirectory("data", models);
+    if(models.empty())
+    {
+        log.logMessage("data was not found, skipping the benchmark\n");
+        return;
+    }
+
+    // decoding on a task queue gives the same data as decoding on the loading thread
+    {
+        gep::TaskQueue taskQueue(4);
+        for(auto& model : models)
+        {
+            gep::ModelLoader serialLoader, parallelReadLoader, parallelMappedLoader;
+            serialLoader.loadFile(model.c_str(), gep::ModelLoader::Load::Everything, gep::Chunkfile::Operation::read);
+            parallelReadLoader.loadFile(model.c_str(), gep::ModelLoader::Load::Everything, gep::Chunkfile::Operation::read, &taskQueue);
+            parallelMappedLoader.loadFile(model.c_str(), gep::ModelLoader::Load::Everything, gep::Chunkfile::Operation::mappedRead, &taskQueue);
+            checkEqualMeshes(serialLoader, parallelReadLoader, model);
+            checkEqualMeshes(serialLoader, parallelMappedLoader, model);
+        }
+    }
+
+    const size_t numRepetitions = 100;
+    auto loadAll = [&](gep::TaskQueue* pTaskQueue){
+        for(size_t repetition=0; repetition < numRepetitions; repetition++)
+        {
+            for(auto& model : models)
+            {
+                gep::ModelLoader loader;
+                loader.loadFile(model.c_str(), gep::ModelLoader::Load::Everything, gep::Chunkfile::Operation::mappedRead, pTaskQueue);
+            }
+        }
+    };
+
+    // warm up the file cache
+    loadAll(nullptr);
+    const float serialTime = measureTime([&](){ loadAll(nullptr); });
+
+    size_t numHardwareWorkers = 0;
+    {
+        gep::TaskQueue taskQueue;
+        numHardwareWorkers = taskQueue.getNumWorkers();
+    }
+    // more workers than hardware threads show what the task queue costs when it can not run in parallel
+    const size_t maxNumWorkers = GEP_MAX(numHardwareWorkers, size_t(4));
+
+    log.logMessage("loading the %u models of %s %u times, %u hardware threads:\n", (gep::uint32)models.size(), directory.c_str(),
+        (gep::uint32)numRepetitions, (gep::uint32)numHardwareWorkers);
+    log.logMessage("    loading thread: %8.3f ms per pass\n", serialTime * 1000.0f / numRepetitions);
+    for(size_t numWorkers = 1; numWorkers <= maxNumWorkers; numWorkers *= 2)
+    {
+        gep::TaskQueue taskQueue(numWorkers);
+        const float parallelTime = measureTime([&](){ loadAll(&taskQueue); });
+        log.logMessage("    %2u workers:     %8.3f ms per pass (%.2fx)\n", (gep::uint32)numWorkers,
+            parallelTime * 1000.0f / numRepetitions, serialTime / GEP_MAX(parallelTime, 1e-6f));
+    }
+}
@@ -0,0 +1,190 @@
+#include "stdafx.h"
+#include "Test_Resources.h"
+#include "benchmarkUtils.h"
+#include "gep/resourceCache.h"
+#include "gep/file.h"
+#include "gep/container/hashmap.h"
+#include <vector>
+#include <string>
+
+namespace
+{
+    const char* g_cacheDirectory = "resourcecache_test.tmp";
+
+    gep::ArrayPtr<const gep::uint8> toBytes(const char* str)
+    {
+        return gep::ArrayPtr<const gep::uint8>(reinterpret_cast<const gep::uint8*>(str), strlen(str));
+    }
+
+    void deleteCacheDirectory()
+    {
+        WIN32_FIND_DATAA findData;
+        HANDLE findHandle = FindFirstFileA((std::string(g_cacheDirectory) + "/*").c_str(), &findData);
+        if(findHandle != INVALID_HANDLE_VALUE)
+        {
+            do
+            {
+                if(!(findData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY))
+                    DeleteFileA((std::string(g_cacheDirectory) + "/" + findData.cFileName).c_str());
+            } while(FindNextFileA(findHandle, &findData));
+            FindClose(findHandle);
+        }
+        RemoveDirectoryA(g_cacheDirectory);
+    }
+
+    // all files below the given directory
+    void findFiles(const std::string& directory, std::vector<std::string>& files)
+    {
+        WIN32_FIND_DATAA findData;
+        HANDLE findHandle = FindFirstFileA((directory + "/*").c_str(), &findData);
+        if(findHandle == INVALID_HANDLE_VALUE)
+            return;
+        do
+        {
+            std::string name = findData.cFileName;
+            if(findData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
+            {
+                if(name != "." && name != "..")
+                    findFiles(directory + "/" + name, files);
+            }
+            else
+            {
+                files.push_back(directory + "/" + name);
+            }
+        } while(FindNextFileA(findHandle, &findData));
+        FindClose(findHandle);
+    }
+}
+
+GEP_UNITTEST_TEST(Resources, ContentHash)
+{
+    // the hash is stored in the cache, it must never change
+    GEP_ASSERT(gep::ResourceCache::hashContent(gep::ArrayPtr<const gep::uint8>()) == 0xEF46DB3751D8E999ull, "wrong hash of no data");
+    GEP_ASSERT(gep::ResourceCache::hashContent(toBytes("a")) == 0xD24EC4F1A98C6E5Bull, "wrong hash of a single byte");
+    gep::uint8 bytes[100];
+    for(gep::uint8 i=0; i < GEP_ARRAY_SIZE(bytes); i++)
+        bytes[i] = i;
+    GEP_ASSERT(gep::ResourceCache::hashContent(bytes, 42) == 0x819D2B726001D507ull, "wrong hash with a seed");
+
+    // every byte counts, also in the tail after the last full stripe
+    for(size_t i=0; i < GEP_ARRAY_SIZE(bytes); i++)
+    {
+        const gep::uint64 hash = gep::ResourceCache::hashContent(bytes);
+        bytes[i] ^= 1;
+        GEP_ASSERT(gep::ResourceCache::hashContent(bytes) != hash, "changing a byte did not change the hash", i);
+        bytes[i] ^= 1;
+    }
+    GEP_ASSERT(gep::ResourceCache::hashContent(gep::ArrayPtr<const gep::uint8>(bytes, 99)) != gep::ResourceCache::hashContent(bytes));
+}
+
+GEP_UNITTEST_TEST(Resources, ResourceCache)
+{
+    deleteCacheDirectory();
+    SCOPE_EXIT{ deleteCacheDirectory(); });
+
+    gep::ResourceCache cache(g_cacheDirectory);
+    const gep::uint64 hash = gep::ResourceCache::hashContent(toBytes("float4 main() : SV_Target { return 1; }"));
+    const char* payload = "compiled bytecode";
+
+    gep::DynamicArray<gep::uint8> loaded;
+    GEP_ASSERT(cache.load("Shader", hash, 1, loaded) == gep::FAILURE, "found an entry in an empty cache");
+
+    GEP_ASSERT(cache.store("Shader", hash, 1, toBytes(payload), 25.0f) == gep::SUCCESS);
+    GEP_ASSERT(cache.load("Shader", hash, 1, loaded) == gep::SUCCESS, "the stored entry was not found");
+    GEP_ASSERT(loaded.length() == strlen(payload) && memcmp(loaded.toArray().getPtr(), payload, loaded.length()) == 0, "wrong payload");
+
+    // other types, hashes and versions do not match
+    GEP_ASSERT(cache.load("Texture2D", hash, 1, loaded) == gep::FAILURE, "found an entry of another type");
+    GEP_ASSERT(cache.load("Shader", hash + 1, 1, loaded) == gep::FAILURE, "found an entry of another hash");
+    GEP_ASSERT(cache.load("Shader", hash, 2, loaded) == gep::FAILURE, "found an outdated entry");
+
+    // a cache written by a previous run is found
+    {
+        gep::ResourceCache warmCache(g_cacheDirectory);
+        GEP_ASSERT(warmCache.load("Shader", hash, 1, loaded) == gep::SUCCESS, "the entry did not survive");
+        auto statistics = warmCache.getStatistics();
+        GEP_ASSERT(statistics.numHits == 1 && statistics.numMisses == 0 && statistics.savedTimeMs == 25.0f);
+    }
+
+    auto statistics = cache.getStatistics();
+    GEP_ASSERT(statistics.numHits == 1, "wrong number of hits", statistics.numHits);
+    GEP_ASSERT(statistics.numMisses == 4, "wrong number of misses", statistics.numMisses);
+    GEP_ASSERT(statistics.numStores == 1, "wrong number of stores", statistics.numStores);
+
+    // damaged entries are misses, storing again repairs them
+    char filename[256];
+    sprintf_s(filename, "%s/Shader_%08x%08x.bin", g_cacheDirectory, (gep::uint32)(hash >> 32), (gep::uint32)hash);
+    {
+        gep::RawFile file(filename, "r+b");
+        GEP_ASSERT(file.isOpen(), "the entry is not where it is expected", filename);
+        file.seekEnd();
+        file.seek(file.position() - 1);
+        file.write('X');
+    }
+    GEP_ASSERT(cache.load("Shader", hash, 1, loaded) == gep::FAILURE, "loaded a damaged entry");
+    {
+        gep::RawFile file(filename, "wb");
+        file.write(gep::uint32(0));
+    }
+    GEP_ASSERT(cache.load("Shader", hash, 1, loaded) == gep::FAILURE, "loaded a truncated entry");
+    GEP_ASSERT(cache.store("Shader", hash, 1, toBytes(payload), 25.0f) == gep::SUCCESS);
+    GEP_ASSERT(cache.load("Shader", hash, 1, loaded) == gep::SUCCESS, "the entry was not repaired");
+}
+
+GEP_UNITTEST_TEST(Resources, ContentDeduplication)
+{
+    // the tests run in the project or in the bin directory
+    std::vector<std::string> files;
+    const char* prefixes[] = { "", "../", "../../" };
+    for(size_t i=0; i < GEP_ARRAY_SIZE(prefixes) && files.empty(); i++)
+        findFiles(std::string(prefixes[i]) + "data", files);
+    if(files.empty())
+    {
+        log.logMessage("data directory not found, skipping the report\n");
+        return;
+    }
+
+    // identical files would be loaded once and shared
+    gep::Hashmap<gep::uint64, size_t> firstFileByHash;
+    size_t numBytes = 0, numDuplicates = 0, numDuplicateBytes = 0;
+    const float hashTime = measureTime([&](){
+        for(size_t i=0; i < files.size(); i++)
+        {
+            gep::MappedFile file;
+            if(!file.open(files[i].c_str()))
+                continue;
+            const gep::uint64 hash = gep::ResourceCache::hashContent(file.getData());
+            numBytes += file.getData().length();
+            size_t first;
+            if(firstFileByHash.tryGet(hash, first) == gep::SUCCESS)
+            {
+                log.logMessage("    %s is the same as %s\n", files[i].c_str(), files[first].c_str());
+                numDuplicates++;
+                numDuplicateBytes += file.getData().length();
+            }
+            else
+                firstFileByHash[hash] = i;
+        }
+    });
+    log.logMessage("%u files, %u KB, hashed in %.2f ms (%.0f MB/s)\n", (gep::uint32)files.size(), (gep::uint32)(numBytes / 1024),
+        hashTime * 1000.0f, numBytes / (1024.0f * 1024.0f) / GEP_MAX(hashTime, 1e-6f));
+    log.logMessage("%u duplicates, %u KB loaded only once\n", (gep::uint32)numDuplicates, (gep::uint32)(numDuplicateBytes / 1024));
+
+    // a warm start reads the converted data instead of converting again, measure what a read costs
+    deleteCacheDirectory();
+    SCOPE_EXIT{ deleteCacheDirectory(); });
+    gep::ResourceCache cache(g_cacheDirectory);
+    std::vector<gep::uint8> payload(64 * 1024);
+    for(size_t i=0; i < payload.size(); i++)
+        payload[i] = (gep::uint8)(i * 31);
+    const size_t numEntries = 32;
+    for(size_t i=0; i < numEntries; i++)
+        GEP_ASSERT(cache.store("Shader", i, 1, gep::ArrayPtr<const gep::uint8>(&payload[0], payload.size()), 0.0f) == gep::SUCCESS);
+    gep::DynamicArray<gep::uint8> loaded;
+    const float loadTime = measureTime([&](){
+        for(size_t i=0; i < numEntries; i++)
+            GEP_ASSERT(cache.load("Shader", i, 1, loaded) == gep::SUCCESS);
+    });
+    log.logMessage("reading a %u KB cache entry takes %.3f ms, the conversion times it saves are in the resource loading statistics\n",
+        (gep::uint32)(payload.size() / 1024), loadTime * 1000.0f / numEntries);
+}
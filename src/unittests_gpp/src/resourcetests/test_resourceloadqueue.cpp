@@ -0,0 +1,297 @@
+#include "stdafx.h"
+#include "Test_Resources.h"
+#include "benchmarkUtils.h"
+#include "gepimpl/subsystems/resourceLoadQueue.h"
+#include <thread>
+#include <vector>
+
+namespace
+{
+    gep::ResourceLoadQueue::Request makeRequest(const char* resourceId, gep::LoadPriority priority)
+    {
+        gep::ResourceLoadQueue::Request request;
+        request.pLoader = nullptr;
+        request.resourceId = resourceId;
+        request.priority = priority;
+        request.requestTime = 0.0;
+        return request;
+    }
+
+    // takes a request without waiting and finishes loading it, returns its id
+    std::string takeAndFinish(gep::ResourceLoadQueue& queue)
+    {
+        gep::ResourceLoadQueue::Request request;
+        GEP_ASSERT(queue.take(request, 0) == gep::SUCCESS, "the queue is empty");
+        GEP_ASSERT(queue.finishLoading(request, true), "the request was canceled", request.resourceId.c_str());
+        return request.resourceId;
+    }
+
+    // loader threads which take requests until they are stopped, loading a resource just sleeps
+    class SimulatedLoaders
+    {
+        gep::ResourceLoadQueue& m_queue;
+        std::vector<std::thread> m_threads;
+        volatile bool m_isRunning;
+        volatile LONG m_numLoaded;
+        DWORD m_loadTimeMs;
+
+        void run()
+        {
+            while(m_isRunning)
+            {
+                gep::ResourceLoadQueue::Request request;
+                if(m_queue.take(request, 10) == gep::FAILURE)
+                    continue;
+                Sleep(m_loadTimeMs);
+                m_queue.finishLoading(request, true);
+                InterlockedIncrement(&m_numLoaded);
+            }
+        }
+
+    public:
+        SimulatedLoaders(gep::ResourceLoadQueue& queue, size_t numThreads, DWORD loadTimeMs) :
+            m_queue(queue),
+            m_isRunning(true),
+            m_numLoaded(0),
+            m_loadTimeMs(loadTimeMs)
+        {
+            for(size_t i=0; i < numThreads; i++)
+                m_threads.push_back(std::thread([this](){ run(); }));
+        }
+
+        ~SimulatedLoaders()
+        {
+            m_isRunning = false;
+            for(size_t i=0; i < m_threads.size(); i++)
+                m_queue.wakeUp();
+            for(auto& thread : m_threads)
+                thread.join();
+        }
+
+        void waitForLoaded(LONG numLoaded)
+        {
+            while(m_numLoaded < numLoaded)
+                Sleep(0);
+        }
+    };
+
+    // loads numRequests resources on numThreads loader threads, returns the time in seconds
+    float loadOnThreads(size_t numThreads, size_t numRequests, DWORD loadTimeMs)
+    {
+        gep::ResourceLoadQueue queue;
+        SimulatedLoaders loaders(queue, numThreads, loadTimeMs);
+        return measureTime([&](){
+            char resourceId[32];
+            for(size_t i=0; i < numRequests; i++)
+            {
+                sprintf_s(resourceId, "resource%u", (gep::uint32)i);
+                queue.push(makeRequest(resourceId, gep::LoadPriority::Visible));
+            }
+            loaders.waitForLoaded((LONG)numRequests);
+        });
+    }
+}
+
+GEP_UNITTEST_TEST(Resources, LoadQueuePriorities)
+{
+    gep::ResourceLoadQueue queue;
+
+    // the most urgent priority first, the oldest request of a priority first
+    queue.push(makeRequest("prefetch", gep::LoadPriority::Prefetch));
+    queue.push(makeRequest("visible1", gep::LoadPriority::Visible));
+    queue.push(makeRequest("critical", gep::LoadPriority::Critical));
+    queue.push(makeRequest("visible2", gep::LoadPriority::Visible));
+    GEP_ASSERT(takeAndFinish(queue) == "critical");
+    GEP_ASSERT(takeAndFinish(queue) == "visible1");
+    GEP_ASSERT(takeAndFinish(queue) == "visible2");
+    GEP_ASSERT(takeAndFinish(queue) == "prefetch");
+
+    gep::ResourceLoadQueue::Request request;
+    GEP_ASSERT(queue.take(request, 0) == gep::FAILURE, "the queue should be empty");
+
+    // requesting a waiting resource again raises its priority, but never lowers it
+    queue.push(makeRequest("first", gep::LoadPriority::Visible));
+    queue.push(makeRequest("raised", gep::LoadPriority::Prefetch));
+    queue.push(makeRequest("lowered", gep::LoadPriority::Critical));
+    GEP_ASSERT(queue.raisePriority("raised", gep::LoadPriority::Critical));
+    GEP_ASSERT(queue.raisePriority("lowered", gep::LoadPriority::Prefetch));
+    GEP_ASSERT(!queue.raisePriority("unknown", gep::LoadPriority::Critical));
+    GEP_ASSERT(takeAndFinish(queue) == "lowered");
+    GEP_ASSERT(takeAndFinish(queue) == "raised");
+    GEP_ASSERT(takeAndFinish(queue) == "first");
+
+    // many requests, taking some in between, keep their order
+    char resourceId[32];
+    size_t numTaken = 0;
+    for(size_t i=0; i < 100; i++)
+    {
+        sprintf_s(resourceId, "resource%u", (gep::uint32)i);
+        queue.push(makeRequest(resourceId, gep::LoadPriority::Visible));
+        if(i % 3 == 0)
+        {
+            sprintf_s(resourceId, "resource%u", (gep::uint32)numTaken++);
+            GEP_ASSERT(takeAndFinish(queue) == resourceId, "wrong order", resourceId);
+        }
+    }
+    while(numTaken < 100)
+    {
+        sprintf_s(resourceId, "resource%u", (gep::uint32)numTaken++);
+        GEP_ASSERT(takeAndFinish(queue) == resourceId, "wrong order", resourceId);
+    }
+
+    gep::ResourceLoadingStatistics statistics;
+    queue.getStatistics(statistics);
+    GEP_ASSERT(statistics.numLoaded == 107, "wrong number of loaded resources", statistics.numLoaded);
+    GEP_ASSERT(statistics.numLoading == 0);
+}
+
+GEP_UNITTEST_TEST(Resources, LoadQueueCancel)
+{
+    gep::ResourceLoadQueue queue;
+    gep::DynamicArray<gep::ResourceLoadQueue::Request> canceled;
+    gep::DynamicArray<std::string> canceledLoading;
+
+    // waiting requests are removed and handed back
+    queue.push(makeRequest("stale", gep::LoadPriority::Visible));
+    queue.push(makeRequest("kept", gep::LoadPriority::Visible));
+    GEP_ASSERT(queue.cancel("stale", canceled));
+    GEP_ASSERT(canceled.length() == 1 && canceled[0].resourceId == "stale");
+    GEP_ASSERT(!queue.cancel("unknown", canceled));
+    GEP_ASSERT(takeAndFinish(queue) == "kept");
+
+    // loading requests are marked, their result has to be thrown away
+    queue.push(makeRequest("loading", gep::LoadPriority::Visible));
+    gep::ResourceLoadQueue::Request request;
+    GEP_ASSERT(queue.take(request, 0) == gep::SUCCESS);
+    GEP_ASSERT(queue.cancel("loading", canceled));
+    GEP_ASSERT(canceled.length() == 1, "a loading request must not be handed back");
+    GEP_ASSERT(!queue.finishLoading(request, true), "the canceled result was not thrown away");
+
+    // canceling a priority keeps the others
+    canceled.clear();
+    queue.push(makeRequest("prefetch1", gep::LoadPriority::Prefetch));
+    queue.push(makeRequest("visible", gep::LoadPriority::Visible));
+    queue.push(makeRequest("prefetch2", gep::LoadPriority::Prefetch));
+    queue.push(makeRequest("prefetch3", gep::LoadPriority::Prefetch));
+    gep::ResourceLoadQueue::Request loadingPrefetch;
+    gep::ResourceLoadQueue::Request loadingVisible;
+    GEP_ASSERT(queue.take(loadingVisible, 0) == gep::SUCCESS && loadingVisible.resourceId == "visible");
+    GEP_ASSERT(queue.take(loadingPrefetch, 0) == gep::SUCCESS && loadingPrefetch.resourceId == "prefetch1");
+    GEP_ASSERT(queue.cancel(gep::LoadPriority::Prefetch, canceled, canceledLoading) == 3);
+    GEP_ASSERT(canceled.length() == 2 && canceled[0].resourceId == "prefetch2" && canceled[1].resourceId == "prefetch3");
+    GEP_ASSERT(canceledLoading.length() == 1 && canceledLoading[0] == "prefetch1");
+    GEP_ASSERT(queue.take(request, 0) == gep::FAILURE, "canceled requests are still waiting");
+    GEP_ASSERT(!queue.finishLoading(loadingPrefetch, true));
+    GEP_ASSERT(queue.finishLoading(loadingVisible, true));
+
+    // a canceled resource can be requested again
+    queue.push(makeRequest("stale", gep::LoadPriority::Critical));
+    GEP_ASSERT(takeAndFinish(queue) == "stale");
+
+    gep::ResourceLoadingStatistics statistics;
+    queue.getStatistics(statistics);
+    GEP_ASSERT(statistics.numCanceled == 5, "wrong number of canceled requests", statistics.numCanceled);
+    GEP_ASSERT(statistics.numLoaded == 3, "wrong number of loaded resources", statistics.numLoaded);
+}
+
+GEP_UNITTEST_TEST(Resources, LoadQueueStatistics)
+{
+    gep::ResourceLoadQueue queue;
+    gep::ResourceLoadingStatistics statistics;
+
+    queue.getStatistics(statistics);
+    GEP_ASSERT(statistics.latencyMedianMs == 0.0f && statistics.latencyMaxMs == 0.0f, "latencies without samples");
+
+    queue.push(makeRequest("critical", gep::LoadPriority::Critical));
+    queue.push(makeRequest("visible1", gep::LoadPriority::Visible));
+    queue.push(makeRequest("visible2", gep::LoadPriority::Visible));
+    queue.push(makeRequest("prefetch", gep::LoadPriority::Prefetch));
+    gep::ResourceLoadQueue::Request request;
+    GEP_ASSERT(queue.take(request, 0) == gep::SUCCESS);
+    queue.getStatistics(statistics);
+    GEP_ASSERT(statistics.queueDepth[(size_t)gep::LoadPriority::Critical] == 0);
+    GEP_ASSERT(statistics.queueDepth[(size_t)gep::LoadPriority::Visible] == 2);
+    GEP_ASSERT(statistics.queueDepth[(size_t)gep::LoadPriority::Prefetch] == 1);
+    GEP_ASSERT(statistics.numLoading == 1);
+    queue.finishLoading(request, false);
+    queue.getStatistics(statistics);
+    GEP_ASSERT(statistics.numLoading == 0 && statistics.numFailed == 1);
+
+    // the percentiles of 1..100 ms, in shuffled order
+    for(gep::uint32 i=0; i < 100; i++)
+        queue.addLatency((float)((i * 37) % 100 + 1));
+    queue.getStatistics(statistics);
+    GEP_ASSERT(statistics.latencyMedianMs == 50.0f, "wrong median", statistics.latencyMedianMs);
+    GEP_ASSERT(statistics.latency90Ms == 90.0f, "wrong 90th percentile", statistics.latency90Ms);
+    GEP_ASSERT(statistics.latency99Ms == 99.0f, "wrong 99th percentile", statistics.latency99Ms);
+    GEP_ASSERT(statistics.latencyMaxMs == 100.0f, "wrong maximum", statistics.latencyMaxMs);
+
+    // only the most recent loads count
+    for(size_t i=0; i < gep::ResourceLoadQueue::NUM_LATENCY_SAMPLES; i++)
+        queue.addLatency(5.0f);
+    queue.getStatistics(statistics);
+    GEP_ASSERT(statistics.latencyMedianMs == 5.0f && statistics.latencyMaxMs == 5.0f, "old latencies are still counted");
+}
+
+GEP_UNITTEST_TEST(Resources, LoadQueueThreads)
+{
+    // every request is loaded exactly once, no matter how many threads take them
+    {
+        const size_t numRequests = 1000;
+        gep::ResourceLoadQueue queue;
+        {
+            SimulatedLoaders loaders(queue, 4, 0);
+            char resourceId[32];
+            for(size_t i=0; i < numRequests; i++)
+            {
+                sprintf_s(resourceId, "resource%u", (gep::uint32)i);
+                queue.push(makeRequest(resourceId, (gep::LoadPriority)(i % gep::NUM_LOAD_PRIORITIES)));
+            }
+            loaders.waitForLoaded((LONG)numRequests);
+        }
+        gep::ResourceLoadingStatistics statistics;
+        queue.getStatistics(statistics);
+        GEP_ASSERT(statistics.numLoaded == numRequests, "wrong number of loaded resources", statistics.numLoaded);
+        GEP_ASSERT(statistics.numLoading == 0);
+        for(size_t i=0; i < gep::NUM_LOAD_PRIORITIES; i++)
+            GEP_ASSERT(statistics.queueDepth[i] == 0, "requests were left in the queue", i);
+    }
+
+    // loading waits for the disk most of the time, so more loader threads shorten the load
+    const size_t numRequests = 64;
+    const DWORD loadTimeMs = 2;
+    const float singleThreadTime = loadOnThreads(1, numRequests, loadTimeMs);
+    log.logMessage("loading %u resources taking %u ms each:\n", (gep::uint32)numRequests, (gep::uint32)loadTimeMs);
+    log.logMessage("    1 loader thread:  %8.3f ms\n", singleThreadTime * 1000.0f);
+    for(size_t numThreads = 2; numThreads <= 8; numThreads *= 2)
+    {
+        const float time = loadOnThreads(numThreads, numRequests, loadTimeMs);
+        log.logMessage("    %u loader threads: %8.3f ms (%.2fx)\n", (gep::uint32)numThreads, time * 1000.0f, singleThreadTime / GEP_MAX(time, 1e-6f));
+    }
+
+    // a critical request overtakes a backlog of prefetches
+    {
+        gep::ResourceLoadQueue queue;
+        SimulatedLoaders loaders(queue, 1, loadTimeMs);
+        char resourceId[32];
+        for(size_t i=0; i < numRequests; i++)
+        {
+            sprintf_s(resourceId, "prefetch%u", (gep::uint32)i);
+            queue.push(makeRequest(resourceId, gep::LoadPriority::Prefetch));
+        }
+        const float criticalTime = measureTime([&](){
+            queue.push(makeRequest("critical", gep::LoadPriority::Critical));
+            // the critical request is taken next
+            loaders.waitForLoaded(2);
+        });
+        gep::ResourceLoadingStatistics statistics;
+        queue.getStatistics(statistics);
+        GEP_ASSERT(statistics.queueDepth[(size_t)gep::LoadPriority::Critical] == 0, "the critical request is still waiting");
+        log.logMessage("    critical request behind %u prefetches: %8.3f ms, %u prefetches still waiting\n",
+            (gep::uint32)numRequests, criticalTime * 1000.0f, (gep::uint32)statistics.queueDepth[(size_t)gep::LoadPriority::Prefetch]);
+        // do not wait for the rest of the backlog
+        gep::DynamicArray<gep::ResourceLoadQueue::Request> canceled;
+        gep::DynamicArray<std::string> canceledLoading;
+        queue.cancel(gep::LoadPriority::Prefetch, canceled, canceledLoading);
+    }
+}
@@ -0,0 +1,188 @@
+#include "stdafx.h"
+#include "Test_Scripting.h"
+#include "benchmarkUtils.h"
+#include "gep/interfaces/scripting.h"
+#include <vector>
+
+namespace
+{
+    class ProxyTestObject
+    {
+    public:
+        int value;
+
+        ProxyTestObject(int value) : value(value) {}
+
+        int getValue() { return value; }
+
+        LUA_BIND_REFERENCE_TYPE_BEGIN
+            LUA_BIND_FUNCTION(getValue)
+        LUA_BIND_REFERENCE_TYPE_END
+    };
+
+    // counts the new blocks the Lua state allocates in userData
+    void* countingLuaAllocator(void* userData, void* ptr, size_t originalSize, size_t newSize)
+    {
+        if(newSize == 0)
+        {
+            free(ptr);
+            return nullptr;
+        }
+        if(ptr == nullptr)
+            ++*static_cast<size_t*>(userData);
+        return realloc(ptr, newSize);
+    }
+
+    void pushProxy(lua_State* L, ProxyTestObject* pObject)
+    {
+        lua::structs::objectHandling<lua::structs::ReferenceTypeMarker>::push(L, pObject);
+    }
+
+    // runs a chunk returning a single boolean
+    bool evaluate(lua_State* L, const char* chunk)
+    {
+        GEP_ASSERT(luaL_dostring(L, chunk) == 0, "chunk failed", chunk, lua_tostring(L, -1));
+        bool result = lua_toboolean(L, -1) != 0;
+        lua_pop(L, 1);
+        return result;
+    }
+
+    lua_State* createState(size_t* pNumAllocations)
+    {
+        lua_State* L = lua_newstate(&countingLuaAllocator, pNumAllocations);
+        luaL_openlibs(L);
+        ProxyTestObject::Lua_Bind<ProxyTestObject>(L, "ProxyTestObject");
+        return L;
+    }
+}
+
+GEP_UNITTEST_TEST(Scripting, CachedProxies)
+{
+    size_t numAllocations = 0;
+    lua_State* L = createState(&numAllocations);
+    SCOPE_EXIT{ lua_close(L); });
+
+    ProxyTestObject first(1);
+    ProxyTestObject second(2);
+
+    pushProxy(L, &first);
+    lua_setglobal(L, "first");
+    pushProxy(L, &second);
+    lua_setglobal(L, "second");
+    GEP_ASSERT(evaluate(L, "return first:getValue() == 1 and second:getValue() == 2"));
+    GEP_ASSERT(evaluate(L, "return not first:isNull() and not first:equals(second) and first:equals(first)"));
+
+    // pushing the same object again gives the same proxy and does not allocate
+    const size_t numAllocationsBefore = numAllocations;
+    for(int i=0; i < 1000; i++)
+    {
+        pushProxy(L, &first);
+        lua_getglobal(L, "first");
+        GEP_ASSERT(lua_rawequal(L, -1, -2) != 0, "pushing the same object created another proxy", i);
+        lua_pop(L, 2);
+    }
+    GEP_ASSERT(numAllocations == numAllocationsBefore, "pushing a cached proxy allocated", numAllocations - numAllocationsBefore);
+
+    // fields set by scripts stay with the object
+    GEP_ASSERT(luaL_dostring(L, "first.tag = 'cached'") == 0);
+    pushProxy(L, &first);
+    lua_getfield(L, -1, "tag");
+    GEP_ASSERT(lua_isstring(L, -1) && strcmp(lua_tostring(L, -1), "cached") == 0, "the proxy was not cached");
+    lua_pop(L, 2);
+
+    // scripts still holding the proxy of a destroyed object see a null object
+    lua::utils::invalidateProxy(L, &first);
+    GEP_ASSERT(evaluate(L, "return first:isNull() and first.tag == 'cached'"));
+    GEP_ASSERT(evaluate(L, "return not second:isNull()"));
+
+    // an object at the same address gets a new proxy
+    pushProxy(L, &first);
+    lua_getglobal(L, "first");
+    GEP_ASSERT(lua_rawequal(L, -1, -2) == 0, "the invalidated proxy was pushed again");
+    lua_pop(L, 1);
+    lua_setglobal(L, "first");
+    GEP_ASSERT(evaluate(L, "return not first:isNull() and first:getValue() == 1 and first.tag == nil"));
+
+    // proxies no script references are collected, pushing the object again creates a new one
+    GEP_ASSERT(luaL_dostring(L, "second.tag = 'collected'; second = nil") == 0);
+    lua_gc(L, LUA_GCCOLLECT, 0);
+    pushProxy(L, &second);
+    lua_getfield(L, -1, "tag");
+    GEP_ASSERT(lua_isnil(L, -1), "the proxy of second was not collected");
+    lua_pop(L, 2);
+
+    // invalidating an object that was never pushed does nothing
+    ProxyTestObject third(3);
+    lua::utils::invalidateProxy(L, &third);
+    lua::utils::invalidateProxy(nullptr, &third);
+    GEP_ASSERT(lua_gettop(L) == 0, "the stack is not clean", lua_gettop(L));
+
+    // destructors invalidate the proxies in the state of the scripting manager, while there is one
+    lua::utils::setProxyState(L);
+    {
+        SCOPE_EXIT{ lua::utils::setProxyState(nullptr); });
+        ProxyTestObject fourth(4);
+        pushProxy(L, &fourth);
+        lua_setglobal(L, "fourth");
+        lua::utils::invalidateProxy(&fourth);
+        GEP_ASSERT(evaluate(L, "return fourth:isNull()"), "the proxy of the scripting manager's state was not invalidated");
+    }
+    pushProxy(L, &third);
+    lua_setglobal(L, "third");
+    lua::utils::invalidateProxy(&third);
+    GEP_ASSERT(evaluate(L, "return not third:isNull()"), "a proxy was invalidated without a state");
+}
+
+GEP_UNITTEST_TEST(Scripting, ProxyPushPerformance)
+{
+    const size_t numObjects = 1000;
+    const size_t numFrames = 100;
+
+    size_t numAllocations = 0;
+    lua_State* L = createState(&numAllocations);
+    SCOPE_EXIT{ lua_close(L); });
+
+    std::vector<ProxyTestObject> objects;
+    objects.reserve(numObjects);
+    for(size_t i=0; i < numObjects; i++)
+        objects.push_back(ProxyTestObject((int)i));
+
+    // every frame pushes all objects, like a script component passing its game object to its update function,
+    // and ends with a full collection
+    auto pushAll = [&](){
+        for(size_t frame=0; frame < numFrames; frame++)
+        {
+            for(size_t i=0; i < numObjects; i++)
+            {
+                pushProxy(L, &objects[i]);
+                lua_pop(L, 1);
+            }
+            lua_gc(L, LUA_GCCOLLECT, 0);
+        }
+    };
+
+    // the first frame creates the proxies, keep them alive while measuring
+    lua_createtable(L, (int)numObjects, 0);
+    for(size_t i=0; i < numObjects; i++)
+    {
+        pushProxy(L, &objects[i]);
+        lua_rawseti(L, -2, (int)i + 1);
+    }
+    lua_setglobal(L, "keepAlive");
+
+    const size_t numAllocationsBefore = numAllocations;
+    const float cachedTime = measureTime(pushAll);
+    const size_t numCachedAllocations = numAllocations - numAllocationsBefore;
+    GEP_ASSERT(numCachedAllocations == 0, "pushing cached proxies allocated", numCachedAllocations);
+
+    // without references the proxies are collected and created again, as before the cache existed
+    lua_pushnil(L);
+    lua_setglobal(L, "keepAlive");
+    lua_gc(L, LUA_GCCOLLECT, 0);
+    const float uncachedTime = measureTime(pushAll);
+
+    log.logMessage("%u frames pushing %u objects each:\n", (gep::uint32)numFrames, (gep::uint32)numObjects);
+    log.logMessage("    new proxies:    %8.3f ms per frame\n", uncachedTime * 1000.0f / numFrames);
+    log.logMessage("    cached proxies: %8.3f ms per frame (%.2fx), %u allocations\n",
+        cachedTime * 1000.0f / numFrames, uncachedTime / GEP_MAX(cachedTime, 1e-6f), (gep::uint32)numCachedAllocations);
+}
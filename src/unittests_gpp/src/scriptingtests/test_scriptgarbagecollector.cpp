@@ -0,0 +1,128 @@
+#include "stdafx.h"
+#include "Test_Scripting.h"
+#include "gepimpl/subsystems/scriptGarbageCollector.h"
+#include "gep/timer.h"
+#include <cmath>
+
+namespace
+{
+    void run(lua_State* L, const char* chunk)
+    {
+        GEP_ASSERT(luaL_dostring(L, chunk) == 0, "chunk failed", chunk, lua_tostring(L, -1));
+    }
+
+    // allocates tables until Lua uses the given multiple of the memory it used after the last cycle,
+    // half of them stay referenced, the other half is garbage
+    void grow(lua_State* L, const gep::ScriptGarbageCollector& collector, float factor)
+    {
+        const size_t targetBytes = size_t(collector.getBytesUsed() * factor);
+        run(L, "kept = kept or {}");
+        while(collector.getBytesUsed() < targetBytes)
+        {
+            run(L, "for i=1,100 do kept[#kept + 1] = {} local garbage = {} end");
+        }
+    }
+
+    // a Lua state whose automatic collector does not interfere with the measured growth
+    lua_State* createState(gep::ScriptGarbageCollector& collector)
+    {
+        lua_State* L = luaL_newstate();
+        luaL_openlibs(L);
+        lua_gc(L, LUA_GCCOLLECT, 0);
+        collector.initialize(L);
+        lua_gc(L, LUA_GCSTOP, 0);
+        return L;
+    }
+}
+
+GEP_UNITTEST_TEST(Scripting, GarbageCollectionBudget)
+{
+    gep::settings::Scripts settings;
+    settings.garbageCollectionBudgetMs = 1.0f;
+    settings.maxGarbageCollectionBudgetMs = 4.0f;
+    gep::ScriptGarbageCollector collector(&settings);
+    lua_State* L = createState(collector);
+    SCOPE_EXIT{ lua_close(L); });
+
+    const float frameTime = 1.0f / 60.0f;
+    const float baseBytes = float(collector.getBytesUsed());
+    GEP_ASSERT(collector.calculateBudget(frameTime, frameTime) == 1.0f, "no growth should get the configured budget");
+
+    // the budget grows with the memory allocated since the last cycle
+    grow(L, collector, 1.5f);
+    float growth = collector.getBytesUsed() / baseBytes;
+    float budget = collector.calculateBudget(frameTime, frameTime);
+    GEP_ASSERT(fabsf(budget - growth) < 0.01f, "the budget does not follow the growth", budget, growth);
+
+    // a slow frame halves it, as long as the collector is not falling behind
+    float slowFrameBudget = collector.calculateBudget(frameTime * 2.0f, frameTime);
+    GEP_ASSERT(fabsf(slowFrameBudget - growth * 0.5f) < 0.01f, "a slow frame did not halve the budget", slowFrameBudget, growth);
+    GEP_ASSERT(collector.calculateBudget(frameTime * 1.1f, frameTime) == budget, "a slightly slower frame should not change the budget");
+
+    // at half the growth which starts Lua's own collector, slow frames get the full budget
+    grow(L, collector, 2.5f / growth);
+    growth = collector.getBytesUsed() / baseBytes;
+    budget = collector.calculateBudget(frameTime * 2.0f, frameTime);
+    GEP_ASSERT(fabsf(budget - growth) < 0.01f, "a collector which falls behind should keep its budget", budget, growth);
+
+    // but never more than the maximum
+    grow(L, collector, 5.0f / growth);
+    budget = collector.calculateBudget(frameTime, frameTime);
+    GEP_ASSERT(budget == settings.maxGarbageCollectionBudgetMs, "the budget is not clamped", budget);
+
+    // a finished cycle resets the growth
+    collector.collectFully();
+    budget = collector.calculateBudget(frameTime, frameTime);
+    GEP_ASSERT(budget < 1.5f, "the budget did not shrink after a cycle", budget);
+}
+
+GEP_UNITTEST_TEST(Scripting, GarbageCollectionSteps)
+{
+    gep::Timer timer;
+    const float frameTime = 1.0f / 60.0f;
+
+    // incremental steps run until the budget is used up or a cycle finished
+    {
+        gep::settings::Scripts settings;
+        settings.garbageCollectionBudgetMs = 1000.0f;
+        settings.maxGarbageCollectionBudgetMs = 1000.0f;
+        gep::ScriptGarbageCollector collector(&settings);
+        lua_State* L = createState(collector);
+        SCOPE_EXIT{ lua_close(L); });
+
+        grow(L, collector, 3.0f);
+        collector.update(timer, frameTime, frameTime);
+        auto& statistics = collector.getStatistics();
+        GEP_ASSERT(statistics.numCycles == 1, "a large budget should finish the cycle", statistics.numCycles);
+        GEP_ASSERT(statistics.numSteps > 1, "the cycle should take several steps", statistics.numSteps);
+        GEP_ASSERT(statistics.bytesFreed > 0, "the garbage was not freed");
+        GEP_ASSERT(statistics.timeMs < statistics.budgetMs, "the steps ran over the budget", statistics.timeMs, statistics.budgetMs);
+
+        // no budget, no steps
+        settings.garbageCollectionBudgetMs = 0.0f;
+        grow(L, collector, 2.0f);
+        collector.update(timer, frameTime, frameTime);
+        GEP_ASSERT(statistics.numSteps == 0, "steps ran without a budget", statistics.numSteps);
+        GEP_ASSERT(statistics.numCycles == 1, "a cycle finished without a budget", statistics.numCycles);
+    }
+
+    // in generational mode a step is a whole minor collection, only one runs per frame
+    {
+        gep::settings::Scripts settings;
+        settings.garbageCollectionBudgetMs = 1000.0f;
+        settings.maxGarbageCollectionBudgetMs = 1000.0f;
+        settings.generationalGarbageCollection = true;
+        gep::ScriptGarbageCollector collector(&settings);
+        lua_State* L = createState(collector);
+        SCOPE_EXIT{ lua_close(L); });
+
+        for(int frame=0; frame < 10; frame++)
+        {
+            grow(L, collector, 1.5f);
+            collector.update(timer, frameTime, frameTime);
+            auto& statistics = collector.getStatistics();
+            GEP_ASSERT(collector.isGenerational(), "the collector did not switch to generational mode");
+            GEP_ASSERT(statistics.numSteps == 1, "more than one generational step ran in a frame", frame, statistics.numSteps);
+        }
+    }
+}
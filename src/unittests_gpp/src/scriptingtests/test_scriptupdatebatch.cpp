@@ -0,0 +1,220 @@
+#include "stdafx.h"
+#include "Test_Scripting.h"
+#include "benchmarkUtils.h"
+#include "gep/interfaces/scripting.h"
+#include "gpp/scriptUpdateBatch.h"
+#include <vector>
+
+namespace
+{
+    struct UpdatedObject
+    {
+        std::string guid;
+
+        UpdatedObject(const std::string& guid) : guid(guid) {}
+    };
+
+    void pushGuid(lua_State* L, void* pObject)
+    {
+        const std::string& guid = static_cast<UpdatedObject*>(pObject)->guid;
+        lua_pushlstring(L, guid.c_str(), guid.length());
+    }
+
+    void run(lua_State* L, const char* chunk)
+    {
+        GEP_ASSERT(luaL_dostring(L, chunk) == 0, "chunk failed", chunk, lua_tostring(L, -1));
+    }
+
+    bool evaluate(lua_State* L, const char* chunk)
+    {
+        run(L, chunk);
+        bool result = lua_toboolean(L, -1) != 0;
+        lua_pop(L, 1);
+        return result;
+    }
+
+    gpp::ScriptUpdateBatch* createBatch(lua_State* L, const char* functionName, gpp::ScriptUpdateBatch::CallMode::Enum callMode)
+    {
+        lua_getglobal(L, functionName);
+        auto pBatch = new gpp::ScriptUpdateBatch(L, -1, callMode, &pushGuid);
+        lua_pop(L, 1);
+        return pBatch;
+    }
+
+    std::string makeGuid(size_t i)
+    {
+        char guid[32];
+        sprintf_s(guid, "updatedObject%u", (gep::uint32)i);
+        return guid;
+    }
+}
+
+GEP_UNITTEST_TEST(Scripting, ScriptUpdateBatch)
+{
+    lua_State* L = luaL_newstate();
+    SCOPE_EXIT{ lua_close(L); });
+    luaL_openlibs(L);
+    run(L, "calls = {}\n"
+           "function perObject(guid, elapsedTime) calls[#calls + 1] = guid .. ':' .. elapsedTime end\n"
+           "function forAll(objects, numObjects, elapsedTime)\n"
+           "    result = table.concat(objects, ',', 1, numObjects) .. ':' .. elapsedTime\n"
+           "    tableLength = #objects\n"
+           "end\n"
+           "function failing(guid, elapsedTime) error('update of ' .. guid .. ' failed') end\n");
+
+    UpdatedObject a("a"), b("b"), c("c");
+    auto pPerObject = createBatch(L, "perObject", gpp::ScriptUpdateBatch::CallMode::OncePerObject);
+    auto pForAll = createBatch(L, "forAll", gpp::ScriptUpdateBatch::CallMode::OnceForAll);
+    SCOPE_EXIT{ delete pPerObject; delete pForAll; });
+
+    // batches of the same function have the same identity
+    auto pSameFunction = createBatch(L, "perObject", gpp::ScriptUpdateBatch::CallMode::OnceForAll);
+    GEP_ASSERT(pSameFunction->getFunctionIdentity() == pPerObject->getFunctionIdentity(), "the same function has another identity");
+    GEP_ASSERT(pForAll->getFunctionIdentity() != pPerObject->getFunctionIdentity(), "different functions have the same identity");
+    delete pSameFunction;
+
+    // once per object, in the order they were queued
+    pPerObject->queue(&a);
+    pPerObject->queue(&b);
+    pPerObject->queue(&c);
+    pPerObject->call(0.5f);
+    GEP_ASSERT(pPerObject->getNumQueued() == 0, "the queue was not cleared");
+    GEP_ASSERT(pPerObject->getNumObjectsPushed() == 3, "wrong number of objects pushed", pPerObject->getNumObjectsPushed());
+    GEP_ASSERT(evaluate(L, "return #calls == 3 and calls[1] == 'a:0.5' and calls[2] == 'b:0.5' and calls[3] == 'c:0.5'"));
+
+    // the same objects again are not pushed again
+    pPerObject->queue(&a);
+    pPerObject->queue(&b);
+    pPerObject->queue(&c);
+    pPerObject->call(0.25f);
+    GEP_ASSERT(pPerObject->getNumObjectsPushed() == 0, "unchanged objects were pushed", pPerObject->getNumObjectsPushed());
+    GEP_ASSERT(evaluate(L, "return #calls == 6 and calls[4] == 'a:0.25' and calls[6] == 'c:0.25'"));
+
+    // nothing queued, nothing called
+    pPerObject->call(1.0f);
+    GEP_ASSERT(evaluate(L, "return #calls == 6"));
+
+    // once for all, only the changed entries are written and the entries behind the objects are cleared
+    pForAll->queue(&a);
+    pForAll->queue(&b);
+    pForAll->queue(&c);
+    pForAll->call(1.0f);
+    GEP_ASSERT(evaluate(L, "return result == 'a,b,c:1' and tableLength == 3"));
+    pForAll->queue(&a);
+    pForAll->queue(&c);
+    pForAll->call(2.0f);
+    GEP_ASSERT(pForAll->getNumObjectsPushed() == 1, "wrong number of objects pushed", pForAll->getNumObjectsPushed());
+    GEP_ASSERT(evaluate(L, "return result == 'a,c:2' and tableLength == 2"));
+
+    // a forgotten object is pushed again, even if another object at its address takes its place
+    pForAll->queue(&a);
+    pForAll->queue(&c);
+    pForAll->forgetObject(&c);
+    GEP_ASSERT(pForAll->getNumQueued() == 1, "the forgotten object is still queued");
+    pForAll->queue(&c);
+    pForAll->call(3.0f);
+    GEP_ASSERT(pForAll->getNumObjectsPushed() == 1, "the forgotten object was not pushed", pForAll->getNumObjectsPushed());
+    GEP_ASSERT(evaluate(L, "return result == 'a,c:3'"));
+
+    // errors are raised as exceptions with the Lua message and leave a clean stack
+    auto pFailing = createBatch(L, "failing", gpp::ScriptUpdateBatch::CallMode::OncePerObject);
+    SCOPE_EXIT{ delete pFailing; });
+    pFailing->queue(&b);
+    bool raised = false;
+    try
+    {
+        pFailing->call(1.0f);
+    }
+    catch(gep::ScriptExecutionException& ex)
+    {
+        raised = strstr(ex.what(), "update of b failed") != nullptr;
+    }
+    GEP_ASSERT(raised, "the error was not raised");
+    GEP_ASSERT(lua_gettop(L) == 0, "the stack is not clean", lua_gettop(L));
+
+    pPerObject->queue(&b);
+    pPerObject->call(1.0f);
+    GEP_ASSERT(evaluate(L, "return #calls == 7 and calls[7] == 'b:1'"));
+
+    // users are only counted
+    pPerObject->addUser();
+    pPerObject->addUser();
+    pPerObject->removeUser();
+    GEP_ASSERT(pPerObject->getNumUsers() == 1, "wrong number of users", pPerObject->getNumUsers());
+    GEP_ASSERT(lua_gettop(L) == 0, "the stack is not clean", lua_gettop(L));
+}
+
+GEP_UNITTEST_TEST(Scripting, ScriptUpdateBatchPerformance)
+{
+    const size_t numObjects = 1000;
+    const size_t numFrames = 100;
+    const float elapsedTime = 0.016f;
+
+    lua_State* L = luaL_newstate();
+    SCOPE_EXIT{ lua_close(L); });
+    luaL_openlibs(L);
+    // the updates do almost nothing, so the time is what it costs to get into them
+    run(L, "numUpdates = 0\n"
+           "function update(guid, elapsedTime) numUpdates = numUpdates + 1 end\n"
+           "function updateAll(objects, numObjects, elapsedTime)\n"
+           "    for i = 1, numObjects do numUpdates = numUpdates + 1 end\n"
+           "end\n");
+
+    std::vector<UpdatedObject> objects;
+    objects.reserve(numObjects);
+    for(size_t i=0; i < numObjects; i++)
+        objects.push_back(UpdatedObject(makeGuid(i)));
+
+    auto checkUpdates = [&](const char* name){
+        lua_getglobal(L, "numUpdates");
+        const size_t numUpdates = (size_t)lua_tointeger(L, -1);
+        lua_pop(L, 1);
+        GEP_ASSERT(numUpdates == numObjects * numFrames, "wrong number of updates", name, numUpdates);
+        run(L, "numUpdates = 0");
+    };
+
+    // what ScriptComponent did before: one unprotected call per object through IScriptingManager::callFunction,
+    // pushing the function, the guid as a new string and the elapsed time
+    lua_getglobal(L, "update");
+    // FunctionWrapper needs an absolute index, it pushes before reading the function
+    lua::FunctionWrapper updateFunction(L, lua_gettop(L));
+    lua_pop(L, 1);
+    const float singleCallsTime = measureTime([&](){
+        for(size_t frame=0; frame < numFrames; frame++)
+        {
+            for(size_t i=0; i < numObjects; i++)
+            {
+                lua::utils::StackCleaner cleaner(L, 0);
+                updateFunction.push();
+                lua::push(L, objects[i].guid);
+                lua::push(L, elapsedTime);
+                lua_call(L, 2, 0);
+            }
+        }
+    });
+    checkUpdates("single calls");
+
+    auto measureBatch = [&](const char* functionName, gpp::ScriptUpdateBatch::CallMode::Enum callMode) -> float {
+        auto pBatch = createBatch(L, functionName, callMode);
+        SCOPE_EXIT{ delete pBatch; });
+        const float time = measureTime([&](){
+            for(size_t frame=0; frame < numFrames; frame++)
+            {
+                for(size_t i=0; i < numObjects; i++)
+                    pBatch->queue(&objects[i]);
+                pBatch->call(elapsedTime);
+            }
+        });
+        checkUpdates(functionName);
+        return time;
+    };
+    const float perObjectTime = measureBatch("update", gpp::ScriptUpdateBatch::CallMode::OncePerObject);
+    const float forAllTime = measureBatch("updateAll", gpp::ScriptUpdateBatch::CallMode::OnceForAll);
+
+    const float scale = 1e9f / (numObjects * numFrames);
+    log.logMessage("%u frames updating %u objects each, ns per object:\n", (gep::uint32)numFrames, (gep::uint32)numObjects);
+    log.logMessage("    one call per object (before):         %8.1f\n", singleCallsTime * scale);
+    log.logMessage("    batch, setUpdateFunction:             %8.1f (%.2fx)\n", perObjectTime * scale, singleCallsTime / GEP_MAX(perObjectTime, 1e-9f));
+    log.logMessage("    batch, setBatchUpdateFunction:        %8.1f (%.2fx)\n", forAllTime * scale, singleCallsTime / GEP_MAX(forAllTime, 1e-9f));
+    GEP_ASSERT(lua_gettop(L) == 0, "the stack is not clean", lua_gettop(L));
+}
@@ -0,0 +1,141 @@
+#include "stdafx.h"
+#include "Test_Threading.h"
+#include "benchmarkUtils.h"
+#include "gep/threading/parallelFor.h"
+#include <vector>
+#include <cmath>
+
+GEP_UNITTEST_TEST(Threading, ParallelFor)
+{
+    gep::TaskQueue queue(4);
+
+    // every element is visited exactly once, for sizes around the chunk boundaries
+    const size_t sizes[] = { 0, 1, 2, 7, 64, 1000, 12345 };
+    const size_t grainSizes[] = { 1, 3, 64, 100000 };
+    for(size_t size : sizes)
+    {
+        for(size_t grainSize : grainSizes)
+        {
+            std::vector<LONG> timesVisited(size + 10, 0);
+            gep::parallelFor(queue, 5, 5 + size, grainSize, [&](size_t i){
+                InterlockedIncrement(&timesVisited[i]);
+            });
+            for(size_t i=0; i < timesVisited.size(); i++)
+            {
+                LONG expected = (i >= 5 && i < 5 + size) ? 1 : 0;
+                GEP_ASSERT(timesVisited[i] == expected, "element visited wrong number of times", size, grainSize, i, timesVisited[i]);
+            }
+
+            volatile LONG numElements = 0;
+            gep::parallelForRange(queue, 0, size, grainSize, [&](size_t begin, size_t end){
+                GEP_ASSERT(end > begin && (end - begin >= grainSize || end == size), "chunk is too small", begin, end, grainSize);
+                InterlockedExchangeAdd(&numElements, (LONG)(end - begin));
+            });
+            GEP_ASSERT(numElements == (LONG)size, "wrong number of elements", numElements, size);
+        }
+    }
+
+    // reduce with a combine function which is not commutative, the order of the elements has to be kept
+    for(size_t size : sizes)
+    {
+        std::string expected;
+        for(size_t i=0; i < size; i++)
+            expected += (char)('a' + i % 26);
+        std::string result = gep::parallelReduce(queue, 0, size, 16, std::string(),
+            [](size_t i){ return std::string(1, (char)('a' + i % 26)); },
+            [](const std::string& lhs, const std::string& rhs){ return lhs + rhs; });
+        GEP_ASSERT(result == expected, "parallelReduce did not keep the order", size);
+    }
+
+    // nested loops, the worker running the outer iteration helps with the inner loop
+    volatile LONG numInnerIterations = 0;
+    gep::parallelFor(queue, 0, 32, 1, [&](size_t){
+        gep::parallelFor(queue, 0, 100, 4, [&](size_t){
+            InterlockedIncrement(&numInnerIterations);
+        });
+    });
+    GEP_ASSERT(numInnerIterations == 32 * 100, "nested loop lost iterations", numInnerIterations);
+
+    // loops started at the same time by threads which are no workers, like the game thread and the resource loaders
+    const size_t numOutsideThreads = 4;
+    volatile LONG numOutsideIterations = 0;
+    runOnThreads(numOutsideThreads, [&](size_t){
+        for(int run=0; run < 100; run++)
+        {
+            gep::parallelFor(queue, 0, 1000, 8, [&](size_t){
+                InterlockedIncrement(&numOutsideIterations);
+            });
+        }
+    });
+    GEP_ASSERT(numOutsideIterations == numOutsideThreads * 100 * 1000, "loops of outside threads lost iterations", numOutsideIterations);
+
+    // short lived threads one after another, the workers of exited threads are reused
+    volatile LONG numShortLivedIterations = 0;
+    for(int round=0; round < 20; round++)
+    {
+        runOnThreads(numOutsideThreads, [&](size_t){
+            gep::parallelFor(queue, 0, 100, 8, [&](size_t){
+                InterlockedIncrement(&numShortLivedIterations);
+            });
+        });
+    }
+    GEP_ASSERT(numShortLivedIterations == 20 * numOutsideThreads * 100, "loops of short lived threads lost iterations", numShortLivedIterations);
+}
+
+GEP_UNITTEST_TEST(Threading, ParallelForPerformance)
+{
+    gep::TaskQueue queue;
+    const size_t maxNumElements = 10000000;
+    std::vector<float> input(maxNumElements);
+    std::vector<float> output(maxNumElements);
+    for(size_t i=0; i < maxNumElements; i++)
+        input[i] = (float)(i % 1000) * 0.01f;
+
+    log.logMessage("    %u workers\n", (unsigned int)queue.getNumWorkers());
+    log.logMessage("    elements | for: serial ms | parallel ms | speedup | reduce: serial ms | parallel ms | speedup\n");
+    for(size_t numElements = 1000; numElements <= maxNumElements; numElements *= 10)
+    {
+        // repeat small sizes, so the times are measurable
+        const size_t numRepetitions = maxNumElements / numElements;
+        auto transform = [&](size_t i){ output[i] = sqrtf(input[i]) * 2.0f + 1.0f; };
+        auto square = [&](size_t i){ return (double)input[i] * input[i]; };
+        auto add = [](double lhs, double rhs){ return lhs + rhs; };
+
+        float serialForTime = measureTime([&](){
+            for(size_t repetition=0; repetition < numRepetitions; repetition++)
+                for(size_t i=0; i < numElements; i++)
+                    transform(i);
+        });
+        float parallelForTime = measureTime([&](){
+            for(size_t repetition=0; repetition < numRepetitions; repetition++)
+                gep::parallelFor(queue, 0, numElements, 256, transform);
+        });
+
+        volatile double serialSum = 0.0;
+        float serialReduceTime = measureTime([&](){
+            for(size_t repetition=0; repetition < numRepetitions; repetition++)
+            {
+                double sum = 0.0;
+                for(size_t i=0; i < numElements; i++)
+                    sum = add(sum, square(i));
+                serialSum = sum;
+            }
+        });
+        volatile double parallelSum = 0.0;
+        float parallelReduceTime = measureTime([&](){
+            for(size_t repetition=0; repetition < numRepetitions; repetition++)
+                parallelSum = gep::parallelReduce(queue, 0, numElements, 256, 0.0, square, add);
+        });
+        GEP_ASSERT(fabs(serialSum - parallelSum) <= 1e-9 * serialSum, "parallelReduce computed a different result", serialSum, parallelSum);
+
+        const float toMilliseconds = 1000.0f / numRepetitions;
+        log.logMessage("    %8u | %14.4f | %11.4f | %6.2fx | %17.4f | %11.4f | %6.2fx\n",
+            (unsigned int)numElements,
+            serialForTime * toMilliseconds,
+            parallelForTime * toMilliseconds,
+            serialForTime / parallelForTime,
+            serialReduceTime * toMilliseconds,
+            parallelReduceTime * toMilliseconds,
+            serialReduceTime / parallelReduceTime);
+    }
+}
@@ -0,0 +1,375 @@
+#include "stdafx.h"
+#include "Test_Threading.h"
+#include "benchmarkUtils.h"
+#include "gep/threading/taskQueue.h"
+#include "gep/threading/workStealingDeque.h"
+#include <vector>
+
+namespace
+{
+    // task which burns a fixed number of loop iterations
+    class BusyTask : public gep::ITask
+    {
+        size_t m_numIterations;
+    public:
+        volatile size_t result;
+
+        BusyTask() : m_numIterations(0), result(0) {}
+        void setNumIterations(size_t numIterations) { m_numIterations = numIterations; }
+        size_t getNumIterations() const { return m_numIterations; }
+
+        virtual void execute() override
+        {
+            size_t value = 0;
+            for(size_t i=0; i < m_numIterations; i++)
+                value = value * 31 + i + 1;
+            result = value;
+        }
+    };
+
+    // task which records when it was executed
+    class OrderTask : public gep::ITask
+    {
+    public:
+        volatile LONG* pCounter;
+        volatile LONG executionIndex;
+
+        virtual void execute() override
+        {
+            executionIndex = InterlockedIncrement(pCounter);
+        }
+    };
+
+    // returns how many BusyTask iterations take the given amount of seconds
+    size_t calibrateIterations(float seconds)
+    {
+        const size_t numCalibrationIterations = 10000000;
+        BusyTask task;
+        task.setNumIterations(numCalibrationIterations);
+        float time = measureTime([&](){ task.execute(); });
+        size_t result = (size_t)(numCalibrationIterations * (seconds / time));
+        return result > 0 ? result : 1;
+    }
+
+    // runs a group of tasks on the queue and waits until all of them are finished, returns the time in seconds
+    float runGroup(gep::TaskQueue& queue, std::vector<BusyTask>& tasks)
+    {
+        gep::TaskGroup* pGroup = queue.createGroup();
+        for(auto& task : tasks)
+            pGroup->addTask(&task);
+
+        float time = measureTime([&](){
+            queue.scheduleForExecution(pGroup);
+            queue.waitForGroup(pGroup);
+        });
+        queue.deleteGroup(pGroup);
+        return time;
+    }
+}
+
+GEP_UNITTEST_TEST(Threading, WorkStealingDeque)
+{
+    // single threaded: LIFO for the owner, FIFO for thieves, growing past the initial capacity
+    {
+        gep::WorkStealingDeque<size_t*> deque(nullptr, 4);
+        size_t values[100];
+        GEP_ASSERT(deque.isEmpty());
+        GEP_ASSERT(deque.pop() == nullptr);
+        GEP_ASSERT(deque.steal() == nullptr);
+        for(size_t i=0; i < GEP_ARRAY_SIZE(values); i++)
+            deque.push(&values[i]);
+        GEP_ASSERT(deque.count() == GEP_ARRAY_SIZE(values));
+        GEP_ASSERT(deque.steal() == &values[0]);
+        GEP_ASSERT(deque.pop() == &values[99]);
+        GEP_ASSERT(deque.steal() == &values[1]);
+        for(size_t i=98; i >= 2; i--)
+            GEP_ASSERT(deque.pop() == &values[i], "wrong element popped", i);
+        GEP_ASSERT(deque.isEmpty());
+        GEP_ASSERT(deque.pop() == nullptr);
+    }
+
+    // the owner pushes and pops while the thieves steal, every element has to be taken exactly once
+    {
+        const size_t numElements = 200000;
+        const size_t numThieves = 3;
+        gep::WorkStealingDeque<volatile LONG*> deque(nullptr, 16);
+        std::vector<LONG> timesTaken(numElements, 0);
+        volatile LONG numTaken = 0;
+
+        runOnThreads(numThieves + 1, [&](size_t threadIndex){
+            if(threadIndex == 0)
+            {
+                for(size_t i=0; i < numElements; i++)
+                {
+                    deque.push(&timesTaken[i]);
+                    if(i % 3 == 0)
+                    {
+                        auto pElement = deque.pop();
+                        if(pElement != nullptr)
+                        {
+                            InterlockedIncrement(pElement);
+                            InterlockedIncrement(&numTaken);
+                        }
+                    }
+                }
+                while(auto pElement = deque.pop())
+                {
+                    InterlockedIncrement(pElement);
+                    InterlockedIncrement(&numTaken);
+                }
+            }
+            else
+            {
+                while(numTaken < (LONG)numElements)
+                {
+                    auto pElement = deque.steal();
+                    if(pElement != nullptr)
+                    {
+                        InterlockedIncrement(pElement);
+                        InterlockedIncrement(&numTaken);
+                    }
+                }
+            }
+        });
+
+        GEP_ASSERT(numTaken == (LONG)numElements, "elements got lost or were taken twice", numTaken);
+        for(size_t i=0; i < numElements; i++)
+            GEP_ASSERT(timesTaken[i] == 1, "element was not taken exactly once", i, timesTaken[i]);
+    }
+}
+
+GEP_UNITTEST_TEST(Threading, TaskQueue)
+{
+    gep::TaskQueue queue(4);
+    queue.attachLocalWorker();
+    std::vector<BusyTask> tasks(1000);
+    for(size_t i=0; i < tasks.size(); i++)
+        tasks[i].setNumIterations(i % 100 + 1);
+
+    // the same group is executed multiple times, every task has to run each time
+    for(int run=0; run < 10; run++)
+    {
+        for(auto& task : tasks)
+            task.result = 0;
+        runGroup(queue, tasks);
+        for(size_t i=0; i < tasks.size(); i++)
+            GEP_ASSERT(tasks[i].result != 0, "task was not executed", i, run);
+    }
+
+    // every task is counted by exactly one worker
+    GEP_ASSERT(queue.getNumWorkers() == 4);
+    gep::uint64 numTasksExecuted = 0;
+    for(size_t i=0; i < queue.getNumWorkers(); i++)
+        numTasksExecuted += queue.getWorkerStatistics(i).numTasksExecuted;
+    GEP_ASSERT(numTasksExecuted == 10 * tasks.size(), "wrong number of executed tasks", numTasksExecuted);
+}
+
+GEP_UNITTEST_TEST(Threading, TaskQueueThroughput)
+{
+    struct TaskSize
+    {
+        const char* name;
+        float seconds;
+        size_t numTasks;
+    };
+    const TaskSize taskSizes[] = {
+        { "100ns", 100e-9f, 200000 },
+        { "10us",  10e-6f,   20000 }
+    };
+    const size_t workerCounts[] = { 1, 2, 4, 8, 16 };
+
+    for(auto& taskSize : taskSizes)
+    {
+        std::vector<BusyTask> tasks(taskSize.numTasks);
+        size_t numIterations = calibrateIterations(taskSize.seconds);
+        for(auto& task : tasks)
+            task.setNumIterations(numIterations);
+
+        log.logMessage("    %s tasks\n", taskSize.name);
+        log.logMessage("    workers |      tasks/s | speedup |   steals |  parks | busy %% | spin %%\n");
+        float singleWorkerTime = 0.0f;
+        for(size_t workerCount : workerCounts)
+        {
+            gep::TaskQueue queue(workerCount);
+            queue.attachLocalWorker();
+            // warm up, so the workers and their deques are ready
+            runGroup(queue, tasks);
+            float time = runGroup(queue, tasks);
+            if(workerCount == 1)
+                singleWorkerTime = time;
+
+            gep::TaskWorkerStatistics total = {};
+            for(size_t i=0; i < queue.getNumWorkers(); i++)
+            {
+                auto statistics = queue.getWorkerStatistics(i);
+                total.numTasksStolen += statistics.numTasksStolen;
+                total.numParks += statistics.numParks;
+                total.busyTime += statistics.busyTime;
+                total.spinTime += statistics.spinTime;
+                total.idleTime += statistics.idleTime;
+            }
+            // the local worker only helps out in waitForGroup, which is not timed
+            float totalTime = GEP_MAX(total.busyTime + total.spinTime + total.idleTime, 1e-6f);
+            log.logMessage("    %7u | %12.0f | %6.2fx | %8u | %6u | %6.1f | %6.1f\n",
+                (unsigned int)workerCount,
+                taskSize.numTasks / time,
+                singleWorkerTime / time,
+                (unsigned int)total.numTasksStolen,
+                (unsigned int)total.numParks,
+                100.0f * total.busyTime / totalTime,
+                100.0f * total.spinTime / totalTime);
+        }
+    }
+}
+
+GEP_UNITTEST_TEST(Threading, TaskGraph)
+{
+    gep::TaskQueue queue(4);
+    volatile LONG counter = 0;
+
+    // diamond: a -> (b, c) -> d, with multiple tasks per group
+    const size_t numTasksPerGroup = 50;
+    OrderTask tasks[4][numTasksPerGroup];
+    gep::TaskGroup* groups[4];
+    for(size_t i=0; i < 4; i++)
+    {
+        groups[i] = queue.createGroup();
+        for(auto& task : tasks[i])
+        {
+            task.pCounter = &counter;
+            groups[i]->addTask(&task);
+        }
+    }
+    groups[1]->addDependency(groups[0]);
+    groups[2]->addDependency(groups[0]);
+    groups[3]->addDependency(groups[1]);
+    groups[3]->addDependency(groups[2]);
+
+    for(int run=0; run < 10; run++)
+    {
+        // schedule in reverse order, the dependencies decide the execution order
+        for(size_t i=4; i > 0; i--)
+            queue.scheduleForExecution(groups[i - 1]);
+        queue.waitForGroup(groups[3]);
+        for(size_t i=0; i < 4; i++)
+            GEP_ASSERT(!groups[i]->isExecuting(), "group did not finish", i, run);
+
+        LONG minIndex[4];
+        LONG maxIndex[4];
+        for(size_t i=0; i < 4; i++)
+        {
+            minIndex[i] = maxIndex[i] = tasks[i][0].executionIndex;
+            for(auto& task : tasks[i])
+            {
+                maxIndex[i] = GEP_MAX(maxIndex[i], task.executionIndex);
+                minIndex[i] = GEP_MIN(minIndex[i], task.executionIndex);
+            }
+        }
+        GEP_ASSERT(minIndex[1] > maxIndex[0] && minIndex[2] > maxIndex[0], "dependency was not respected", run);
+        GEP_ASSERT(minIndex[3] > maxIndex[1] && minIndex[3] > maxIndex[2], "dependency was not respected", run);
+    }
+    GEP_ASSERT(counter == 10 * 4 * numTasksPerGroup, "wrong number of tasks executed", counter);
+
+    // deleting a group removes it from the dependencies of other groups
+    queue.deleteGroup(groups[1]);
+    queue.deleteGroup(groups[2]);
+    queue.scheduleForExecution(groups[0]);
+    queue.scheduleForExecution(groups[3]);
+    queue.waitForGroup(groups[0]);
+    queue.waitForGroup(groups[3]);
+    GEP_ASSERT(counter == 10 * 4 * numTasksPerGroup + 2 * numTasksPerGroup, "wrong number of tasks executed", counter);
+    queue.deleteGroup(groups[0]);
+    queue.deleteGroup(groups[3]);
+}
+
+GEP_UNITTEST_TEST(Threading, TaskGraphCriticalPath)
+{
+    // Synthetic frame of 20 stages: 4 independent chains of 4 stages each, the last stage of
+    // every chain feeds into a join chain of the remaining 4 stages. The stages have an uneven number of tasks with
+    // an uneven duration, so running them one after another leaves cores idle at the tail of each stage.
+    const size_t numStages = 20;
+    const size_t numChains = 4;
+    const size_t chainLength = 4;
+    const size_t taskIterations = calibrateIterations(20e-6f);
+    const size_t workerCounts[] = { 1, 2, 4, 8 };
+
+    std::vector<std::vector<BusyTask>> stageTasks(numStages);
+    for(size_t stage=0; stage < numStages; stage++)
+    {
+        stageTasks[stage].resize(3 + (stage * 7) % 13);
+        for(size_t i=0; i < stageTasks[stage].size(); i++)
+            stageTasks[stage][i].setNumIterations(taskIterations * (1 + (stage + i) % 4));
+    }
+
+    // critical path with unlimited workers, in units of the shortest task
+    size_t longestTask[numStages];
+    for(size_t stage=0; stage < numStages; stage++)
+    {
+        longestTask[stage] = 0;
+        for(auto& task : stageTasks[stage])
+            longestTask[stage] = GEP_MAX(longestTask[stage], task.getNumIterations() / taskIterations);
+    }
+    size_t sequentialPath = 0;
+    for(size_t stage=0; stage < numStages; stage++)
+        sequentialPath += longestTask[stage];
+    size_t graphPath = 0;
+    for(size_t chain=0; chain < numChains; chain++)
+    {
+        size_t chainPath = 0;
+        for(size_t i=0; i < chainLength; i++)
+            chainPath += longestTask[chain * chainLength + i];
+        graphPath = GEP_MAX(graphPath, chainPath);
+    }
+    for(size_t stage=numChains * chainLength; stage < numStages; stage++)
+        graphPath += longestTask[stage];
+    log.logMessage("    critical path with unlimited workers: sequential %u, graph %u tasks\n",
+        (unsigned int)sequentialPath, (unsigned int)graphPath);
+
+    log.logMessage("    workers | sequential groups ms | task graph ms | critical path reduction\n");
+    for(size_t workerCount : workerCounts)
+    {
+        gep::TaskQueue queue(workerCount);
+        gep::TaskGroup* groups[numStages];
+        for(size_t stage=0; stage < numStages; stage++)
+        {
+            groups[stage] = queue.createGroup();
+            for(auto& task : stageTasks[stage])
+                groups[stage]->addTask(&task);
+        }
+
+        // old behaviour: every stage waits for the previous one
+        for(size_t stage=1; stage < numStages; stage++)
+            groups[stage]->addDependency(groups[stage - 1]);
+        auto runFrame = [&](){
+            for(size_t stage=0; stage < numStages; stage++)
+                queue.scheduleForExecution(groups[stage]);
+            for(size_t stage=0; stage < numStages; stage++)
+                queue.waitForGroup(groups[stage]);
+        };
+        runFrame();
+        float sequentialTime = measureTime(runFrame);
+
+        // graph: chains of stages which only depend on their predecessor in the chain
+        for(size_t stage=1; stage < numStages; stage++)
+            groups[stage]->removeDependency(groups[stage - 1]);
+        for(size_t chain=0; chain < numChains; chain++)
+        {
+            for(size_t i=1; i < chainLength; i++)
+                groups[chain * chainLength + i]->addDependency(groups[chain * chainLength + i - 1]);
+            groups[numChains * chainLength]->addDependency(groups[chain * chainLength + chainLength - 1]);
+        }
+        for(size_t stage=numChains * chainLength + 1; stage < numStages; stage++)
+            groups[stage]->addDependency(groups[stage - 1]);
+        runFrame();
+        float graphTime = measureTime(runFrame);
+
+        for(size_t stage=0; stage < numStages; stage++)
+            queue.deleteGroup(groups[stage]);
+
+        log.logMessage("    %7u | %20.3f | %13.3f | %6.2fx\n",
+            (unsigned int)workerCount,
+            sequentialTime * 1000.0f,
+            graphTime * 1000.0f,
+            sequentialTime / graphTime);
+    }
+}